@@ -5,6 +5,8 @@
 #include <dbus-c++/message.h>
 
 #include <chrono>
+#include <map>
+#include <vector>
 #include "log.h"
 
 namespace NXE {
@@ -104,6 +106,18 @@ namespace __details {
         call("set_attr", proxy, attrName, val);
     }
 
+    // Fetches several attributes with one get_attrs round trip. Names may be
+    // paths like "route.destination_length", attributes navit has no value
+    // for are missing from the result.
+    inline std::map<std::string, ::DBus::Variant> getAttrs(const std::vector<std::string>& attrNames, ::DBus::InterfaceProxy& proxy)
+    {
+        ::DBus::Message ret = call("get_attrs", proxy, attrNames);
+        std::map<std::string, ::DBus::Variant> values;
+        ::DBus::MessageIter retIter = ret.reader();
+        retIter >> values;
+        return values;
+    }
+
     template<typename T>
     T getFromIter(::DBus::MessageIter iter)
     {
@@ -1,6 +1,8 @@
 #include "gpsdprovider.h"
+#include "positionfusion.h"
 #include "log.h"
 
+#include <atomic>
 #include <thread>
 #include <gps.h>
 #include <libgpsmm.h>
@@ -13,7 +15,12 @@ const std::int32_t gpsTimeout = 50000;
 namespace NXE {
 
 struct GPSDProviderPrivate {
+    GPSDProviderPrivate(std::shared_ptr<IMotionSource> motion)
+        : fusion(motion)
+    {
+    }
 
+    // Only reads gpsd and hands the fix over, the fusion stage does the rest on its own thread
     void threadRoutine()
     {
         gps_open("localhost", DEFAULT_GPSD_PORT, &gps_data);
@@ -28,29 +35,28 @@ struct GPSDProviderPrivate {
             while (m_bThreadRunning) {
                 if (gps_waiting(&gps_data, 5000)) {
                     if (gps_read(&gps_data) != -1) {
-                        m_currentPosition.altitude = gps_data.fix.altitude;
-                        m_currentPosition.longitude = gps_data.fix.longitude;
-                        m_currentPosition.latitude = gps_data.fix.latitude;
-                        std::for_each(callbacks.begin(), callbacks.end(), [this](const GPSDProvider::PositionUpdateCb& cb) {
-                            if(cb) {
-                                cb(m_currentPosition);
-                            }
-                        });
+                        Position fix;
+                        fix.altitude = gps_data.fix.altitude;
+                        fix.longitude = gps_data.fix.longitude;
+                        fix.latitude = gps_data.fix.latitude;
+                        fix.speed = gps_data.fix.speed;
+                        fix.heading = gps_data.fix.track;
+                        fusion.publishFix(fix);
                     }
                 }
             }
+            gps_close(&gps_data);
         }
     }
 
+    PositionFusion fusion;
     std::thread m_gpsdThread;
-    bool m_bThreadRunning{ true };
-    Position m_currentPosition;
+    std::atomic<bool> m_bThreadRunning{ true };
     gps_data_t gps_data;
-    std::vector<GPSDProvider::PositionUpdateCb> callbacks;
 };
 
-GPSDProvider::GPSDProvider()
-    : d(new GPSDProviderPrivate)
+GPSDProvider::GPSDProvider(std::shared_ptr<IMotionSource> motion)
+    : d(new GPSDProviderPrivate{ motion })
 {
     nTrace() << "GPSDProvider::GPSDProvider()";
     d->m_gpsdThread = std::thread{ std::bind(&GPSDProviderPrivate::threadRoutine, d.get()) };
@@ -65,12 +71,17 @@ GPSDProvider::~GPSDProvider()
 
 Position GPSDProvider::position() const
 {
-    return d->m_currentPosition;
+    return d->fusion.position();
 }
 
 void GPSDProvider::addPostionUpdate(const IGPSProvider::PositionUpdateCb &position)
 {
-    d->callbacks.push_back(position);
+    d->fusion.subscribe(position);
+}
+
+PositionFusion::Statistics GPSDProvider::statistics() const
+{
+    return d->fusion.statistics();
 }
 
 } // namespace NXE
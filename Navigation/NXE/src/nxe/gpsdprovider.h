@@ -2,19 +2,25 @@
 #define NXE_GPSDPROVIDER_H
 
 #include "igpsprovider.h"
+#include "positionfusion.h"
 #include <memory>
 
 namespace NXE {
+class IMotionSource;
 
 struct GPSDProviderPrivate;
 class GPSDProvider : public IGPSProvider {
 public:
-    GPSDProvider();
+    // motion is optional, with it positions are dead reckoned between fixes
+    GPSDProvider(std::shared_ptr<IMotionSource> motion = std::shared_ptr<IMotionSource>());
     ~GPSDProvider();
 
     virtual Position position() const override;
+    // Callbacks run on a thread of their own, a slow one only loses positions
     virtual void addPostionUpdate(const PositionUpdateCb& position) override;
 
+    PositionFusion::Statistics statistics() const;
+
 private:
     std::unique_ptr<GPSDProviderPrivate> d;
 };
@@ -0,0 +1,27 @@
+#ifndef IMOTIONSOURCE_H
+#define IMOTIONSOURCE_H
+
+#include <limits>
+
+namespace NXE {
+
+struct MotionSample {
+    // wheel speed in m/s
+    double speed{ std::numeric_limits<double>::quiet_NaN() };
+    // yaw rate in degrees per second, clockwise like Position::heading
+    double yawRate{ std::numeric_limits<double>::quiet_NaN() };
+};
+
+// Vehicle odometry (e.g. CAN wheel speed and yaw rate) used to dead reckon
+// between GPS fixes
+class IMotionSource {
+public:
+    virtual ~IMotionSource() {}
+
+    // Returns false if there is no recent sample, must not block
+    virtual bool sample(MotionSample& sample) const = 0;
+};
+
+} // NXE
+
+#endif // IMOTIONSOURCE_H
@@ -5,6 +5,7 @@
 #include <boost/signals2/signal.hpp>
 #include <map>
 #include "position.h"
+#include "ispeech.h"
 
 namespace NXE {
 
@@ -53,6 +54,56 @@ struct PointClicked {
     const ItemArrayType items;
 };
 
+struct ReverseGeocodeResult {
+    std::string street;
+    std::string houseNumber;
+    std::string town;
+    std::string postal;
+    // distance to the street in meters, -1 if there is no street nearby
+    std::int32_t distance{ -1 };
+};
+
+typedef std::vector<ReverseGeocodeResult> ReverseGeocodeResults;
+
+struct PoiQuery {
+    Position center;
+    // maximum distance from the center in meters
+    std::int32_t distance{ 0 };
+    // navit item types like "poi_fuel", all POIs if empty
+    std::vector<std::string> categories;
+    // number of nearest POIs to skip, to start at a later page
+    std::size_t offset{ 0 };
+    // maximum number of POIs, 0 for all within distance
+    std::size_t limit{ 0 };
+    // POIs per poiResultsResponse() signal
+    std::size_t chunkSize{ 50 };
+};
+
+struct PoiResult {
+    std::string type;
+    std::string label;
+    std::string address;
+    Position position;
+    // distance from the center of the search in meters
+    std::int32_t distance{ -1 };
+    // distance from the current position in meters, -1 if unknown
+    std::int32_t currentPositionDistance{ -1 };
+};
+
+typedef std::vector<PoiResult> PoiResults;
+
+struct NavigationState {
+    // false once navigation ended, the other members are not set then
+    bool active{ false };
+    // to the destination, in meters and 1/10 seconds
+    std::int32_t distance{ -1 };
+    std::int32_t eta{ -1 };
+    // navit item type of the next maneuver like "nav_right_2" and the distance to it in meters
+    std::string maneuver;
+    std::int32_t maneuverDistance{ -1 };
+    std::string street;
+};
+
 class INavitIPC {
 public:
 
@@ -63,7 +114,7 @@ public:
         Address
     };
 
-    typedef boost::signals2::signal<void(std::string)> SpeechSignalType;
+    typedef boost::signals2::signal<void(std::string, ISpeech::Priority)> SpeechSignalType;
     typedef boost::signals2::signal<void(std::string)> RoutingSignalType;
     typedef boost::signals2::signal<void(const PointClicked&)> PointClickedSignalType;
     typedef boost::signals2::signal<void()> InitializedSignalType;
@@ -76,6 +127,11 @@ public:
     typedef boost::signals2::signal<void(SearchResults, SearchType)> SearchResultsSignalType;
     typedef boost::signals2::signal<void(std::string)> StringSignalType;
     typedef boost::signals2::signal<void(std::pair<std::int32_t, std::int32_t>)> PossibleTrackSignalType;
+    typedef boost::signals2::signal<void(ReverseGeocodeResults)> ReverseGeocodeSignalType;
+    // POIs nearest first, the flag is set on the last chunk of a search
+    typedef boost::signals2::signal<void(PoiResults, bool)> PoiResultsSignalType;
+    // pushed by navit whenever the state changes while navigating
+    typedef boost::signals2::signal<void(const NavigationState&)> NavigationStateSignalType;
 
     virtual ~INavitIPC() {}
 
@@ -99,6 +155,7 @@ public:
     virtual void clearDestination() = 0;
     virtual void addWaypoint(double longitude, double latitude) = 0;
     virtual void searchPOIs(double longitude, double latitude, int distance) = 0;
+    virtual void searchPOIs(const PoiQuery& query) = 0;
     virtual void setPitch(std::uint16_t newPitchValue) = 0;
 
     virtual void setScheme(const std::string& scheme) = 0;
@@ -113,10 +170,12 @@ public:
     virtual void distance() = 0;
     virtual void eta() = 0;
     virtual void currentStreet() = 0;
+    virtual void navigationInfo() = 0;
     virtual void zoomToRoute() = 0;
     virtual void addMapMarker(double longitude, double latitude) = 0;
     virtual void clearMapMarker() = 0;
     virtual void possibleTrackInformation(const NXE::Position& from, const NXE::Position& to) = 0;
+    virtual void reverseGeocode(const std::vector<NXE::Position>& positions) = 0;
 
     // DBus responses
     virtual IntSignalType& orientationResponse() = 0;
@@ -128,6 +187,8 @@ public:
     virtual IntSignalType& etaResponse() = 0;
     virtual BoolSignalType& navigationChanged() = 0;
     virtual StringSignalType& currentStreetResponse() = 0;
+    virtual ReverseGeocodeSignalType& reverseGeocodeResponse() = 0;
+    virtual PoiResultsSignalType& poiResultsResponse() = 0;
 
 
     // Signals from IPC
@@ -137,6 +198,7 @@ public:
     virtual InitializedSignalType& initializedSignal() = 0;
     virtual RoutingSignalType& routingSignal() = 0;
     virtual PossibleTrackSignalType& possibleTrackInfoSignal() = 0;
+    virtual NavigationStateSignalType& navigationStateSignal() = 0;
 };
 
 
@@ -7,11 +7,16 @@ namespace NXE {
 
 class ISpeech {
 public:
+    // Values match navit's enum speech_priority
+    enum class Priority {
+        Information = 0,
+        Maneuver = 1
+    };
+
     virtual ~ISpeech() {}
-    virtual void say(const std::string& command) = 0;
+    virtual void say(const std::string& command, Priority priority) = 0;
 };
 
 }
 
 #endif // ISPEECH_H
-
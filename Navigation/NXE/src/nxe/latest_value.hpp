@@ -0,0 +1,61 @@
+#ifndef LATEST_VALUE_HPP
+#define LATEST_VALUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Holds the latest value written by a single writer (seqlock). store() never waits,
+// load() retries while a store is in progress and never blocks the writer.
+// Data has to be trivially copyable.
+template <typename Data>
+class latest_value {
+private:
+    static const std::size_t words = (sizeof(Data) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    std::atomic<std::uint32_t> _sequence{ 0 };
+    std::atomic<std::uint64_t> _data[words];
+
+public:
+    latest_value()
+    {
+        for (std::size_t i = 0; i < words; ++i) {
+            _data[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void store(const Data& value)
+    {
+        std::uint64_t buffer[words] = {};
+        std::memcpy(buffer, &value, sizeof(Data));
+
+        const std::uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < words; ++i) {
+            _data[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Returns the number of stores so far, 0 means value was not set
+    std::uint32_t load(Data& value) const
+    {
+        std::uint64_t buffer[words];
+        std::uint32_t before, after;
+        do {
+            before = _sequence.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < words; ++i) {
+                buffer[i] = _data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        if (before) {
+            std::memcpy(&value, buffer, sizeof(Data));
+        }
+        return before / 2;
+    }
+};
+
+#endif // LATEST_VALUE_HPP
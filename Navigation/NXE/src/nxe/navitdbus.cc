@@ -20,6 +20,7 @@ const std::string navitDBusPath = "/org/navit_project/navit/navit/0";
 const std::string navitDBusInterface = "org.navit_project.navit.navit";
 const std::string rootNavitDBusInterface = "org.navit_project.navit";
 const std::string searchNavitDBusInterface = "org.navit_project.navit.search_list";
+const std::string poiSearchNavitDBusInterface = "org.navit_project.navit.poi_search";
 
 const std::string routeNavitDBusPath = "/org/navit_project/navit/default_navit/default_route";
 const std::string routeNavitDBusInterface = "org.navit_project.navit.route";
@@ -73,10 +74,13 @@ struct DBusQueuedMessage {
         Distance,
         Eta,
         CurrentStreet,
+        NavigationInfo,
         ZoomToRoute,
         AddMapMarker,
         ClearMapMarker,
-        PossibleTrackInfo
+        PossibleTrackInfo,
+        ReverseGeocode,
+        PoiSearch
     } type;
     typedef boost::variant<int,
         std::string,
@@ -86,6 +90,8 @@ struct DBusQueuedMessage {
         std::uint16_t, // for pitch
         std::pair<NXE::INavitIPC::SearchType, std::string>, // for search
         std::pair<NXE::INavitIPC::SearchType, std::int32_t>, // for select search
+        std::vector<DBus::Struct<double, double> >, // for reverse geocode
+        NXE::PoiQuery, // for poi search
         bool> VariantType;
     VariantType value;
 };
@@ -142,10 +148,13 @@ inline std::ostream& operator<<(std::ostream& os, DBusQueuedMessage::Type t)
         ENUM(Distance),
         ENUM(Eta),
         ENUM(CurrentStreet),
+        ENUM(NavigationInfo),
         ENUM(ZoomToRoute),
         ENUM(AddMapMarker),
         ENUM(ClearMapMarker),
-        ENUM(PossibleTrackInfo)
+        ENUM(PossibleTrackInfo),
+        ENUM(ReverseGeocode),
+        ENUM(PoiSearch)
     };
     os << mapped.at(t);
     return os;
@@ -189,6 +198,15 @@ struct NavitDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Obje
 
         }) != res.end();
 
+        bool isNavigationState = std::find_if(res.begin(), res.end(), [](const std::pair<std::string, DBus::Variant>& val) -> bool {
+            if (val.first == "type") {
+                const std::string strVal = DBusHelpers::getFromIter<std::string>(val.second.reader());
+                return strVal == "navigation_state";
+            }
+            return false;
+
+        }) != res.end();
+
         bool isPointClicked = std::find_if(res.begin(), res.end(), [](const std::pair<std::string, ::DBus::Variant>& val) -> bool {
             return val.first == "click_coord_geo";
         }) != res.end();
@@ -207,10 +225,19 @@ struct NavitDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Obje
                 return val.first == "data";
             });
 
+            // navit versions without a speech queue don't send a priority, they only announce maneuvers
+            auto priorityIter = std::find_if(res.begin(), res.end(), [](const std::pair<std::string, ::DBus::Variant>& val) -> bool {
+                return val.first == "priority";
+            });
+            ISpeech::Priority priority = ISpeech::Priority::Maneuver;
+            if (priorityIter != res.end()) {
+                priority = static_cast<ISpeech::Priority>(DBusHelpers::getFromIter<std::int32_t>(priorityIter->second.reader()));
+            }
+
             if (dataIter != res.end()) {
                 std::string data = DBusHelpers::getFromIter<std::string>(dataIter->second.reader());
                 dbusTrace() << " I have to say " << data;
-                speechSignal(data);
+                speechSignal(data, priority);
             }
         }
         else if (isRoutingSignal) {
@@ -225,6 +252,12 @@ struct NavitDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Obje
                 routingSignal(data);
             }
         }
+        else if (isNavigationState) {
+            auto state = unpackNavigationState(res);
+            dbusTrace() << "Navigation state active= " << state.active << " distance= " << state.distance
+                        << " maneuver= " << state.maneuver << " in " << state.maneuverDistance;
+            navigationStateSignal(state);
+        }
         else if (isPointClicked) {
             dbusTrace() << "Point callback";
             auto point = unpackPointClicked(res);
@@ -312,12 +345,33 @@ struct NavitDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Obje
         return retVal;
     }
 
+    NavigationState unpackNavigationState(const std::vector<std::pair<std::string, ::DBus::Variant> >& dictionary)
+    {
+        NavigationState state;
+        for (const auto& p : dictionary) {
+            if (p.first == "destination_length") {
+                state.active = true;
+                state.distance = DBusHelpers::getFromIter<std::int32_t>(p.second.reader());
+            } else if (p.first == "destination_time") {
+                state.eta = DBusHelpers::getFromIter<std::int32_t>(p.second.reader());
+            } else if (p.first == "item_type") {
+                state.maneuver = DBusHelpers::getFromIter<std::string>(p.second.reader());
+            } else if (p.first == "length") {
+                state.maneuverDistance = DBusHelpers::getFromIter<std::int32_t>(p.second.reader());
+            } else if (p.first == "street_name") {
+                state.street = DBusHelpers::getFromIter<std::string>(p.second.reader());
+            }
+        }
+        return state;
+    }
+
     INavitIPC::SpeechSignalType speechSignal;
     INavitIPC::PointClickedSignalType pointClickedSignal;
     INavitIPC::PointClickedSignalType tapSignal;
     INavitIPC::InitializedSignalType initializedSignal;
     INavitIPC::RoutingSignalType routingSignal;
     INavitIPC::PossibleTrackSignalType possInfoSignal;
+    INavitIPC::NavigationStateSignalType navigationStateSignal;
     bool inProgress = false;
 };
 
@@ -329,6 +383,14 @@ struct NavitSearchObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Ob
     }
 };
 
+struct NavitPoiSearchObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::ObjectProxy {
+    NavitPoiSearchObjectProxy(const std::string& searchPath, ::DBus::Connection& con)
+        : ::DBus::InterfaceProxy(poiSearchNavitDBusInterface)
+        , ::DBus::ObjectProxy(con, searchPath, navitDBusDestination.c_str())
+    {
+    }
+};
+
 struct NavitRouteObjectProxy : public DBus::InterfaceProxy, public DBus::ObjectProxy {
     NavitRouteObjectProxy(DBus::Connection& con)
         : DBus::InterfaceProxy(routeNavitDBusInterface)
@@ -513,6 +575,28 @@ struct NavitDBusPrivate {
                     currentStreetSignal(streetName);
                     break;
                 }
+                case DBusQueuedMessage::Type::NavigationInfo:
+                {
+                    // Distance, eta and street with a single round trip
+                    std::vector<std::string> names;
+                    if (!navigationCancelled) {
+                        names.push_back("route.destination_length");
+                        names.push_back("route.destination_time");
+                    }
+                    names.push_back("trackingo.street_name");
+                    auto values = DBusHelpers::getAttrs(names, *(object.get()));
+                    dbusTrace() << "Navigation info has " << values.size() << " of " << names.size() << " values";
+                    auto value = values.find("route.destination_length");
+                    if (value != values.end())
+                        distanceSignal(static_cast<std::int32_t>(value->second));
+                    value = values.find("route.destination_time");
+                    if (value != values.end())
+                        etaSignal(static_cast<std::int32_t>(value->second));
+                    value = values.find("trackingo.street_name");
+                    if (value != values.end())
+                        currentStreetSignal(DBusHelpers::getFromIter<std::string>(value->second.reader()));
+                    break;
+                }
                 case DBusQueuedMessage::Type::ZoomToRoute:
                 {
                     DBusHelpers::call("zoom_to_route", *(object.get()));
@@ -538,6 +622,38 @@ struct NavitDBusPrivate {
                     DBus::Message msg =  DBusHelpers::call("send_length_time", *(object.get()), from, to);
                     break;
                 }
+                case DBusQueuedMessage::Type::ReverseGeocode:
+                {
+                    const auto& positions = boost::get<std::vector<DBus::Struct<double, double> > >(msg.value);
+                    DBus::Message reply = DBusHelpers::call("reverse_geocode_batch", *(object.get()), positions);
+                    DBus::MessageIter it = reply.reader();
+                    DBus::MessageIter ait = it.recurse();
+                    ReverseGeocodeResults results;
+                    while (!ait.at_end()) {
+                        std::vector<std::pair<std::string, DBus::Variant> > dict;
+                        ReverseGeocodeResult result;
+                        ait >> dict;
+                        for (const auto& entry : dict) {
+                            if (entry.first == "street_name")
+                                result.street = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                            else if (entry.first == "house_number")
+                                result.houseNumber = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                            else if (entry.first == "town_name")
+                                result.town = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                            else if (entry.first == "postal")
+                                result.postal = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                            else if (entry.first == "distance")
+                                result.distance = DBusHelpers::getFromIter<std::int32_t>(entry.second.reader());
+                        }
+                        results.push_back(result);
+                    }
+                    dbusTrace() << "Reverse geocoded " << results.size() << " positions";
+                    reverseGeocodeSignal(results);
+                    break;
+                }
+                case DBusQueuedMessage::Type::PoiSearch:
+                    searchPois(boost::get<PoiQuery>(msg.value));
+                    break;
 
                 } // switch end
             } catch(const std::exception& ex) {
@@ -548,6 +664,78 @@ struct NavitDBusPrivate {
         dbusThreadRunning = false;
     }
 
+    // Fetches the POIs of a navit poi_search object page by page and emits one signal per page
+    void searchPois(const PoiQuery& query)
+    {
+        const std::string center = (boost::format("geo: %1% %2%") % query.center.longitude % query.center.latitude).str();
+        DBus::Message reply = DBusHelpers::call("poi_search_new", *(object.get()), center, query.distance, query.categories);
+        DBus::MessageIter it = reply.reader();
+        DBus::Path path;
+        it >> path;
+        NavitPoiSearchObjectProxy search{ path, con };
+
+        try {
+            if (query.offset) {
+                DBusHelpers::call("skip", search, static_cast<std::int32_t>(query.offset));
+            }
+
+            std::size_t received = 0;
+            bool last = false;
+            while (!last) {
+                std::size_t count = query.chunkSize;
+                if (query.limit) {
+                    count = std::min(count, query.limit - received);
+                }
+                DBus::Message results = DBusHelpers::call("get_results", search, static_cast<std::int32_t>(count));
+                PoiResults pois = unpackPois(results);
+                received += pois.size();
+                last = pois.size() < count || (query.limit && received >= query.limit);
+                dbusTrace() << "Received " << pois.size() << " POIs, last= " << last;
+                poiResultsSignal(pois, last);
+            }
+        } catch (...) {
+            DBusHelpers::call("destroy", search);
+            throw;
+        }
+        DBusHelpers::call("destroy", search);
+    }
+
+    PoiResults unpackPois(DBus::Message& reply)
+    {
+        PoiResults pois;
+        DBus::MessageIter it = reply.reader();
+        DBus::MessageIter ait = it.recurse();
+        while (!ait.at_end()) {
+            std::vector<std::pair<std::string, DBus::Variant> > dict;
+            PoiResult poi;
+            ait >> dict;
+            for (const auto& entry : dict) {
+                if (entry.first == "item_type") {
+                    poi.type = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                }
+                else if (entry.first == "label") {
+                    poi.label = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                }
+                else if (entry.first == "address") {
+                    poi.address = DBusHelpers::getFromIter<std::string>(entry.second.reader());
+                }
+                else if (entry.first == "position_coord_geo") {
+                    // navit sends latitude first
+                    std::vector<double> coords = DBusHelpers::getFromIter<std::vector<double> >(entry.second.reader());
+                    poi.position = Position{ coords.at(1), coords.at(0) };
+                }
+                else if (entry.first == "static_distance") {
+                    poi.distance = DBusHelpers::getFromIter<std::int32_t>(entry.second.reader());
+                }
+                else if (entry.first == "curr_position_distance") {
+                    poi.currentPositionDistance = DBusHelpers::getFromIter<std::int32_t>(entry.second.reader());
+                }
+            }
+            pois.push_back(poi);
+        }
+        return pois;
+    }
+
     void createSearchList()
     {
         // create a new search
@@ -573,6 +761,7 @@ struct NavitDBusPrivate {
 
         dbusTrace() << "Tag =" << tag;
         SearchResults ret;
+        const auto start = std::chrono::steady_clock::now();
 
         DBus::Variant var;
         DBus::MessageIter variantIter = var.writer();
@@ -695,6 +884,8 @@ struct NavitDBusPrivate {
                 break;
             }
         }
+        dbusTrace() << "Search for " << searchString << " returned " << ret.size() << " results in "
+                   << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms";
         return ret;
     }
 
@@ -721,6 +912,8 @@ struct NavitDBusPrivate {
     INavitIPC::IntSignalType etaSignal;
     INavitIPC::BoolSignalType navigationChangedSignal;
     INavitIPC::StringSignalType currentStreetSignal;
+    INavitIPC::ReverseGeocodeSignalType reverseGeocodeSignal;
+    INavitIPC::PoiResultsSignalType poiResultsSignal;
 };
 
 NavitDBus::NavitDBus(DBusController& ctrl)
@@ -731,6 +924,13 @@ NavitDBus::NavitDBus(DBusController& ctrl)
     d->rootObject.reset(new NavitDBusObjectProxy(rootNavitDBusInterface, ctrl.connection()));
     d->routeObject.reset(new NavitRouteObjectProxy(ctrl.connection()));
     d->trackingObject.reset(new NavitTrackingObjectProxy(ctrl.connection()));
+    d->object->navigationStateSignal.connect([this](const NavigationState& state) {
+        if (!state.active || d->navigationCancelled)
+            return;
+        d->distanceSignal(state.distance);
+        d->etaSignal(state.eta);
+        d->currentStreetSignal(state.street);
+    });
 }
 
 NavitDBus::~NavitDBus()
@@ -866,6 +1066,11 @@ void NavitDBus::searchPOIs(double longitude, double latitude, int dist)
     d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::SearchPOI, DBusQueuedMessage::VariantType{ std::make_pair(center_coord, distance) } });
 }
 
+void NavitDBus::searchPOIs(const PoiQuery& query)
+{
+    d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::PoiSearch, DBusQueuedMessage::VariantType{ query } });
+}
+
 void NavitDBus::currentCenter()
 {
     d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::CurrentCenter });
@@ -876,6 +1081,11 @@ void NavitDBus::currentStreet()
     d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::CurrentStreet });
 }
 
+void NavitDBus::navigationInfo()
+{
+    d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::NavigationInfo });
+}
+
 void NavitDBus::startSearch()
 {
     d->createSearchList();
@@ -937,6 +1147,18 @@ void NavitDBus::possibleTrackInformation(const Position &from, const Position &t
 
     d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::PossibleTrackInfo, std::make_pair(_f,_t)});
 }
+void NavitDBus::reverseGeocode(const std::vector<Position>& positions)
+{
+    std::vector<DBus::Struct<double, double> > coordinates;
+    for (const Position& pos : positions) {
+        DBus::Struct<double, double> s;
+        s._1 = pos.longitude;
+        s._2 = pos.latitude;
+        coordinates.push_back(s);
+    }
+    d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::ReverseGeocode, DBusQueuedMessage::VariantType{ coordinates } });
+}
+
 void NavitDBus::distance()
 {
     d->spsc_queue.push(DBusQueuedMessage{ DBusQueuedMessage::Type::Distance });
@@ -992,6 +1214,16 @@ INavitIPC::StringSignalType& NavitDBus::currentStreetResponse()
     return d->currentStreetSignal;
 }
 
+INavitIPC::ReverseGeocodeSignalType& NavitDBus::reverseGeocodeResponse()
+{
+    return d->reverseGeocodeSignal;
+}
+
+INavitIPC::PoiResultsSignalType& NavitDBus::poiResultsResponse()
+{
+    return d->poiResultsSignal;
+}
+
 INavitIPC::SpeechSignalType& NavitDBus::speechSignal()
 {
     assert(d && d->object);
@@ -1019,6 +1251,11 @@ INavitIPC::RoutingSignalType& NavitDBus::routingSignal()
     return d->object->routingSignal;
 }
 
+INavitIPC::NavigationStateSignalType& NavitDBus::navigationStateSignal()
+{
+    return d->object->navigationStateSignal;
+}
+
 INavitIPC::PossibleTrackSignalType &NavitDBus::possibleTrackInfoSignal()
 {
     return d->object->possInfoSignal;
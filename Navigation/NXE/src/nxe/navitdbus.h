@@ -33,8 +33,10 @@ public:
     virtual void setPitch(std::uint16_t newPitchValue) override;
 
     virtual void searchPOIs(double longitude, double latitude, int distance) override;
+    virtual void searchPOIs(const PoiQuery& query) override;
     virtual void currentCenter() override;
     virtual void currentStreet() override;
+    virtual void navigationInfo() override;
 
     virtual void startSearch() override;
     virtual void search(SearchType type, const std::string& searchString) override;
@@ -47,6 +49,7 @@ public:
     virtual void addMapMarker(double longitude, double latitude);
     virtual void clearMapMarker() override;
     virtual void possibleTrackInformation(const NXE::Position& from, const NXE::Position& to) override;
+    virtual void reverseGeocode(const std::vector<NXE::Position>& positions) override;
 
     virtual IntSignalType &orientationResponse() override;
     virtual IntSignalType& zoomResponse() override;
@@ -57,6 +60,8 @@ public:
     virtual IntSignalType& etaResponse() override;
     virtual BoolSignalType& navigationChanged() override;
     virtual StringSignalType& currentStreetResponse() override;
+    virtual ReverseGeocodeSignalType& reverseGeocodeResponse() override;
+    virtual PoiResultsSignalType& poiResultsResponse() override;
 
     virtual SpeechSignalType& speechSignal() override;
     virtual PointClickedSignalType& pointClickedSignal() override;
@@ -64,6 +69,7 @@ public:
     virtual InitializedSignalType& initializedSignal() override;
     virtual RoutingSignalType& routingSignal() override;
     virtual PossibleTrackSignalType& possibleTrackInfoSignal() override;
+    virtual NavigationStateSignalType& navigationStateSignal() override;
 
 private:
     std::unique_ptr<NavitDBusPrivate> d;
@@ -7,6 +7,7 @@
 #include "igpsprovider.h"
 #include "imapdownloader.h"
 #include "ispeech.h"
+#include "positionstream.h"
 
 #include <sstream>
 #include <string>
@@ -41,13 +42,11 @@ struct NXEInstancePrivate {
     std::shared_ptr<IGPSProvider> gps;
     std::shared_ptr<IMapDownloader> mapDownloaderIPC;
     std::shared_ptr<ISpeech> speech;
+    std::shared_ptr<PositionStream> positionStream;
     std::pair<int, int> geometry;
     Settings settings;
     bool initialized{ false };
     bool mute{ false };
-    std::thread distanceThread;
-    bool distanceThreadShouldRun{ false };
-    bool distanceThreadRunning {false};
 
     void setOrientation(int newOrientation)
     {
@@ -81,26 +80,6 @@ struct NXEInstancePrivate {
         }
     }
 
-    void getDistanceThread()
-    {
-        distanceThreadRunning = true;
-        nDebug() << "Starting distance thread";
-        std::chrono::milliseconds dura_3s(3000);
-        std::this_thread::sleep_for(dura_3s);
-
-        while (distanceThreadShouldRun) {
-            nTrace() << "Getting navigation informations";
-            std::chrono::milliseconds dura_1s(1000);
-            std::this_thread::sleep_for(dura_1s);
-
-            ipc->distance();
-            ipc->eta();
-            ipc->currentStreet();
-        }
-
-        nTrace() << "Finishing getDistanceThread()";
-        distanceThreadRunning = false;
-    }
 };
 
 NXEInstance::NXEInstance(DI::Injector& impls)
@@ -108,6 +87,19 @@ NXEInstance::NXEInstance(DI::Injector& impls)
 {
     nDebug() << "Creating NXE instance. Settings path = " << d->settings.configPath();
     nTrace() << "Connecting to navitprocess signals";
+
+    using SettingsTags::Navit::PositionStream;
+    const std::string streamPath = d->settings.get<PositionStream>(std::string());
+    if (!streamPath.empty()) {
+        nDebug() << "Streaming positions to " << streamPath;
+        d->positionStream = std::make_shared<NXE::PositionStream>(streamPath);
+        std::weak_ptr<NXE::PositionStream> stream = d->positionStream;
+        d->gps->addPostionUpdate([stream](const Position& position) {
+            if (auto s = stream.lock()) {
+                s->send(position);
+            }
+        });
+    }
 }
 
 NXEInstance::~NXEInstance()
@@ -124,12 +116,6 @@ NXEInstance::~NXEInstance()
         }
         d->navitProcess->stop();
     }
-
-    // stop destination thread
-    d->distanceThreadShouldRun = false;
-    if (d->distanceThread.joinable()) {
-        d->distanceThread.join();
-    }
 }
 
 void NXEInstance::startNavit()
@@ -152,10 +138,10 @@ void NXEInstance::startNavit()
             nInfo() << "Navit external is set, won't run";
         }
         nDebug() << "Trying to start IPC Navit controller";
-        d->ipc->speechSignal().connect([this](const std::string& string) {
+        d->ipc->speechSignal().connect([this](const std::string& string, ISpeech::Priority priority) {
             nDebug() << "Saying " << string << " speech pointer = " << static_cast<void*>(d->speech.get());
             if (d->speech && !(d->mute)) {
-                d->speech->say(string);
+                d->speech->say(string, priority);
             }
         });
     }
@@ -205,24 +191,14 @@ void NXEInstance::resize(int w, int h)
 void NXEInstance::startNavigation(double lat, double lon, const string& description)
 {
     assert(d && d->ipc);
+    // distance, eta and street are pushed by navit's navigation_state signal from now on
     d->ipc->setDestination(lat, lon, description);
-
-    if (d->distanceThreadRunning) {
-        return;
-    }
-
-    d->distanceThreadShouldRun = true;
-    d->distanceThread =std::thread { std::bind(&NXEInstancePrivate::getDistanceThread, d.get()) };
 }
 
 void NXEInstance::cancelNavigation()
 {
     nDebug() << "Canceling navigation";
     assert(d && d->ipc);
-    d->distanceThreadShouldRun = false;
-    if (d->distanceThread.joinable()) {
-        d->distanceThread.join();
-    }
     d->ipc->clearDestination();
 }
 
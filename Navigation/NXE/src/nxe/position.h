@@ -16,6 +16,10 @@ struct Position {
     double longitude{ std::numeric_limits<double>::quiet_NaN() };
     double latitude{ std::numeric_limits<double>::quiet_NaN() };
     double altitude{ std::numeric_limits<double>::quiet_NaN() };
+    // speed over ground in m/s
+    double speed{ std::numeric_limits<double>::quiet_NaN() };
+    // course over ground in degrees, clockwise from north
+    double heading{ std::numeric_limits<double>::quiet_NaN() };
 };
 
 } // NXE
@@ -0,0 +1,248 @@
+#include "positionfusion.h"
+#include "imotionsource.h"
+#include "latest_value.hpp"
+#include "spsc_queue.hpp"
+#include "log.h"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// the last fix is not advanced further than this
+const std::chrono::milliseconds maxDeadReckoning{ 10000 };
+const std::size_t subscriberQueueSize = 16;
+const double metersPerDegree = 111320.0;
+const double pi = 3.14159265358979323846;
+}
+
+namespace NXE {
+
+struct Subscriber {
+    Subscriber(const IGPSProvider::PositionUpdateCb& callback)
+        : cb(callback)
+    {
+        thread = std::thread{ std::bind(&Subscriber::run, this) };
+    }
+
+    ~Subscriber()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            stop = true;
+        }
+        cond.notify_one();
+        thread.join();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        while (!stop) {
+            cond.wait(lock, [this]() { return stop || !queue.empty(); });
+            lock.unlock();
+            Position position;
+            while (!stop && queue.try_pop(position)) {
+                cb(position);
+            }
+            lock.lock();
+        }
+    }
+
+    void push(const Position& position, std::atomic<std::size_t>& dropped)
+    {
+        if (!queue.try_push(position)) {
+            ++dropped;
+            return;
+        }
+        {
+            // the subscriber checks the queue with the lock held, so it cannot miss the wakeup
+            std::lock_guard<std::mutex> lock{ mutex };
+        }
+        cond.notify_one();
+    }
+
+    IGPSProvider::PositionUpdateCb cb;
+    spsc_queue<Position, subscriberQueueSize> queue;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> stop{ false };
+};
+
+struct PositionFusionPrivate {
+    PositionFusionPrivate(std::shared_ptr<IMotionSource> motionSource, std::chrono::milliseconds fusionPeriod)
+        : motion(motionSource)
+        , period(fusionPeriod)
+    {
+    }
+
+    void run()
+    {
+        std::uint32_t lastFix = 0;
+        Position current;
+        Position previousFix;
+        auto fixTime = std::chrono::steady_clock::now();
+        auto next = fixTime;
+        bool reckoning = false;
+
+        std::unique_lock<std::mutex> lock{ mutex };
+        const auto newFix = [this, &lastFix]() { return !running || fixSequence != lastFix; };
+        while (running) {
+            if (!reckoning) {
+                // there is no position to advance, only a fix brings news
+                cond.wait(lock, newFix);
+            } else if (!cond.wait_until(lock, next, newFix)) {
+                next += period;
+                lock.unlock();
+                reckoning = deadReckon(current, fixTime);
+                lock.lock();
+                continue;
+            }
+            if (!running) {
+                break;
+            }
+
+            Position fix = pendingFix;
+            lastFix = fixSequence;
+            lock.unlock();
+            if (std::isnan(fix.heading) && !std::isnan(previousFix.latitude)) {
+                fix.heading = bearing(previousFix, fix, current.heading);
+            }
+            previousFix = fix;
+            current = fix;
+            fixTime = std::chrono::steady_clock::now();
+            next = fixTime + period;
+            reckoning = motion && !std::isnan(current.heading);
+            ++fixes;
+            publish(current);
+            lock.lock();
+        }
+    }
+
+    // Advances current by one period, returns whether it can be advanced further
+    bool deadReckon(Position& current, std::chrono::steady_clock::time_point fixTime)
+    {
+        if (std::chrono::steady_clock::now() - fixTime > maxDeadReckoning) {
+            return false;
+        }
+        MotionSample sample;
+        if (!motion->sample(sample) || std::isnan(sample.speed)) {
+            return true;
+        }
+
+        const double dt = std::chrono::duration<double>(period).count();
+        if (!std::isnan(sample.yawRate)) {
+            current.heading = std::fmod(current.heading + sample.yawRate * dt + 360.0, 360.0);
+        }
+        const double distance = sample.speed * dt;
+        const double heading = current.heading * pi / 180.0;
+        current.latitude += distance * std::cos(heading) / metersPerDegree;
+        current.longitude += distance * std::sin(heading) / (metersPerDegree * std::cos(current.latitude * pi / 180.0));
+        current.speed = sample.speed;
+        ++deadReckoned;
+        publish(current);
+        return true;
+    }
+
+    // Keeps the previous heading when the vehicle did not move far enough to tell
+    static double bearing(const Position& from, const Position& to, double previous)
+    {
+        const double dy = (to.latitude - from.latitude) * metersPerDegree;
+        const double dx = (to.longitude - from.longitude) * metersPerDegree * std::cos(to.latitude * pi / 180.0);
+        if (dx * dx + dy * dy < 4.0) {
+            return previous;
+        }
+        return std::fmod(std::atan2(dx, dy) * 180.0 / pi + 360.0, 360.0);
+    }
+
+    void publish(const Position& position)
+    {
+        latestPosition.store(position);
+        std::lock_guard<std::mutex> lock{ subscribersMutex };
+        for (auto& subscriber : subscribers) {
+            subscriber->push(position, dropped);
+        }
+    }
+
+    std::shared_ptr<IMotionSource> motion;
+    const std::chrono::milliseconds period;
+    latest_value<Position> latestPosition;
+
+    // guards the fix handed over by publishFix() and running
+    std::mutex mutex;
+    std::condition_variable cond;
+    Position pendingFix;
+    std::uint32_t fixSequence{ 0 };
+    bool running{ true };
+
+    // only taken by subscribe() and to hand positions over, never while a callback runs
+    std::mutex subscribersMutex;
+    std::vector<std::unique_ptr<Subscriber> > subscribers;
+
+    std::atomic<std::size_t> fixes{ 0 };
+    std::atomic<std::size_t> deadReckoned{ 0 };
+    std::atomic<std::size_t> dropped{ 0 };
+
+    std::thread m_fusionThread;
+};
+
+PositionFusion::PositionFusion(std::shared_ptr<IMotionSource> motion, std::chrono::milliseconds period)
+    : d(new PositionFusionPrivate{ motion, period })
+{
+    nTrace() << "PositionFusion::PositionFusion() period= " << period.count() << " ms motion= " << (motion ? "yes" : "no");
+    d->m_fusionThread = std::thread{ std::bind(&PositionFusionPrivate::run, d.get()) };
+}
+
+PositionFusion::~PositionFusion()
+{
+    {
+        std::lock_guard<std::mutex> lock{ d->mutex };
+        d->running = false;
+    }
+    d->cond.notify_one();
+    d->m_fusionThread.join();
+    std::lock_guard<std::mutex> lock{ d->subscribersMutex };
+    d->subscribers.clear();
+}
+
+void PositionFusion::publishFix(const Position& fix)
+{
+    {
+        std::lock_guard<std::mutex> lock{ d->mutex };
+        d->pendingFix = fix;
+        ++d->fixSequence;
+    }
+    d->cond.notify_one();
+}
+
+Position PositionFusion::position() const
+{
+    Position position;
+    d->latestPosition.load(position);
+    return position;
+}
+
+void PositionFusion::subscribe(const IGPSProvider::PositionUpdateCb& cb)
+{
+    if (!cb) {
+        return;
+    }
+    std::unique_ptr<Subscriber> subscriber{ new Subscriber{ cb } };
+    std::lock_guard<std::mutex> lock{ d->subscribersMutex };
+    d->subscribers.push_back(std::move(subscriber));
+}
+
+PositionFusion::Statistics PositionFusion::statistics() const
+{
+    Statistics stats;
+    stats.fixes = d->fixes;
+    stats.deadReckoned = d->deadReckoned;
+    stats.dropped = d->dropped;
+    return stats;
+}
+
+} // namespace NXE
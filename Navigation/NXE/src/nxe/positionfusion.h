@@ -0,0 +1,46 @@
+#ifndef NXE_POSITIONFUSION_H
+#define NXE_POSITIONFUSION_H
+
+#include "igpsprovider.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+namespace NXE {
+class IMotionSource;
+
+struct PositionFusionPrivate;
+// Publishes new GPS fixes as they arrive. Between fixes the last fix is
+// advanced once per period with the speed and yaw rate of the motion source
+// if there is one. Every subscriber gets the positions through its own
+// bounded queue and thread, a subscriber that is too slow loses positions
+// instead of delaying the others or the GPS source.
+class PositionFusion {
+public:
+    struct Statistics {
+        std::size_t fixes{ 0 };
+        std::size_t deadReckoned{ 0 };
+        // positions a subscriber could not take because its queue was full
+        std::size_t dropped{ 0 };
+    };
+
+    PositionFusion(std::shared_ptr<IMotionSource> motion = std::shared_ptr<IMotionSource>(),
+        std::chrono::milliseconds period = std::chrono::milliseconds{ 100 });
+    ~PositionFusion();
+
+    // Called by the GPS source for every fix, never waits for the subscribers
+    void publishFix(const Position& fix);
+
+    // Latest published position, never blocks
+    Position position() const;
+    void subscribe(const IGPSProvider::PositionUpdateCb& cb);
+
+    Statistics statistics() const;
+
+private:
+    std::unique_ptr<PositionFusionPrivate> d;
+};
+
+} // namespace NXE
+
+#endif // NXE_POSITIONFUSION_H
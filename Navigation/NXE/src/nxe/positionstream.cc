@@ -0,0 +1,225 @@
+#include "positionstream.h"
+#include "log.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+// Records as defined in navit/vehicle/binstream/vehicle_binstream.h, both sides have to match
+const std::uint8_t recordKey = 1;
+const std::uint8_t recordDelta = 2;
+const std::size_t keyInterval = 10;
+const std::uint16_t unknown = 0xffff;
+
+struct KeyRecord {
+    std::uint8_t type;
+    std::uint8_t reserved;
+    std::uint16_t seq;
+    std::int32_t lat;
+    std::int32_t lng;
+    std::uint16_t speed;
+    std::uint16_t direction;
+    std::int64_t time;
+};
+static_assert(sizeof(KeyRecord) == 24, "KeyRecord does not match struct vehicle_binstream_key");
+
+struct DeltaRecord {
+    std::uint8_t type;
+    std::uint8_t reserved;
+    std::uint16_t seq;
+    std::int16_t lat;
+    std::int16_t lng;
+    std::uint16_t time;
+    std::uint16_t speed;
+    std::uint16_t direction;
+};
+static_assert(sizeof(DeltaRecord) == 14, "DeltaRecord does not match struct vehicle_binstream_delta");
+
+// positions kept while navit does not read
+const std::size_t maxPending = 32;
+
+std::uint16_t toSpeed(double speed)
+{
+    if (std::isnan(speed) || speed < 0 || speed * 100 >= unknown) {
+        return unknown;
+    }
+    return static_cast<std::uint16_t>(std::lround(speed * 100));
+}
+
+std::uint16_t toDirection(double heading)
+{
+    if (std::isnan(heading)) {
+        return unknown;
+    }
+    return static_cast<std::uint16_t>(std::lround(heading * 100)) % 36000;
+}
+
+bool fitsDelta(std::int64_t value)
+{
+    return value >= std::numeric_limits<std::int16_t>::min() && value <= std::numeric_limits<std::int16_t>::max();
+}
+}
+
+namespace NXE {
+
+struct PendingPosition {
+    std::int32_t lat;
+    std::int32_t lng;
+    std::uint16_t speed;
+    std::uint16_t direction;
+    std::int64_t time;
+};
+
+struct PositionStreamPrivate {
+    PositionStreamPrivate(const std::string& p)
+        : path(p)
+    {
+    }
+
+    ~PositionStreamPrivate()
+    {
+        disconnect();
+    }
+
+    bool connect()
+    {
+        sockaddr_un addr;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+
+        fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, path.c_str());
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            disconnect();
+            return false;
+        }
+        nDebug() << "Position stream connected to " << path;
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+        // the receiver can not apply deltas to a position it did not see
+        forceKey = true;
+    }
+
+    // Returns false if navit did not take the record, the position is sent again later
+    bool sendOne(const PendingPosition& position)
+    {
+        const std::uint16_t seq = static_cast<std::uint16_t>(lastSeq + 1);
+        const std::int64_t dlat = static_cast<std::int64_t>(position.lat) - last.lat;
+        const std::int64_t dlng = static_cast<std::int64_t>(position.lng) - last.lng;
+        const std::int64_t dtime = position.time - last.time;
+        const bool key = forceKey || sinceKey + 1 >= keyInterval || !fitsDelta(dlat) || !fitsDelta(dlng) || dtime < 0 || dtime > std::numeric_limits<std::uint16_t>::max();
+
+        ssize_t ret;
+        if (key) {
+            KeyRecord record{ recordKey, 0, seq, position.lat, position.lng, position.speed, position.direction, position.time };
+            ret = ::send(fd, &record, sizeof(record), MSG_DONTWAIT);
+        }
+        else {
+            DeltaRecord record{ recordDelta, 0, seq, static_cast<std::int16_t>(dlat), static_cast<std::int16_t>(dlng),
+                static_cast<std::uint16_t>(dtime), position.speed, position.direction };
+            ret = ::send(fd, &record, sizeof(record), MSG_DONTWAIT);
+        }
+
+        if (ret < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // navit was restarted or stopped
+                nDebug() << "Position stream to " << path << " lost: " << std::strerror(errno);
+                disconnect();
+            }
+            return false;
+        }
+
+        lastSeq = seq;
+        last = position;
+        sinceKey = key ? 0 : sinceKey + 1;
+        forceKey = false;
+        ++stats.sent;
+        if (key) {
+            ++stats.keyRecords;
+        }
+        return true;
+    }
+
+    const std::string path;
+    int fd{ -1 };
+    std::mutex mutex;
+    std::deque<PendingPosition> pending;
+    PendingPosition last{ 0, 0, 0, 0, 0 };
+    std::uint16_t lastSeq{ 0 };
+    std::size_t sinceKey{ 0 };
+    bool forceKey{ true };
+    PositionStream::Statistics stats;
+};
+
+PositionStream::PositionStream(const std::string& path)
+    : d(new PositionStreamPrivate(path))
+{
+    nTrace() << "PositionStream::PositionStream() " << path;
+}
+
+PositionStream::~PositionStream()
+{
+}
+
+void PositionStream::send(const Position& position)
+{
+    if (std::isnan(position.latitude) || std::isnan(position.longitude)) {
+        return;
+    }
+
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    PendingPosition entry;
+    entry.lat = static_cast<std::int32_t>(std::lround(position.latitude * 1e7));
+    entry.lng = static_cast<std::int32_t>(std::lround(position.longitude * 1e7));
+    entry.speed = toSpeed(position.speed);
+    entry.direction = toDirection(position.heading);
+    entry.time = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+    std::lock_guard<std::mutex> lock{ d->mutex };
+    d->pending.push_back(entry);
+    if (d->pending.size() > maxPending) {
+        d->pending.pop_front();
+        ++d->stats.dropped;
+    }
+
+    if (d->fd < 0 && !d->connect()) {
+        return;
+    }
+    while (!d->pending.empty() && d->sendOne(d->pending.front())) {
+        d->pending.pop_front();
+    }
+}
+
+PositionStream::Statistics PositionStream::statistics() const
+{
+    std::lock_guard<std::mutex> lock{ d->mutex };
+    Statistics stats = d->stats;
+    stats.pending = d->pending.size();
+    return stats;
+}
+
+} // namespace NXE
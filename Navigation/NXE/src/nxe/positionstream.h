@@ -0,0 +1,40 @@
+#ifndef NXE_POSITIONSTREAM_H
+#define NXE_POSITIONSTREAM_H
+
+#include "position.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace NXE {
+
+struct PositionStreamPrivate;
+// Sends positions to the navit vehicle "binstream" (navit/vehicle/binstream) over a
+// unix datagram socket, as fixed point records which are mostly deltas to the
+// previous one. While navit does not read, positions are kept in a bounded queue
+// and the oldest are dropped, send() never blocks.
+class PositionStream {
+public:
+    struct Statistics {
+        std::size_t sent{ 0 };
+        std::size_t keyRecords{ 0 };
+        // positions dropped because navit did not read them in time
+        std::size_t dropped{ 0 };
+        std::size_t pending{ 0 };
+    };
+
+    // path of the socket navit listens on, as in source="binstream:<path>"
+    PositionStream(const std::string& path);
+    ~PositionStream();
+
+    void send(const Position& position);
+
+    Statistics statistics() const;
+
+private:
+    std::unique_ptr<PositionStreamPrivate> d;
+};
+
+} // namespace NXE
+
+#endif // NXE_POSITIONSTREAM_H
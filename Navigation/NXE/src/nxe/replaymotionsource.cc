@@ -0,0 +1,78 @@
+#include "replaymotionsource.h"
+#include "latest_value.hpp"
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+// samples older than this are not used for dead reckoning
+const std::chrono::milliseconds maxSampleAge{ 1000 };
+}
+
+namespace NXE {
+
+struct TimedMotionSample {
+    MotionSample sample;
+    std::chrono::steady_clock::time_point time;
+};
+
+struct ReplayMotionSourcePrivate {
+    void threadRoutine(const std::string& path)
+    {
+        std::ifstream log{ path };
+        if (!log) {
+            nError() << "Unable to open motion log " << path;
+            return;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        std::string line;
+        while (m_bThreadRunning && std::getline(log, line)) {
+            std::istringstream fields{ line };
+            long long ms;
+            TimedMotionSample timed;
+            if (!(fields >> ms >> timed.sample.speed >> timed.sample.yawRate)) {
+                continue;
+            }
+            timed.time = start + std::chrono::milliseconds{ ms };
+            while (m_bThreadRunning && std::chrono::steady_clock::now() < timed.time) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+            }
+            latest.store(timed);
+        }
+        nDebug() << "Motion replay of " << path << " finished";
+    }
+
+    std::thread m_replayThread;
+    std::atomic<bool> m_bThreadRunning{ true };
+    latest_value<TimedMotionSample> latest;
+};
+
+ReplayMotionSource::ReplayMotionSource(const std::string& path)
+    : d(new ReplayMotionSourcePrivate)
+{
+    nTrace() << "ReplayMotionSource::ReplayMotionSource() " << path;
+    d->m_replayThread = std::thread{ std::bind(&ReplayMotionSourcePrivate::threadRoutine, d.get(), path) };
+}
+
+ReplayMotionSource::~ReplayMotionSource()
+{
+    d->m_bThreadRunning = false;
+    d->m_replayThread.join();
+}
+
+bool ReplayMotionSource::sample(MotionSample& sample) const
+{
+    TimedMotionSample timed;
+    if (!d->latest.load(timed) || std::chrono::steady_clock::now() - timed.time > maxSampleAge) {
+        return false;
+    }
+    sample = timed.sample;
+    return true;
+}
+
+} // namespace NXE
@@ -0,0 +1,26 @@
+#ifndef NXE_REPLAYMOTIONSOURCE_H
+#define NXE_REPLAYMOTIONSOURCE_H
+
+#include "imotionsource.h"
+#include <memory>
+#include <string>
+
+namespace NXE {
+
+struct ReplayMotionSourcePrivate;
+// Replays a recorded motion log instead of reading the vehicle bus.
+// Every line of the log is "<milliseconds since start> <speed m/s> <yaw rate deg/s>".
+class ReplayMotionSource : public IMotionSource {
+public:
+    ReplayMotionSource(const std::string& path);
+    ~ReplayMotionSource();
+
+    virtual bool sample(MotionSample& sample) const override;
+
+private:
+    std::unique_ptr<ReplayMotionSourcePrivate> d;
+};
+
+} // namespace NXE
+
+#endif // NXE_REPLAYMOTIONSOURCE_H
@@ -21,6 +21,13 @@ public:
         return m_tree.get<typename T::type>(T::name());
     }
 
+    // Returns defaultValue if the setting is not present in the config file
+    template <typename T>
+    typename T::type get(const typename T::type& defaultValue)
+    {
+        return m_tree.get<typename T::type>(T::name(), defaultValue);
+    }
+
     template <typename T>
     void set(const typename T::type& value)
     {
@@ -25,6 +25,12 @@ namespace Navit {
         typedef std::string type;
         static std::string name() noexcept { return "navit.platform"; }
     };
+
+    // Socket of navit's binstream vehicle, positions are not streamed if empty
+    struct PositionStream {
+        typedef std::string type;
+        static std::string name() noexcept { return "navit.positionStream"; }
+    };
 } // Navit
 
 struct LogPath {
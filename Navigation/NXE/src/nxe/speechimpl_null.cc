@@ -13,7 +13,7 @@ SpeechImpl::~SpeechImpl()
 {
 }
 
-void SpeechImpl::say(const std::string& command)
+void SpeechImpl::say(const std::string& command, Priority priority)
 {
     nInfo() << "Trying to say " << command;
 }
@@ -4,13 +4,21 @@
 #include <dbus-c++/dbus.h>
 #include "dbus_helpers.hpp"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <thread>
 
 namespace NXE {
 const std::string srsDBusDestination = "org.tizen.srs";
 const std::string srsDBusPath = "/tts";
 const std::string srsDBusInterface = "org.tizen.srs";
 
+// A maneuver which waited longer than this is most likely behind the vehicle already
+const std::chrono::milliseconds staleManeuver{ 5000 };
+
 struct SRSDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::ObjectProxy {
     SRSDBusObjectProxy(::DBus::Connection& connection)
         : ::DBus::InterfaceProxy(srsDBusInterface)
@@ -18,29 +26,128 @@ struct SRSDBusObjectProxy : public ::DBus::InterfaceProxy, public ::DBus::Object
     {}
 };
 
+static SpeechImplDBus::Synthesizer srsSynthesizer(DBusController& ctrl)
+{
+    std::shared_ptr<SRSDBusObjectProxy> object{ new SRSDBusObjectProxy{ ctrl.connection() } };
+    return [object](const std::string& text) {
+        DBusHelpers::call("synthesize", *object, text, std::string{"english"});
+    };
+}
+
+struct Utterance {
+    std::string text;
+    ISpeech::Priority priority;
+    std::chrono::steady_clock::time_point queued;
+};
+
 struct SpeechImplDBusPrivate {
-    SpeechImplDBusPrivate(DBusController& ctrl)
-        : object (ctrl.connection())
+    SpeechImplDBusPrivate(SpeechImplDBus::Synthesizer synth, std::chrono::milliseconds stale)
+        : synthesize(std::move(synth))
+        , staleAfter(stale)
     {}
-    SRSDBusObjectProxy object;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        while (true) {
+            cond.wait(lock, [this]() { return stop || !queue.empty(); });
+            if (stop) {
+                return;
+            }
+
+            Utterance utterance = std::move(queue.front());
+            queue.pop_front();
+            const auto started = std::chrono::steady_clock::now();
+            const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(started - utterance.queued);
+            if (utterance.priority == ISpeech::Priority::Maneuver && started - utterance.queued > staleAfter) {
+                nDebug() << "Dropping stale announcement " << utterance.text << " after " << waited.count() << " ms";
+                ++stats.dropped;
+                continue;
+            }
+
+            lock.unlock();
+            try {
+                synthesize(utterance.text);
+            } catch( const std::exception& ex) {
+                nError() << "Error in speech = " << ex.what();
+            }
+            const auto synthesis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+            nInfo() << "Said " << utterance.text << " queued " << waited.count() << " ms, synthesis " << synthesis.count() << " ms";
+            lock.lock();
+
+            ++stats.spoken;
+            stats.lastQueueLatency = waited;
+            stats.maxQueueLatency = std::max(stats.maxQueueLatency, waited);
+            stats.lastSynthesisTime = synthesis;
+        }
+    }
+
+    SpeechImplDBus::Synthesizer synthesize;
+    const std::chrono::milliseconds staleAfter;
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    // highest priority first, FIFO within a priority
+    std::deque<Utterance> queue;
+    bool stop{ false };
+    SpeechImplDBus::Statistics stats;
+    std::thread worker;
 };
 
 SpeechImplDBus::SpeechImplDBus(DBusController& ctrl)
-    : d(new SpeechImplDBusPrivate (ctrl))
+    : SpeechImplDBus(srsSynthesizer(ctrl), staleManeuver)
+{
+}
+
+SpeechImplDBus::SpeechImplDBus(Synthesizer synthesize, std::chrono::milliseconds staleAfter)
+    : d(new SpeechImplDBusPrivate (std::move(synthesize), staleAfter))
 {
+    d->worker = std::thread{ std::bind(&SpeechImplDBusPrivate::run, d.get()) };
 }
 
 SpeechImplDBus::~SpeechImplDBus()
 {
+    {
+        std::lock_guard<std::mutex> lock{ d->mutex };
+        d->stop = true;
+    }
+    d->cond.notify_one();
+    d->worker.join();
 }
 
-void SpeechImplDBus::say(const std::string& command)
+void SpeechImplDBus::say(const std::string& command, Priority priority)
 {
-    try {
-        DBusHelpers::call("synthesize", d->object, command, std::string{"english"});
-    } catch( const std::exception& ex) {
-        nError() << "Error in speech = " << ex.what();
+    std::unique_lock<std::mutex> lock{ d->mutex };
+
+    auto same = std::find_if(d->queue.begin(), d->queue.end(), [&command](const Utterance& u) {
+        return u.text == command;
+    });
+    const bool merged = same != d->queue.end();
+    if (merged) {
+        ++d->stats.merged;
+        if (same->priority >= priority) {
+            return;
+        }
     }
+
+    // A newer maneuver supersedes the ones still waiting, the same text with a lower priority is replaced
+    auto end = std::remove_if(d->queue.begin(), d->queue.end(), [&command, priority](const Utterance& u) {
+        return u.text == command || (priority == Priority::Maneuver && u.priority == Priority::Maneuver);
+    });
+    d->stats.dropped += std::distance(end, d->queue.end()) - (merged ? 1 : 0);
+    d->queue.erase(end, d->queue.end());
+
+    auto pos = std::find_if(d->queue.begin(), d->queue.end(), [priority](const Utterance& u) {
+        return u.priority < priority;
+    });
+    d->queue.insert(pos, Utterance{ command, priority, std::chrono::steady_clock::now() });
+    lock.unlock();
+    d->cond.notify_one();
+}
+
+SpeechImplDBus::Statistics SpeechImplDBus::statistics() const
+{
+    std::lock_guard<std::mutex> lock{ d->mutex };
+    return d->stats;
 }
 
 } // namespace NXE
@@ -2,6 +2,8 @@
 #define NXE_SPEECHIMPLDBUS_H
 
 #include "ispeech.h"
+#include <chrono>
+#include <functional>
 #include <memory>
 
 namespace NXE {
@@ -11,10 +13,29 @@ struct SpeechImplDBusPrivate;
 class SpeechImplDBus : public NXE::ISpeech
 {
 public:
+    struct Statistics {
+        std::size_t spoken{ 0 };
+        // stale maneuvers and announcements superseded by a newer maneuver
+        std::size_t dropped{ 0 };
+        // announcements of a text that was already waiting
+        std::size_t merged{ 0 };
+        std::chrono::milliseconds lastQueueLatency{ 0 };
+        std::chrono::milliseconds maxQueueLatency{ 0 };
+        std::chrono::milliseconds lastSynthesisTime{ 0 };
+    };
+
+    using Synthesizer = std::function<void(const std::string&)>;
+
     SpeechImplDBus(DBusController& ctrl);
+    // Synthesizes with the given function instead of the srs service, maneuvers waiting longer than staleAfter are dropped
+    SpeechImplDBus(Synthesizer synthesize, std::chrono::milliseconds staleAfter);
     ~SpeechImplDBus();
 
-    void say(const std::string& command) override;
+    // Queues the announcement and returns immediately, it is synthesized by a worker thread
+    void say(const std::string& command, Priority priority) override;
+
+    Statistics statistics() const;
+
 private:
     std::unique_ptr<SpeechImplDBusPrivate> d;
 
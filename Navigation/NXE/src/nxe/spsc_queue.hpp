@@ -0,0 +1,49 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock free queue for exactly one producer and one consumer thread.
+// Neither side ever waits, try_push() fails if the queue is full.
+template <typename Data, std::size_t Capacity>
+class spsc_queue {
+private:
+    std::array<Data, Capacity + 1> _ring;
+    std::atomic<std::size_t> _head{ 0 };
+    std::atomic<std::size_t> _tail{ 0 };
+
+public:
+    bool try_push(const Data& entry)
+    {
+        const std::size_t tail = _tail.load(std::memory_order_relaxed);
+        const std::size_t next = (tail + 1) % _ring.size();
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        _ring[tail] = entry;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(Data& val)
+    {
+        const std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        val = _ring[head];
+        _head.store((head + 1) % _ring.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SPSC_QUEUE_HPP
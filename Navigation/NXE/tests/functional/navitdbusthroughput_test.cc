@@ -0,0 +1,78 @@
+#include "nxe_instance.h"
+#include "navitprocessimpl.h"
+#include "navitdbus.h"
+#include "mapdownloaderdbus.h"
+#include "gpsdprovider.h"
+#include "testutils.h"
+#include "dbuscontroller.h"
+#include "mocks/speechmock.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+using namespace NXE;
+
+// Measures how many get_attr round trips navit's D-Bus binding answers per
+// second. Each zoom() request is a navit.get_attr("zoom") call whose reply
+// arrives as a zoomResponse signal.
+struct NavitDBusThroughputTest : public ::testing::Test {
+
+    DBusController dbusController;
+    INavitIPC* ipc{ new NavitDBus{ dbusController } };
+    NXE::DI::Injector injector{ std::make_tuple(
+        std::shared_ptr<NXE::INavitIPC>(ipc),
+        std::shared_ptr<NXE::INavitProcess>(new NXE::NavitProcessImpl),
+        std::shared_ptr<NXE::IGPSProvider>(new GPSDProvider),
+        std::shared_ptr<NXE::IMapDownloader>(new MapDownloaderDBus{ dbusController }),
+        std::shared_ptr<NXE::ISpeech>(new SpeechMock)) };
+    NXEInstance instance{ injector };
+    std::atomic<int> responses{ 0 };
+
+    static void SetUpTestCase()
+    {
+        TestUtils::createNXEConfFile();
+    }
+
+    void SetUp() override
+    {
+        instance.startNavit();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        instance.ipc()->zoomResponse().connect([this](int) { ++responses; });
+    }
+
+    bool waitForResponses(int count, std::chrono::seconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (responses < count) {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+};
+
+TEST_F(NavitDBusThroughputTest, getAttrCallsPerSecond)
+{
+    const int warmup = 100;
+    const int calls = 5000;
+
+    for (int i = 0; i < warmup; ++i)
+        instance.ipc()->zoom();
+    ASSERT_TRUE(waitForResponses(warmup, std::chrono::seconds(10)));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        instance.ipc()->zoom();
+    ASSERT_TRUE(waitForResponses(warmup + calls, std::chrono::seconds(60)));
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    const double perSecond = calls * 1e6 / elapsed.count();
+    std::cout << "navit.get_attr: " << calls << " calls in " << elapsed.count() / 1000
+              << " ms, " << static_cast<int>(perSecond) << " calls/s" << std::endl;
+    RecordProperty("calls_per_second", static_cast<int>(perSecond));
+}
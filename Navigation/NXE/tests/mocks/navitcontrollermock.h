@@ -17,6 +17,7 @@ struct NavitIPCMock : public NXE::INavitIPC {
     MOCK_METHOD0(pointClickedSignal, PointClickedSignalType&());
     MOCK_METHOD0(initializedSignal, InitializedSignalType&());
     MOCK_METHOD0(routingSignal, RoutingSignalType&());
+    MOCK_METHOD0(navigationStateSignal, NavigationStateSignalType&());
     MOCK_METHOD1(setOrientation, void(int));
     MOCK_METHOD0(orientation, int());
     MOCK_METHOD2(setCenter, void(double,double));
@@ -33,9 +34,11 @@ struct NavitIPCMock : public NXE::INavitIPC {
     MOCK_METHOD2(search, NXE::SearchResults(NXE::INavitIPC::SearchType, const std::string&));
     MOCK_METHOD2(selectSearchResult, void(NXE::INavitIPC::SearchType, std::int32_t));
     MOCK_METHOD3(searchPOIs, void(double,double,int));
+    MOCK_METHOD1(searchPOIs, void(const NXE::PoiQuery&));
     MOCK_METHOD1(setPitch, void(std::uint16_t));
     MOCK_METHOD0(distance, std::int32_t());
     MOCK_METHOD0(eta, std::int32_t());
+    MOCK_METHOD0(navigationInfo, void());
 };
 
 #endif // NAVITCONTROLLERMOCK_H
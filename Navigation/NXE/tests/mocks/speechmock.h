@@ -6,7 +6,7 @@
 
 struct SpeechMock : public NXE::ISpeech {
     using Inject = SpeechMock();
-    MOCK_METHOD1(say, void(const std::string&));
+    MOCK_METHOD2(say, void(const std::string&, NXE::ISpeech::Priority));
 };
 
 #endif // SPEECHMOCK_H
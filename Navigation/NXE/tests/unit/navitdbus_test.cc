@@ -184,6 +184,31 @@ TEST_F(NavitDBusTest, SearchPois)
     waitFor(received);
 }
 
+TEST_F(NavitDBusTest, searchPoisNearestFirstInChunks)
+{
+    bool last{ false };
+    std::size_t chunks{ 0 };
+    NXE::PoiResults pois;
+    connection.poiResultsResponse().connect([&](NXE::PoiResults results, bool isLast) {
+        pois.insert(pois.end(), results.begin(), results.end());
+        ++chunks;
+        last = isLast;
+    });
+
+    NXE::PoiQuery query;
+    query.center = NXE::Position{ 11.5659, 48.1392 };
+    query.distance = 5000;
+    query.limit = 10;
+    query.chunkSize = 4;
+    connection.searchPOIs(query);
+    ASSERT_TRUE(waitFor(last));
+    EXPECT_LE(pois.size(), 10u);
+    EXPECT_GE(chunks, pois.size() / 4);
+    for (std::size_t i = 1; i < pois.size(); ++i) {
+        EXPECT_LE(pois[i - 1].distance, pois[i].distance);
+    }
+}
+
 TEST_F(NavitDBusTest, setScheme)
 {
     EXPECT_NO_THROW(
@@ -375,3 +400,60 @@ TEST_F(NavitDBusTest, getCurrentStreet)
     connection.currentStreet();
     EXPECT_TRUE(waitFor(bRec));
 }
+
+// Shares one navit start-up between the requested and the pushed navigation state
+TEST_F(NavitDBusTest, navigationInfo)
+{
+    bool distanceRec{ false }, etaRec{ false }, streetRec{ false }, stateRec{ false };
+    NXE::NavigationState lastState;
+    connection.distanceResponse().connect([&](int) { distanceRec = true; });
+    connection.etaResponse().connect([&](int) { etaRec = true; });
+    connection.currentStreetResponse().connect([&](std::string) { streetRec = true; });
+    connection.navigationStateSignal().connect([&](const NXE::NavigationState& state) {
+        lastState = state;
+        stateRec = true;
+    });
+
+    connection.setPosition(11.5659, 48.1392);
+    connection.setDestination(11.5820, 48.1351, "Test");
+    ASSERT_TRUE(waitFor(stateRec, 20));
+    EXPECT_TRUE(lastState.active);
+    EXPECT_GT(lastState.distance, 0);
+    EXPECT_FALSE(lastState.maneuver.empty());
+
+    connection.navigationInfo();
+    EXPECT_TRUE(waitFor(distanceRec, 20));
+    EXPECT_TRUE(waitFor(etaRec));
+    EXPECT_TRUE(waitFor(streetRec));
+
+    // A route to the current position has no streets, so no maneuver is left
+    stateRec = false;
+    connection.setDestination(11.5659, 48.1392, "Here");
+    ASSERT_TRUE(waitFor(stateRec, 20));
+    EXPECT_FALSE(lastState.active);
+
+    stateRec = false;
+    connection.setDestination(11.5820, 48.1351, "Test");
+    ASSERT_TRUE(waitFor(stateRec, 20));
+    EXPECT_TRUE(lastState.active);
+
+    stateRec = false;
+    connection.clearDestination();
+    ASSERT_TRUE(waitFor(stateRec, 20));
+    EXPECT_FALSE(lastState.active);
+}
+
+TEST_F(NavitDBusTest, reverseGeocode)
+{
+    bool bRec{false};
+    NXE::ReverseGeocodeResults lastResults;
+    connection.reverseGeocodeResponse().connect([&](NXE::ReverseGeocodeResults results) {
+        lastResults = results;
+        bRec = true;
+    });
+
+    std::vector<NXE::Position> positions{ NXE::Position{ 11.5, 48.1 }, NXE::Position{ 11.6, 48.2 } };
+    connection.reverseGeocode(positions);
+    ASSERT_TRUE(waitFor(bRec));
+    EXPECT_EQ(lastResults.size(), positions.size());
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "positionfusion.h"
+#include "imotionsource.h"
+
+namespace {
+const std::chrono::milliseconds period{ 20 };
+
+struct FakeMotionSource : public NXE::IMotionSource {
+    bool sample(NXE::MotionSample& sample) const override
+    {
+        sample.speed = speed;
+        sample.yawRate = yawRate;
+        return true;
+    }
+
+    double speed{ 10.0 };
+    double yawRate{ 0.0 };
+};
+
+NXE::Position fix(double lon, double lat, double heading)
+{
+    NXE::Position position{ lon, lat };
+    position.heading = heading;
+    return position;
+}
+
+// Records the positions a subscriber gets, optionally blocking in the callback until the test opens it
+struct Receiver {
+    NXE::IGPSProvider::PositionUpdateCb callback()
+    {
+        return [this](const NXE::Position& position) {
+            std::unique_lock<std::mutex> lock{ mutex };
+            positions.push_back(position);
+            cond.notify_all();
+            cond.wait(lock, [this]() { return open; });
+        };
+    }
+
+    NXE::Position waitFor(const std::function<bool(const NXE::Position&)>& matches)
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        cond.wait(lock, [this, &matches]() { return !positions.empty() && matches(positions.back()); });
+        return positions.back();
+    }
+
+    void setOpen(bool value)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        open = value;
+        cond.notify_all();
+    }
+
+    std::size_t count()
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return positions.size();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<NXE::Position> positions;
+    bool open{ true };
+};
+
+std::function<bool(const NXE::Position&)> latitude(double value)
+{
+    return [value](const NXE::Position& position) { return position.latitude == value; };
+}
+}
+
+struct PositionFusionTest : public ::testing::Test {
+};
+
+TEST_F(PositionFusionTest, fixIsPublished)
+{
+    Receiver receiver;
+    NXE::PositionFusion fusion{ std::shared_ptr<NXE::IMotionSource>(), period };
+    fusion.subscribe(receiver.callback());
+
+    // nothing published yet
+    EXPECT_TRUE(std::isnan(fusion.position().latitude));
+
+    fusion.publishFix(fix(11.0, 48.0, 90.0));
+    receiver.waitFor(latitude(48.0));
+
+    EXPECT_DOUBLE_EQ(fusion.position().latitude, 48.0);
+    EXPECT_DOUBLE_EQ(fusion.position().longitude, 11.0);
+    EXPECT_EQ(fusion.statistics().fixes, 1u);
+    // without a motion source the fix is not advanced
+    EXPECT_EQ(fusion.statistics().deadReckoned, 0u);
+    EXPECT_EQ(receiver.count(), 1u);
+}
+
+TEST_F(PositionFusionTest, deadReckoningBetweenFixes)
+{
+    std::shared_ptr<FakeMotionSource> motion{ new FakeMotionSource };
+    Receiver receiver;
+    NXE::PositionFusion fusion{ motion, period };
+    fusion.subscribe(receiver.callback());
+
+    // heading north at 10 m/s, 0.2 m per period
+    fusion.publishFix(fix(11.0, 48.0, 0.0));
+    const NXE::Position position = receiver.waitFor([](const NXE::Position& position) { return (position.latitude - 48.0) * 111320.0 > 9.9; });
+
+    EXPECT_NEAR((position.latitude - 48.0) * 111320.0, 10.0, 0.15);
+    EXPECT_NEAR(position.longitude, 11.0, 1e-9);
+    EXPECT_GE(fusion.statistics().deadReckoned, 50u);
+
+    // a new fix replaces the estimate
+    fusion.publishFix(fix(11.5, 48.5, 0.0));
+    receiver.waitFor([](const NXE::Position& position) { return std::fabs(position.latitude - 48.5) < 0.001; });
+    EXPECT_EQ(fusion.statistics().fixes, 2u);
+}
+
+TEST_F(PositionFusionTest, slowSubscriberDoesNotStallOthers)
+{
+    // outlive the fusion, whose subscriber threads call them
+    Receiver slow;
+    Receiver fast;
+    NXE::PositionFusion fusion{ std::shared_ptr<NXE::IMotionSource>(), period };
+    slow.setOpen(false);
+    fusion.subscribe(slow.callback());
+    fusion.subscribe(fast.callback());
+
+    // the slow subscriber is stuck in its first callback while every fix reaches the fast one
+    for (int i = 0; i < 50; ++i) {
+        fusion.publishFix(fix(11.0, 48.0 + i * 0.001, 0.0));
+        fast.waitFor(latitude(48.0 + i * 0.001));
+    }
+
+    EXPECT_EQ(fast.count(), 50u);
+    EXPECT_EQ(slow.count(), 1u);
+    EXPECT_GT(fusion.statistics().dropped, 0u);
+    slow.setOpen(true);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "positionstream.h"
+
+namespace {
+// Layout of the records of navit/vehicle/binstream/vehicle_binstream.h
+#pragma pack(push, 1)
+struct Record {
+    std::uint8_t type;
+    std::uint8_t reserved;
+    std::uint16_t seq;
+};
+#pragma pack(pop)
+
+struct Key {
+    Record header;
+    std::int32_t lat;
+    std::int32_t lng;
+    std::uint16_t speed;
+    std::uint16_t direction;
+    std::int64_t time;
+};
+
+struct Delta {
+    Record header;
+    std::int16_t lat;
+    std::int16_t lng;
+    std::uint16_t time;
+    std::uint16_t speed;
+    std::uint16_t direction;
+};
+
+NXE::Position position(double lon, double lat)
+{
+    NXE::Position p{ lon, lat };
+    p.speed = 10.0;
+    p.heading = 90.0;
+    return p;
+}
+}
+
+struct PositionStreamTest : public ::testing::Test {
+    void SetUp() override
+    {
+        path = "/tmp/nxe-positionstream-test-" + std::to_string(::getpid());
+        ::unlink(path.c_str());
+    }
+
+    void TearDown() override
+    {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        ::unlink(path.c_str());
+    }
+
+    void listen()
+    {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, path.c_str());
+        fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+        ASSERT_EQ(0, ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+    }
+
+    ssize_t receive(char* buffer, std::size_t size)
+    {
+        return ::recv(fd, buffer, size, MSG_DONTWAIT);
+    }
+
+    std::string path;
+    int fd{ -1 };
+};
+
+TEST_F(PositionStreamTest, deltasFollowKey)
+{
+    listen();
+    NXE::PositionStream stream{ path };
+    char buffer[64];
+    std::int32_t lat = 0;
+    for (int i = 0; i < 12; ++i) {
+        stream.send(position(17.0 + i * 0.0001, 51.0 + i * 0.0002));
+        const ssize_t size = receive(buffer, sizeof(buffer));
+        Record header;
+        std::memcpy(&header, buffer, sizeof(header));
+        EXPECT_EQ(i + 1, header.seq);
+        if (i % 10 == 0) {
+            Key key;
+            ASSERT_EQ(24, size);
+            std::memcpy(&key, buffer, sizeof(key));
+            EXPECT_EQ(1, key.header.type);
+            EXPECT_EQ(1000, key.speed);
+            EXPECT_EQ(9000, key.direction);
+            lat = key.lat;
+        }
+        else {
+            Delta delta;
+            ASSERT_EQ(14, size);
+            std::memcpy(&delta, buffer, sizeof(delta));
+            EXPECT_EQ(2, delta.header.type);
+            lat += delta.lat;
+        }
+        EXPECT_EQ(510000000 + i * 2000, lat);
+    }
+
+    const NXE::PositionStream::Statistics stats = stream.statistics();
+    EXPECT_EQ(12u, stats.sent);
+    EXPECT_EQ(2u, stats.keyRecords);
+    EXPECT_EQ(0u, stats.dropped);
+}
+
+TEST_F(PositionStreamTest, oldestDroppedWithoutReceiver)
+{
+    NXE::PositionStream stream{ path };
+    for (int i = 0; i < 40; ++i) {
+        stream.send(position(17.0, 51.0 + i * 0.0001));
+    }
+
+    NXE::PositionStream::Statistics stats = stream.statistics();
+    EXPECT_EQ(0u, stats.sent);
+    EXPECT_EQ(32u, stats.pending);
+    EXPECT_EQ(8u, stats.dropped);
+
+    // the queued positions are sent starting with a key record once navit listens,
+    // as far as the socket takes them
+    listen();
+    stream.send(position(17.0, 51.01));
+    char buffer[64];
+    ASSERT_EQ(24, receive(buffer, sizeof(buffer)));
+    Key key;
+    std::memcpy(&key, buffer, sizeof(key));
+    EXPECT_EQ(510009000, key.lat);
+
+    std::size_t received = 1;
+    while (stream.statistics().pending) {
+        while (receive(buffer, sizeof(buffer)) > 0) {
+            ++received;
+        }
+        stream.send(position(17.0, 51.01));
+    }
+    while (receive(buffer, sizeof(buffer)) > 0) {
+        ++received;
+    }
+    stats = stream.statistics();
+    EXPECT_EQ(received, stats.sent);
+    // the position queued on reconnect pushed out one more
+    EXPECT_EQ(9u, stats.dropped);
+}
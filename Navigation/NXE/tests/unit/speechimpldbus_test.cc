@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "speechimpldbus.h"
+
+namespace {
+using Priority = NXE::ISpeech::Priority;
+
+// Records what is synthesized and blocks in the synthesis until the test opens it
+struct FakeSynthesizer {
+    void synthesize(const std::string& text)
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        spoken.push_back(text);
+        cond.notify_all();
+        cond.wait(lock, [this]() { return open; });
+    }
+
+    void waitFor(const std::string& text)
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        cond.wait(lock, [this, &text]() { return !spoken.empty() && spoken.back() == text; });
+    }
+
+    void setOpen(bool value)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        open = value;
+        cond.notify_all();
+    }
+
+    std::vector<std::string> said()
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return spoken;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::string> spoken;
+    bool open{ false };
+};
+}
+
+struct SpeechImplDBusTest : public ::testing::Test {
+    NXE::SpeechImplDBus::Synthesizer synthesizer()
+    {
+        return [this](const std::string& text) { fake.synthesize(text); };
+    }
+
+    FakeSynthesizer fake;
+};
+
+TEST_F(SpeechImplDBusTest, maneuverSupersedesWaitingManeuver)
+{
+    NXE::SpeechImplDBus speech{ synthesizer(), std::chrono::milliseconds{ 60000 } };
+
+    // keep the worker busy while the queue fills
+    speech.say("busy", Priority::Information);
+    fake.waitFor("busy");
+    speech.say("info", Priority::Information);
+    speech.say("turn left", Priority::Maneuver);
+    speech.say("turn right", Priority::Maneuver);
+    fake.setOpen(true);
+    speech.say("last", Priority::Information);
+    fake.waitFor("last");
+
+    // maneuvers go first, the older one was dropped
+    EXPECT_EQ(fake.said(), (std::vector<std::string>{ "busy", "turn right", "info", "last" }));
+    EXPECT_EQ(speech.statistics().dropped, 1u);
+    EXPECT_EQ(speech.statistics().merged, 0u);
+}
+
+TEST_F(SpeechImplDBusTest, sameTextIsMerged)
+{
+    NXE::SpeechImplDBus speech{ synthesizer(), std::chrono::milliseconds{ 60000 } };
+
+    speech.say("busy", Priority::Information);
+    fake.waitFor("busy");
+    speech.say("traffic ahead", Priority::Information);
+    speech.say("other", Priority::Information);
+    speech.say("traffic ahead", Priority::Information);
+    // a higher priority moves the waiting text ahead
+    speech.say("other", Priority::Maneuver);
+    fake.setOpen(true);
+    speech.say("last", Priority::Information);
+    fake.waitFor("last");
+
+    EXPECT_EQ(fake.said(), (std::vector<std::string>{ "busy", "other", "traffic ahead", "last" }));
+    EXPECT_EQ(speech.statistics().merged, 2u);
+    EXPECT_EQ(speech.statistics().dropped, 0u);
+}
+
+TEST_F(SpeechImplDBusTest, staleManeuverIsDropped)
+{
+    // every maneuver that had to wait at all is stale
+    NXE::SpeechImplDBus speech{ synthesizer(), std::chrono::milliseconds{ 0 } };
+
+    speech.say("busy", Priority::Information);
+    fake.waitFor("busy");
+    speech.say("turn left", Priority::Maneuver);
+    speech.say("info", Priority::Information);
+    fake.setOpen(true);
+    fake.waitFor("info");
+
+    EXPECT_EQ(fake.said(), (std::vector<std::string>{ "busy", "info" }));
+    EXPECT_EQ(speech.statistics().dropped, 1u);
+}
@@ -81,6 +81,12 @@
 
 #cmakedefine HAVE_FSYNC 1
 
+#cmakedefine HAVE_POSIX_FADVISE 1
+
+#cmakedefine HAVE_MADVISE 1
+
+#cmakedefine HAVE_PTHREAD 1
+
 #cmakedefine HAVE_ENDIAN_H 1
 
 #cmakedefine HAVE_FREEIMAGE 1
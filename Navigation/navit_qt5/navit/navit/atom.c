@@ -1,26 +1,47 @@
 #include <glib.h>
+#include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "atom.h"
 
 static GHashTable *atom_hash;
 
+/* Files may be created while maps are opened in the background */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t atom_lock=PTHREAD_MUTEX_INITIALIZER;
+#define atom_hash_lock() pthread_mutex_lock(&atom_lock)
+#define atom_hash_unlock() pthread_mutex_unlock(&atom_lock)
+#else
+#define atom_hash_lock()
+#define atom_hash_unlock()
+#endif
+
 char *
 atom_lookup(char *name)
 {
+	char *id;
 	if (!atom_hash)
 		return NULL;
-	return g_hash_table_lookup(atom_hash,name);
+	atom_hash_lock();
+	id=g_hash_table_lookup(atom_hash,name);
+	atom_hash_unlock();
+	return id;
 }
 
 char *
 atom(char *name)
 {
-	char *id=atom_lookup(name);
-	if (id)
-		return id;
+	char *id;
 	if (!atom_hash)
 		return NULL;
-	id=g_strdup(name);
-	g_hash_table_insert(atom_hash, id, id);
+	atom_hash_lock();
+	id=g_hash_table_lookup(atom_hash,name);
+	if (!id) {
+		id=g_strdup(name);
+		g_hash_table_insert(atom_hash, id, id);
+	}
+	atom_hash_unlock();
 	return id;
 }
 
@@ -42,12 +42,38 @@
 #include "util.h"
 #include "types.h"
 #include "xmlconfig.h"
+#include "benchmark.h"
+#include "counter.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 struct attr_name {
 	enum attr_type attr;
 	char *name;
 };
 
+static struct attr_stats attr_stats;
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t attr_stats_lock=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Allocations are only counted while benchmarking or collecting counters, see attr_get_stats() */
+static void
+attr_count_alloc(int size)
+{
+	if (!benchmark_enabled && !counter_enabled)
+		return;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&attr_stats_lock);
+#endif
+	attr_stats.allocs++;
+	attr_stats.alloc_bytes+=size;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&attr_stats_lock);
+#endif
+}
+
 
 /** List of attr_types with their names as strings. */
 static struct attr_name attr_names[]={
@@ -594,6 +620,7 @@ attr_generic_set_attr(struct attr **attrs, struct attr *attr)
 		count++;
 	}
 	curr=g_new0(struct attr *, count+2);
+	attr_count_alloc((count+2)*sizeof(struct attr *));
 	for (i = 0 ; i < count ; i++)
 		curr[i]=attrs[i];
 	curr[count]=attr_dup(attr);
@@ -621,6 +648,7 @@ attr_generic_add_attr(struct attr **attrs, struct attr *attr)
 		count++;
 	}
 	curr=g_new0(struct attr *, count+2);
+	attr_count_alloc((count+2)*sizeof(struct attr *));
 	for (i = 0 ; i < count ; i++)
 		curr[i]=attrs[i];
 	curr[count]=attr_dup(attr);
@@ -649,6 +677,7 @@ attr_generic_prepend_attr(struct attr **attrs, struct attr *attr)
 		count++;
 	}
 	curr=g_new0(struct attr *, count+2);
+	attr_count_alloc((count+2)*sizeof(struct attr *));
 	for (i = 0 ; i  < count ; i++)
 		curr[i+1]=attrs[i];
 	curr[0]=attr_dup(attr);
@@ -671,6 +700,7 @@ attr_generic_remove_attr(struct attr **attrs, struct attr *attr)
 	if (!found)
 		return attrs;
 	curr=g_new0(struct attr *, count);
+	attr_count_alloc(count*sizeof(struct attr *));
 	j=0;
 	for (i = 0 ; i < count ; i++) {
 		if (attrs[i]->type != attr->type || attrs[i]->u.data != attr->u.data)
@@ -846,6 +876,7 @@ attr_dup_content(struct attr *src, struct attr *dst)
 		size=attr_data_size(src);
 		if (size) {
 			dst->u.data=g_malloc(size);
+			attr_count_alloc(size);
 			memcpy(dst->u.data, src->u.data, size);
 		}
 	}
@@ -855,6 +886,7 @@ struct attr *
 attr_dup(struct attr *attr)
 {
 	struct attr *ret=g_new0(struct attr, 1);
+	attr_count_alloc(sizeof(*ret));
 	attr_dup_content(attr, ret);
 	return ret;
 }
@@ -881,6 +913,7 @@ attr_list_dup(struct attr **attrs)
 	while (attrs[count])
 		count++;
 	ret=g_new0(struct attr *, count+1);
+	attr_count_alloc((count+1)*sizeof(struct attr *));
 	for (i = 0 ; i < count ; i++)
 		ret[i]=attr_dup(attrs[i]);
 	return ret;
@@ -998,3 +1031,220 @@ int attr_rel2real(int attrval, int whole, int treat_neg_as_rel)
   return attrval;
 }
 
+
+struct attr_store_chunk {
+	struct attr_store_chunk *next;
+	int size;
+	int used;
+	double data[1];
+};
+
+/**
+ * @brief Initializes an attribute store
+ *
+ * An attribute store keeps a list of attributes without allocating each of
+ * them. Attributes are appended in constant time, the first ATTR_STORE_INLINE
+ * of them within the store itself. Unless borrow is set, the content of added
+ * attributes is copied: strings and other data are placed in blocks owned by
+ * the store and objects are referenced as by attr_dup(). The blocks are freed
+ * with the store, so no string outlives it.
+ * With borrow set, the content of the attributes is referenced as it is and has
+ * to outlive the store.
+ *
+ * The store itself is typically a local variable or part of another structure.
+ * It must not be copied or moved and has to be freed with attr_store_clear().
+ *
+ * @param store The store to initialize
+ * @param borrow Whether the content of added attributes is referenced instead of copied
+ */
+void
+attr_store_init(struct attr_store *store, int borrow)
+{
+	store->attrs=store->inline_attrs;
+	store->list=store->inline_list;
+	store->list[0]=NULL;
+	store->count=0;
+	store->size=ATTR_STORE_INLINE;
+	store->borrow=borrow;
+	store->data_used=0;
+	store->chunks=NULL;
+}
+
+static void *
+attr_store_alloc(struct attr_store *store, int size)
+{
+	int count=(size+sizeof(double)-1)/sizeof(double);
+	struct attr_store_chunk *chunk=store->chunks;
+	void *ret;
+
+	if (!chunk && store->data_used+count <= G_N_ELEMENTS(store->inline_data)) {
+		ret=store->inline_data+store->data_used;
+		store->data_used+=count;
+		return ret;
+	}
+	if (!chunk || chunk->used+count > chunk->size) {
+		int chunk_size=chunk ? chunk->size*2 : 32;
+		if (chunk_size < count)
+			chunk_size=count;
+		chunk=g_malloc(sizeof(*chunk)+(chunk_size-1)*sizeof(double));
+		attr_count_alloc(sizeof(*chunk)+(chunk_size-1)*sizeof(double));
+		chunk->next=store->chunks;
+		chunk->size=chunk_size;
+		chunk->used=0;
+		store->chunks=chunk;
+	}
+	ret=chunk->data+chunk->used;
+	chunk->used+=count;
+	return ret;
+}
+
+/* Strings are copied into the data blocks of the store, which never move, so they stay valid until the store is cleared */
+static char *
+attr_store_strdup(struct attr_store *store, char *str)
+{
+	char *ret;
+	int len;
+
+	if (!str)
+		return NULL;
+	len=strlen(str)+1;
+	ret=attr_store_alloc(store, len);
+	memcpy(ret, str, len);
+	if (benchmark_enabled || counter_enabled) {
+#ifdef HAVE_PTHREAD
+		pthread_mutex_lock(&attr_stats_lock);
+#endif
+		attr_stats.strings++;
+		attr_stats.string_bytes+=len;
+#ifdef HAVE_PTHREAD
+		pthread_mutex_unlock(&attr_stats_lock);
+#endif
+	}
+	return ret;
+}
+
+static void
+attr_store_grow(struct attr_store *store)
+{
+	int i,size=store->size*2;
+
+	if (store->attrs == store->inline_attrs) {
+		store->attrs=g_new(struct attr, size);
+		memcpy(store->attrs, store->inline_attrs, store->count*sizeof(struct attr));
+		store->list=g_new(struct attr *, size+1);
+	} else {
+		store->attrs=g_renew(struct attr, store->attrs, size);
+		store->list=g_renew(struct attr *, store->list, size+1);
+	}
+	attr_count_alloc(size*sizeof(struct attr));
+	attr_count_alloc((size+1)*sizeof(struct attr *));
+	for (i = 0 ; i < store->count ; i++)
+		store->list[i]=&store->attrs[i];
+	store->size=size;
+}
+
+/**
+ * @brief Appends an attribute to a store
+ *
+ * @param store The store
+ * @param attr The attribute, its content is copied unless the store was initialized with borrow set
+ * @return The attribute within the store, valid until the next attribute is added
+ */
+struct attr *
+attr_store_add(struct attr_store *store, struct attr *attr)
+{
+	struct attr *ret;
+	int size;
+
+	if (store->count == store->size)
+		attr_store_grow(store);
+	ret=&store->attrs[store->count];
+	store->list[store->count++]=ret;
+	store->list[store->count]=NULL;
+	ret->type=attr->type;
+	if (store->borrow || ATTR_IS_INT(attr->type) || attr->type == attr_item_type || attr->type == attr_order ||
+	    (attr->type >= attr_type_item_type_begin && attr->type <= attr_type_item_type_end)) {
+		ret->u=attr->u;
+	} else if (ATTR_IS_STRING(attr->type)) {
+		ret->u.str=attr_store_strdup(store, attr->u.str);
+	} else if (ATTR_IS_OBJECT(attr->type)) {
+		struct navit_object *obj=attr->u.data;
+		if (HAS_OBJECT_FUNC(attr->type) && obj && obj->func && obj->func->ref)
+			ret->u.data=obj->func->ref(obj);
+		else
+			ret->u.data=obj;
+	} else if ((size=attr_data_size(attr))) {
+		ret->u.data=attr_store_alloc(store, size);
+		memcpy(ret->u.data, attr->u.data, size);
+	} else {
+		ret->u.data=NULL;
+	}
+	return ret;
+}
+
+/**
+ * @brief Returns the attributes of a store as a NULL terminated array
+ *
+ * The array can be passed to attr_generic_get_attr() or callbacks expecting an attribute list.
+ * It belongs to the store and is valid until the next attribute is added.
+ *
+ * @param store The store
+ * @return The attributes
+ */
+struct attr **
+attr_store_get_list(struct attr_store *store)
+{
+	return store->list;
+}
+
+/**
+ * @brief Removes all attributes from a store and frees its memory
+ *
+ * The store is empty afterwards and can be reused.
+ *
+ * @param store The store
+ */
+void
+attr_store_clear(struct attr_store *store)
+{
+	struct attr_store_chunk *chunk=store->chunks,*next;
+	int i;
+
+	if (!store->borrow) {
+		for (i = 0 ; i < store->count ; i++) {
+			struct attr *attr=&store->attrs[i];
+			if (HAS_OBJECT_FUNC(attr->type)) {
+				struct navit_object *obj=attr->u.data;
+				if (obj && obj->func && obj->func->unref)
+					obj->func->unref(obj);
+			}
+		}
+	}
+	while (chunk) {
+		next=chunk->next;
+		g_free(chunk);
+		chunk=next;
+	}
+	if (store->attrs != store->inline_attrs) {
+		g_free(store->attrs);
+		g_free(store->list);
+	}
+	attr_store_init(store, store->borrow);
+}
+
+/**
+ * @brief Returns the number of allocations made for attributes while benchmarking or collecting counters
+ *
+ * @param stats Receives the counters
+ */
+void
+attr_get_stats(struct attr_stats *stats)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&attr_stats_lock);
+#endif
+	*stats=attr_stats;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&attr_stats_lock);
+#endif
+}
@@ -195,6 +195,41 @@ struct attr {
 	} u;
 };
 
+#define ATTR_STORE_INLINE 4
+
+struct attr_store_chunk;
+
+/**
+ * @brief Compact container of attributes, see attr_store_init()
+ *
+ * The attributes are kept by value. The first ATTR_STORE_INLINE of them and a
+ * few bytes of their data live in the container itself, so small lists need no
+ * heap allocation at all. A container must not be copied or moved once it has
+ * been initialized.
+ */
+struct attr_store {
+	struct attr **list;		/**< NULL terminated, see attr_store_get_list() */
+	struct attr *attrs;
+	int count;
+	int size;
+	int borrow;			/**< Content of the attributes is referenced, not copied */
+	int data_used;
+	struct attr_store_chunk *chunks;
+	struct attr *inline_list[ATTR_STORE_INLINE+1];
+	struct attr inline_attrs[ATTR_STORE_INLINE];
+	double inline_data[4];
+};
+
+/**
+ * @brief Allocations made for attributes, see attr_get_stats()
+ */
+struct attr_stats {
+	int allocs;			/**< Heap allocations by attr_dup(), the attr_generic_* functions and attribute stores */
+	long long alloc_bytes;
+	int strings;			/**< Strings copied into attribute stores */
+	long long string_bytes;
+};
+
 struct attr_iter;
 /* prototypes */
 void attr_create_hash(void);
@@ -227,6 +262,11 @@ int attr_from_line(char *line, char *name, int *pos, char *val_ret, char *name_r
 int attr_types_contains(enum attr_type *types, enum attr_type type);
 int attr_types_contains_default(enum attr_type *types, enum attr_type type, int deflt);
 int attr_rel2real(int attrval, int whole, int treat_neg_as_rel);
+void attr_store_init(struct attr_store *store, int borrow);
+struct attr *attr_store_add(struct attr_store *store, struct attr *attr);
+struct attr **attr_store_get_list(struct attr_store *store);
+void attr_store_clear(struct attr_store *store);
+void attr_get_stats(struct attr_stats *stats);
 /* end of prototypes */
 #ifdef __cplusplus
 }
@@ -193,6 +193,11 @@ ATTR(turn_around_count)
 ATTR(turn_around_penalty)
 ATTR(turn_around_penalty2)
 ATTR(autozoom_max)
+ATTR(map_matching_window)
+ATTR(time_warp)
+ATTR(prediction_rate)
+ATTR(priority)
+ATTR(simplified_orders)
 ATTR2(0x00027500,type_rel_abs_begin)
 /* These attributes are int that can either hold relative		*
  * or absolute values. A relative value is indicated by 		*
@@ -0,0 +1,198 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Timing of tracking, rerouting, redraws, announcements and disk reads.
+ *
+ * Once enabled with benchmark_init() (navit -b), the time of each of these
+ * operations is recorded and a summary is written when navit exits. Together
+ * with a vehicle replaying a recorded trip with time_warp and on_eof="exit"
+ * and the null graphics this gives reproducible headless measurements, see
+ * script/replay_benchmark.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "config.h"
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "debug.h"
+#include "util.h"
+#include "types.h"
+#include "file.h"
+#include "cache.h"
+#include "item.h"
+#include "attr.h"
+#include "counter.h"
+#include "benchmark.h"
+
+struct benchmark_samples {
+	double *ms;
+	int count;
+	int size;
+};
+
+int benchmark_enabled;
+static char *benchmark_filename;
+static struct benchmark_samples benchmark_samples[benchmark_type_last];
+static const char *benchmark_names[benchmark_type_last]={"tracking","reroute","redraw","speech","file_read"};
+static struct counter *benchmark_counters[benchmark_type_last];
+#ifdef HAVE_PTHREAD
+/* Disk reads are also timed on the threads opening maps */
+static pthread_mutex_t benchmark_lock=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void
+benchmark_atexit(void)
+{
+	benchmark_write();
+}
+
+/**
+ * @brief Enables the benchmark
+ *
+ * @param filename File the summary is written to at exit, "-" for stdout
+ */
+void
+benchmark_init(const char *filename)
+{
+	if (!benchmark_enabled)
+		atexit(benchmark_atexit);
+	g_free(benchmark_filename);
+	benchmark_filename=g_strdup(filename);
+	benchmark_enabled=1;
+}
+
+/**
+ * @brief Returns the current time for use with benchmark_add()
+ *
+ * @return Time in milliseconds, with an arbitrary origin
+ */
+double
+benchmark_time(void)
+{
+	struct timeval tv;
+
+	if (gettimeofday(&tv, NULL) == -1)
+		return 0;
+	return tv.tv_sec*1000.0+tv.tv_usec/1000.0;
+}
+
+/**
+ * @brief Records one operation
+ *
+ * While performance counters are enabled, the operation is also added to the latency
+ * counter of the same name.
+ *
+ * @param type The operation
+ * @param start Time the operation started, as returned by benchmark_time()
+ */
+void
+benchmark_add(enum benchmark_type type, double start)
+{
+	struct benchmark_samples *samples=&benchmark_samples[type];
+	double ms;
+
+	if (!benchmark_enabled && !counter_enabled)
+		return;
+	ms=benchmark_time()-start;
+	if (counter_enabled) {
+		if (!benchmark_counters[type])
+			benchmark_counters[type]=counter_get(benchmark_names[type], counter_type_latency);
+		counter_add(benchmark_counters[type], ms);
+	}
+	if (!benchmark_enabled)
+		return;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&benchmark_lock);
+#endif
+	if (samples->count == samples->size) {
+		samples->size=samples->size ? samples->size*2 : 256;
+		samples->ms=g_renew(double, samples->ms, samples->size);
+	}
+	samples->ms[samples->count++]=ms;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&benchmark_lock);
+#endif
+}
+
+static int
+benchmark_compare(const void *a, const void *b)
+{
+	double da=*(const double *)a, db=*(const double *)b;
+	if (da != db)
+		return da < db ? -1:1;
+	return 0;
+}
+
+/**
+ * @brief Writes count, total, mean, median, 95th percentile and maximum of every operation
+ *
+ * The prefetch counters of the file layer and the allocations made for attributes are written as well.
+ */
+void
+benchmark_write(void)
+{
+	struct file_stats stats;
+	struct cache_stats cache;
+	struct attr_stats attrs;
+	FILE *f;
+	int i,j;
+
+	if (!benchmark_enabled)
+		return;
+	if (!benchmark_filename || !strcmp(benchmark_filename, "-"))
+		f=stdout;
+	else if (!(f=fopen(benchmark_filename, "w"))) {
+		dbg(lvl_error,"unable to write benchmark to %s\n", benchmark_filename);
+		return;
+	}
+	for (i = 0 ; i < benchmark_type_last ; i++) {
+		struct benchmark_samples *samples=&benchmark_samples[i];
+		double total=0;
+		for (j = 0 ; j < samples->count ; j++)
+			total+=samples->ms[j];
+		qsort(samples->ms, samples->count, sizeof(double), benchmark_compare);
+		if (samples->count)
+			fprintf(f,"%s count=%d total=%.3f mean=%.3f p50=%.3f p95=%.3f max=%.3f\n", benchmark_names[i], samples->count, total,
+				total/samples->count, samples->ms[samples->count/2], samples->ms[samples->count*95/100],
+				samples->ms[samples->count-1]);
+		else
+			fprintf(f,"%s count=0\n", benchmark_names[i]);
+	}
+	file_get_stats(&stats);
+	fprintf(f,"prefetch count=%d bytes="LONGLONG_FMT" hits=%d pending=%d\n", stats.prefetches, stats.prefetch_bytes,
+		stats.prefetch_hits, stats.pending);
+	if (file_get_cache_stats(&cache))
+		fprintf(f,"cache hits=%d misses=%d hit_bytes="LONGLONG_FMT" miss_bytes="LONGLONG_FMT" budget="LONGLONG_FMT" shards=%d\n",
+			cache.hits, cache.misses, cache.hit_bytes, cache.miss_bytes, cache.budget, cache.shards);
+	attr_get_stats(&attrs);
+	fprintf(f,"attr allocs=%d bytes="LONGLONG_FMT" strings=%d string_bytes="LONGLONG_FMT"\n", attrs.allocs, attrs.alloc_bytes,
+		attrs.strings, attrs.string_bytes);
+	if (f == stdout)
+		fflush(f);
+	else
+		fclose(f);
+}
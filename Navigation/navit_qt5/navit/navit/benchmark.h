@@ -0,0 +1,51 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_BENCHMARK_H
+#define NAVIT_BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Operations timed while benchmarking
+ */
+enum benchmark_type {
+	benchmark_tracking,	/**< Map matching of a single position fix */
+	benchmark_reroute,	/**< Route calculation, from the graph update to the finished path */
+	benchmark_redraw,	/**< Map redraw, from loading the map data to the finished drawing */
+	benchmark_speech,	/**< Delay of an announcement in the speech queue */
+	benchmark_file_read,	/**< Blocking read of map data from disk */
+	benchmark_type_last,
+};
+
+extern int benchmark_enabled;
+
+/* prototypes */
+void benchmark_init(const char *filename);
+double benchmark_time(void);
+void benchmark_add(enum benchmark_type type, double start);
+void benchmark_write(void);
+/* end of prototypes */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
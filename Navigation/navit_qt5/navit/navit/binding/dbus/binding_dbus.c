@@ -52,12 +52,17 @@
 #include "util.h"
 #include "transform.h"
 #include "event.h"
+#include "geocode.h"
+#include "poisearch.h"
+#include "benchmark.h"
+#include "counter.h"
 
 static DBusConnection *connection;
 static dbus_uint32_t dbus_serial;
 
 static char *service_name = "org.navit_project.navit";
 static char *object_path = "/org/navit_project/navit";
+static char *navit_interface;	/* service_name".navit", built once by plugin_init() */
 char *navitintrospectxml_head1 = "<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\"\n"
                                  "\"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n"
                                  "<node name=\"";
@@ -267,12 +272,23 @@ encode_dict_string_variant_string(DBusMessageIter *iter, char *key, char *value)
 	dbus_message_iter_close_container(iter, &dict);
 }
 
+/* Returns whether encode_attr_value() knows how to encode attributes of this type */
 static int
-encode_attr(DBusMessageIter *iter1, struct attr *attr)
+encode_attr_supported(enum attr_type type)
+{
+	return (type >= attr_type_int_begin && type <= attr_type_int_end) ||
+		(type >= attr_type_string_begin && type <= attr_type_string_end) ||
+		(type >= attr_type_item_type_begin && type <= attr_type_item_type_end) || type == attr_item_type ||
+		(type >= attr_type_coord_geo_begin && type <= attr_type_coord_geo_end) ||
+		(type >= attr_type_pcoord_begin && type <= attr_type_pcoord_end) ||
+		(type >= attr_type_object_begin && type <= attr_type_object_end) ||
+		type == attr_item_types;
+}
+
+static int
+encode_attr_value(DBusMessageIter *iter1, struct attr *attr)
 {
-	char *name=attr_to_name(attr->type);
 	DBusMessageIter iter2,iter3;
-	dbus_message_iter_append_basic(iter1, DBUS_TYPE_STRING, &name);
 
 	if (attr->type >= attr_type_int_begin && attr->type < attr_type_boolean_begin) {
 		dbus_message_iter_open_container(iter1, DBUS_TYPE_VARIANT, DBUS_TYPE_INT32_AS_STRING, &iter2);
@@ -332,6 +348,14 @@ encode_attr(DBusMessageIter *iter1, struct attr *attr)
 	return 1;
 }
 
+static int
+encode_attr(DBusMessageIter *iter1, struct attr *attr)
+{
+	char *name=attr_to_name(attr->type);
+	dbus_message_iter_append_basic(iter1, DBUS_TYPE_STRING, &name);
+	return encode_attr_value(iter1, attr);
+}
+
 
 static DBusHandlerResult
 empty_reply(DBusConnection *connection, DBusMessage *message)
@@ -563,6 +587,50 @@ decode_attr_type_from_iter(DBusMessageIter *iter)
 	return ret;
 }
 
+/*
+ * Values decoded by decode_attr_from_iter() which don't fit into the attr
+ * itself (doubles and coordinates) are taken from this arena instead of the
+ * heap. It is reset once navit_handler_func() has handled the request, so
+ * decoded attrs are only valid while the request is handled. The attr
+ * setters copy these values.
+ */
+static struct {
+	double data[32];
+	int used;
+	GList *overflow;
+	int depth;
+} request_arena;
+
+static void *
+request_arena_alloc(int size)
+{
+	int count=(size+sizeof(double)-1)/sizeof(double);
+	void *ret;
+
+	if (request_arena.used+count > G_N_ELEMENTS(request_arena.data)) {
+		ret=g_malloc(size);
+		request_arena.overflow=g_list_prepend(request_arena.overflow, ret);
+		return ret;
+	}
+	ret=request_arena.data+request_arena.used;
+	request_arena.used+=count;
+	return ret;
+}
+
+static void
+request_arena_reset(void)
+{
+	GList *l=request_arena.overflow;
+
+	while (l) {
+		g_free(l->data);
+		l=g_list_next(l);
+	}
+	g_list_free(request_arena.overflow);
+	request_arena.overflow=NULL;
+	request_arena.used=0;
+}
+
 static int
 decode_attr_from_iter(DBusMessageIter *iter, struct attr *attr)
 {
@@ -608,7 +676,7 @@ decode_attr_from_iter(DBusMessageIter *iter, struct attr *attr)
         }
 	if(attr->type >= attr_type_double_begin && attr->type <= attr_type_double_end) {
 		if (dbus_message_iter_get_arg_type(&iterattr) == DBUS_TYPE_DOUBLE) {
-			attr->u.numd=g_new(typeof(*attr->u.numd),1);
+			attr->u.numd=request_arena_alloc(sizeof(*attr->u.numd));
 			dbus_message_iter_get_basic(&iterattr, attr->u.numd);
 			return 1;
 		}
@@ -626,7 +694,7 @@ decode_attr_from_iter(DBusMessageIter *iter, struct attr *attr)
 	}
 	if(attr->type >= attr_type_coord_geo_begin && attr->type <= attr_type_coord_geo_end) {
 		if (dbus_message_iter_get_arg_type(&iterattr) == DBUS_TYPE_STRUCT) {
-			attr->u.coord_geo=g_new(typeof(*attr->u.coord_geo),1);
+			attr->u.coord_geo=request_arena_alloc(sizeof(*attr->u.coord_geo));
 			dbus_message_iter_recurse(&iterattr, &iterstruct);
 			if (dbus_message_iter_get_arg_type(&iterstruct) == DBUS_TYPE_DOUBLE) {
 				dbus_message_iter_get_basic(&iterstruct, &d);
@@ -639,17 +707,15 @@ decode_attr_from_iter(DBusMessageIter *iter, struct attr *attr)
 				attr->u.coord_geo->lat=d;
 			} else
 				ret=0;
-			if (!ret) {
-				g_free(attr->u.coord_geo);
+			if (!ret)
 				attr->u.coord_geo=NULL;
-			}
 			return ret;
 		}
 	}
 	if(attr->type >= attr_type_pcoord_begin && attr->type <= attr_type_pcoord_end) {
 		int i;
 		if (dbus_message_iter_get_arg_type(&iterattr) == DBUS_TYPE_STRUCT) {
-			attr->u.pcoord=g_new(typeof(*attr->u.pcoord),1);
+			attr->u.pcoord=request_arena_alloc(sizeof(*attr->u.pcoord));
 			dbus_message_iter_recurse(&iterattr, &iterstruct);
 			if (dbus_message_iter_get_arg_type(&iterstruct) == DBUS_TYPE_INT32) {
 				dbus_message_iter_get_basic(&iterstruct, &i);
@@ -668,10 +734,8 @@ decode_attr_from_iter(DBusMessageIter *iter, struct attr *attr)
 				attr->u.pcoord->y=i;
 			} else
 				ret=0;
-			if (!ret) {
-				g_free(attr->u.pcoord);
+			if (!ret)
 				attr->u.pcoord=NULL;
-			}
 			return ret;
 		}
 	}
@@ -694,14 +758,6 @@ decode_attr(DBusMessage *message, struct attr *attr)
 	return decode_attr_from_iter(&iter, attr);
 }
 
-static void
-destroy_attr(struct attr *attr)
-{
-	if(attr->type > attr_type_double_begin && attr->type < attr_type_double_end) {
-		g_free(attr->u.numd);
-	}
-}
-
 static char *
 get_iter_name(char *type)
 {
@@ -855,7 +911,6 @@ request_set_add_remove_attr(DBusConnection *connection, DBusMessage *message, ch
 
 	if (decode_attr(message, &attr)) {
 		ret=(*func)(data, &attr);
-		destroy_attr(&attr);
 		if (ret)
 			return empty_reply(connection, message);
 		dbg(lvl_error,"failed to set/add/remove attr\n");
@@ -865,6 +920,133 @@ request_set_add_remove_attr(DBusConnection *connection, DBusMessage *message, ch
     	return dbus_error_invalid_parameter(connection, message);
 }
 
+/*
+ * Looks up an attribute given as "name" or as a path like "route.destination_length",
+ * where each component but the last names an object attribute of the object before it.
+ */
+static int
+get_attr_by_path(void *data, int (*func)(void *data, enum attr_type type, struct attr *attr, struct attr_iter *iter), char *path, struct attr *attr)
+{
+	char *name=path,*next,buffer[64];
+	enum attr_type type;
+	struct object_func *obj_func;
+
+	while ((next=strchr(name, '.'))) {
+		if (next-name >= sizeof(buffer))
+			return 0;
+		memcpy(buffer, name, next-name);
+		buffer[next-name]='\0';
+		type=attr_from_name(buffer);
+		if (!HAS_OBJECT_FUNC(type) || !(obj_func=object_func_lookup(type)) || !obj_func->get_attr)
+			return 0;
+		if (!func(data, type, attr, NULL) || !attr->u.data)
+			return 0;
+		data=attr->u.data;
+		func=obj_func->get_attr;
+		name=next+1;
+	}
+	type=attr_from_name(name);
+	if (type == attr_none)
+		return 0;
+	return func(data, type, attr, NULL);
+}
+
+/*
+ * Answers an array of attribute names or paths (see get_attr_by_path()) with a
+ * dict holding the value of each attribute that is available, keyed by the
+ * name as requested. Missing attributes are left out.
+ */
+static DBusHandlerResult
+request_get_attrs(DBusConnection *connection, DBusMessage *message, char *type, void *data, int (*func)(void *data, enum attr_type type, struct attr *attr, struct attr_iter *iter))
+{
+	DBusMessage *reply;
+	DBusMessageIter iter, names, iter1, dict, entry;
+	struct attr attr;
+	char *name;
+
+	if (! data)
+		data = object_get_from_message(message, type);
+	if (! data)
+		return dbus_error_invalid_object_path(connection, message);
+
+	dbus_message_iter_init(message, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+		return dbus_error_invalid_parameter(connection, message);
+	dbus_message_iter_recurse(&iter, &names);
+
+	reply = dbus_message_new_method_return(message);
+	dbus_message_iter_init_append(reply, &iter1);
+	dbus_message_iter_open_container(&iter1, DBUS_TYPE_ARRAY, "{sv}", &dict);
+	while (dbus_message_iter_get_arg_type(&names) == DBUS_TYPE_STRING) {
+		dbus_message_iter_get_basic(&names, &name);
+		dbus_message_iter_next(&names);
+		if (!get_attr_by_path(data, func, name, &attr) || !encode_attr_supported(attr.type)) {
+			dbg(lvl_debug,"no value for %s\n", name);
+			continue;
+		}
+		dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+		dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &name);
+		encode_attr_value(&entry, &attr);
+		dbus_message_iter_close_container(&dict, &entry);
+	}
+	dbus_message_iter_close_container(&iter1, &dict);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/*
+ * Sets all attributes of a dict of names and values. All of them are decoded
+ * before the first one is set, so a malformed request changes nothing.
+ * Setting them is not atomic: when a setter fails, the other attributes are
+ * set anyway and the error names the attributes which were not set.
+ */
+static DBusHandlerResult
+request_set_attrs(DBusConnection *connection, DBusMessage *message, char *type, void *data, int (*func)(void *data, struct attr *attr))
+{
+	DBusMessageIter iter, dict, entry;
+	struct attr_store store;
+	struct attr attr, **attrs;
+	char *failed=NULL, *tmp;
+	DBusHandlerResult ret;
+
+	if (! data)
+		data = object_get_from_message(message, type);
+	if (! data)
+		return dbus_error_invalid_object_path(connection, message);
+
+	dbus_message_iter_init(message, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+		return dbus_error_invalid_parameter(connection, message);
+	dbus_message_iter_recurse(&iter, &dict);
+	/* The decoded values live in the message and the request arena */
+	attr_store_init(&store, 1);
+	while (dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse(&dict, &entry);
+		dbus_message_iter_next(&dict);
+		if (!decode_attr_from_iter(&entry, &attr)) {
+			dbg(lvl_error,"failed to decode attr\n");
+			attr_store_clear(&store);
+			return dbus_error_invalid_parameter(connection, message);
+		}
+		attr_store_add(&store, &attr);
+	}
+	for (attrs=attr_store_get_list(&store) ; *attrs ; attrs++) {
+		if (!func(data, *attrs)) {
+			dbg(lvl_error,"failed to set attr %s\n", attr_to_name((*attrs)->type));
+			tmp=failed;
+			failed=g_strconcat(failed ? failed : "attributes not set:", " ", attr_to_name((*attrs)->type), NULL);
+			g_free(tmp);
+		}
+	}
+	attr_store_clear(&store);
+	if (!failed)
+		return empty_reply(connection, message);
+	ret=dbus_error(connection, message, DBUS_ERROR_INVALID_ARGS, failed);
+	g_free(failed);
+	return ret;
+}
+
 /* callback */
 
 
@@ -1620,6 +1802,12 @@ request_navit_get_attr(DBusConnection *connection, DBusMessage *message)
 	return request_get_attr(connection, message, "navit", NULL, (int (*)(void *, enum attr_type, struct attr *, struct attr_iter *))navit_get_attr);
 }
 
+static DBusHandlerResult
+request_navit_get_attrs(DBusConnection *connection, DBusMessage *message)
+{
+	return request_get_attrs(connection, message, "navit", NULL, (int (*)(void *, enum attr_type, struct attr *, struct attr_iter *))navit_get_attr);
+}
+
 static DBusHandlerResult
 request_navit_attr_iter(DBusConnection *connection, DBusMessage *message)
 {
@@ -1656,6 +1844,12 @@ request_navit_set_attr(DBusConnection *connection, DBusMessage *message)
 	return request_set_add_remove_attr(connection, message, "navit", NULL, (int (*)(void *, struct attr *))navit_set_attr);
 }
 
+static DBusHandlerResult
+request_navit_set_attrs(DBusConnection *connection, DBusMessage *message)
+{
+	return request_set_attrs(connection, message, "navit", NULL, (int (*)(void *, struct attr *))navit_set_attr);
+}
+
 static DBusHandlerResult
 request_navit_add_attr(DBusConnection *connection, DBusMessage *message)
 {
@@ -1732,6 +1926,235 @@ request_navit_set_destination(DBusConnection *connection, DBusMessage *message)
 	return empty_reply(connection, message);
 }
 
+static void
+encode_geocode_result(DBusMessageIter *iter, struct geocode_result *result)
+{
+	DBusMessageIter dict,entry,variant;
+	char *distance="distance";
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+	if (result->street_name)
+		encode_dict_string_variant_string(&dict, "street_name", result->street_name);
+	if (result->house_number)
+		encode_dict_string_variant_string(&dict, "house_number", result->house_number);
+	if (result->town_name)
+		encode_dict_string_variant_string(&dict, "town_name", result->town_name);
+	if (result->postal)
+		encode_dict_string_variant_string(&dict, "postal", result->postal);
+	dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &distance);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, DBUS_TYPE_INT32_AS_STRING, &variant);
+	dbus_message_iter_append_basic(&variant, DBUS_TYPE_INT32, &result->distance);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(&dict, &entry);
+	dbus_message_iter_close_container(iter, &dict);
+}
+
+static void
+encode_dict_string_variant_basic(DBusMessageIter *iter, char *key, int type, void *value)
+{
+	DBusMessageIter entry,variant;
+	char signature[2]={type,'\0'};
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, signature, &variant);
+	dbus_message_iter_append_basic(&variant, type, value);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(iter, &entry);
+}
+
+static void
+encode_counter_value(DBusMessageIter *iter, struct counter_value *value)
+{
+	DBusMessageIter dict,entry,variant,array;
+	char *buckets="buckets";
+	const int *bucket=value->buckets;
+	dbus_int64_t count=value->count;
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+	encode_dict_string_variant_string(&dict, "name", (char *)value->name);
+	encode_dict_string_variant_string(&dict, "type", value->type == counter_type_latency ? "latency":"count");
+	encode_dict_string_variant_basic(&dict, "count", DBUS_TYPE_INT64, &count);
+	encode_dict_string_variant_basic(&dict, "total", DBUS_TYPE_DOUBLE, &value->total);
+	encode_dict_string_variant_basic(&dict, "min", DBUS_TYPE_DOUBLE, &value->min);
+	encode_dict_string_variant_basic(&dict, "max", DBUS_TYPE_DOUBLE, &value->max);
+	if (value->type == counter_type_latency) {
+		dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+		dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &buckets);
+		dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "ai", &variant);
+		dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, DBUS_TYPE_INT32_AS_STRING, &array);
+		dbus_message_iter_append_fixed_array(&array, DBUS_TYPE_INT32, &bucket, COUNTER_BUCKETS);
+		dbus_message_iter_close_container(&variant, &array);
+		dbus_message_iter_close_container(&entry, &variant);
+		dbus_message_iter_close_container(&dict, &entry);
+	}
+	dbus_message_iter_close_container(iter, &dict);
+}
+
+/**
+ * @brief Returns the performance counters
+ *
+ * Replies with one dictionary per counter, holding name, type ("count" or "latency"),
+ * count, total, min and max and for latency counters the histogram as buckets, see
+ * struct counter_value. Latencies are in milliseconds.
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_navit_get_counters(DBusConnection *connection, DBusMessage *message)
+{
+	struct counter_value *values;
+	DBusMessage *reply;
+	DBusMessageIter iter,iter2;
+	int i,count;
+
+	values=counter_get_values(&count);
+	reply = dbus_message_new_method_return(message);
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "a{sv}", &iter2);
+	for (i = 0 ; i < count ; i++)
+		encode_counter_value(&iter2, &values[i]);
+	dbus_message_iter_close_container(&iter, &iter2);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	g_free(values);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/**
+ * @brief Enables or disables the performance counters
+ *
+ * Takes the interval in seconds to log the counters at, 0 to collect them without
+ * logging and a negative value to stop collecting them.
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_navit_set_counters(DBusConnection *connection, DBusMessage *message)
+{
+	DBusMessageIter iter;
+	int interval;
+
+	dbus_message_iter_init(message, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_INT32)
+		return dbus_error_invalid_parameter(connection, message);
+	dbus_message_iter_get_basic(&iter, &interval);
+	if (interval < 0)
+		counter_disable();
+	else
+		counter_init(interval);
+	return empty_reply(connection, message);
+}
+
+static void
+navit_reverse_geocode_or_empty(struct navit *navit, struct pcoord *pc, struct geocode_result *result)
+{
+	if (!navit_reverse_geocode(navit, pc, result)) {
+		memset(result, 0, sizeof(*result));
+		result->distance=-1;
+	}
+}
+
+/**
+ * @brief Returns street, house number and town at a coordinate
+ *
+ * The reply is a dictionary with the keys street_name, house_number, town_name and postal
+ * (each only if known) and distance (meters to the street, -1 if there is none nearby).
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_navit_reverse_geocode(DBusConnection *connection, DBusMessage *message)
+{
+	struct pcoord pc;
+	struct navit *navit;
+	struct geocode_result result;
+	DBusMessage *reply;
+	DBusMessageIter iter;
+
+	navit = object_get_from_message(message, "navit");
+	if (! navit)
+		return dbus_error_invalid_object_path(connection, message);
+
+	dbus_message_iter_init(message, &iter);
+	if (!pcoord_get_from_message(message, &iter, &pc))
+		return dbus_error_invalid_parameter(connection, message);
+
+	navit_reverse_geocode_or_empty(navit, &pc, &result);
+	reply = dbus_message_new_method_return(message);
+	dbus_message_iter_init_append(reply, &iter);
+	encode_geocode_result(&iter, &result);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/**
+ * @brief Returns street, house number and town for a list of coordinates
+ *
+ * Takes an array of (longitude,latitude) pairs and replies with one dictionary per
+ * coordinate, in the same order and with the same keys as reverse_geocode.
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_navit_reverse_geocode_batch(DBusConnection *connection, DBusMessage *message)
+{
+	struct navit *navit;
+	struct geocode_result result;
+	DBusMessage *reply;
+	DBusMessageIter iter,iter2,iter_out,iter_out2;
+	char *signature;
+	int valid;
+
+	navit = object_get_from_message(message, "navit");
+	if (! navit)
+		return dbus_error_invalid_object_path(connection, message);
+
+	dbus_message_iter_init(message, &iter);
+	signature=dbus_message_iter_get_signature(&iter);
+	valid=!strcmp(signature, "a(dd)");
+	dbus_free(signature);
+	if (!valid)
+		return dbus_error_invalid_parameter(connection, message);
+
+	reply = dbus_message_new_method_return(message);
+	dbus_message_iter_init_append(reply, &iter_out);
+	dbus_message_iter_open_container(&iter_out, DBUS_TYPE_ARRAY, "a{sv}", &iter_out2);
+	dbus_message_iter_recurse(&iter, &iter2);
+	while (dbus_message_iter_get_arg_type(&iter2) == DBUS_TYPE_STRUCT) {
+		DBusMessageIter iter3;
+		struct coord_geo g;
+		struct coord c;
+		struct pcoord pc;
+
+		dbus_message_iter_recurse(&iter2, &iter3);
+		dbus_message_iter_get_basic(&iter3, &g.lng);
+		dbus_message_iter_next(&iter3);
+		dbus_message_iter_get_basic(&iter3, &g.lat);
+		transform_from_geo(projection_mg, &g, &c);
+		pc.pro=projection_mg;
+		pc.x=c.x;
+		pc.y=c.y;
+		navit_reverse_geocode_or_empty(navit, &pc, &result);
+		encode_geocode_result(&iter_out2, &result);
+		dbus_message_iter_next(&iter2);
+	}
+	dbus_message_iter_close_container(&iter_out, &iter_out2);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
 /**
  * @brief Sends estimated time and length for the route between 2 points
  *
@@ -1796,6 +2219,63 @@ request_navit_search_pois(DBusConnection *connection, DBusMessage *message)
 }
 
 
+/**
+ * @brief Starts a POI search around a coordinate
+ *
+ * Takes the center, the maximum distance in meters and the names of the item types to
+ * search for (e.g. poi_fuel), an empty array searches for all POIs. Replies with a
+ * poi_search object whose results are fetched with get_results.
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_navit_poi_search_new(DBusConnection *connection, DBusMessage *message)
+{
+	struct pcoord pc;
+	struct navit *navit;
+	struct poi_search *poi_search;
+	DBusMessageIter iter,iter2;
+	DBusMessage *reply;
+	enum item_type *types=NULL;
+	char *opath;
+	int dist,type_count=0;
+
+	navit = object_get_from_message(message, "navit");
+	if (! navit)
+		return dbus_error_invalid_object_path(connection, message);
+
+	dbus_message_iter_init(message, &iter);
+	if (!pcoord_get_from_message(message, &iter, &pc))
+		return dbus_error_invalid_parameter(connection, message);
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_get_basic(&iter, &dist);
+	dbus_message_iter_next(&iter);
+
+	dbus_message_iter_recurse(&iter, &iter2);
+	while (dbus_message_iter_get_arg_type(&iter2) == DBUS_TYPE_STRING) {
+		char *name;
+		dbus_message_iter_get_basic(&iter2, &name);
+		types=g_renew(enum item_type, types, type_count+1);
+		if ((types[type_count++]=item_from_name(name)) == type_none) {
+			g_free(types);
+			return dbus_error_invalid_parameter(connection, message);
+		}
+		dbus_message_iter_next(&iter2);
+	}
+	poi_search=poi_search_new(navit_get_mapset(navit), &pc, dist, types, type_count);
+	g_free(types);
+
+	opath=object_new("poi_search", poi_search);
+	reply = dbus_message_new_method_return(message);
+	dbus_message_append_args(reply, DBUS_TYPE_OBJECT_PATH, &opath, DBUS_TYPE_INVALID);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+
 static DBusHandlerResult
 request_navit_clear_destination(DBusConnection *connection, DBusMessage *message)
 {
@@ -1837,6 +2317,103 @@ request_navit_evaluate(DBusConnection *connection, DBusMessage *message)
 	return DBUS_HANDLER_RESULT_HANDLED;
 }
 
+/* poi_search */
+
+static DBusHandlerResult
+request_poi_search_destroy(DBusConnection *connection, DBusMessage *message)
+{
+	return request_destroy(connection, message, "poi_search", NULL, (void (*)(void *)) poi_search_destroy);
+}
+
+/**
+ * @brief Returns the next results of a POI search, nearest first
+ *
+ * Replies with up to the requested number of dictionaries with the same keys as the
+ * signals sent for search_pois. An empty array means there are no more results.
+ *
+ * @param connection dbus connection
+ * @param message dbus message
+ * @returns dbus status
+ */
+static DBusHandlerResult
+request_poi_search_get_results(DBusConnection *connection, DBusMessage *message)
+{
+	struct poi_search *poi_search;
+	struct poi_search_result *results;
+	DBusMessage *reply;
+	DBusMessageIter iter,iter2,iter3,iter4;
+	int i,count;
+
+	poi_search = object_get_from_message(message, "poi_search");
+	if (! poi_search)
+		return dbus_error_invalid_object_path(connection, message);
+	dbus_message_get_args(message, NULL, DBUS_TYPE_INT32, &count, DBUS_TYPE_INVALID);
+	if (count <= 0)
+		return dbus_error_invalid_parameter(connection, message);
+
+	count=poi_search_get_results(poi_search, count, &results);
+	reply = dbus_message_new_method_return(message);
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "a{sv}", &iter2);
+	for (i = 0 ; i < count ; i++) {
+		struct attr attr;
+		struct coord_geo g;
+		struct pcoord pc;
+
+		dbus_message_iter_open_container(&iter2, DBUS_TYPE_ARRAY, "{sv}", &iter3);
+		dbus_message_iter_open_container(&iter3, DBUS_TYPE_DICT_ENTRY, NULL, &iter4);
+		attr.type=attr_item_type;
+		attr.u.item_type=results[i].type;
+		encode_attr(&iter4, &attr);
+		dbus_message_iter_close_container(&iter3, &iter4);
+		dbus_message_iter_open_container(&iter3, DBUS_TYPE_DICT_ENTRY, NULL, &iter4);
+		transform_to_geo(projection_mg, &results[i].c, &g);
+		attr.type=attr_position_coord_geo;
+		attr.u.coord_geo=&g;
+		encode_attr(&iter4, &attr);
+		dbus_message_iter_close_container(&iter3, &iter4);
+		dbus_message_iter_open_container(&iter3, DBUS_TYPE_DICT_ENTRY, NULL, &iter4);
+		attr.type=attr_static_distance;
+		attr.u.num=results[i].distance;
+		encode_attr(&iter4, &attr);
+		dbus_message_iter_close_container(&iter3, &iter4);
+		pc.pro=projection_mg;
+		pc.x=results[i].c.x;
+		pc.y=results[i].c.y;
+		if (navit_create_curr_position_distance_attr(&pc, &attr)) {
+			dbus_message_iter_open_container(&iter3, DBUS_TYPE_DICT_ENTRY, NULL, &iter4);
+			encode_attr(&iter4, &attr);
+			dbus_message_iter_close_container(&iter3, &iter4);
+		}
+		encode_dict_string_variant_string(&iter3, "label", results[i].label);
+		encode_dict_string_variant_string(&iter3, "address", results[i].address);
+		dbus_message_iter_close_container(&iter2, &iter3);
+	}
+	dbus_message_iter_close_container(&iter, &iter2);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static DBusHandlerResult
+request_poi_search_skip(DBusConnection *connection, DBusMessage *message)
+{
+	struct poi_search *poi_search;
+	DBusMessage *reply;
+	int count;
+
+	poi_search = object_get_from_message(message, "poi_search");
+	if (! poi_search)
+		return dbus_error_invalid_object_path(connection, message);
+	dbus_message_get_args(message, NULL, DBUS_TYPE_INT32, &count, DBUS_TYPE_INVALID);
+	count=poi_search_skip(poi_search, count);
+	reply = dbus_message_new_method_return(message);
+	dbus_message_append_args(reply, DBUS_TYPE_INT32, &count, DBUS_TYPE_INVALID);
+	dbus_connection_send (connection, reply, NULL);
+	dbus_message_unref (reply);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
 /* search_list */
 
 static DBusHandlerResult
@@ -2040,7 +2617,6 @@ request_vehicle_set_attr(DBusConnection *connection, DBusMessage *message)
 		return dbus_error_invalid_object_path(connection, message);
 	if (decode_attr(message, &attr)) {
 		ret=vehicle_set_attr(vehicle, &attr);
-		destroy_attr(&attr);
 		if (ret)
 			return empty_reply(connection, message);
 	}
@@ -2151,7 +2727,9 @@ struct dbus_method {
 	{".navit",  "attr_iter_destroy",   "o",       "attr_iter",                               "",   "",      request_navit_attr_iter_destroy},
 	{".navit",  "get_attr",            "s",       "attribute",                               "sv",  "attrname,value", request_navit_get_attr},
 	{".navit",  "get_attr_wi",         "so",      "attribute,attr_iter",                     "sv",  "attrname,value", request_navit_get_attr},
+	{".navit",  "get_attrs",           "as",      "attributes",                              "a{sv}", "values", request_navit_get_attrs},
 	{".navit",  "set_attr",            "sv",      "attribute,value",                         "",   "",      request_navit_set_attr},
+	{".navit",  "set_attrs",           "a{sv}",   "values",                                  "",   "",      request_navit_set_attrs},
 	{".navit",  "add_attr",            "sv",      "attribute,value",                         "",   "",      request_navit_add_attr},
 	{".navit",  "remove_attr",         "sv",      "attribute,value",                         "",   "",      request_navit_remove_attr},
 	{".navit",  "set_position",        "s",       "(coordinates)",                           "",   "",      request_navit_set_position},
@@ -2163,10 +2741,18 @@ struct dbus_method {
 	{".navit",  "clear_destination",   "",        "",                                        "",   "",      request_navit_clear_destination},
 	{".navit",  "add_waypoint",        "s",       "(coordinates)",                           "",   "",      request_navit_add_waypoint},
 	{".navit",  "search_pois",         "ss",      "coordinates,distance",                    "",   "",      request_navit_search_pois},
+	{".navit",  "poi_search_new",      "sias",    "coordinates,distance,item_types",         "o",  "poi_search", request_navit_poi_search_new},
+	{".navit",  "poi_search_new",      "(is)ias", "(projection,coordinates)distance,item_types", "o", "poi_search", request_navit_poi_search_new},
 	{".navit",  "draw_sel_point",          "s",       "coordinates",                         "",   "",      request_navit_draw_sel_point},
 	{".navit",  "clear_sel_point",   "",        "",                                          "",   "",      request_navit_clear_sel_point},
 	{".navit",  "evaluate", 	   "s",	      "command",				 "s",  "",      request_navit_evaluate},
 	{".navit",  "send_length_time",     "ss",      "coordinates,coordinates",                     "",   "",      request_navit_dbus_send_dest_time_length},
+	{".navit",  "reverse_geocode",     "s",       "(coordinates)",                           "a{sv}", "address", request_navit_reverse_geocode},
+	{".navit",  "reverse_geocode",     "(is)",    "(projection,coordinates)",                "a{sv}", "address", request_navit_reverse_geocode},
+	{".navit",  "reverse_geocode",     "(iii)",   "(projection,longitude,latitude)",         "a{sv}", "address", request_navit_reverse_geocode},
+	{".navit",  "reverse_geocode_batch", "a(dd)", "coordinates",                             "aa{sv}", "addresses", request_navit_reverse_geocode_batch},
+	{".navit",  "get_counters",        "",        "",                                        "aa{sv}", "counters", request_navit_get_counters},
+	{".navit",  "set_counters",        "i",       "interval",                                "",   "",      request_navit_set_counters},
 	{".layout", "get_attr",		   "s",	      "attribute",                               "sv",  "attrname,value", request_layout_get_attr},
 	{".map",    "get_attr",            "s",       "attribute",                               "sv",  "attrname,value", request_map_get_attr},
 	{".map",    "set_attr",            "sv",      "attribute,value",                         "",   "",      request_map_set_attr},
@@ -2189,6 +2775,9 @@ struct dbus_method {
 	{".route",    "remove_attr",       "sv",      "attribute,value",                         "",    "",  request_route_remove_attr},
 	{".route",    "destroy",           "",        "",                                        "",    "",  request_route_destroy},
 	{".route",    "dup",               "",        "",                                        "",    "",  request_route_dup},
+	{".poi_search","destroy",          "",        "",                                        "",   "",      request_poi_search_destroy},
+	{".poi_search","get_results",      "i",       "count",                                   "aa{sv}", "pois", request_poi_search_get_results},
+	{".poi_search","skip",             "i",       "count",                                   "i",  "skipped", request_poi_search_skip},
 	{".search_list","destroy",         "",        "",                                        "",   "",      request_search_list_destroy},
 	{".search_list","destroy",         "",        "",                                        "",   "",      request_search_list_destroy},
 	{".search_list","destroy",         "",        "",                                        "",   "",      request_search_list_destroy},
@@ -2234,6 +2823,46 @@ introspect_path(const char *object)
 	return ret;
 }
 
+/* "<interface> <method>" to the index+1 of its first entry in dbus_methods, built by dbus_methods_init() */
+static GHashTable *dbus_method_hash;
+/* Index+1 of the next entry with the same interface and method but another signature, 0 at the end */
+static int dbus_method_next[sizeof(dbus_methods)/sizeof(struct dbus_method)];
+
+static void
+dbus_methods_init(void)
+{
+	int i=sizeof(dbus_methods)/sizeof(struct dbus_method);
+
+	dbus_method_hash=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	/* Walk backwards so the chains keep the order of the table, the first matching signature wins */
+	while (i-- > 0) {
+		char *key=g_strdup_printf("%s%s %s", service_name, dbus_methods[i].path, dbus_methods[i].method);
+		dbus_method_next[i]=GPOINTER_TO_INT(g_hash_table_lookup(dbus_method_hash, key));
+		g_hash_table_replace(dbus_method_hash, key, GINT_TO_POINTER(i+1));
+	}
+}
+
+static struct dbus_method *
+dbus_method_lookup(DBusMessage *message)
+{
+	const char *interface=dbus_message_get_interface(message);
+	const char *member=dbus_message_get_member(message);
+	char key[256];
+	int i;
+
+	if (!dbus_method_hash || dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL || !interface || !member)
+		return NULL;
+	if (snprintf(key, sizeof(key), "%s %s", interface, member) >= sizeof(key))
+		return NULL;
+	i=GPOINTER_TO_INT(g_hash_table_lookup(dbus_method_hash, key));
+	while (i) {
+		if (dbus_message_has_signature(message, dbus_methods[i-1].signature))
+			return &dbus_methods[i-1];
+		i=dbus_method_next[i-1];
+	}
+	return NULL;
+}
+
 static char *
 generate_navitintrospectxml(const char *object)
 {
@@ -2280,11 +2909,29 @@ generate_navitintrospectxml(const char *object)
     return navitintrospectxml;
 }
 
+static struct counter *dbus_method_counters[sizeof(dbus_methods)/sizeof(struct dbus_method)];
+
+/* Adds the time taken by a request to the counter "dbus_request" and a counter per method like "dbus.navit.get_attr" */
+static void
+dbus_method_count(struct dbus_method *method, double start)
+{
+	int i=method-dbus_methods;
+
+	if (!dbus_method_counters[i]) {
+		char *name=g_strdup_printf("dbus%s.%s", method->path, method->method);
+		dbus_method_counters[i]=counter_get(name, counter_type_latency);
+		g_free(name);
+	}
+	counter_add(dbus_method_counters[i], benchmark_time()-start);
+	counter_latency("dbus_request", start);
+}
+
 static DBusHandlerResult
 navit_handler_func(DBusConnection *connection, DBusMessage *message, void *user_data)
 {
-	int i;
-	char *path;
+	struct dbus_method *method;
+	DBusHandlerResult ret;
+	double start;
 	dbg(lvl_debug,"type=%s interface=%s path=%s member=%s signature=%s\n", dbus_message_type_to_string(dbus_message_get_type(message)), dbus_message_get_interface(message), dbus_message_get_path(message), dbus_message_get_member(message), dbus_message_get_signature(message));
 	if (dbus_message_is_method_call (message, "org.freedesktop.DBus.Introspectable", "Introspect")) {
 		DBusMessage *reply;
@@ -2301,16 +2948,17 @@ navit_handler_func(DBusConnection *connection, DBusMessage *message, void *user_
 		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 	}
 
-    for (i = 0 ; i < sizeof(dbus_methods)/sizeof(struct dbus_method) ; i++) {
-		path=g_strdup_printf("%s%s", service_name, dbus_methods[i].path);
-		if (dbus_message_is_method_call(message, path, dbus_methods[i].method) &&
-		    dbus_message_has_signature(message, dbus_methods[i].signature)) {
-			g_free(path);
-			return dbus_methods[i].func(connection, message);
-		}
-		g_free(path);
-	}
-	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	method=dbus_method_lookup(message);
+	if (!method)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	start=counter_enabled ? benchmark_time() : 0;
+	request_arena.depth++;
+	ret=method->func(connection, message);
+	if (!--request_arena.depth)
+		request_arena_reset();
+	if (start)
+		dbus_method_count(method, start);
+	return ret;
 }
 
 static DBusObjectPathVTable dbus_navit_vtable = {
@@ -2335,10 +2983,9 @@ dbus_cmd_send_signal(struct navit *navit, char *command, struct attr **in, struc
 {
 	DBusMessage* msg;
 	char *opath=object_new("navit",navit);
-	char *interface=g_strdup_printf("%s%s", service_name, ".navit");
-	dbg(lvl_debug,"enter %s %s %s\n",opath,command,interface);
+	dbg(lvl_debug,"enter %s %s %s\n",opath,command,navit_interface);
 
-	msg = dbus_message_new_signal(opath, interface, "signal");
+	msg = dbus_message_new_signal(opath, navit_interface, "signal");
 	if (msg) {
 		DBusMessageIter iter1,iter2,iter3;
 		dbus_message_iter_init_append(msg, &iter1);
@@ -2356,7 +3003,6 @@ dbus_cmd_send_signal(struct navit *navit, char *command, struct attr **in, struc
 		dbus_connection_flush(connection);
 		dbus_message_unref(msg);
 	}
-	g_free(interface);
 	return 0;
 }
 
@@ -2374,14 +3020,12 @@ dbus_main_navit(struct navit *navit, int added)
 	if (added==1) {
 		DBusMessage* msg;
 		char *opath=object_new("navit",navit);
-		char *interface=g_strdup_printf("%s%s", service_name, ".navit");
 		command_add_table_attr(commands, sizeof(commands)/sizeof(struct command_table), navit, &attr);
 		navit_add_attr(navit, &attr);
-		msg = dbus_message_new_signal(opath, interface, "startup");
+		msg = dbus_message_new_signal(opath, navit_interface, "startup");
 		dbus_connection_send(connection, msg, &dbus_serial);
 		dbus_connection_flush(connection);
 		dbus_message_unref(msg);
-		g_free(interface);
 	}
 }
 
@@ -2393,6 +3037,8 @@ void plugin_init(void)
 	object_hash=g_hash_table_new(g_str_hash, g_str_equal);
 	object_hash_rev=g_hash_table_new(NULL, NULL);
 	object_count=g_hash_table_new(g_str_hash, g_str_equal);
+	navit_interface=g_strdup_printf("%s.navit", service_name);
+	dbus_methods_init();
 	dbg(lvl_debug,"enter\n");
 	dbus_error_init(&error);
 #ifdef DBUS_USE_SYSTEM_BUS
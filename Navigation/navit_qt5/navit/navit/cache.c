@@ -1,11 +1,25 @@
+#include "config.h"
 #include "glib_slice.h"
 #ifdef DEBUG_CACHE
 #include <stdio.h>
 #endif
 #include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "debug.h"
+#include "types.h"
 #include "cache.h"
 
+/*
+ * The cache is split into shards selected by the hash of the id. Every shard is a
+ * complete 2Q-style cache (T1/T2 with the phantom lists B1/B2) with its own share of
+ * the byte budget and its own lock, so threads using different ids rarely wait for
+ * each other. Data returned by cache_lookup() or cache_insert_new() stays valid until
+ * it is released with cache_entry_destroy(). Data from cache_entry_new() is only seen
+ * by other users after cache_insert(), so it should be filled in before.
+ */
+
 struct cache_entry {
 	int usage;
 	int size;
@@ -20,15 +34,33 @@ struct cache_entry_list {
 	int size;
 };
 
-struct cache {
-	struct cache_entry_list t1,b1,t2,b2,*insert;
-	int size,id_size,entry_size;
+struct cache_shard {
+	struct cache_entry_list t1,b1,t2,b2;
+	int size;
 	int t1_target;
-	int misses;
-	int hits;
+	int hits,misses;
+	long long hit_bytes,miss_bytes;
 	GHashTable *hash;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
 };
 
+struct cache {
+	int id_size,entry_size;
+	int shard_count;
+	GHashFunc hash_func;
+	struct cache_shard *shards;
+};
+
+#ifdef HAVE_PTHREAD
+#define cache_shard_lock(shard) pthread_mutex_lock(&(shard)->lock)
+#define cache_shard_unlock(shard) pthread_mutex_unlock(&(shard)->lock)
+#else
+#define cache_shard_lock(shard)
+#define cache_shard_unlock(shard)
+#endif
+
 static void
 cache_entry_dump(struct cache *cache, struct cache_entry *entry)
 {
@@ -90,37 +122,79 @@ cache_equal20(gconstpointer a, gconstpointer b)
 	       ida[4] == idb[4]);
 }
 
+/**
+ * @brief Creates a new cache
+ *
+ * @param id_size Size of the ids in bytes, 4 or 20
+ * @param size Budget of the cache in bytes, including the bookkeeping of the entries
+ * @param shards Number of independently locked shards the budget is split into
+ * @return The new cache, NULL if the id size is not supported
+ */
 struct cache *
-cache_new(int id_size, int size)
+cache_new(int id_size, int size, int shards)
 {
-	struct cache *cache=g_new0(struct cache, 1);
-	
-	cache->id_size=id_size/4;
-	cache->entry_size=cache->id_size*sizeof(int)+sizeof(struct cache_entry);
-	cache->size=size;
+	struct cache *cache;
+	GEqualFunc equal_func;
+	int i;
+
 	switch (id_size) {
 	case 4:
-		cache->hash=g_hash_table_new(cache_hash4, cache_equal4);
+		equal_func=cache_equal4;
 		break;
 	case 20:
-		cache->hash=g_hash_table_new(cache_hash20, cache_equal20);
+		equal_func=cache_equal20;
 		break;
 	default:
 		dbg(lvl_error,"cache with id_size of %d not supported\n", id_size);
-		g_free(cache);
-		cache=NULL;
+		return NULL;
 	}
+	cache=g_new0(struct cache, 1);
+	cache->id_size=id_size/4;
+	cache->entry_size=cache->id_size*sizeof(int)+sizeof(struct cache_entry);
+	cache->hash_func=id_size == 4 ? cache_hash4 : cache_hash20;
+	cache->shard_count=MAX(shards, 1);
+	cache->shards=g_new0(struct cache_shard, cache->shard_count);
+	for (i = 0 ; i < cache->shard_count ; i++) {
+		cache->shards[i].hash=g_hash_table_new(cache->hash_func, equal_func);
+#ifdef HAVE_PTHREAD
+		pthread_mutex_init(&cache->shards[i].lock, NULL);
+#endif
+	}
+	cache_resize(cache, size);
 	return cache;
 }
 
+/**
+ * @brief Changes the budget of a cache
+ *
+ * Entries are only evicted as new ones are inserted.
+ *
+ * @param cache The cache
+ * @param size The new budget in bytes
+ */
 void
 cache_resize(struct cache *cache, int size)
 {
-	cache->size=size;
+	int i;
+	for (i = 0 ; i < cache->shard_count ; i++) {
+		struct cache_shard *shard=&cache->shards[i];
+		cache_shard_lock(shard);
+		shard->size=MAX(size/cache->shard_count, 1);
+		cache_shard_unlock(shard);
+	}
+}
+
+static struct cache_shard *
+cache_get_shard(struct cache *cache, void *id)
+{
+	guint hash=cache->hash_func(id);
+	/* The hash tables of the shards use the same hash, so mix it before picking the shard */
+	hash=(hash^(hash >> 16))*0x45d9f3b;
+	return &cache->shards[(hash^(hash >> 16)) % cache->shard_count];
 }
 
 static void
-cache_insert_mru(struct cache *cache, struct cache_entry_list *list, struct cache_entry *entry)
+cache_insert_mru(struct cache_shard *shard, struct cache_entry_list *list, struct cache_entry *entry)
 {
 	entry->prev=NULL;
 	entry->next=list->first;
@@ -131,8 +205,8 @@ cache_insert_mru(struct cache *cache, struct cache_entry_list *list, struct cach
 	if (! list->last)
 		list->last=entry;
 	list->size+=entry->size;
-	if (cache) 
-		g_hash_table_insert(cache->hash, (gpointer)entry->id, entry);
+	if (shard)
+		g_hash_table_insert(shard->hash, (gpointer)entry->id, entry);
 }
 
 static void
@@ -150,10 +224,10 @@ cache_remove_from_list(struct cache_entry_list *list, struct cache_entry *entry)
 }
 
 static void
-cache_remove(struct cache *cache, struct cache_entry *entry)
+cache_remove(struct cache_shard *shard, struct cache_entry *entry)
 {
 	dbg(lvl_debug,"remove 0x%x 0x%x 0x%x 0x%x 0x%x\n", entry->id[0], entry->id[1], entry->id[2], entry->id[3], entry->id[4]);
-	g_hash_table_remove(cache->hash, (gpointer)(entry->id));
+	g_hash_table_remove(shard->hash, (gpointer)(entry->id));
 	g_slice_free1(entry->size, entry);
 }
 
@@ -173,7 +247,7 @@ cache_remove_lru_helper(struct cache_entry_list *list)
 }
 
 static struct cache_entry *
-cache_remove_lru(struct cache *cache, struct cache_entry_list *list)
+cache_remove_lru(struct cache_shard *shard, struct cache_entry_list *list)
 {
 	struct cache_entry *last;
 	int seen=0;
@@ -187,8 +261,8 @@ cache_remove_lru(struct cache *cache, struct cache_entry_list *list)
 		return NULL;
 	dbg(lvl_debug,"removing %d\n", last->id[0]);
 	cache_remove_lru_helper(list);
-	if (cache) {
-		cache_remove(cache, last);
+	if (shard) {
+		cache_remove(shard, last);
 		return NULL;
 	}
 	return last;
@@ -199,7 +273,6 @@ cache_entry_new(struct cache *cache, void *id, int size)
 {
 	struct cache_entry *ret;
 	size+=cache->entry_size;
-	cache->misses+=size;
 	ret=(struct cache_entry *)g_slice_alloc0(size);
 	ret->size=size;
 	ret->usage=1;
@@ -211,26 +284,31 @@ void
 cache_entry_destroy(struct cache *cache, void *data)
 {
 	struct cache_entry *entry=(struct cache_entry *)((char *)data-cache->entry_size);
+	struct cache_shard *shard=cache_get_shard(cache, entry->id);
 	dbg(lvl_debug,"destroy 0x%x 0x%x 0x%x 0x%x 0x%x\n", entry->id[0], entry->id[1], entry->id[2], entry->id[3], entry->id[4]);
-	entry->usage--;
+	cache_shard_lock(shard);
+	/* Entries replaced by cache_insert() while in use are freed by their last user */
+	if (!--entry->usage && !entry->where)
+		g_slice_free1(entry->size, entry);
+	cache_shard_unlock(shard);
 }
 
 static struct cache_entry *
-cache_trim(struct cache *cache, struct cache_entry *entry)
+cache_trim(struct cache *cache, struct cache_shard *shard, struct cache_entry *entry)
 {
 	struct cache_entry *new_entry;
 	dbg(lvl_debug,"trim 0x%x 0x%x 0x%x 0x%x 0x%x\n", entry->id[0], entry->id[1], entry->id[2], entry->id[3], entry->id[4]);
-	dbg(lvl_debug,"Trim %x from %d -> %d\n", entry->id[0], entry->size, cache->size);
+	dbg(lvl_debug,"Trim %x from %d -> %d\n", entry->id[0], entry->size, shard->size);
 	if ( cache->entry_size < entry->size )
 	{
-	    g_hash_table_remove(cache->hash, (gpointer)(entry->id));
+	    g_hash_table_remove(shard->hash, (gpointer)(entry->id));
 
 	    new_entry = g_slice_alloc0(cache->entry_size);
 	    memcpy(new_entry, entry, cache->entry_size);
 	    g_slice_free1( entry->size, entry);
 	    new_entry->size = cache->entry_size;
 
-	    g_hash_table_insert(cache->hash, (gpointer)new_entry->id, new_entry);
+	    g_hash_table_insert(shard->hash, (gpointer)new_entry->id, new_entry);
 	}
 	else
 	{
@@ -241,28 +319,28 @@ cache_trim(struct cache *cache, struct cache_entry *entry)
 }
 
 static struct cache_entry *
-cache_move(struct cache *cache, struct cache_entry_list *old, struct cache_entry_list *new)
+cache_move(struct cache *cache, struct cache_shard *shard, struct cache_entry_list *old, struct cache_entry_list *new)
 {
 	struct cache_entry *entry;
 	entry=cache_remove_lru(NULL, old);
 	if (! entry)
 		return NULL;
-	entry=cache_trim(cache, entry);
+	entry=cache_trim(cache, shard, entry);
 	cache_insert_mru(NULL, new, entry);
 	return entry;
 }
 
 static int
-cache_replace(struct cache *cache)
+cache_replace(struct cache *cache, struct cache_shard *shard)
 {
-	if (cache->t1.size >= MAX(1,cache->t1_target)) {
+	if (shard->t1.size >= MAX(1,shard->t1_target)) {
 		dbg(lvl_debug,"replace 12\n");
-		if (!cache_move(cache, &cache->t1, &cache->b1))
-			cache_move(cache, &cache->t2, &cache->b2);
+		if (!cache_move(cache, shard, &shard->t1, &shard->b1))
+			cache_move(cache, shard, &shard->t2, &shard->b2);
 	} else {
 		dbg(lvl_debug,"replace t2\n");
-		if (!cache_move(cache, &cache->t2, &cache->b2))
-			cache_move(cache, &cache->t1, &cache->b1);
+		if (!cache_move(cache, shard, &shard->t2, &shard->b2))
+			cache_move(cache, shard, &shard->t1, &shard->b1);
 	}
 #if 0
 	if (! entry) {
@@ -276,99 +354,118 @@ cache_replace(struct cache *cache)
 void
 cache_flush(struct cache *cache, void *id)
 {
-	struct cache_entry *entry=g_hash_table_lookup(cache->hash, id);
+	struct cache_shard *shard=cache_get_shard(cache, id);
+	struct cache_entry *entry;
+	cache_shard_lock(shard);
+	entry=g_hash_table_lookup(shard->hash, id);
 	if (entry) {
 		cache_remove_from_list(entry->where, entry);
-		cache_remove(cache, entry);
+		cache_remove(shard, entry);
 	}
+	cache_shard_unlock(shard);
 }
 
 void
 cache_flush_data(struct cache *cache, void *data)
 {
 	struct cache_entry *entry=(struct cache_entry *)((char *)data-cache->entry_size);
-	if (entry) {
+	struct cache_shard *shard=cache_get_shard(cache, entry->id);
+	cache_shard_lock(shard);
+	if (entry->where) {
 		cache_remove_from_list(entry->where, entry);
-		cache_remove(cache, entry);
-	}
+		cache_remove(shard, entry);
+	} else
+		g_slice_free1(entry->size, entry);
+	cache_shard_unlock(shard);
 }
 
 
 void *
 cache_lookup(struct cache *cache, void *id) {
+	struct cache_shard *shard=cache_get_shard(cache, id);
 	struct cache_entry *entry;
 
 	dbg(lvl_debug,"get %d\n", ((int *)id)[0]);
-	entry=g_hash_table_lookup(cache->hash, id);
-	if (entry == NULL) {
-		cache->insert=&cache->t1;
+	cache_shard_lock(shard);
+	entry=g_hash_table_lookup(shard->hash, id);
+	if (entry == NULL || (entry->where != &shard->t1 && entry->where != &shard->t2)) {
+		cache_shard_unlock(shard);
 #ifdef DEBUG_CACHE
-		fprintf(stderr,"-");
+		fprintf(stderr, entry ? "m":"-");
 #endif
+		/* Hits in the phantom lists are handled by cache_insert() when the data is inserted again */
 		dbg(lvl_debug,"not in cache\n");
 		return NULL;
 	}
 	dbg(lvl_debug,"found 0x%x 0x%x 0x%x 0x%x 0x%x\n", entry->id[0], entry->id[1], entry->id[2], entry->id[3], entry->id[4]);
-	if (entry->where == &cache->t1 || entry->where == &cache->t2) {
-		cache->hits+=entry->size;
+	shard->hits++;
+	shard->hit_bytes+=entry->size;
 #ifdef DEBUG_CACHE
-		if (entry->where == &cache->t1)
-			fprintf(stderr,"h");
-		else
-			fprintf(stderr,"H");
-#endif
-		dbg(lvl_debug,"in cache %s\n", entry->where == &cache->t1 ? "T1" : "T2");
-		cache_remove_from_list(entry->where, entry);
-		cache_insert_mru(NULL, &cache->t2, entry);
-		entry->usage++;
-		return &entry->id[cache->id_size];
-	} else {
-		if (entry->where == &cache->b1) {
-#ifdef DEBUG_CACHE
-			fprintf(stderr,"m");
-#endif
-			dbg(lvl_debug,"in phantom cache B1\n");
-			cache->t1_target=MIN(cache->t1_target+MAX(cache->b2.size/cache->b1.size, 1),cache->size);
-			cache_remove_from_list(&cache->b1, entry);
-		} else if (entry->where == &cache->b2) {
-#ifdef DEBUG_CACHE
-			fprintf(stderr,"M");
+	if (entry->where == &shard->t1)
+		fprintf(stderr,"h");
+	else
+		fprintf(stderr,"H");
 #endif
-			dbg(lvl_debug,"in phantom cache B2\n");
-			cache->t1_target=MAX(cache->t1_target-MAX(cache->b1.size/cache->b2.size, 1),0);
-			cache_remove_from_list(&cache->b2, entry);
-		} else {
-			dbg(lvl_error,"**ERROR** invalid where\n");
-		}
-		cache_replace(cache);
-		cache_remove(cache, entry);
-		cache->insert=&cache->t2;
-		return NULL;
-	}
+	dbg(lvl_debug,"in cache %s\n", entry->where == &shard->t1 ? "T1" : "T2");
+	cache_remove_from_list(entry->where, entry);
+	cache_insert_mru(NULL, &shard->t2, entry);
+	entry->usage++;
+	cache_shard_unlock(shard);
+	return &entry->id[cache->id_size];
 }
 
 void
 cache_insert(struct cache *cache, void *data)
 {
 	struct cache_entry *entry=(struct cache_entry *)((char *)data-cache->entry_size);
+	struct cache_shard *shard=cache_get_shard(cache, entry->id);
+	struct cache_entry *old;
+	struct cache_entry_list *insert=&shard->t1;
 	dbg(lvl_debug,"insert 0x%x 0x%x 0x%x 0x%x 0x%x\n", entry->id[0], entry->id[1], entry->id[2], entry->id[3], entry->id[4]);
-	if (cache->insert == &cache->t1) {
-		if (cache->t1.size + cache->b1.size >= cache->size) {
-			if (cache->t1.size < cache->size) {
-				cache_remove_lru(cache, &cache->b1);
-				cache_replace(cache);
+	cache_shard_lock(shard);
+	shard->misses++;
+	shard->miss_bytes+=entry->size;
+	old=g_hash_table_lookup(shard->hash, entry->id);
+	if (old && old->where == &shard->b1) {
+		dbg(lvl_debug,"in phantom cache B1\n");
+		shard->t1_target=MIN(shard->t1_target+MAX(shard->b2.size/shard->b1.size, 1),shard->size);
+		cache_remove_from_list(&shard->b1, old);
+		cache_replace(cache, shard);
+		cache_remove(shard, old);
+		insert=&shard->t2;
+	} else if (old && old->where == &shard->b2) {
+		dbg(lvl_debug,"in phantom cache B2\n");
+		shard->t1_target=MAX(shard->t1_target-MAX(shard->b1.size/shard->b2.size, 1),0);
+		cache_remove_from_list(&shard->b2, old);
+		cache_replace(cache, shard);
+		cache_remove(shard, old);
+		insert=&shard->t2;
+	} else if (old) {
+		/* Another thread inserted the same data after our lookup, the older copy is dropped */
+		cache_remove_from_list(old->where, old);
+		g_hash_table_remove(shard->hash, (gpointer)(old->id));
+		old->where=NULL;
+		if (!old->usage)
+			g_slice_free1(old->size, old);
+	}
+	if (insert == &shard->t1) {
+		if (shard->t1.size + shard->b1.size >= shard->size) {
+			if (shard->t1.size < shard->size) {
+				cache_remove_lru(shard, &shard->b1);
+				cache_replace(cache, shard);
 			} else {
-				cache_remove_lru(cache, &cache->t1);
+				cache_remove_lru(shard, &shard->t1);
 			}
 		} else {
-			if (cache->t1.size + cache->t2.size + cache->b1.size + cache->b2.size >= cache->size) {
-				if (cache->t1.size + cache->t2.size + cache->b1.size + cache->b2.size >= 2*cache->size) 
-					cache_remove_lru(cache, &cache->b2);
-				cache_replace(cache);
+			if (shard->t1.size + shard->t2.size + shard->b1.size + shard->b2.size >= shard->size) {
+				if (shard->t1.size + shard->t2.size + shard->b1.size + shard->b2.size >= 2*shard->size) 
+					cache_remove_lru(shard, &shard->b2);
+				cache_replace(cache, shard);
 			}
 		}
 	}
-	cache_insert_mru(cache, cache->insert, entry);
+	cache_insert_mru(shard, insert, entry);
+	cache_shard_unlock(shard);
 }
 
 void *
@@ -379,23 +476,50 @@ cache_insert_new(struct cache *cache, void *id, int size)
 	return data;	
 }
 
-static void
-cache_stats(struct cache *cache)
+/**
+ * @brief Returns the counters of a cache, summed over all shards
+ *
+ * @param cache The cache
+ * @param stats Returns the counters
+ */
+void
+cache_stats(struct cache *cache, struct cache_stats *stats)
 {
-	dbg(lvl_debug,"hits %d misses %d hitratio %d size %d entry_size %d id_size %d T1 target %d\n", cache->hits, cache->misses, cache->hits*100/(cache->hits+cache->misses), cache->size, cache->entry_size, cache->id_size, cache->t1_target);
-	dbg(lvl_debug,"T1:%d B1:%d T2:%d B2:%d\n", cache->t1.size, cache->b1.size, cache->t2.size, cache->b2.size);
-	cache->hits=0;
-	cache->misses=0;
+	int i;
+	memset(stats, 0, sizeof(*stats));
+	stats->shards=cache->shard_count;
+	for (i = 0 ; i < cache->shard_count ; i++) {
+		struct cache_shard *shard=&cache->shards[i];
+		cache_shard_lock(shard);
+		stats->hits+=shard->hits;
+		stats->misses+=shard->misses;
+		stats->hit_bytes+=shard->hit_bytes;
+		stats->miss_bytes+=shard->miss_bytes;
+		stats->budget+=shard->size;
+		stats->t1+=shard->t1.size;
+		stats->t2+=shard->t2.size;
+		stats->b1+=shard->b1.size;
+		stats->b2+=shard->b2.size;
+		cache_shard_unlock(shard);
+	}
 }
 
 void
 cache_dump(struct cache *cache)
 {
-	cache_stats(cache);
-	cache_list_dump("T1", cache, &cache->t1);
-	cache_list_dump("B1", cache, &cache->b1);
-	cache_list_dump("T2", cache, &cache->t2);
-	cache_list_dump("B2", cache, &cache->b2);
+	struct cache_stats stats;
+	int i;
+	cache_stats(cache, &stats);
+	dbg(lvl_debug,"hits %d misses %d hitratio %d budget "LONGLONG_FMT" entry_size %d id_size %d shards %d\n", stats.hits, stats.misses, stats.hits*100/MAX(stats.hits+stats.misses, 1), stats.budget, cache->entry_size, cache->id_size, stats.shards);
+	for (i = 0 ; i < cache->shard_count ; i++) {
+		struct cache_shard *shard=&cache->shards[i];
+		cache_shard_lock(shard);
+		dbg(lvl_debug,"shard %d T1 target %d\n", i, shard->t1_target);
+		cache_list_dump("T1", cache, &shard->t1);
+		cache_list_dump("B1", cache, &shard->b1);
+		cache_list_dump("T2", cache, &shard->t2);
+		cache_list_dump("B2", cache, &shard->b2);
+		cache_shard_unlock(shard);
+	}
 	dbg(lvl_debug,"dump end\n");
 }
-
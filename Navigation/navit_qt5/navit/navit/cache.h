@@ -1,7 +1,22 @@
 struct cache_entry;
 struct cache;
+
+/**
+ * @brief Counters of a cache, see cache_stats()
+ */
+struct cache_stats {
+	int shards;
+	int hits;			/**< Lookups which found the data */
+	int misses;			/**< Data inserted after a failed lookup */
+	long long hit_bytes;
+	long long miss_bytes;
+	long long budget;		/**< Size the cache may use in bytes */
+	long long t1,t2;		/**< Bytes of data seen once and more than once */
+	long long b1,b2;		/**< Bytes of the phantom entries remembering evicted data */
+};
+
 /* prototypes */
-struct cache *cache_new(int id_size, int size);
+struct cache *cache_new(int id_size, int size, int shards);
 void cache_resize(struct cache *cache, int size);
 void *cache_entry_new(struct cache *cache, void *id, int size);
 void cache_entry_destroy(struct cache *cache, void *data);
@@ -11,4 +26,5 @@ void *cache_insert_new(struct cache *cache, void *id, int size);
 void cache_flush(struct cache *cache, void *id);
 void cache_dump(struct cache *cache);
 void cache_flush_data(struct cache *cache, void *data);
+void cache_stats(struct cache *cache, struct cache_stats *stats);
 /* end of prototypes */
@@ -0,0 +1,534 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Binary cache of the parsed configuration.
+ *
+ * Parsing navit.xml and the files it includes, and matching the xpointers
+ * of every xi:include against them, takes a noticeable part of the startup.
+ * The cache stores the elements that survived the inclusion, in document
+ * order, so they can be fed to the config builder again without touching
+ * the XML. Objects themselves are not stored, they contain pointers and
+ * callbacks and are rebuilt from the elements on every start.
+ *
+ * Besides the elements the cache records every file that was read, with its
+ * modification time and size, and every href pattern that was expanded,
+ * with its result. If any of these differ on the next start, or the cache
+ * was written by another navit version, config_cache_open() rejects it and
+ * the XML is parsed again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib.h>
+#include "debug.h"
+#include "file.h"
+#include "configcache.h"
+
+extern char *version;
+
+#define CONFIG_CACHE_MAGIC "NCFG"
+#define CONFIG_CACHE_VERSION 1
+
+enum config_cache_record {
+	config_cache_record_config=0x10,	/**< navit version and config file the cache was built from */
+	config_cache_record_file,		/**< File read while parsing, with mtime and size */
+	config_cache_record_wordexp,		/**< href pattern of an xi:include, with its expansion */
+};
+
+struct config_cache_header {
+	char magic[4];
+	int version;
+	int size;
+};
+
+struct config_cache_buffer {
+	unsigned char *data;
+	int size;
+	int alloc;
+};
+
+struct config_cache {
+	/* Writing */
+	struct config_cache_buffer deps;
+	struct config_cache_buffer events;
+	GHashTable *files;
+	char *config_file;
+	/* Reading */
+	struct file *file;
+	unsigned char *pos;
+	unsigned char *end;
+	GList *arrays;
+};
+
+static void
+config_cache_buffer_put(struct config_cache_buffer *buffer, const void *data, int size)
+{
+	if (buffer->size + size > buffer->alloc) {
+		buffer->alloc=buffer->alloc ? buffer->alloc*2 : 4096;
+		if (buffer->alloc < buffer->size + size)
+			buffer->alloc=buffer->size + size;
+		buffer->data=g_realloc(buffer->data, buffer->alloc);
+	}
+	memcpy(buffer->data+buffer->size, data, size);
+	buffer->size+=size;
+}
+
+static void
+config_cache_buffer_put_int(struct config_cache_buffer *buffer, int val)
+{
+	config_cache_buffer_put(buffer, &val, sizeof(val));
+}
+
+static void
+config_cache_buffer_put_long_long(struct config_cache_buffer *buffer, long long val)
+{
+	config_cache_buffer_put(buffer, &val, sizeof(val));
+}
+
+/* Strings are stored with their length and a terminating nul, so they can be used in place */
+static void
+config_cache_buffer_put_string(struct config_cache_buffer *buffer, const char *str, int len)
+{
+	static const char pad[sizeof(int)];
+	if (!str)
+		str="";
+	if (len < 0)
+		len=strlen(str);
+	config_cache_buffer_put_int(buffer, len);
+	config_cache_buffer_put(buffer, str, len);
+	config_cache_buffer_put(buffer, pad, sizeof(int) - len % sizeof(int));
+}
+
+static int
+config_cache_get_int(struct config_cache *cc, int *val)
+{
+	if (cc->end - cc->pos < sizeof(*val))
+		return 0;
+	memcpy(val, cc->pos, sizeof(*val));
+	cc->pos+=sizeof(*val);
+	return 1;
+}
+
+static int
+config_cache_get_long_long(struct config_cache *cc, long long *val)
+{
+	if (cc->end - cc->pos < sizeof(*val))
+		return 0;
+	memcpy(val, cc->pos, sizeof(*val));
+	cc->pos+=sizeof(*val);
+	return 1;
+}
+
+static int
+config_cache_get_string(struct config_cache *cc, const char **str, int *len)
+{
+	int l,padded;
+	if (!config_cache_get_int(cc, &l) || l < 0)
+		return 0;
+	padded=l + sizeof(int) - l % sizeof(int);
+	if (cc->end - cc->pos < padded || cc->pos[l])
+		return 0;
+	*str=(const char *)cc->pos;
+	if (len)
+		*len=l;
+	cc->pos+=padded;
+	return 1;
+}
+
+/**
+ * @brief Creates a cache to record the configuration while it is parsed
+ *
+ * @param config_file The config file that is being parsed
+ * @return The new cache
+ */
+struct config_cache *
+config_cache_new(const char *config_file)
+{
+	struct config_cache *cc=g_new0(struct config_cache, 1);
+	cc->files=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	cc->config_file=g_strdup(config_file);
+	return cc;
+}
+
+/**
+ * @brief Records a file that was read while parsing
+ *
+ * @param cc The cache
+ * @param name The name of the file
+ */
+void
+config_cache_add_file(struct config_cache *cc, const char *name)
+{
+	struct stat st;
+
+	if (g_hash_table_lookup(cc->files, name))
+		return;
+	g_hash_table_insert(cc->files, g_strdup(name), cc);
+	if (stat(name, &st)) {
+		st.st_mtime=0;
+		st.st_size=-1;
+	}
+	config_cache_buffer_put_int(&cc->deps, config_cache_record_file);
+	config_cache_buffer_put_string(&cc->deps, name, -1);
+	config_cache_buffer_put_long_long(&cc->deps, st.st_mtime);
+	config_cache_buffer_put_long_long(&cc->deps, st.st_size);
+}
+
+/**
+ * @brief Records the expansion of an href pattern
+ *
+ * The pattern is expanded again when the cache is opened, with XMLDIR and XMLFILE set as they are now,
+ * so that files matching a wildcard which are added or removed invalidate the cache.
+ *
+ * @param cc The cache
+ * @param pattern The pattern
+ * @param files The files the pattern expanded to
+ * @param count The number of files
+ */
+void
+config_cache_add_wordexp(struct config_cache *cc, const char *pattern, char **files, int count)
+{
+	int i;
+
+	config_cache_buffer_put_int(&cc->deps, config_cache_record_wordexp);
+	config_cache_buffer_put_string(&cc->deps, pattern, -1);
+	config_cache_buffer_put_string(&cc->deps, getenv("XMLDIR"), -1);
+	config_cache_buffer_put_string(&cc->deps, getenv("XMLFILE"), -1);
+	config_cache_buffer_put_int(&cc->deps, count);
+	for (i = 0 ; i < count ; i++)
+		config_cache_buffer_put_string(&cc->deps, files[i], -1);
+}
+
+void
+config_cache_add_document(struct config_cache *cc, const char *href)
+{
+	config_cache_buffer_put_int(&cc->events, config_cache_event_document);
+	config_cache_buffer_put_string(&cc->events, href, -1);
+}
+
+void
+config_cache_add_document_end(struct config_cache *cc)
+{
+	config_cache_buffer_put_int(&cc->events, config_cache_event_document_end);
+}
+
+void
+config_cache_add_start(struct config_cache *cc, const char *name, const char **attribute_names, const char **attribute_values)
+{
+	int i,count=0;
+
+	while (attribute_names[count])
+		count++;
+	config_cache_buffer_put_int(&cc->events, config_cache_event_start);
+	config_cache_buffer_put_string(&cc->events, name, -1);
+	config_cache_buffer_put_int(&cc->events, count);
+	for (i = 0 ; i < count ; i++) {
+		config_cache_buffer_put_string(&cc->events, attribute_names[i], -1);
+		config_cache_buffer_put_string(&cc->events, attribute_values[i], -1);
+	}
+}
+
+void
+config_cache_add_end(struct config_cache *cc, const char *name)
+{
+	config_cache_buffer_put_int(&cc->events, config_cache_event_end);
+	config_cache_buffer_put_string(&cc->events, name, -1);
+}
+
+void
+config_cache_add_text(struct config_cache *cc, const char *text, int len)
+{
+	config_cache_buffer_put_int(&cc->events, config_cache_event_text);
+	config_cache_buffer_put_string(&cc->events, text, len);
+}
+
+/**
+ * @brief Writes the recorded configuration to a file
+ *
+ * The file is written under a temporary name and renamed, so a concurrently starting navit
+ * never sees a partial cache.
+ *
+ * @param cc The cache
+ * @param filename The name of the cache file
+ * @return True on success, false on failure
+ */
+int
+config_cache_write(struct config_cache *cc, const char *filename)
+{
+	struct config_cache_buffer config={NULL,0,0};
+	struct config_cache_header header;
+	char *tmp=g_strdup_printf("%s.tmp", filename);
+	FILE *f;
+	int ret=0;
+
+	config_cache_buffer_put_int(&config, config_cache_record_config);
+	config_cache_buffer_put_string(&config, version, -1);
+	config_cache_buffer_put_string(&config, cc->config_file, -1);
+	memcpy(header.magic, CONFIG_CACHE_MAGIC, sizeof(header.magic));
+	header.version=CONFIG_CACHE_VERSION;
+	header.size=config.size+cc->deps.size+cc->events.size;
+	f=fopen(tmp, "wb");
+	if (f) {
+		ret=fwrite(&header, sizeof(header), 1, f) == 1 &&
+			fwrite(config.data, config.size, 1, f) == 1 &&
+			(!cc->deps.size || fwrite(cc->deps.data, cc->deps.size, 1, f) == 1) &&
+			(!cc->events.size || fwrite(cc->events.data, cc->events.size, 1, f) == 1);
+		if (fclose(f))
+			ret=0;
+		if (ret && rename(tmp, filename))
+			ret=0;
+		if (!ret)
+			unlink(tmp);
+	}
+	if (ret) {
+		dbg(lvl_info,"wrote %d bytes to '%s'\n", header.size, filename);
+	} else {
+		dbg(lvl_error,"failed to write config cache '%s'\n", filename);
+	}
+	g_free(config.data);
+	g_free(tmp);
+	return ret;
+}
+
+static int
+config_cache_check_file(struct config_cache *cc)
+{
+	const char *name;
+	long long mtime,size;
+	struct stat st;
+
+	if (!config_cache_get_string(cc, &name, NULL) || !config_cache_get_long_long(cc, &mtime) ||
+			!config_cache_get_long_long(cc, &size))
+		return 0;
+	if (stat(name, &st)) {
+		st.st_mtime=0;
+		st.st_size=-1;
+	}
+	if (st.st_mtime != mtime || st.st_size != size) {
+		dbg(lvl_debug,"'%s' has changed\n", name);
+		return 0;
+	}
+	return 1;
+}
+
+static void
+config_cache_setenv(const char *name, const char *value)
+{
+	if (value)
+		setenv(name, value, 1);
+	else
+		unsetenv(name);
+}
+
+static int
+config_cache_check_wordexp(struct config_cache *cc)
+{
+	const char *pattern,*xmldir,*xmlfile,*name;
+	char *old_xmldir,*old_xmlfile;
+	struct file_wordexp *we;
+	char **files;
+	int i,count,ret=1;
+
+	if (!config_cache_get_string(cc, &pattern, NULL) || !config_cache_get_string(cc, &xmldir, NULL) ||
+			!config_cache_get_string(cc, &xmlfile, NULL) || !config_cache_get_int(cc, &count))
+		return 0;
+	old_xmldir=g_strdup(getenv("XMLDIR"));
+	old_xmlfile=g_strdup(getenv("XMLFILE"));
+	setenv("XMLDIR", xmldir, 1);
+	setenv("XMLFILE", xmlfile, 1);
+	we=file_wordexp_new(pattern);
+	config_cache_setenv("XMLDIR", old_xmldir);
+	config_cache_setenv("XMLFILE", old_xmlfile);
+	g_free(old_xmldir);
+	g_free(old_xmlfile);
+	files=file_wordexp_get_array(we);
+	if (file_wordexp_get_count(we) != count)
+		ret=0;
+	for (i = 0 ; i < count ; i++) {
+		if (!config_cache_get_string(cc, &name, NULL) || (ret && strcmp(files[i], name)))
+			ret=0;
+	}
+	if (!ret)
+		dbg(lvl_debug,"expansion of '%s' has changed\n", pattern);
+	file_wordexp_destroy(we);
+	return ret;
+}
+
+static void
+config_cache_free_arrays(struct config_cache *cc)
+{
+	GList *l=cc->arrays;
+	while (l) {
+		g_free(l->data);
+		l=g_list_next(l);
+	}
+	g_list_free(cc->arrays);
+	cc->arrays=NULL;
+}
+
+/**
+ * @brief Opens a cache file and checks whether it is still valid
+ *
+ * @param filename The name of the cache file
+ * @param config_file The config file the cache must have been built from
+ * @return The cache positioned at its first event, or NULL if the cache is missing or stale
+ */
+struct config_cache *
+config_cache_open(const char *filename, const char *config_file)
+{
+	struct config_cache *cc;
+	struct config_cache_header *header;
+	struct config_cache_event event;
+	const char *cache_version,*cache_config_file;
+	unsigned char *prev;
+	int type;
+
+	if (!file_exists(filename))
+		return NULL;
+	cc=g_new0(struct config_cache, 1);
+	cc->file=file_create((char *)filename, NULL);
+	if (!cc->file || cc->file->size < sizeof(*header) || !file_mmap(cc->file)) {
+		config_cache_destroy(cc);
+		return NULL;
+	}
+	header=(struct config_cache_header *)cc->file->begin;
+	if (memcmp(header->magic, CONFIG_CACHE_MAGIC, sizeof(header->magic)) || header->version != CONFIG_CACHE_VERSION ||
+			header->size != cc->file->size-sizeof(*header)) {
+		dbg(lvl_warning,"'%s' is not a config cache of this version\n", filename);
+		config_cache_destroy(cc);
+		return NULL;
+	}
+	cc->pos=cc->file->begin+sizeof(*header);
+	cc->end=cc->file->end;
+	if (!config_cache_get_int(cc, &type) || type != config_cache_record_config ||
+			!config_cache_get_string(cc, &cache_version, NULL) || !config_cache_get_string(cc, &cache_config_file, NULL) ||
+			strcmp(cache_version, version) || strcmp(cache_config_file, config_file)) {
+		dbg(lvl_info,"'%s' was built by another version or from another config file\n", filename);
+		config_cache_destroy(cc);
+		return NULL;
+	}
+	for (;;) {
+		prev=cc->pos;
+		if (!config_cache_get_int(cc, &type)) {
+			config_cache_destroy(cc);
+			return NULL;
+		}
+		if (type == config_cache_record_file) {
+			if (!config_cache_check_file(cc))
+				break;
+		} else if (type == config_cache_record_wordexp) {
+			if (!config_cache_check_wordexp(cc))
+				break;
+		} else {
+			cc->pos=prev;
+			break;
+		}
+	}
+	if (cc->pos == prev) {
+		/* Walk the events once, objects must not be half built from a damaged cache */
+		while (config_cache_next(cc, &event));
+		config_cache_free_arrays(cc);
+		if (cc->pos == cc->end) {
+			cc->pos=prev;
+			return cc;
+		}
+		dbg(lvl_error,"'%s' is damaged\n", filename);
+		config_cache_destroy(cc);
+		return NULL;
+	}
+	dbg(lvl_info,"'%s' is stale\n", filename);
+	config_cache_destroy(cc);
+	return NULL;
+}
+
+/**
+ * @brief Reads the next event from a cache
+ *
+ * @param cc The cache
+ * @param event Receives the event. Its strings and arrays remain valid until the cache is destroyed.
+ * @return True if an event was read, false at the end of the cache or if the cache is corrupt
+ */
+int
+config_cache_next(struct config_cache *cc, struct config_cache_event *event)
+{
+	int i,type,count;
+
+	memset(event, 0, sizeof(*event));
+	if (cc->pos == cc->end || !config_cache_get_int(cc, &type))
+		return 0;
+	switch (type) {
+	case config_cache_event_document:
+		if (!config_cache_get_string(cc, &event->name, NULL))
+			return 0;
+		break;
+	case config_cache_event_document_end:
+		break;
+	case config_cache_event_start:
+		if (!config_cache_get_string(cc, &event->name, NULL) || !config_cache_get_int(cc, &count) ||
+				count < 0 || count > (cc->end-cc->pos)/(2*sizeof(int)))
+			return 0;
+		event->attribute_names=g_new(const char *, (count+1)*2);
+		event->attribute_values=event->attribute_names+count+1;
+		cc->arrays=g_list_prepend(cc->arrays, event->attribute_names);
+		for (i = 0 ; i < count ; i++) {
+			if (!config_cache_get_string(cc, &event->attribute_names[i], NULL) ||
+					!config_cache_get_string(cc, &event->attribute_values[i], NULL))
+				return 0;
+		}
+		event->attribute_names[count]=NULL;
+		event->attribute_values[count]=NULL;
+		break;
+	case config_cache_event_end:
+		if (!config_cache_get_string(cc, &event->name, NULL))
+			return 0;
+		break;
+	case config_cache_event_text:
+		if (!config_cache_get_string(cc, &event->text, &event->text_len))
+			return 0;
+		break;
+	default:
+		dbg(lvl_error,"unknown record type %d\n", type);
+		return 0;
+	}
+	event->type=type;
+	return 1;
+}
+
+/**
+ * @brief Destroys a cache, whether it was recorded or opened
+ *
+ * @param cc The cache
+ */
+void
+config_cache_destroy(struct config_cache *cc)
+{
+	config_cache_free_arrays(cc);
+	if (cc->file)
+		file_destroy(cc->file);
+	if (cc->files)
+		g_hash_table_destroy(cc->files);
+	g_free(cc->deps.data);
+	g_free(cc->events.data);
+	g_free(cc->config_file);
+	g_free(cc);
+}
@@ -0,0 +1,71 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_CONFIGCACHE_H
+#define NAVIT_CONFIGCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Events of a configuration replayed from the cache
+ */
+enum config_cache_event_type {
+	config_cache_event_none,
+	config_cache_event_document,	/**< Start of an included file, sets XMLDIR and XMLFILE */
+	config_cache_event_document_end,	/**< End of an included file, restores XMLDIR and XMLFILE */
+	config_cache_event_start,	/**< Opening tag of an element */
+	config_cache_event_end,		/**< Closing tag of an element */
+	config_cache_event_text,	/**< Character data of an element */
+};
+
+/**
+ * @brief A single event read from the cache, valid until the cache is closed
+ */
+struct config_cache_event {
+	enum config_cache_event_type type;
+	const char *name;		/**< Element name, or href of a document */
+	const char **attribute_names;	/**< NULL terminated, only for config_cache_event_start */
+	const char **attribute_values;
+	const char *text;		/**< Character data, only for config_cache_event_text */
+	int text_len;
+};
+
+/* prototypes */
+struct config_cache;
+struct config_cache *config_cache_new(const char *config_file);
+void config_cache_add_file(struct config_cache *cc, const char *name);
+void config_cache_add_wordexp(struct config_cache *cc, const char *pattern, char **files, int count);
+void config_cache_add_document(struct config_cache *cc, const char *href);
+void config_cache_add_document_end(struct config_cache *cc);
+void config_cache_add_start(struct config_cache *cc, const char *name, const char **attribute_names, const char **attribute_values);
+void config_cache_add_end(struct config_cache *cc, const char *name);
+void config_cache_add_text(struct config_cache *cc, const char *text, int len);
+int config_cache_write(struct config_cache *cc, const char *filename);
+struct config_cache *config_cache_open(const char *filename, const char *config_file);
+int config_cache_next(struct config_cache *cc, struct config_cache_event *event);
+void config_cache_destroy(struct config_cache *cc);
+/* end of prototypes */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
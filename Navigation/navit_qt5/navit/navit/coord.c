@@ -382,13 +382,21 @@ void coord_format(float lat,float lng, enum coord_format fmt, char * buffer, int
 	
 }
 
+/**
+ * @brief Hash function of coordinates, for GHashTables keyed by struct coord
+ *
+ * Also spreads the small coordinates of block grids, whose diagonals x^y would map to few values.
+ */
 unsigned int 
 coord_hash(const void *key)
 {
         const struct coord *c=key;
-	return c->x^c->y;
+	return (unsigned int)c->x*31+(unsigned int)c->y;
 }
 
+/**
+ * @brief Equality function of coordinates, for GHashTables keyed by struct coord
+ */
 int
 coord_equal(const void *a, const void *b)
 {
@@ -398,4 +406,19 @@ coord_equal(const void *a, const void *b)
                 return TRUE;
         return FALSE;
 }
+
+/**
+ * @brief Divides by a power of two, rounding down also for negative values
+ *
+ * Gives the index of the cell of size 1<<shift a coordinate is in, e.g. on block grids.
+ *
+ * @param v The value
+ * @param shift The power of two
+ * @return v/(1<<shift), rounded towards minus infinity
+ */
+int
+coord_floor_shift(int v, int shift)
+{
+	return v >= 0 ? v >> shift : -((-v-1) >> shift)-1;
+}
 /** @} */
@@ -157,6 +157,7 @@ void coord_print(enum projection pro, struct coord *c, FILE *out);
 void coord_format(float lat, float lng, enum coord_format fmt, char *buffer, int size);
 unsigned int coord_hash(const void *key);
 int coord_equal(const void *a, const void *b);
+int coord_floor_shift(int v, int shift);
 /* end of prototypes */
 #ifdef __cplusplus
 }
@@ -0,0 +1,258 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Performance counters.
+ *
+ * Unlike the benchmark, which keeps every sample until exit, the counters
+ * need a fixed amount of memory and are meant to stay enabled on units in
+ * the field (navit -p, or the set_counters D-Bus method). Counters are
+ * registered by name on first use: plain counters sum up values like the
+ * number of items drawn, latency counters also keep a histogram of durations
+ * like the redraw time. The operations timed by the benchmark are recorded as
+ * latency counters as well, and the statistics of the file layer, the data
+ * cache and attribute allocations are reported with them. The values are read
+ * with counter_get_values() (get_counters over D-Bus) and can be logged
+ * periodically. While disabled, a counter costs a single test.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "debug.h"
+#include "types.h"
+#include "callback.h"
+#include "event.h"
+#include "file.h"
+#include "cache.h"
+#include "item.h"
+#include "attr.h"
+#include "counter.h"
+
+struct counter {
+	struct counter_value value;
+	struct counter *next;
+};
+
+int counter_enabled;
+static GHashTable *counter_hash;
+static struct counter *counters;
+static int counter_number;
+static struct callback *counter_log_cb;
+static struct event_timeout *counter_log_timeout;
+#ifdef HAVE_PTHREAD
+/* Counters are also updated by the threads opening maps */
+static pthread_mutex_t counter_mutex=PTHREAD_MUTEX_INITIALIZER;
+#define counter_lock() pthread_mutex_lock(&counter_mutex)
+#define counter_unlock() pthread_mutex_unlock(&counter_mutex)
+#else
+#define counter_lock()
+#define counter_unlock()
+#endif
+
+/**
+ * @brief Enables the performance counters
+ *
+ * Values collected before are kept.
+ *
+ * @param interval Interval in seconds to log all counters at, 0 to never log them
+ */
+void
+counter_init(int interval)
+{
+	counter_enabled=1;
+	if (counter_log_timeout) {
+		event_remove_timeout(counter_log_timeout);
+		counter_log_timeout=NULL;
+	}
+	if (interval > 0) {
+		if (!counter_log_cb)
+			counter_log_cb=callback_new_0(callback_cast(counter_log));
+		counter_log_timeout=event_add_timeout(interval*1000, 1, counter_log_cb);
+	}
+}
+
+/**
+ * @brief Stops collecting and logging, the values collected so far are kept
+ */
+void
+counter_disable(void)
+{
+	counter_enabled=0;
+	if (counter_log_timeout) {
+		event_remove_timeout(counter_log_timeout);
+		counter_log_timeout=NULL;
+	}
+}
+
+/**
+ * @brief Looks up a counter, registering it on first use
+ *
+ * Counters are never freed, so the result can be kept, see counter_add_static().
+ *
+ * @param name Name of the counter
+ * @param type Kind of the counter, only used when it is registered
+ * @return The counter
+ */
+struct counter *
+counter_get(const char *name, enum counter_type type)
+{
+	struct counter *ret;
+
+	counter_lock();
+	if (!counter_hash)
+		counter_hash=g_hash_table_new(g_str_hash, g_str_equal);
+	ret=g_hash_table_lookup(counter_hash, name);
+	if (!ret) {
+		ret=g_new0(struct counter, 1);
+		ret->value.name=g_strdup(name);
+		ret->value.type=type;
+		ret->next=counters;
+		counters=ret;
+		counter_number++;
+		g_hash_table_insert(counter_hash, (char *)ret->value.name, ret);
+	}
+	counter_unlock();
+	return ret;
+}
+
+/**
+ * @brief Adds a value to a counter
+ *
+ * @param counter The counter
+ * @param value The value, a duration in milliseconds for latency counters
+ */
+void
+counter_add(struct counter *counter, double value)
+{
+	struct counter_value *v=&counter->value;
+	int bucket=0;
+
+	if (v->type == counter_type_latency) {
+		while (bucket < COUNTER_BUCKETS-1 && value >= (1 << bucket))
+			bucket++;
+	}
+	counter_lock();
+	if (!v->count || value < v->min)
+		v->min=value;
+	if (!v->count || value > v->max)
+		v->max=value;
+	v->count++;
+	v->total+=value;
+	if (v->type == counter_type_latency)
+		v->buckets[bucket]++;
+	counter_unlock();
+}
+
+static void
+counter_value_set(struct counter_value *v, const char *name, long long count, double total)
+{
+	memset(v, 0, sizeof(*v));
+	v->name=name;
+	v->type=counter_type_count;
+	v->count=count;
+	v->total=total;
+}
+
+static int
+counter_compare(const void *a, const void *b)
+{
+	return strcmp(((const struct counter_value *)a)->name, ((const struct counter_value *)b)->name);
+}
+
+/**
+ * @brief Returns the values of all counters, sorted by name
+ *
+ * Besides the registered counters, the statistics of the file layer ("file_reads",
+ * "prefetches", "prefetch_hits"), the data cache ("cache_hits", "cache_misses", with
+ * the bytes as total) and allocations for attributes ("attr_allocs") are returned.
+ *
+ * @param count Receives the number of values
+ * @return The values, to be freed with g_free()
+ */
+struct counter_value *
+counter_get_values(int *count)
+{
+	struct file_stats file;
+	struct cache_stats cache;
+	struct attr_stats attr;
+	struct counter_value *ret;
+	struct counter *c;
+	int n=0;
+
+	file_get_stats(&file);
+	attr_get_stats(&attr);
+	counter_lock();
+	ret=g_new(struct counter_value, counter_number+6);
+	for (c = counters ; c ; c=c->next)
+		ret[n++]=c->value;
+	counter_unlock();
+	counter_value_set(&ret[n++], "file_reads", file.reads, file.read_bytes);
+	counter_value_set(&ret[n++], "prefetches", file.prefetches, file.prefetch_bytes);
+	counter_value_set(&ret[n++], "prefetch_hits", file.prefetch_hits, file.prefetch_hits);
+	counter_value_set(&ret[n++], "attr_allocs", attr.allocs, attr.alloc_bytes);
+	if (file_get_cache_stats(&cache)) {
+		counter_value_set(&ret[n++], "cache_hits", cache.hits, cache.hit_bytes);
+		counter_value_set(&ret[n++], "cache_misses", cache.misses, cache.miss_bytes);
+	}
+	qsort(ret, n, sizeof(*ret), counter_compare);
+	*count=n;
+	return ret;
+}
+
+/* Upper bound of the histogram bucket holding the given percentile */
+static int
+counter_percentile(struct counter_value *v, int percent)
+{
+	long long sum=0;
+	int i;
+
+	for (i = 0 ; i < COUNTER_BUCKETS-1 ; i++) {
+		sum+=v->buckets[i];
+		if (sum*100 >= v->count*percent)
+			return 1 << i;
+	}
+	return (int)v->max+1;
+}
+
+/**
+ * @brief Logs the values of all counters
+ */
+void
+counter_log(void)
+{
+	struct counter_value *values;
+	int i,count;
+
+	values=counter_get_values(&count);
+	for (i = 0 ; i < count ; i++) {
+		struct counter_value *v=&values[i];
+		if (v->type == counter_type_latency && v->count) {
+			dbg(lvl_error,"%s count="LONGLONG_FMT" total=%.3f mean=%.3f min=%.3f max=%.3f p50<%d p95<%d\n", v->name, v->count,
+				v->total, v->total/v->count, v->min, v->max, counter_percentile(v, 50), counter_percentile(v, 95));
+		} else {
+			dbg(lvl_error,"%s count="LONGLONG_FMT" total=%.0f\n", v->name, v->count, v->total);
+		}
+	}
+	g_free(values);
+}
@@ -0,0 +1,84 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_COUNTER_H
+#define NAVIT_COUNTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Kinds of performance counters
+ */
+enum counter_type {
+	counter_type_count,	/**< Sum of the added values, e.g. the number of items drawn */
+	counter_type_latency,	/**< Durations in milliseconds, with a histogram */
+};
+
+#define COUNTER_BUCKETS 16
+
+/**
+ * @brief Value of a performance counter, see counter_get_values()
+ */
+struct counter_value {
+	const char *name;
+	enum counter_type type;
+	long long count;		/**< Number of values added */
+	double total;			/**< Sum of the values added */
+	double min;
+	double max;
+	int buckets[COUNTER_BUCKETS];	/**< Latencies below 1 ms, below 2 ms, below 4 ms and so on, the last one all others */
+};
+
+extern int counter_enabled;
+
+/*
+ * Adds a value to the counter name, which has to be a constant string.
+ * The counter is looked up once per call site, nothing is done while
+ * counters are disabled.
+ */
+#define counter_add_static(name,type,value) do { \
+	if (counter_enabled) { \
+		static struct counter *counter_; \
+		if (!counter_) \
+			counter_=counter_get(name, type); \
+		counter_add(counter_, value); \
+	} \
+} while (0)
+
+/** Adds value to the counter name */
+#define counter_count(name,value) counter_add_static(name,counter_type_count,value)
+/** Adds the time since start, as returned by benchmark_time(), to the latency counter name */
+#define counter_latency(name,start) counter_add_static(name,counter_type_latency,benchmark_time()-(start))
+
+/* prototypes */
+struct counter;
+void counter_init(int interval);
+void counter_disable(void);
+struct counter *counter_get(const char *name, enum counter_type type);
+void counter_add(struct counter *counter, double value);
+struct counter_value *counter_get_values(int *count);
+void counter_log(void);
+/* end of prototypes */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,6 +28,9 @@
 #include <sys/time.h>
 #endif /* _MSC_VER */
 #include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "file.h"
 #include "item.h"
 #include "debug.h"
@@ -61,6 +64,15 @@ int timestamp_prefix=0;
 
 static int dummy;
 static GHashTable *debug_hash;
+#ifdef HAVE_PTHREAD
+/* debug_hash is read by dbg() on the threads opening maps while the config may still add levels */
+static pthread_mutex_t debug_hash_mutex=PTHREAD_MUTEX_INITIALIZER;
+#define debug_hash_lock() pthread_mutex_lock(&debug_hash_mutex)
+#define debug_hash_unlock() pthread_mutex_unlock(&debug_hash_mutex)
+#else
+#define debug_hash_lock()
+#define debug_hash_unlock()
+#endif
 static gchar *gdb_program;
 
 static FILE *debug_fp;
@@ -134,8 +146,10 @@ debug_level_set(const char *name, dbg_level level)
 	} else if (!strcmp(name, DEBUG_MODULE_GLOBAL)) {
 		debug_set_global_level(level, 0);
 	} else {
+		debug_hash_lock();
 		g_hash_table_insert(debug_hash, g_strdup(name), GINT_TO_POINTER(level));
 		g_hash_table_foreach(debug_hash, debug_update_level, NULL);
+		debug_hash_unlock();
 	}
 }
 
@@ -209,9 +223,12 @@ debug_new(struct attr *parent, struct attr **attrs)
 dbg_level
 debug_level_get(const char *message_category)
 {
+	gpointer level;
 	if (!debug_hash)
 		return DEFAULT_DEBUG_LEVEL;
-	gpointer level = g_hash_table_lookup(debug_hash, message_category);
+	debug_hash_lock();
+	level = g_hash_table_lookup(debug_hash, message_category);
+	debug_hash_unlock();
 	if (!level) {
 		return DEFAULT_DEBUG_LEVEL;
 	}
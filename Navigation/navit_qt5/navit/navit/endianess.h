@@ -102,8 +102,10 @@
 #elif __BYTE_ORDER == __LITTLE_ENDIAN 
   #define le16_to_cpu(x)	(x)
   #define le32_to_cpu(x)	(x)
+  #define le64_to_cpu(x)	(x)
   #define cpu_to_le16(x)	(x)
   #define cpu_to_le32(x)	(x)
+  #define cpu_to_le64(x)	(x)
 #else
   #error "Unknown endianess"
 #endif
@@ -27,9 +27,15 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif
 #include <stdlib.h>
 #include <wordexp.h>
 #include <glib.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include <zlib.h>
 #include "debug.h"
 #include "cache.h"
@@ -39,6 +45,8 @@
 #include "util.h"
 #include "types.h"
 #include "zipfile.h"
+#include "benchmark.h"
+#include "counter.h"
 #ifdef HAVE_SOCKET
 #include <sys/socket.h>
 #include <netdb.h>
@@ -60,6 +68,34 @@ static GHashTable *file_name_hash;
 
 static struct cache *file_cache;
 
+/* file_cache is split into up to FILE_CACHE_SHARDS independently locked parts, but only
+ * as many as keep FILE_CACHE_SHARD_MIN bytes each, so the default cache stays in one piece */
+#define FILE_CACHE_SHARDS 4
+#define FILE_CACHE_SHARD_MIN (1024*1024)
+
+/* Ranges passed to file_data_prefetch() which have not been read yet, oldest first */
+#define FILE_PREFETCH_PENDING 256
+
+struct file_prefetch_range {
+	int name_id;
+	long long offset;
+	int size;
+};
+
+static struct file_prefetch_range file_prefetch_pending[FILE_PREFETCH_PENDING];
+static int file_prefetch_pending_count;
+static struct file_stats file_stats;
+
+/* Guards file_stats and the pending prefetches, maps may be read from several threads */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t file_stats_mutex=PTHREAD_MUTEX_INITIALIZER;
+#define file_stats_lock() pthread_mutex_lock(&file_stats_mutex)
+#define file_stats_unlock() pthread_mutex_unlock(&file_stats_mutex)
+#else
+#define file_stats_lock()
+#define file_stats_unlock()
+#endif
+
 #ifdef HAVE_PRAGMA_PACK
 #pragma pack(push)
 #pragma pack(1)
@@ -333,6 +369,41 @@ file_mmap(struct file *file)
 	return 1;
 }
 
+/* Reads from disk, accounting the time the caller is blocked if benchmarks or counters are enabled */
+static int
+file_read_at(struct file *file, long long offset, void *buffer, int size)
+{
+	int timed=benchmark_enabled || counter_enabled;
+	double start=timed ? benchmark_time() : 0;
+	int i,ret;
+
+#ifdef HAVE_API_WIN32_BASE
+	lseek(file->fd, offset, SEEK_SET);
+	ret=(read(file->fd, buffer, size) == size);
+#else
+	/* pread() leaves the file position alone, so threads can share the fd */
+	ret=(pread(file->fd, buffer, size, offset) == size);
+#endif
+	file_stats_lock();
+	file_stats.reads++;
+	file_stats.read_bytes+=size;
+	if (timed) {
+		file_stats.stall_time+=benchmark_time()-start;
+		benchmark_add(benchmark_file_read, start);
+	}
+	for (i = 0 ; i < file_prefetch_pending_count ; i++) {
+		struct file_prefetch_range *range=&file_prefetch_pending[i];
+		if (range->name_id == file->name_id && offset >= range->offset && offset+size <= range->offset+range->size) {
+			file_stats.prefetch_hits++;
+			memmove(range, range+1, (file_prefetch_pending_count-i-1)*sizeof(*range));
+			file_prefetch_pending_count--;
+			break;
+		}
+	}
+	file_stats_unlock();
+	return ret;
+}
+
 unsigned char *
 file_data_read(struct file *file, long long offset, int size)
 {
@@ -346,18 +417,92 @@ file_data_read(struct file *file, long long offset, int size)
 		ret=cache_lookup(file_cache,&id); 
 		if (ret)
 			return ret;
-		ret=cache_insert_new(file_cache,&id,size);
+		ret=cache_entry_new(file_cache,&id,size);
 	} else
 		ret=g_malloc(size);
-	lseek(file->fd, offset, SEEK_SET);
-	if (read(file->fd, ret, size) != size) {
+	if (!file_read_at(file, offset, ret, size)) {
 		file_data_free(file, ret);
 		ret=NULL;
-	}
+	} else if (file->cache)
+		cache_insert(file_cache, ret);
 	return ret;
 
 }
 
+/**
+ * @brief Asks the operating system to read a range of a file in the background
+ *
+ * Navit has no I/O threads, so the read-ahead of the kernel does the work: the call returns
+ * immediately and a later file_data_read() of the range finds it in the page cache instead
+ * of blocking on the disk. This works for mapped files as well.
+ *
+ * @param file The file
+ * @param offset Start of the range
+ * @param size Size of the range
+ */
+void
+file_data_prefetch(struct file *file, long long offset, int size)
+{
+	struct file_prefetch_range *range;
+
+	if (file->special || size <= 0 || offset+size > file->size)
+		return;
+	file_stats_lock();
+	file_stats.prefetches++;
+	file_stats.prefetch_bytes+=size;
+	file_stats_unlock();
+	if (file->begin) {
+#ifdef HAVE_MADVISE
+		long long page=getpagesize();
+		long long start=offset & ~(page-1);
+		madvise(file->begin+start, offset+size-start, MADV_WILLNEED);
+#endif
+		return;
+	}
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise(file->fd, offset, size, POSIX_FADV_WILLNEED);
+#endif
+	file_stats_lock();
+	if (file_prefetch_pending_count == FILE_PREFETCH_PENDING) {
+		memmove(file_prefetch_pending, file_prefetch_pending+1, sizeof(file_prefetch_pending)-sizeof(*range));
+		file_prefetch_pending_count--;
+	}
+	range=&file_prefetch_pending[file_prefetch_pending_count++];
+	range->name_id=file->name_id;
+	range->offset=offset;
+	range->size=size;
+	file_stats_unlock();
+}
+
+/**
+ * @brief Returns the counters of the file layer
+ *
+ * @param stats Returns the counters
+ */
+void
+file_get_stats(struct file_stats *stats)
+{
+	file_stats_lock();
+	*stats=file_stats;
+	stats->pending=file_prefetch_pending_count;
+	file_stats_unlock();
+}
+
+/**
+ * @brief Returns the counters of the cache of file data
+ *
+ * @param stats Returns the counters
+ * @return 1 if there is a cache, 0 otherwise
+ */
+int
+file_get_cache_stats(struct cache_stats *stats)
+{
+	if (!file_cache)
+		return 0;
+	cache_stats(file_cache, stats);
+	return 1;
+}
+
 static void
 file_process_headers(struct file *file, unsigned char *headers)
 {
@@ -469,9 +614,14 @@ int
 file_data_write(struct file *file, long long offset, int size, const void *data)
 {
 	file_data_flush(file, offset, size);
+#ifdef HAVE_API_WIN32_BASE
 	lseek(file->fd, offset, SEEK_SET);
 	if (write(file->fd, data, size) != size)
 		return 0;
+#else
+	if (pwrite(file->fd, data, size, offset) != size)
+		return 0;
+#endif
 	if (file->size < offset+size)
 		file->size=offset+size;
 	return 1;
@@ -534,23 +684,23 @@ file_data_read_compressed(struct file *file, long long offset, int size, int siz
 		ret=cache_lookup(file_cache,&id); 
 		if (ret)
 			return ret;
-		ret=cache_insert_new(file_cache,&id,size_uncomp);
+		ret=cache_entry_new(file_cache,&id,size_uncomp);
 	} else 
 		ret=g_malloc(size_uncomp);
-	lseek(file->fd, offset, SEEK_SET);
-
 	buffer = (char *)g_malloc(size);
-	if (read(file->fd, buffer, size) != size) {
-		g_free(ret);
+	if (!file_read_at(file, offset, buffer, size)) {
+		file_data_free(file, ret);
 		ret=NULL;
 	} else {
 		if (uncompress_int(ret, &destLen, (Bytef *)buffer, size) != Z_OK) {
 			dbg(lvl_error,"uncompress failed\n");
-			g_free(ret);
+			file_data_free(file, ret);
 			ret=NULL;
 		}
 	}
 	g_free(buffer);
+	if (ret && file->cache)
+		cache_insert(file_cache, ret);
 
 	return ret;
 }
@@ -568,14 +718,12 @@ file_data_read_encrypted(struct file *file, long long offset, int size, int size
 		ret=cache_lookup(file_cache,&id); 
 		if (ret)
 			return ret;
-		ret=cache_insert_new(file_cache,&id,size_uncomp);
+		ret=cache_entry_new(file_cache,&id,size_uncomp);
 	} else 
 		ret=g_malloc(size_uncomp);
-	lseek(file->fd, offset, SEEK_SET);
-
 	buffer = (unsigned char *)g_malloc(size);
-	if (read(file->fd, buffer, size) != size) {
-		g_free(ret);
+	if (!file_read_at(file, offset, buffer, size)) {
+		file_data_free(file, ret);
 		ret=NULL;
 	} else {
 		unsigned char key[34], salt[8], verify[2], counter[16], xor[16], mac[10], *datap;
@@ -605,7 +753,7 @@ file_data_read_encrypted(struct file *file, long long offset, int size, int size
 			if (compressed) {
 				if (uncompress_int(ret, &destLen, (Bytef *)datap, size) != Z_OK) {
 					dbg(lvl_error,"uncompress failed\n");
-					g_free(ret);
+					file_data_free(file, ret);
 					ret=NULL;
 				}
 			} else {
@@ -613,16 +761,18 @@ file_data_read_encrypted(struct file *file, long long offset, int size, int size
 					memcpy(ret, buffer, destLen);
 				else {
 					dbg(lvl_error,"memcpy failed\n");
-					g_free(ret);
+					file_data_free(file, ret);
 					ret=NULL;
 				}
 			}
 		} else {
-			g_free(ret);
+			file_data_free(file, ret);
 			ret=NULL;
 		}
 	}
 	g_free(buffer);
+	if (ret && file->cache)
+		cache_insert(file_cache, ret);
 
 	return ret;
 #else
@@ -917,7 +1067,7 @@ file_init(void)
 {
 #ifdef CACHE_SIZE
 	file_name_hash=g_hash_table_new(g_str_hash, g_str_equal);
-	file_cache=cache_new(sizeof(struct file_cache_id), CACHE_SIZE);
+	file_cache=cache_new(sizeof(struct file_cache_id), CACHE_SIZE, MIN(MAX(CACHE_SIZE/FILE_CACHE_SHARD_MIN, 1), FILE_CACHE_SHARDS));
 #endif
 	if(sizeof(off_t)<8)
 		dbg(lvl_error,"Maps larger than 2GB are not supported by this binary, sizeof(off_t)=%zu\n",sizeof(off_t));
@@ -59,7 +59,21 @@ struct file {
 	GHashTable *headers;
 };
 
+/**
+ * @brief Counters of the file layer, see file_get_stats()
+ */
+struct file_stats {
+	int reads;			/**< Blocking reads from disk */
+	long long read_bytes;
+	double stall_time;		/**< Time spent in blocking reads in milliseconds */
+	int prefetches;			/**< Ranges passed to file_data_prefetch() */
+	long long prefetch_bytes;
+	int prefetch_hits;		/**< Blocking reads of a range which had been prefetched */
+	int pending;			/**< Prefetched ranges which have not been read yet */
+};
+
 struct attr;
+struct cache_stats;
 
 /* prototypes */
 int file_request(struct file *f, struct attr **options);
@@ -70,6 +84,9 @@ long long file_size(struct file *file);
 int file_mkdir(char *name, int pflag);
 int file_mmap(struct file *file);
 unsigned char *file_data_read(struct file *file, long long offset, int size);
+void file_data_prefetch(struct file *file, long long offset, int size);
+void file_get_stats(struct file_stats *stats);
+int file_get_cache_stats(struct cache_stats *stats);
 unsigned char *file_data_read_special(struct file *file, int size, int *size_ret);
 unsigned char *file_data_read_all(struct file *file);
 void file_data_flush(struct file *file, long long offset, int size);
@@ -0,0 +1,514 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Reverse geocoding.
+ *
+ * The map is read in square blocks. For each block the street segments and
+ * house numbers (plus a margin around the block) are put into a grid of
+ * cells, and the town labels (with a larger margin) into a list. A query
+ * reads the block containing the coordinate once and then only visits the
+ * cells around it, nearest first. The most recently used blocks are kept
+ * until the maps to read change.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "debug.h"
+#include "item.h"
+#include "coord.h"
+#include "projection.h"
+#include "transform.h"
+#include "map.h"
+#include "mapset.h"
+#include "geocode.h"
+
+#define GEOCODE_BLOCK_SHIFT 13		/* blocks of 8192 units */
+#define GEOCODE_CELL_SHIFT 8		/* cells of 256 units */
+#define GEOCODE_MAX_BLOCKS 16
+#define GEOCODE_STREET_DIST 500		/* streets further away are not reported */
+#define GEOCODE_HOUSE_NUMBER_DIST 60
+#define GEOCODE_TOWN_DIST 8192
+
+enum geocode_entry_type {
+	geocode_street,
+	geocode_house_number,
+};
+
+struct geocode_entry {
+	struct coord c[2];	/* segment of a street, or twice the position of a house number */
+	char *name;		/* street name or house number */
+	char *street_name;	/* street of a house number, NULL if unknown */
+	char *town_name;	/* town the map gives for the street or house number, NULL if unknown */
+	char *postal;
+	enum geocode_entry_type type;
+};
+
+struct geocode_town {
+	struct coord c;
+	char *name;
+	char *postal;
+};
+
+struct geocode_cell {
+	int *entries;
+	int count,size;
+};
+
+struct geocode_block {
+	struct coord key;		/* block number in x and y */
+	struct coord cell0;		/* number of the first cell of the grid */
+	int width,height;		/* size of the grid in cells */
+	struct geocode_cell *cells;
+	struct geocode_entry *entries;
+	int entry_count,entry_size;
+	struct geocode_town *towns;
+	int town_count,town_size;
+	GHashTable *strings;		/* names of the block, each stored once */
+	unsigned int used;
+};
+
+struct geocode {
+	struct mapset *ms;
+	GList *maps;		/* maps the blocks were read from */
+	GHashTable *blocks;
+	unsigned int queries;
+};
+
+static void
+geocode_block_destroy(struct geocode_block *block)
+{
+	int i;
+	for (i = 0 ; i < block->width*block->height ; i++)
+		g_free(block->cells[i].entries);
+	g_free(block->cells);
+	g_free(block->entries);
+	g_free(block->towns);
+	g_hash_table_destroy(block->strings);
+	g_free(block);
+}
+
+/* Equal names of a block share one copy, so they can be compared by pointer */
+static char *
+geocode_block_string(struct geocode_block *block, struct item *item, char *str)
+{
+	char *ret;
+	str=map_convert_string_tmp(item->map, str);
+	ret=g_hash_table_lookup(block->strings, str);
+	if (!ret) {
+		ret=g_strdup(str);
+		g_hash_table_insert(block->strings, ret, ret);
+	}
+	return ret;
+}
+
+/* Town and postal code of a street or house number, if the map has them */
+static void
+geocode_block_town_attrs(struct geocode_block *block, struct item *item, char **town_name, char **postal)
+{
+	struct attr attr;
+
+	*town_name=*postal=NULL;
+	if (item_attr_get(item, attr_town_name, &attr))
+		*town_name=geocode_block_string(block, item, attr.u.str);
+	if (item_attr_get(item, attr_postal, &attr) || item_attr_get(item, attr_town_postal, &attr))
+		*postal=geocode_block_string(block, item, attr.u.str);
+}
+
+static void
+geocode_block_add_entry(struct geocode_block *block, enum geocode_entry_type type, struct coord *c0, struct coord *c1,
+		char *name, char *street_name, char *town_name, char *postal)
+{
+	struct geocode_entry *e;
+	int x,y,x0,y0,x1,y1;
+
+	x0=coord_floor_shift(MIN(c0->x, c1->x), GEOCODE_CELL_SHIFT)-block->cell0.x;
+	y0=coord_floor_shift(MIN(c0->y, c1->y), GEOCODE_CELL_SHIFT)-block->cell0.y;
+	x1=coord_floor_shift(MAX(c0->x, c1->x), GEOCODE_CELL_SHIFT)-block->cell0.x;
+	y1=coord_floor_shift(MAX(c0->y, c1->y), GEOCODE_CELL_SHIFT)-block->cell0.y;
+	if (x1 < 0 || y1 < 0 || x0 >= block->width || y0 >= block->height)
+		return;
+	if (block->entry_count == block->entry_size) {
+		block->entry_size=block->entry_size ? block->entry_size*2 : 256;
+		block->entries=g_renew(struct geocode_entry, block->entries, block->entry_size);
+	}
+	e=&block->entries[block->entry_count];
+	e->c[0]=*c0;
+	e->c[1]=*c1;
+	e->name=name;
+	e->street_name=street_name;
+	e->town_name=town_name;
+	e->postal=postal;
+	e->type=type;
+	for (y = MAX(y0, 0) ; y <= y1 && y < block->height ; y++) {
+		for (x = MAX(x0, 0) ; x <= x1 && x < block->width ; x++) {
+			struct geocode_cell *cell=&block->cells[y*block->width+x];
+			if (cell->count == cell->size) {
+				cell->size=cell->size ? cell->size*2 : 4;
+				cell->entries=g_renew(int, cell->entries, cell->size);
+			}
+			cell->entries[cell->count++]=block->entry_count;
+		}
+	}
+	block->entry_count++;
+}
+
+static void
+geocode_block_add_street(struct geocode_block *block, struct item *item)
+{
+	struct attr attr;
+	struct coord c[128],last;
+	char *name,*town_name,*postal;
+	int i,count,first=1;
+
+	if (!item_attr_get(item, attr_street_name, &attr) && !item_attr_get(item, attr_label, &attr))
+		return;
+	name=geocode_block_string(block, item, attr.u.str);
+	geocode_block_town_attrs(block, item, &town_name, &postal);
+	while ((count=item_coord_get_pro(item, c, sizeof(c)/sizeof(c[0]), projection_mg)) > 0) {
+		for (i = 0 ; i < count ; i++) {
+			if (!first)
+				geocode_block_add_entry(block, geocode_street, &last, &c[i], name, NULL, town_name, postal);
+			last=c[i];
+			first=0;
+		}
+	}
+}
+
+static void
+geocode_block_add_house_number(struct geocode_block *block, struct item *item)
+{
+	struct attr attr;
+	struct coord_rect r;
+	struct coord c[128],center;
+	char *name,*street_name=NULL,*town_name,*postal;
+	int i,count,first=1;
+
+	if (!item_attr_get(item, attr_house_number, &attr))
+		return;
+	name=geocode_block_string(block, item, attr.u.str);
+	if (item_attr_get(item, attr_street_name, &attr))
+		street_name=geocode_block_string(block, item, attr.u.str);
+	geocode_block_town_attrs(block, item, &town_name, &postal);
+	/* Buildings are reduced to the center of their bounding box */
+	while ((count=item_coord_get_pro(item, c, sizeof(c)/sizeof(c[0]), projection_mg)) > 0) {
+		for (i = 0 ; i < count ; i++) {
+			if (first) {
+				r.lu=r.rl=c[i];
+				first=0;
+			} else
+				coord_rect_extend(&r, &c[i]);
+		}
+	}
+	if (first)
+		return;
+	center.x=r.lu.x/2+r.rl.x/2;
+	center.y=r.lu.y/2+r.rl.y/2;
+	geocode_block_add_entry(block, geocode_house_number, &center, &center, name, street_name, town_name, postal);
+}
+
+static void
+geocode_block_add_town(struct geocode_block *block, struct item *item)
+{
+	struct geocode_town *town;
+	struct attr attr;
+	struct coord c;
+
+	if (!item_attr_get(item, attr_town_name, &attr) && !item_attr_get(item, attr_label, &attr))
+		return;
+	if (block->town_count == block->town_size) {
+		block->town_size=block->town_size ? block->town_size*2 : 16;
+		block->towns=g_renew(struct geocode_town, block->towns, block->town_size);
+	}
+	town=&block->towns[block->town_count];
+	town->name=geocode_block_string(block, item, attr.u.str);
+	town->postal=NULL;
+	if (item_attr_get(item, attr_town_postal, &attr) || item_attr_get(item, attr_postal, &attr))
+		town->postal=geocode_block_string(block, item, attr.u.str);
+	if (item_coord_get_pro(item, &c, 1, projection_mg) != 1)
+		return;
+	town->c=c;
+	block->town_count++;
+}
+
+static void
+geocode_block_read(struct geocode *this_, struct geocode_block *block, int margin, int order, int towns)
+{
+	struct map_selection sel;
+	struct mapset_handle *h;
+	struct map *m;
+	int size=1 << GEOCODE_BLOCK_SHIFT;
+
+	memset(&sel, 0, sizeof(sel));
+	sel.u.c_rect.lu.x=block->key.x*size-margin;
+	sel.u.c_rect.lu.y=(block->key.y+1)*size-1+margin;
+	sel.u.c_rect.rl.x=(block->key.x+1)*size-1+margin;
+	sel.u.c_rect.rl.y=block->key.y*size-margin;
+	sel.order=order;
+	sel.range=item_range_all;
+	h=mapset_open(this_->ms);
+	while ((m=mapset_next(h, 2))) {
+		struct map_selection *msel=map_selection_dup_pro(&sel, projection_mg, map_projection(m));
+		struct map_rect *mr=map_rect_new(m, msel);
+		struct item *item;
+		if (mr) {
+			while ((item=map_rect_get_item(mr))) {
+				if (towns) {
+					if (item->type >= type_town_label && item->type <= type_town_label_1e7)
+						geocode_block_add_town(block, item);
+				} else if (item_is_street(*item))
+					geocode_block_add_street(block, item);
+				else if (item->type == type_house_number || item->type == type_poly_building)
+					geocode_block_add_house_number(block, item);
+			}
+			map_rect_destroy(mr);
+		}
+		map_selection_destroy(msel);
+	}
+	mapset_close(h);
+}
+
+static struct geocode_block *
+geocode_block_get(struct geocode *this_, struct coord *c)
+{
+	struct geocode_block *block;
+	struct coord key;
+	int size=1 << GEOCODE_BLOCK_SHIFT;
+
+	key.x=coord_floor_shift(c->x, GEOCODE_BLOCK_SHIFT);
+	key.y=coord_floor_shift(c->y, GEOCODE_BLOCK_SHIFT);
+	block=g_hash_table_lookup(this_->blocks, &key);
+	if (block) {
+		block->used=this_->queries;
+		return block;
+	}
+	if (g_hash_table_size(this_->blocks) >= GEOCODE_MAX_BLOCKS) {
+		struct geocode_block *oldest=NULL,*curr;
+		GHashTableIter iter;
+		g_hash_table_iter_init(&iter, this_->blocks);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&curr))
+			if (!oldest || this_->queries-curr->used > this_->queries-oldest->used)
+				oldest=curr;
+		g_hash_table_remove(this_->blocks, &oldest->key);
+	}
+	block=g_new0(struct geocode_block, 1);
+	block->key=key;
+	block->used=this_->queries;
+	block->strings=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	block->cell0.x=coord_floor_shift(key.x*size-GEOCODE_STREET_DIST, GEOCODE_CELL_SHIFT);
+	block->cell0.y=coord_floor_shift(key.y*size-GEOCODE_STREET_DIST, GEOCODE_CELL_SHIFT);
+	block->width=coord_floor_shift((key.x+1)*size-1+GEOCODE_STREET_DIST, GEOCODE_CELL_SHIFT)-block->cell0.x+1;
+	block->height=coord_floor_shift((key.y+1)*size-1+GEOCODE_STREET_DIST, GEOCODE_CELL_SHIFT)-block->cell0.y+1;
+	block->cells=g_new0(struct geocode_cell, block->width*block->height);
+	geocode_block_read(this_, block, GEOCODE_STREET_DIST, 18, 0);
+	/* Town labels are stored up to order 14, see item_order_by_type() in maptool */
+	geocode_block_read(this_, block, GEOCODE_TOWN_DIST, 14, 1);
+	dbg(lvl_debug,"block %d,%d: %d entries, %d towns\n", key.x, key.y, block->entry_count, block->town_count);
+	g_hash_table_insert(this_->blocks, &block->key, block);
+	return block;
+}
+
+/*
+ * Nearest entry of a type within max_dist, visiting the cells in rings around the one containing c.
+ * Every cell of ring r+1 is at least r cells away from c, so the search ends as soon as the best
+ * entry is closer than that.
+ */
+static struct geocode_entry *
+geocode_block_nearest(struct geocode_block *block, struct coord *c, enum geocode_entry_type type, char *street_name,
+		int max_dist, struct coord *lpnt)
+{
+	struct geocode_entry *ret=NULL;
+	struct coord lp;
+	int cx=coord_floor_shift(c->x, GEOCODE_CELL_SHIFT)-block->cell0.x;
+	int cy=coord_floor_shift(c->y, GEOCODE_CELL_SHIFT)-block->cell0.y;
+	int r,x,y,i,dist,best=max_dist*max_dist;
+
+	for (r = 0 ; r <= (max_dist >> GEOCODE_CELL_SHIFT)+1 ; r++) {
+		for (y = cy-r ; y <= cy+r ; y++) {
+			if (y < 0 || y >= block->height)
+				continue;
+			for (x = cx-r ; x <= cx+r ; x += (y == cy-r || y == cy+r) ? 1 : 2*r) {
+				struct geocode_cell *cell;
+				if (x < 0 || x >= block->width)
+					continue;
+				cell=&block->cells[y*block->width+x];
+				for (i = 0 ; i < cell->count ; i++) {
+					struct geocode_entry *e=&block->entries[cell->entries[i]];
+					if (e->type != type || (street_name && e->street_name != street_name))
+						continue;
+					dist=transform_distance_line_sq(&e->c[0], &e->c[1], c, &lp);
+					if (dist <= best) {
+						best=dist;
+						ret=e;
+						if (lpnt)
+							*lpnt=lp;
+					}
+				}
+				if (!r)
+					break;
+			}
+		}
+		if (ret && best <= (r << GEOCODE_CELL_SHIFT)*(r << GEOCODE_CELL_SHIFT))
+			break;
+	}
+	return ret;
+}
+
+/* Remembers the maps to read, returns whether they differ from those the blocks were read from */
+static int
+geocode_maps_changed(struct geocode *this_)
+{
+	struct mapset_handle *h=mapset_open(this_->ms);
+	GList *l=this_->maps,*maps=NULL;
+	struct map *m;
+	int changed=0;
+
+	while ((m=mapset_next(h, 2))) {
+		if (!l || l->data != m)
+			changed=1;
+		maps=g_list_append(maps, m);
+		if (l)
+			l=g_list_next(l);
+	}
+	mapset_close(h);
+	if (l)
+		changed=1;
+	g_list_free(this_->maps);
+	this_->maps=maps;
+	return changed;
+}
+
+/**
+ * @brief Creates a reverse geocoder
+ *
+ * @param ms The mapset to read
+ * @return The new geocoder
+ */
+struct geocode *
+geocode_new(struct mapset *ms)
+{
+	struct geocode *this_=g_new0(struct geocode, 1);
+	this_->ms=ms;
+	this_->blocks=g_hash_table_new_full(coord_hash, coord_equal, NULL, (GDestroyNotify)geocode_block_destroy);
+	return this_;
+}
+
+/**
+ * @brief Drops the index of the areas read so far
+ *
+ * Needed when the data of a map changes. Maps added to or removed from the mapset,
+ * or switched on or off, are noticed by geocode_reverse() itself.
+ *
+ * @param this_ The geocoder
+ */
+void
+geocode_flush(struct geocode *this_)
+{
+	g_hash_table_remove_all(this_->blocks);
+}
+
+/**
+ * @brief Changes the mapset to read
+ *
+ * @param this_ The geocoder
+ * @param ms The mapset
+ */
+void
+geocode_set_mapset(struct geocode *this_, struct mapset *ms)
+{
+	if (this_->ms == ms)
+		return;
+	this_->ms=ms;
+	geocode_flush(this_);
+}
+
+/**
+ * @brief Finds the street, house number and town at a coordinate
+ *
+ * The first query in an area reads the map around it, further queries nearby only
+ * visit the index. The town is the one the map gives for the house number or street
+ * if there is one, otherwise the nearest town label.
+ *
+ * @param this_ The geocoder
+ * @param pc The coordinate
+ * @param result Receives the address, see struct geocode_result
+ * @return 1 if a street or town was found, 0 otherwise
+ */
+int
+geocode_reverse(struct geocode *this_, struct pcoord *pc, struct geocode_result *result)
+{
+	struct geocode_block *block;
+	struct geocode_entry *street,*house_number=NULL;
+	struct coord c;
+	int i,dist,best=0;
+
+	c.x=pc->x;
+	c.y=pc->y;
+	if (pc->pro != projection_mg) {
+		struct coord_geo g;
+		transform_to_geo(pc->pro, &c, &g);
+		transform_from_geo(projection_mg, &g, &c);
+	}
+	memset(result, 0, sizeof(*result));
+	result->distance=-1;
+	if (geocode_maps_changed(this_))
+		geocode_flush(this_);
+	this_->queries++;
+	block=geocode_block_get(this_, &c);
+	street=geocode_block_nearest(block, &c, geocode_street, NULL, GEOCODE_STREET_DIST, &result->c);
+	if (street) {
+		result->street_name=street->name;
+		result->distance=(int)(transform_distance(projection_mg, &c, &result->c)+0.5);
+		house_number=geocode_block_nearest(block, &c, geocode_house_number, street->name, GEOCODE_HOUSE_NUMBER_DIST, NULL);
+	}
+	if (!house_number)
+		house_number=geocode_block_nearest(block, &c, geocode_house_number, NULL, GEOCODE_HOUSE_NUMBER_DIST, NULL);
+	if (house_number) {
+		result->house_number=house_number->name;
+		if (!result->street_name)
+			result->street_name=house_number->street_name;
+	}
+	if (house_number && house_number->town_name) {
+		result->town_name=house_number->town_name;
+		result->postal=house_number->postal;
+		return 1;
+	}
+	if (street && street->town_name) {
+		result->town_name=street->town_name;
+		result->postal=street->postal;
+		return 1;
+	}
+	for (i = 0 ; i < block->town_count ; i++) {
+		dist=transform_distance_sq(&block->towns[i].c, &c);
+		if (!result->town_name || dist < best) {
+			result->town_name=block->towns[i].name;
+			result->postal=block->towns[i].postal;
+			best=dist;
+		}
+	}
+	return result->street_name || result->town_name;
+}
+
+void
+geocode_destroy(struct geocode *this_)
+{
+	g_hash_table_destroy(this_->blocks);
+	g_list_free(this_->maps);
+	g_free(this_);
+}
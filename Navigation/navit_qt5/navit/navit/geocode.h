@@ -0,0 +1,55 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_GEOCODE_H
+#define NAVIT_GEOCODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Result of a reverse geocoding query
+ *
+ * The strings are owned by the geocoder and stay valid until the next query.
+ */
+struct geocode_result {
+	char *street_name;	/**< Nearest named street, NULL if there is none nearby */
+	char *house_number;	/**< Nearest house number, preferably of that street, NULL if there is none nearby */
+	char *town_name;	/**< Town of the house number or street if the map gives one, else the nearest town, NULL if unknown */
+	char *postal;		/**< Postal code of the town, NULL if unknown */
+	int distance;		/**< Distance to the street in meters, -1 if there is no street */
+	struct coord c;		/**< Nearest point of the street (projection_mg) */
+};
+
+/* prototypes */
+struct mapset;
+struct pcoord;
+struct geocode;
+struct geocode *geocode_new(struct mapset *ms);
+void geocode_flush(struct geocode *this_);
+void geocode_set_mapset(struct geocode *this_, struct mapset *ms);
+int geocode_reverse(struct geocode *this_, struct pcoord *pc, struct geocode_result *result);
+void geocode_destroy(struct geocode *this_);
+/* end of prototypes */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
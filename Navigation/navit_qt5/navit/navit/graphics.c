@@ -51,6 +51,9 @@
 #include "callback.h"
 #include "file.h"
 #include "event.h"
+#include "benchmark.h"
+#include "counter.h"
+#include "trace.h"
 
 
 //##############################################################################################################
@@ -120,7 +123,11 @@ struct displaylist {
 	struct callback *idle_cb;
 	struct event_idle *idle_ev;
 	unsigned int seq;
+	double draw_start;
+	struct coord prefetch_center;
+	int prefetch_valid;
 	struct hash_entry hash_entries[HASH_SIZE];
+	struct item_type_filter *types;	/* The types in hash_entries, passed to the maps with the selection */
 };
 
 
@@ -2312,6 +2319,7 @@ displaylist_update_layers(struct displaylist *displaylist, GList *layers, int or
 				while (types) {
 					enum item_type type=(enum item_type) types->data;
 					set_hash_entry(displaylist, type);
+					item_type_filter_add(displaylist->types, type);
 					types=g_list_next(types);
 				}
 			}
@@ -2326,6 +2334,9 @@ displaylist_update_hash(struct displaylist *displaylist)
 {
 	displaylist->max_offset=0;
 	clear_hash(displaylist);
+	if (!displaylist->types)
+		displaylist->types=item_type_filter_new();
+	item_type_filter_clear(displaylist->types);
 	displaylist_update_layers(displaylist, displaylist->layout->layers, displaylist->order);
 	dbg(lvl_debug,"max offset %d\n",displaylist->max_offset);
 }
@@ -2379,6 +2390,31 @@ GList *displaylist_get_clicked_list(struct displaylist *displaylist, struct poin
 }
 
 
+/*
+ * Adds the number of items drawn to the counter "items" and to a counter per
+ * item type, like "items.street_1_city".
+ */
+static void
+displaylist_count_items(struct displaylist *dl)
+{
+	struct displayitem *di;
+	char name[128];
+	int i,count,total=0;
+
+	for (i = 0 ; i < HASH_SIZE ; i++) {
+		if (!dl->hash_entries[i].type)
+			continue;
+		count=0;
+		for (di=dl->hash_entries[i].di ; di ; di=di->next)
+			count++;
+		if (!count)
+			continue;
+		snprintf(name, sizeof(name), "items.%s", item_to_name(dl->hash_entries[i].type));
+		counter_add(counter_get(name, counter_type_count), count);
+		total+=count;
+	}
+	counter_count("items", total);
+}
 
 static void
 do_draw(struct displaylist *displaylist, int cancel, int flags)
@@ -2410,8 +2446,16 @@ do_draw(struct displaylist *displaylist, int cancel, int flags)
 			displaylist->conv=map_requires_conversion(displaylist->m);
 			if (route_selection)
 				displaylist->sel=route_selection;
-			else
+			else {
+				struct map_selection *sel;
 				displaylist->sel=displaylist_get_selection(displaylist);
+				/* Items without a hash entry are dropped below anyway, let the map skip them.
+				 * Geometry simplified for the order is good enough for drawing */
+				for (sel = displaylist->sel ; sel ; sel = sel->next) {
+					sel->types=displaylist->types;
+					sel->simplified=1;
+				}
+			}
 			displaylist->mr=map_rect_new(displaylist->m, displaylist->sel);
 		}
 		if (displaylist->mr) {
@@ -2485,8 +2529,19 @@ do_draw(struct displaylist *displaylist, int cancel, int flags)
 	displaylist->busy=0;
 	graphics_process_selection(displaylist->dc.gra, displaylist);
 	profile(1,"draw\n");
-	if (! cancel)
+	if (! cancel) {
+		double frame_start=trace_enabled ? benchmark_time() : 0;
+		/* Only the first draw is traced, the trace ends with it */
+		trace_span("first displaylist", NULL, displaylist->draw_start);
 		graphics_displaylist_draw(displaylist->dc.gra, displaylist, displaylist->dc.trans, displaylist->layout, flags);
+		benchmark_add(benchmark_redraw, displaylist->draw_start);
+		if (counter_enabled)
+			displaylist_count_items(displaylist);
+		if (trace_enabled) {
+			trace_span("first frame", NULL, frame_start);
+			trace_finish();
+		}
+	}
 	map_rect_destroy(displaylist->mr);
 	if (!route_selection)
 		map_selection_destroy(displaylist->sel);
@@ -2538,6 +2593,54 @@ void graphics_displaylist_draw(struct graphics *gra, struct displaylist *display
 		gra->meth.draw_mode(gra->priv, draw_mode_end);
 }
 
+/**
+ * @brief Prefetches the map data of the area the view moves to
+ *
+ * Assumes the view keeps moving like it did since the last redraw and hints the maps
+ * with the current selection shifted by that movement. Jumps by more than the size
+ * of the view are not extrapolated.
+ *
+ * @param displaylist The displaylist, remembering the last center
+ * @param mapset The mapset to prefetch from
+ * @param trans The transformation of the redraw
+ * @param order The order of the redraw
+ */
+static void
+graphics_prefetch(struct displaylist *displaylist, struct mapset *mapset, struct transformation *trans, int order)
+{
+	struct coord *center=transform_get_center(trans);
+	enum projection pro=transform_get_projection(trans);
+	struct mapset_handle *h;
+	struct map_selection *sel,*s;
+	struct map *m;
+	int dx,dy,valid=displaylist->prefetch_valid;
+
+	dx=center->x-displaylist->prefetch_center.x;
+	dy=center->y-displaylist->prefetch_center.y;
+	displaylist->prefetch_center=*center;
+	displaylist->prefetch_valid=1;
+	if (!valid || (!dx && !dy) || !mapset)
+		return;
+	sel=transform_get_selection(trans, pro, order);
+	for (s = sel ; s ; s = s->next) {
+		if (abs(dx) > s->u.c_rect.rl.x-s->u.c_rect.lu.x || abs(dy) > s->u.c_rect.lu.y-s->u.c_rect.rl.y) {
+			map_selection_destroy(sel);
+			return;
+		}
+		s->u.c_rect.lu.x+=dx;
+		s->u.c_rect.lu.y+=dy;
+		s->u.c_rect.rl.x+=dx;
+		s->u.c_rect.rl.y+=dy;
+	}
+	h=mapset_open(mapset);
+	while ((m=mapset_next(h, 1))) {
+		if (map_projection(m) == pro)
+			map_prefetch(m, sel);
+	}
+	mapset_close(h);
+	map_selection_destroy(sel);
+}
+
 static void graphics_load_mapset(struct graphics *gra, struct displaylist *displaylist, struct mapset *mapset, struct transformation *trans, struct layout *l, int async, struct callback *cb, int flags)
 {
 	int order=transform_get_order(trans);
@@ -2565,6 +2668,9 @@ static void graphics_load_mapset(struct graphics *gra, struct displaylist *displ
 	displaylist->order=order>0?order:0;
 	displaylist->busy=1;
 	displaylist->layout=l;
+	graphics_prefetch(displaylist, mapset, trans, displaylist->order);
+	if (benchmark_enabled || trace_enabled || counter_enabled)
+		displaylist->draw_start=benchmark_time();
 	if (async) {
 		if (! displaylist->idle_cb)
 			displaylist->idle_cb=callback_new_3(callback_cast(do_draw), displaylist, 0, flags);
@@ -2678,6 +2784,8 @@ void graphics_displaylist_destroy(struct displaylist *displaylist)
 {
 	if(displaylist->dc.trans)
 		transform_destroy(displaylist->dc.trans);
+	if (displaylist->types)
+		item_type_filter_destroy(displaylist->types);
 	g_free(displaylist);
 	
 }
@@ -4,6 +4,8 @@
 #include "navit/window.h"
 #include "navit/event.h"
 #include "navit/callback.h"
+#include "navit/benchmark.h"
+#include "navit/counter.h"
 #include "config.h"
 #include "plugin.h"
 
@@ -16,7 +18,6 @@
 
 #include <QtCore/QtDebug>
 #include <QtCore/QEventLoop>
-#include <QtCore/QElapsedTimer>
 #include <QtCore/QBuffer>
 
 #include <QtGui/QPen>
@@ -44,16 +45,7 @@ const std::uint32_t sharedMemorySize = 0 + (defaultHeight * defaultWidth * 4); /
 const std::string sharedMemoryName = "Navit_shm";
 int sharedMemoryFd = -1;
 static graphics_priv* event_gr;
-
-// For testing purposes only
-struct Counter {
-    int polygons = 0;
-    int lines = 0;
-    int text = 0;
-    QElapsedTimer draw;
-};
-
-static Counter ctrs;
+static double frameStart;
 }
 
 template <typename T>
@@ -63,12 +55,6 @@ QDebug operator<<(QDebug dbg, const std::unique_ptr<T>& ptr)
     return dbg.space();
 }
 
-QDebug operator<<(QDebug dbg, const Counter& ctrs)
-{
-    dbg.nospace() << "Time= " << ctrs.draw.elapsed() << " Polygons = " << ctrs.polygons << " lines= " << ctrs.lines << " text= " << ctrs.text;
-    return dbg.space();
-}
-
 bool backendOpenGL()
 {
     const QByteArray val = qgetenv("OFFSCREEN_OPENGL");
@@ -141,8 +127,6 @@ void setupQtPainter(graphics_priv* ret)
 void
 qt_offscreen_draw(graphics_priv* gr)
 {
-    static int count = 0;
-
     QImage img;
     if (gr->opengl) {
         img = gr->fbo->toImage();
@@ -173,15 +157,11 @@ qt_offscreen_draw(graphics_priv* gr)
              <<(int)(cc[3]);
 
     if (gr->dumpFrame) {
-        const QString frame = QString("/tmp/frame%1.png").arg(count);
+        static int count = 0;
+        const QString frame = QString("/tmp/frame%1.png").arg(count++);
         qWarning() << "Saving frame " << frame;
         img.save(frame);
     }
-
-    qWarning() << "[" << count++ << "]" << ctrs;
-    ctrs.polygons = 0;
-    ctrs.lines = 0;
-    ctrs.text = 0;
 }
 
 struct graphics_font_priv {
@@ -295,7 +275,7 @@ static struct graphics_image_priv* image_new(graphics_priv* gr, graphics_image_m
 
 static void draw_lines(graphics_priv* gr, graphics_gc_priv* gc, point* p, int count)
 {
-    ctrs.lines++;
+    counter_count("qt_offscreen.lines", 1);
     int i;
     static QPolygon polygon;
     polygon.resize(count);
@@ -310,7 +290,7 @@ static void draw_polygon(graphics_priv* gr, graphics_gc_priv* gc, point* p, int
 {
     int i;
     QPolygon polygon;
-    ctrs.polygons++;
+    counter_count("qt_offscreen.polygons", 1);
 
     for (i = 0; i < count; i++)
         polygon.putPoints(i, 1, p[i].x, p[i].y);
@@ -332,7 +312,7 @@ static void draw_circle(graphics_priv* gr, graphics_gc_priv* gc, point* p, int r
 
 static void draw_text(graphics_priv* gr, graphics_gc_priv* fg, graphics_gc_priv* bg, graphics_font_priv* font, char* text, point* p, int dx, int dy)
 {
-    ctrs.text++;
+    counter_count("qt_offscreen.text", 1);
     font_freetype_text* t;
     font_freetype_glyph* g, **gp;
     color transparent = { 0x0000, 0x0000, 0x0000, 0x0000 };
@@ -403,7 +383,7 @@ static void draw_mode(graphics_priv* gr, draw_mode_num mode)
     }
     qDebug() << Q_FUNC_INFO << gr << gr->buffer;
     if (mode == draw_mode_begin) {
-        ctrs.draw.start();
+        frameStart = counter_enabled ? benchmark_time() : 0;
         if (gr->buffer->paintingActive()) {
             gr->buffer->paintEngine()->painter()->end();
         }
@@ -412,6 +392,8 @@ static void draw_mode(graphics_priv* gr, draw_mode_num mode)
     if (mode == draw_mode_end) {
         gr->painter->end();
         qt_offscreen_draw(gr);
+        if (frameStart)
+            counter_latency("qt_offscreen.frame", frameStart);
     }
     gr->mode = mode;
 }
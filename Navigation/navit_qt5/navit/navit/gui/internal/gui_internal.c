@@ -1777,6 +1777,8 @@ gui_internal_cmd_map_download_do(struct gui_priv *this, struct widget *wm, void
 		transform_from_geo(projection_mg, &g, &sel.u.c_rect.rl);
 		sel.range.min=type_none;
 		sel.range.max=type_last;
+		sel.types=NULL;
+		sel.simplified=0;
 		mr=map_rect_new(map, &sel);
 		while ((item=map_rect_get_item(mr))) {
 			dbg(lvl_info,"item\n");
@@ -444,6 +444,8 @@ gui_internal_cmd2_route_height_profile(struct gui_priv *this, char *function, st
 	sel.order=18;
 	sel.range.min=type_height_line_1;
 	sel.range.max=type_height_line_3;
+	sel.types=NULL;
+	sel.simplified=0;
 
 
 	menu=gui_internal_menu(this,_("Height Profile"));
@@ -306,6 +306,8 @@ protected:
                 sel.u.c_rect.rl.y=c.y-dist;
                 sel.order=18;
                 sel.range=item_range_all;
+                sel.types=NULL;
+                sel.simplified=0;
                 h=mapset_open(ms);
                 while ((m=mapset_next(h,1))) {
                         mr=map_rect_new(m, &sel);
@@ -440,6 +440,116 @@ item_range_contains_item(struct item_range *range, enum item_type type)
 	return 0;
 }
 
+/*
+ * A set of item types, kept as an open addressed hash table since the type
+ * numbers are sparse. type_none marks a free slot.
+ */
+struct item_type_filter {
+	enum item_type *types;
+	int size;
+	int count;
+};
+
+#define item_type_filter_hash(filter,type) ((type*2654435761U) & ((filter)->size-1))
+
+/**
+ * @brief Creates an empty set of item types
+ *
+ * A filter is used to tell a map which item types are needed, see struct map_selection.
+ *
+ * @return The new filter
+ */
+struct item_type_filter *
+item_type_filter_new(void)
+{
+	struct item_type_filter *filter=g_new0(struct item_type_filter, 1);
+	filter->size=256;
+	filter->types=g_new0(enum item_type, filter->size);
+	return filter;
+}
+
+static void
+item_type_filter_insert(struct item_type_filter *filter, enum item_type type)
+{
+	int idx=item_type_filter_hash(filter, type);
+	while (filter->types[idx] != type_none) {
+		if (filter->types[idx] == type)
+			return;
+		idx=(idx+1) & (filter->size-1);
+	}
+	filter->types[idx]=type;
+	filter->count++;
+}
+
+/**
+ * @brief Adds an item type to a filter
+ *
+ * @param filter The filter
+ * @param type The type to add, adding a type twice has no effect
+ */
+void
+item_type_filter_add(struct item_type_filter *filter, enum item_type type)
+{
+	if (type == type_none)
+		return;
+	if ((filter->count+1)*2 > filter->size) {
+		enum item_type *types=filter->types;
+		int i,size=filter->size;
+		filter->size*=2;
+		filter->types=g_new0(enum item_type, filter->size);
+		filter->count=0;
+		for (i = 0 ; i < size ; i++) {
+			if (types[i] != type_none)
+				item_type_filter_insert(filter, types[i]);
+		}
+		g_free(types);
+	}
+	item_type_filter_insert(filter, type);
+}
+
+/**
+ * @brief Checks whether a filter contains an item type
+ *
+ * @param filter The filter
+ * @param type The type to look up
+ * @return 1 if the type was added to the filter, 0 otherwise
+ */
+int
+item_type_filter_contains(struct item_type_filter *filter, enum item_type type)
+{
+	int idx=item_type_filter_hash(filter, type);
+	while (filter->types[idx] != type_none) {
+		if (filter->types[idx] == type)
+			return 1;
+		idx=(idx+1) & (filter->size-1);
+	}
+	return 0;
+}
+
+/**
+ * @brief Removes all item types from a filter
+ *
+ * @param filter The filter
+ */
+void
+item_type_filter_clear(struct item_type_filter *filter)
+{
+	memset(filter->types, 0, filter->size*sizeof(*filter->types));
+	filter->count=0;
+}
+
+/**
+ * @brief Destroys a filter
+ *
+ * @param filter The filter
+ */
+void
+item_type_filter_destroy(struct item_type_filter *filter)
+{
+	g_free(filter->types);
+	g_free(filter);
+}
+
 void
 item_dump_attr(struct item *item, struct map *map, FILE *out)
 {
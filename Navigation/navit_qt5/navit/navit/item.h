@@ -121,6 +121,7 @@ struct coord;
 struct item;
 struct item_hash;
 struct item_range;
+struct item_type_filter;
 struct map;
 struct map_selection;
 void item_create_hash(void);
@@ -149,6 +150,11 @@ void *item_hash_lookup(struct item_hash *h, struct item *item);
 void item_hash_destroy(struct item_hash *h);
 int item_range_intersects_range(struct item_range *range1, struct item_range *range2);
 int item_range_contains_item(struct item_range *range, enum item_type type);
+struct item_type_filter *item_type_filter_new(void);
+void item_type_filter_add(struct item_type_filter *filter, enum item_type type);
+int item_type_filter_contains(struct item_type_filter *filter, enum item_type type);
+void item_type_filter_clear(struct item_type_filter *filter);
+void item_type_filter_destroy(struct item_type_filter *filter);
 void item_dump_attr(struct item *item, struct map *map, FILE *out);
 void item_dump_filedesc(struct item *item, struct map *map, FILE *out);
 void item_cleanup(void);
@@ -377,6 +377,167 @@ int linguistics_compare(const char *s1, const char *s2, enum linguistics_cmp_mod
 	return ret;
 }
 
+struct linguistics_fuzzy {
+	int len;			/* length of the search string in characters, at most 64 */
+	int max_distance;
+	unsigned long long ascii[128];	/* bit i is set where character i of the search string is the array index */
+	int other_count;
+	gunichar other[64];
+	unsigned long long other_mask[64];
+};
+
+static unsigned long long
+linguistics_fuzzy_mask(struct linguistics_fuzzy *fuzzy, gunichar c)
+{
+	int i;
+	if (c < 128)
+		return fuzzy->ascii[c];
+	for (i = 0 ; i < fuzzy->other_count ; i++)
+		if (fuzzy->other[i] == c)
+			return fuzzy->other_mask[i];
+	return 0;
+}
+
+/**
+ * @brief Prepare an approximate comparison with a search string.
+ *
+ * The search string is precompiled into one bit mask per distinct character, so that
+ * linguistics_fuzzy_distance() can compare a name with a few word operations per character.
+ *
+ * @param str Search string, should be linguistics_casefold()ed before calling this function.
+ * @param max_distance Maximum edit distance to accept, or -1 to choose it by the length of str
+ * (no typos below 4 characters, one below 8, two otherwise).
+ * @returns Matcher to be freed with linguistics_fuzzy_destroy(), or NULL if str is too short or too long for approximate matching.
+ */
+struct linguistics_fuzzy *
+linguistics_fuzzy_new(const char *str, int max_distance)
+{
+	struct linguistics_fuzzy *ret;
+	int i,len=g_utf8_strlen(str, -1);
+
+	if (max_distance < 0)
+		max_distance=len < 4 ? 0 : (len < 8 ? 1 : 2);
+	if (max_distance <= 0 || len > 64)
+		return NULL;
+	ret=g_new0(struct linguistics_fuzzy, 1);
+	ret->len=len;
+	ret->max_distance=max_distance;
+	for (i = 0 ; *str ; i++, str=g_utf8_next_char(str)) {
+		gunichar c=g_utf8_get_char(str);
+		int j;
+		if (c < 128) {
+			ret->ascii[c]|=1ULL << i;
+			continue;
+		}
+		for (j = 0 ; j < ret->other_count && ret->other[j] != c ; j++);
+		if (j == ret->other_count)
+			ret->other[ret->other_count++]=c;
+		ret->other_mask[j]|=1ULL << i;
+	}
+	return ret;
+}
+
+void
+linguistics_fuzzy_destroy(struct linguistics_fuzzy *fuzzy)
+{
+	g_free(fuzzy);
+}
+
+/*
+ * Damerau-Levenshtein distance (adjacent transpositions count as one edit) between the search string
+ * and str, or the smallest distance to any prefix of str if partial is set. This is the bit-parallel
+ * algorithm by Myers as extended by Hyyrö: one column of the distance matrix is kept as bit vectors
+ * of vertical deltas, and only the value in the last row is tracked.
+ */
+static int
+linguistics_fuzzy_distance_word(struct linguistics_fuzzy *fuzzy, const char *str, int partial)
+{
+	unsigned long long vp=~0ULL,vn=0,d0=0,hp,hn,pm,pm_prev=0;
+	unsigned long long last=1ULL << (fuzzy->len-1);
+	int score=fuzzy->len,best=fuzzy->len,n=0;
+
+	while (*str) {
+		/* Each further character raises the distance to at least n-len */
+		if (n >= fuzzy->len+fuzzy->max_distance) {
+			if (!partial)
+				return -1;
+			break;
+		}
+		if (*str & 128) {
+			pm=linguistics_fuzzy_mask(fuzzy, g_utf8_get_char(str));
+			str=g_utf8_next_char(str);
+		} else
+			pm=fuzzy->ascii[(unsigned char)*str++];
+		d0=((((~d0) & pm) << 1) & pm_prev) | (((pm & vp) + vp) ^ vp) | pm | vn;
+		hp=vn | ~(d0 | vp);
+		hn=d0 & vp;
+		if (hp & last)
+			score++;
+		else if (hn & last)
+			score--;
+		hp=(hp << 1) | 1;
+		hn=hn << 1;
+		vp=hn | ~(d0 | hp);
+		vn=hp & d0;
+		pm_prev=pm;
+		n++;
+		if (score < best)
+			best=score;
+	}
+	if (!partial)
+		best=score;
+	return best <= fuzzy->max_distance ? best : -1;
+}
+
+/**
+ * @brief Approximately compare a string with a search string.
+ *
+ * @param fuzzy Matcher for the search string, see linguistics_fuzzy_new().
+ * @param str String to process, for example, an item name from the map. Will be linguistics_casefold()ed before comparison.
+ * @param mode Composition of linguistics_cmp_mode flags, with the same meaning as for linguistics_compare().
+ * @returns Smallest edit distance found, -1 if it exceeds the maximum distance of the matcher.
+ */
+int
+linguistics_fuzzy_distance(struct linguistics_fuzzy *fuzzy, const char *str, enum linguistics_cmp_mode mode)
+{
+	const char *p;
+	char *folded=NULL;
+	int i,best=-1;
+
+	/* Names from the map are often plain lower case ASCII already, these need neither folding nor expansion */
+	for (p = str ; *p ; p++)
+		if ((*p >= 'A' && *p <= 'Z') || (*p & 128))
+			break;
+	if (*p)
+		folded=linguistics_casefold(str);
+	for (i = 0 ; i < 3 ; i++) {
+		char *s,*word;
+		if (i > 0) {
+			if (!folded || !(mode & linguistics_cmp_expand))
+				break;
+			s=linguistics_expand_special(folded, i);
+			if (!s)
+				continue;
+		} else
+			s=folded ? folded : (char *)str;
+		word=s;
+		while (word) {
+			int distance=linguistics_fuzzy_distance_word(fuzzy, word, mode & linguistics_cmp_partial);
+			if (distance >= 0 && (best < 0 || distance < best))
+				best=distance;
+			if (!best || !(mode & linguistics_cmp_words))
+				break;
+			word=linguistics_next_word(word);
+		}
+		if (i > 0)
+			g_free(s);
+		if (!best)
+			break;
+	}
+	g_free(folded);
+	return best;
+}
+
 /**
  * @brief Replace special characters in string (e.g. umlauts) with plain letters.
  * This is useful e.g. to canonicalize a string for comparison.
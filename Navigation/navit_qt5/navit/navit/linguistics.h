@@ -14,6 +14,10 @@ enum linguistics_cmp_mode {
 	linguistics_cmp_words=4
 };
 int linguistics_compare(const char *s1, const char *s2, enum linguistics_cmp_mode mode);
+struct linguistics_fuzzy;
+struct linguistics_fuzzy *linguistics_fuzzy_new(const char *str, int max_distance);
+int linguistics_fuzzy_distance(struct linguistics_fuzzy *fuzzy, const char *str, enum linguistics_cmp_mode mode);
+void linguistics_fuzzy_destroy(struct linguistics_fuzzy *fuzzy);
 #ifdef __cplusplus
 }
 #endif
@@ -51,6 +51,8 @@
 #include "callback.h"
 #include "country.h"
 #include "xmlconfig.h"
+#include "benchmark.h"
+#include "trace.h"
 
 /**
  * @brief Holds information about a map
@@ -94,6 +96,8 @@ map_new(struct attr *parent, struct attr **attrs)
 	struct map *m;
 	struct map_priv *(*maptype_new)(struct map_methods *meth, struct attr **attrs, struct callback_list *cbl);
 	struct attr *type=attr_search(attrs, NULL, attr_type);
+	struct attr *data;
+	double start=trace_enabled ? benchmark_time() : 0;
 
 	if (! type) {
 		dbg(lvl_error,"missing type\n");
@@ -115,6 +119,8 @@ map_new(struct attr *parent, struct attr **attrs)
 		map_destroy(m);
 		m=NULL;
 	}
+	data=attr_search(attrs, NULL, attr_data);
+	trace_span("map", data ? data->u.str : type->u.str, start);
 	return m;
 }
 
@@ -340,6 +346,23 @@ map_rect_new(struct map *m, struct map_selection *sel)
 	return mr;
 }
 
+/**
+ * @brief Hints a map that the data of a selection will probably be needed soon
+ *
+ * Maps supporting this start reading the data in the background, so that a later
+ * map_rect_new() with a similar selection does not block on the disk. This is only
+ * a hint and does nothing for other maps.
+ *
+ * @param m The map
+ * @param sel The selection, in the projection of the map
+ */
+void
+map_prefetch(struct map *m, struct map_selection *sel)
+{
+	if (m->meth.map_prefetch)
+		m->meth.map_prefetch(m->priv, sel);
+}
+
 /**
  * @brief Gets the next item from a map rect
  *
@@ -435,7 +458,9 @@ struct map_search {
  * @param m The map that should be searched
  * @param item Specifies a superior item to "search within" (see description)
  * @param search_attr Attribute specifying what to search for. See description.
- * @param partial Set this to true to also have partial matches. See description.
+ * @param partial Set this to true to also have partial matches. See description. Plugins supporting it
+ * also return approximate matches if map_search_fuzzy is set, other plugins get map_search_partial
+ * instead, see enum map_search_flags.
  * @return A new map search struct for this search
  */
 struct map_search *
@@ -447,6 +472,8 @@ map_search_new(struct map *m, struct item *item, struct attr *search_attr, int p
 	this_=g_new0(struct map_search,1);
 	this_->m=m;
 	this_->search_attr=*search_attr;
+	if ((partial & ~map_search_partial) & ~m->meth.search_flags)
+		partial=map_search_partial;
 	if ((search_attr->type >= attr_country_all && search_attr->type <= attr_country_name) || search_attr->type == attr_country_id)
 		this_->priv=country_search_new(&this_->search_attr, partial);
 	else {
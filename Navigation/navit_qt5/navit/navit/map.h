@@ -62,6 +62,23 @@ struct map_selection {
 	} u;
 	int order;		    	/**< Holds the order */
 	struct item_range range;	/**< Range of items which should be delivered */
+	struct item_type_filter *types;	/**< If not NULL, only items of these types are needed and maps may skip
+					     the others without decoding them. Not owned by the selection, maps use
+					     the filter of the first selection */
+	int simplified;			/**< Items may be delivered as copies with their geometry simplified for the order,
+					     for drawing only. Maps use the flag of the first selection */
+};
+
+/**
+ * @brief Flags for the partial argument of map_search_new()
+ *
+ * map_search_new() passes map_search_fuzzy only to plugins listing it in their search_flags,
+ * other plugins get a partial search instead, so the caller has to check the names of the
+ * items returned.
+ */
+enum map_search_flags {
+	map_search_partial=1,	/**< Also match names starting with the search string */
+	map_search_fuzzy=2,	/**< Also match names differing by a few typos, see linguistics_fuzzy_new() */
 };
 
 /**
@@ -86,6 +103,8 @@ struct map_methods {
 	struct item *		(*map_rect_create_item)(struct map_rect_priv *mr, enum item_type type); /**< Function to create a new item in the map */
 	int			(*map_get_attr)(struct map_priv *priv, enum attr_type type, struct attr *attr);
         int			(*map_set_attr)(struct map_priv *priv, struct attr *attr);
+	void			(*map_prefetch)(struct map_priv *priv, struct map_selection *sel); /**< Optional function to start reading the data of a selection in the background */
+	int			search_flags; /**< Flags of enum map_search_flags besides map_search_partial the plugin supports */
 
 };
 
@@ -255,6 +274,7 @@ enum projection map_projection(struct map *this_);
 void map_set_projection(struct map *this_, enum projection pro);
 void map_destroy(struct map *m);
 struct map_rect *map_rect_new(struct map *m, struct map_selection *sel);
+void map_prefetch(struct map *m, struct map_selection *sel);
 struct item *map_rect_get_item(struct map_rect *mr);
 struct item *map_rect_get_item_byid(struct map_rect *mr, int id_hi, int id_lo);
 struct item *map_rect_create_item(struct map_rect *mr, enum item_type type_);
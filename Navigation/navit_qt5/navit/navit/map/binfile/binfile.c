@@ -22,7 +22,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <zlib.h>
 #include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "debug.h"
 #include "plugin.h"
 #include "projection.h"
@@ -39,9 +43,17 @@
 #include "callback.h"
 #include "types.h"
 #include "geom.h"
+#include "benchmark.h"
+#include "counter.h"
+#include "trace.h"
 
 static int map_id;
 
+/* Limits of one approximate name lookup, see binfile_nameindex_fuzzy_keys() */
+#define BINFILE_NAMEINDEX_FUZZY_MAX_KEYS 200000
+#define BINFILE_NAMEINDEX_FUZZY_BUDGET 150
+#define BINFILE_NAMEINDEX_FUZZY_CHECK 1024
+
 
 /**
  * @brief A map tile, a rectangular region of the world.
@@ -133,6 +145,29 @@ struct map_priv {
 	long download_enabled;
 	int last_searched_town_id_hi;	
 	int last_searched_town_id_lo;
+	struct binfile_nameindex *nameindex;
+	int nameindex_checked;
+	struct binfile_prefetch_tile *prefetch_tiles;
+	int prefetch_tile_count;
+	int prefetch_checked;
+#ifdef HAVE_PTHREAD
+	pthread_t open_thread;		/**< Thread reading the directory of the map, see map_binfile_open_async() */
+	int opening;			/**< open_thread has not been joined yet */
+	int open_result;		/**< Result of map_binfile_setup() on open_thread */
+#endif
+};
+
+#define BINFILE_PREFETCH_NAME_MAX 24
+#define BINFILE_PREFETCH_CD_BLOCK 65536
+
+/**
+ * @brief Location of a tile member in the zip file, used for prefetching
+ */
+struct binfile_prefetch_tile {
+	char name[BINFILE_PREFETCH_NAME_MAX];	/**< Tile name, the tiles are sorted by it */
+	int depth;		/**< Length of the tile name */
+	long long offset;	/**< Offset of the local file header */
+	int size;		/**< Size of the local file header and the compressed data */
 };
 
 struct map_rect_priv {
@@ -142,6 +177,7 @@ struct map_rect_priv {
 	int label;
 	int *label_attr[5];
         struct map_selection *sel;
+	struct item_type_filter *types;	/**< Types of the items to return, from the selection, NULL for all */
         struct map_priv *m;
         struct item item;
 	int tile_depth;
@@ -175,6 +211,30 @@ struct map_search_priv {
 	struct coord_rect rect_new;
 	char *parent_name;
 	GHashTable *search_results;
+	struct binfile_nameindex_posting *postings; /**< Items found in the name index, NULL if the map is scanned. */
+	int postings_count;
+	int posting;
+	struct linguistics_fuzzy *fuzzy; /**< Matcher for approximate search, NULL for exact search. */
+};
+
+/**
+ * @brief Name search index of a map, see maptool/nameindex.c.
+ */
+struct binfile_nameindex {
+	struct tile t;
+	struct binfile_nameindex_key *keys;
+	struct binfile_nameindex_posting *postings;
+	struct binfile_nameindex_trigram *trigrams;
+	int *trigram_refs;
+	char *strings;
+	int key_count;
+	int trigram_count;
+	int strings_size;
+	/* Keys found by the last approximate lookup, reused when streets are searched in the next town */
+	int fuzzy_type,fuzzy_country,fuzzy_partial;
+	char *fuzzy_str;
+	int *fuzzy_keys;
+	int fuzzy_key_count;
 };
 
 
@@ -444,10 +504,13 @@ binfile_search_cd(struct map_priv *m, int offset, char *name, int partial, int s
 	return -1;
 }
 
+static void map_binfile_wait(struct map_priv *m);
+
 static void
 map_destroy_binfile(struct map_priv *m)
 {
 	dbg(lvl_debug,"map_destroy_binfile\n");
+	map_binfile_wait(m);
 	if (m->fi)
 		map_binfile_close(m);
 	map_binfile_destroy(m);
@@ -1486,6 +1549,8 @@ map_rect_new_binfile_int(struct map_priv *map, struct map_selection *sel)
 	mr=g_new0(struct map_rect_priv, 1);
 	mr->m=map;
 	mr->sel=sel;
+	if (sel)
+		mr->types=sel->types;
 	mr->item.id_hi=0;
 	mr->item.id_lo=0;
 	mr->item.meth=&methods_binfile;
@@ -1562,11 +1627,165 @@ map_download_selection(struct map_priv *m, struct map_rect_priv *mr, struct map_
 	}
 }
 
+static int
+binfile_prefetch_tile_compare(const void *a, const void *b)
+{
+	return strcmp(((const struct binfile_prefetch_tile *)a)->name, ((const struct binfile_prefetch_tile *)b)->name);
+}
+
+static int
+binfile_prefetch_possible(struct map_priv *m)
+{
+	return m->fi && !m->fis && m->eoc && !m->url;
+}
+
+/**
+ * @brief Builds the sorted list of tiles which can be prefetched
+ *
+ * The central directory is walked in blocks of BINFILE_PREFETCH_CD_BLOCK bytes instead
+ * of reading each record on its own. Maps opened by map_binfile_open_async() do this on
+ * the thread reading the directory.
+ *
+ * @param m The map
+ */
+static void
+binfile_prefetch_index(struct map_priv *m)
+{
+	long long cdoffset=m->eoc64?m->eoc64->zip64eofst:m->eoc->zipeofst;
+	long long end=m->eoc64?m->eoc64->zip64ecsz:m->eoc->zipecsz;
+	long long offset=0,block_offset=0;
+	int block_size=0,size=0;
+	unsigned char *block=NULL;
+
+	m->prefetch_checked=1;
+	while (offset < end) {
+		struct binfile_prefetch_tile *tile;
+		struct zip_cd *cd;
+		char *name;
+		int j;
+		if (!block || offset+sizeof(*cd) > block_offset+block_size ||
+		    offset+sizeof(*cd)+((struct zip_cd *)(block+offset-block_offset))->zipcfnl+
+		    ((struct zip_cd *)(block+offset-block_offset))->zipcxtl > block_offset+block_size) {
+			if (block)
+				file_data_free(m->fi, block);
+			block_offset=offset;
+			block_size=end-offset > BINFILE_PREFETCH_CD_BLOCK ? BINFILE_PREFETCH_CD_BLOCK : end-offset;
+			block=file_data_read(m->fi, cdoffset+block_offset, block_size);
+			if (!block)
+				break;
+			if (offset+sizeof(*cd) > block_offset+block_size)
+				break;
+		}
+		cd=(struct zip_cd *)(block+offset-block_offset);
+		cd_to_cpu(cd);
+		if (cd->zipcensig != zip_cd_sig || offset+sizeof(*cd)+cd->zipcfnl+cd->zipcxtl > block_offset+block_size)
+			break;
+		offset+=sizeof(*cd)+cd->zipcfnl+cd->zipcxtl+cd->zipccml;
+		name=(char *)(cd+1);
+		for (j = 0 ; j < cd->zipcfnl ; j++)
+			if (name[j] < 'a' || name[j] > 'd')
+				break;
+		if (!cd->zipcfnl || cd->zipcfnl >= BINFILE_PREFETCH_NAME_MAX || j < cd->zipcfnl || !cd->zipcunc ||
+		    cd->zipcsiz == zip_size_64bit_placeholder)
+			continue;
+		if (m->prefetch_tile_count == size) {
+			size=size ? size*2 : 256;
+			m->prefetch_tiles=g_renew(struct binfile_prefetch_tile, m->prefetch_tiles, size);
+		}
+		tile=&m->prefetch_tiles[m->prefetch_tile_count++];
+		memcpy(tile->name, name, cd->zipcfnl);
+		tile->name[cd->zipcfnl]='\0';
+		tile->depth=cd->zipcfnl;
+		tile->offset=binfile_cd_offset(cd);
+		tile->size=sizeof(struct zip_lfh)+cd->zipcfnl+cd->zipcxtl+cd->zipcsiz;
+	}
+	if (block)
+		file_data_free(m->fi, block);
+	qsort(m->prefetch_tiles, m->prefetch_tile_count, sizeof(*m->prefetch_tiles), binfile_prefetch_tile_compare);
+	dbg(lvl_debug,"%d of %d members can be prefetched\n", m->prefetch_tile_count, m->zip_members);
+}
+
+/**
+ * @brief Prefetches the tiles below one tile of the quadtree
+ *
+ * @param m The map
+ * @param sel The selection
+ * @param name Name of the tile, followed by room for BINFILE_PREFETCH_NAME_MAX characters
+ * @param depth Length of name
+ * @param first First entry of m->prefetch_tiles starting with name
+ * @param last Entry after the last one starting with name
+ */
+static void
+binfile_prefetch_subtree(struct map_priv *m, struct map_selection *sel, char *name, int depth, int first, int last)
+{
+	struct map_selection *s;
+	struct coord_rect r;
+	int wanted=0,descend=0;
+	char c;
+
+	tile_bbox(name, depth, &r);
+	for (s = sel ; s ; s = s->next) {
+		if (depth <= s->order && coord_rect_overlap(&r, &s->u.c_rect)) {
+			wanted=1;
+			if (depth < s->order)
+				descend=1;
+		}
+	}
+	if (!wanted)
+		return;
+	/* The tile itself sorts before the tiles below it */
+	if (m->prefetch_tiles[first].depth == depth) {
+		file_data_prefetch(m->fi, m->prefetch_tiles[first].offset, m->prefetch_tiles[first].size);
+		first++;
+	}
+	if (!descend || depth+1 >= BINFILE_PREFETCH_NAME_MAX)
+		return;
+	for (c = 'a' ; c <= 'd' && first < last ; c++) {
+		int lo=first,hi=last;
+		/* Entries below this child end at the first name with a later character at this depth */
+		while (lo < hi) {
+			int mid=(lo+hi)/2;
+			if (m->prefetch_tiles[mid].name[depth] <= c)
+				lo=mid+1;
+			else
+				hi=mid;
+		}
+		if (lo > first && m->prefetch_tiles[first].name[depth] == c) {
+			name[depth]=c;
+			binfile_prefetch_subtree(m, sel, name, depth+1, first, lo);
+		}
+		first=lo;
+	}
+}
+
+/**
+ * @brief Starts reading the tiles a map rect on the selection would visit
+ *
+ * The tiles are found by walking down the quadtree of tile names, only visiting
+ * tiles overlapping the selection. Only single file maps on local storage are
+ * prefetched.
+ */
+static void
+binfile_prefetch(struct map_priv *m, struct map_selection *sel)
+{
+	char name[BINFILE_PREFETCH_NAME_MAX];
+
+	map_binfile_wait(m);
+	if (!binfile_prefetch_possible(m))
+		return;
+	if (!m->prefetch_checked)
+		binfile_prefetch_index(m);
+	if (m->prefetch_tile_count)
+		binfile_prefetch_subtree(m, sel, name, 0, 0, m->prefetch_tile_count);
+}
+
+/* map_binfile_setup() uses this while the map is opened, map_rect_new_binfile() would wait for itself */
 static struct map_rect_priv *
-map_rect_new_binfile(struct map_priv *map, struct map_selection *sel)
+map_rect_new_binfile_nowait(struct map_priv *map, struct map_selection *sel)
 {
 	struct map_rect_priv *mr=map_rect_new_binfile_int(map, sel);
 	struct tile t;
+
 	dbg(lvl_debug,"zip_members=%d\n", map->zip_members);
 	if (map->url && map->fi && sel && sel->order == 255) {
 		map_download_selection(map, mr, sel);
@@ -1591,6 +1810,13 @@ map_rect_new_binfile(struct map_priv *map, struct map_selection *sel)
 	return mr;
 }
 
+static struct map_rect_priv *
+map_rect_new_binfile(struct map_priv *map, struct map_selection *sel)
+{
+	map_binfile_wait(map);
+	return map_rect_new_binfile_nowait(map, sel);
+}
+
 static void
 write_changes_do(gpointer key, gpointer value, gpointer user_data)
 {
@@ -1646,6 +1872,271 @@ load_changes(struct map_priv *m)
 }
 
 
+/**
+ * @brief Stores where the map ended before an update was started.
+ *
+ * @param delta_file The update
+ * @param header Header of the update with base_size set
+ * @return 1 on success, 0 on error
+ */
+static int
+binfile_delta_write_header(char *delta_file, struct binfile_delta_header *header)
+{
+	struct attr readwrite={attr_readwrite,{(void *)1}};
+	struct attr *attrs[]={&readwrite, NULL};
+	struct file *fi=file_create(delta_file, attrs);
+	int ok;
+
+	if (!fi)
+		return 0;
+	ok=file_data_write(fi, 0, sizeof(*header), header);
+	if (ok)
+		file_fsync(fi);
+	file_destroy(fi);
+	return ok;
+}
+
+/* Size of the pieces the tiles of an update are copied in */
+#define BINFILE_DELTA_CHUNK (1024*1024)
+
+/**
+ * @brief Copies a range of one file to another in pieces of at most BINFILE_DELTA_CHUNK bytes.
+ *
+ * @return 1 on success, 0 on error
+ */
+static int
+binfile_delta_copy(struct file *from, long long offset, struct file *to, long long to_offset, long long size)
+{
+	while (size > 0) {
+		int len=size < BINFILE_DELTA_CHUNK ? size : BINFILE_DELTA_CHUNK;
+		unsigned char *data=file_data_read(from, offset, len);
+		int ok=data && file_data_write(to, to_offset, len, data);
+		file_data_free(from, data);
+		if (!ok)
+			return 0;
+		offset+=len;
+		to_offset+=len;
+		size-=len;
+	}
+	return 1;
+}
+
+/**
+ * @brief Applies a tile level update written by "maptool --delta" to the map file.
+ *
+ * Members contained in the delta are appended to the map, followed by the
+ * updated central directory, so tiles which did not change are neither
+ * downloaded nor rewritten. Unchanged members are looked up by name in the
+ * central directory of the installed map and must have the checksum and sizes
+ * recorded in the delta, so a delta made from the previous release applies no
+ * matter whether the installed map was downloaded or updated by earlier deltas.
+ * The size of the map is stored in the delta before anything is written. As
+ * nothing before that end of the map is modified, an interrupted update is
+ * simply repeated on the next start. The space taken by replaced tiles is
+ * reclaimed by the next full download of the map. Only the header and the
+ * member table of the delta are held in memory, the tiles are copied piecewise.
+ *
+ * @param m The map to update, must not be opened yet
+ */
+static void
+binfile_apply_delta(struct map_priv *m)
+{
+	struct attr readwrite={attr_readwrite,{(void *)1}};
+	struct attr *attrs[]={&readwrite, NULL};
+	struct zip_eoc *eoc,eoc_new={zip_eoc_sig};
+	struct zip64_eocl *eocl,eocl_new={zip64_eocl_sig};
+	struct zip64_eoc *eoc64,eoc64_new={zip64_eoc_sig,sizeof(struct zip64_eoc)-12,0,0x0403};
+	struct binfile_delta_header header,*data=NULL;
+	struct file *fi,*dfi;
+	GHashTable *base_members=NULL;
+	char *delta_file=g_strdup_printf("%s.delta",m->filename);
+	unsigned char *table=NULL,*pos,*end,*cd,*old_cd=NULL;
+	long long base_size,cd_offset,cd_size,payload_size,table_size,written=0;
+	int members,i,ok=0;
+
+	if (!file_exists(delta_file) || !(dfi=file_create(delta_file, NULL))) {
+		g_free(delta_file);
+		return;
+	}
+	if (file_size(dfi) >= sizeof(header))
+		data=(struct binfile_delta_header *)file_data_read(dfi, 0, sizeof(header));
+	if (data) {
+		header=*data;
+		file_data_free(dfi, (unsigned char *)data);
+	}
+	fi=file_create(m->filename, attrs);
+	if (!fi || !data || memcmp(header.magic, binfile_delta_magic, sizeof(header.magic)) ||
+	    le32_to_cpu(header.version) != binfile_delta_version) {
+		dbg(lvl_error,"map file %s: invalid update %s\n", m->filename, delta_file);
+		goto out;
+	}
+	members=le32_to_cpu(header.members);
+	cd_size=le64_to_cpu(header.cd_size);
+	payload_size=le64_to_cpu(header.payload_size);
+	table_size=members*(long long)sizeof(struct binfile_delta_entry)+cd_size;
+	if (members < 0 || cd_size < 0 || payload_size < 0 || table_size > G_MAXINT ||
+	    file_size(dfi) != sizeof(header)+table_size+payload_size) {
+		dbg(lvl_error,"map file %s: update %s is corrupt\n", m->filename, delta_file);
+		goto out;
+	}
+	base_size=le64_to_cpu(header.base_size);
+	if (!base_size) {
+		base_size=file_size(fi);
+		header.base_size=cpu_to_le64(base_size);
+		if (!binfile_delta_write_header(delta_file, &header)) {
+			dbg(lvl_error,"map file %s: unable to write %s\n", m->filename, delta_file);
+			goto out;
+		}
+	}
+	if (file_size(fi) < base_size || base_size < sizeof(*eoc)+sizeof(*eocl)) {
+		dbg(lvl_error,"map file %s: update %s was made for a different map\n", m->filename, delta_file);
+		goto out;
+	}
+
+	/* Locate the central directory of the installed map, it is still intact even if an earlier update was interrupted */
+	eoc=(struct zip_eoc *)file_data_read(fi, base_size-sizeof(*eoc), sizeof(*eoc));
+	if (!eoc) {
+		dbg(lvl_error,"map file %s: unable to read end of central directory\n", m->filename);
+		goto out;
+	}
+	eoc_to_cpu(eoc);
+	cd_offset=eoc->zipeofst;
+	cd_size=eoc->zipecsz;
+	file_data_free(fi, (unsigned char *)eoc);
+	eocl=(struct zip64_eocl *)file_data_read(fi, base_size-sizeof(*eoc)-sizeof(*eocl), sizeof(*eocl));
+	if (!eocl) {
+		dbg(lvl_error,"map file %s: unable to read end of central directory\n", m->filename);
+		goto out;
+	}
+	if (le32_to_cpu(eocl->zip64lsig) == zip64_eocl_sig) {
+		eoc64=(struct zip64_eoc *)file_data_read(fi, le64_to_cpu(eocl->zip64lofst), sizeof(*eoc64));
+		if (!eoc64 || le32_to_cpu(eoc64->zip64esig) != zip64_eoc_sig) {
+			dbg(lvl_error,"map file %s: broken zip64 end of central directory\n", m->filename);
+			file_data_free(fi, (unsigned char *)eoc64);
+			file_data_free(fi, (unsigned char *)eocl);
+			goto out;
+		}
+		cd_offset=le64_to_cpu(eoc64->zip64eofst);
+		cd_size=le64_to_cpu(eoc64->zip64ecsz);
+		file_data_free(fi, (unsigned char *)eoc64);
+	}
+	file_data_free(fi, (unsigned char *)eocl);
+	old_cd=file_data_read(fi, cd_offset, cd_size);
+	if (!old_cd) {
+		dbg(lvl_error,"map file %s: unable to read central directory\n", m->filename);
+		goto out;
+	}
+	base_members=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (pos = old_cd ; pos+sizeof(struct zip_cd) <= old_cd+cd_size ; ) {
+		struct zip_cd *zcd=(struct zip_cd *)pos;
+		cd_to_cpu(zcd);
+		if (zcd->zipcensig != zip_cd_sig || pos+sizeof(*zcd)+zcd->zipcfnl+zcd->zipcxtl+zcd->zipccml > old_cd+cd_size)
+			break;
+		g_hash_table_insert(base_members, g_strndup(zcd->zipcfn, zcd->zipcfnl), zcd);
+		pos+=sizeof(*zcd)+zcd->zipcfnl+zcd->zipcxtl+zcd->zipccml;
+	}
+
+	/* Build the new central directory, pointing to the installed map or to the appended members */
+	table=file_data_read(dfi, sizeof(header), table_size);
+	if (!table) {
+		dbg(lvl_error,"map file %s: unable to read %s\n", m->filename, delta_file);
+		goto out;
+	}
+	cd_size=le64_to_cpu(header.cd_size);
+	cd=g_malloc(cd_size);
+	pos=table;
+	end=table+table_size;
+	for (i = 0 ; i < members ; i++) {
+		struct binfile_delta_entry *entry=(struct binfile_delta_entry *)pos;
+		struct zip_cd *zcd=(struct zip_cd *)(pos+sizeof(*entry));
+		struct zip_cd_ext *ext;
+		long long offset;
+		int len;
+		if (pos+sizeof(*entry)+sizeof(*zcd) > end)
+			break;
+		len=sizeof(*zcd)+le16_to_cpu(zcd->zipcfnl)+le16_to_cpu(zcd->zipcxtl)+le16_to_cpu(zcd->zipccml);
+		if (pos+sizeof(*entry)+len > end || written+len > cd_size)
+			break;
+		if (le32_to_cpu(entry->source) == binfile_delta_source_delta)
+			offset=le64_to_cpu(entry->offset)+base_size;
+		else {
+			char *name=g_strndup(zcd->zipcfn, le16_to_cpu(zcd->zipcfnl));
+			struct zip_cd *base=g_hash_table_lookup(base_members, name);
+			g_free(name);
+			if (!base || base->zipccrc != le32_to_cpu(zcd->zipccrc) || base->zipcsiz != le32_to_cpu(zcd->zipcsiz) ||
+			    base->zipcunc != le32_to_cpu(zcd->zipcunc) || base->zipcmthd != le16_to_cpu(zcd->zipcmthd)) {
+				dbg(lvl_error,"map file %s: update %s was made for a different map\n", m->filename, delta_file);
+				g_free(cd);
+				goto out;
+			}
+			offset=binfile_cd_offset(base);
+		}
+		memcpy(cd+written, zcd, len);
+		zcd=(struct zip_cd *)(cd+written);
+		ext=(struct zip_cd_ext *)((unsigned char *)zcd+sizeof(*zcd)+le16_to_cpu(zcd->zipcfnl));
+		if (le32_to_cpu(zcd->zipofst) == zip_size_64bit_placeholder && le16_to_cpu(zcd->zipcxtl) >= sizeof(*ext) &&
+		    le16_to_cpu(ext->tag) == zip_extra_header_id_zip64)
+			ext->zipofst=cpu_to_le64(offset);
+		else if (offset < zip_size_64bit_placeholder)
+			zcd->zipofst=cpu_to_le32(offset);
+		else
+			break;
+		written+=len;
+		pos+=sizeof(*entry)+len;
+	}
+	if (i != members || written != cd_size || pos != end) {
+		dbg(lvl_error,"map file %s: update %s is corrupt\n", m->filename, delta_file);
+		g_free(cd);
+		goto out;
+	}
+
+	/* Everything is written behind the end of the installed map, the new end of central directory goes last */
+	cd_offset=base_size+payload_size;
+	ok=binfile_delta_copy(dfi, sizeof(header)+table_size, fi, base_size, payload_size) && file_data_write(fi, cd_offset, cd_size, cd);
+	g_free(cd);
+	if (le32_to_cpu(header.flags) & binfile_delta_flag_zip64) {
+		eoc64_new.zip64enum=members;
+		eoc64_new.zip64ecenn=members;
+		eoc64_new.zip64ecsz=cd_size;
+		eoc64_new.zip64eofst=cd_offset;
+		eocl_new.zip64lofst=cd_offset+cd_size;
+		ok=ok && file_data_write(fi, cd_offset+cd_size, sizeof(eoc64_new), &eoc64_new) &&
+			file_data_write(fi, cd_offset+cd_size+sizeof(eoc64_new), sizeof(eocl_new), &eocl_new);
+		/* The counts are in the zip64 record, the 16 bit ones only hold placeholders */
+		eoc_new.zipenum=0xffff;
+		eoc_new.zipecenn=0xffff;
+	} else {
+		eoc_new.zipenum=members;
+		eoc_new.zipecenn=members;
+	}
+	eoc_new.zipecsz=cd_size < zip_size_64bit_placeholder ? cd_size : zip_size_64bit_placeholder;
+	eoc_new.zipeofst=cd_offset < zip_size_64bit_placeholder ? cd_offset : zip_size_64bit_placeholder;
+	if (le32_to_cpu(header.flags) & binfile_delta_flag_zip64)
+		cd_size+=sizeof(eoc64_new)+sizeof(eocl_new);
+	/* The end of central directory has to end the file, see binfile_read_eoc(), so no comment is kept */
+	eoc_new.zipecoml=0;
+	ok=ok && file_data_write(fi, cd_offset+cd_size, sizeof(eoc_new), &eoc_new);
+	if (ok) {
+		file_fsync(fi);
+		dbg(lvl_info,"map file %s: applied update, "LONGLONG_FMT" bytes of tiles added\n", m->filename, payload_size);
+	} else
+		dbg(lvl_error,"map file %s: failed to write update %s, will retry on next start\n", m->filename, delta_file);
+out:
+	if (base_members)
+		g_hash_table_destroy(base_members);
+	if (old_cd)
+		file_data_free(fi, old_cd);
+	if (fi)
+		file_destroy(fi);
+	if (table)
+		file_data_free(dfi, table);
+	file_destroy(dfi);
+	if (ok)
+		remove(delta_file);
+	g_free(delta_file);
+}
+
+
 static void
 map_rect_destroy_binfile(struct map_rect_priv *mr)
 {
@@ -1715,7 +2206,8 @@ map_parse_country_binfile(struct map_rect_priv *mr)
 	if (!binfile_attr_get(mr->item.priv_data, attr_zipfile_ref, &at))
 		return;
 
-	if(mr->msp)
+	/* Approximate matches may differ in the first letters, so all town tiles are read */
+	if(mr->msp && !mr->msp->fuzzy)
 	{
 		struct attr *search=&mr->msp->search;
 		if(search->type==attr_town_name || search->type==attr_district_name || search->type==attr_town_or_district_name) {
@@ -1787,6 +2279,29 @@ push_modified_item(struct map_rect_priv *mr)
 	return 0;
 }
 
+/*
+ * Ways and polygons may be stored several times by maptool -L, simplified for low
+ * orders. Those copies, and the original, carry the orders they are meant for as
+ * their first attribute. Copies are only delivered to selections asking for
+ * simplified geometry at a matching order, the original whenever no copy is.
+ */
+static int
+binfile_item_wanted_at_order(struct map_rect_priv *mr)
+{
+	struct tile *t=mr->t;
+	int orders,min,max;
+
+	if (mr->item.type < type_line || t->pos_attr_start+2 >= t->pos_next ||
+			le32_to_cpu(t->pos_attr_start[1]) != attr_simplified_orders)
+		return 1;
+	orders=le32_to_cpu(t->pos_attr_start[2]);
+	min=orders & 0xffff;
+	max=orders >> 16;
+	if (!mr->sel || !mr->sel->simplified)
+		return max == 255;
+	return mr->sel->order >= min && mr->sel->order <= max;
+}
+
 static struct item *
 map_rect_get_item_binfile(struct map_rect_priv *mr)
 {
@@ -1812,6 +2327,14 @@ map_rect_get_item_binfile(struct map_rect_priv *mr)
 			return NULL;
 		}
 		setup_pos(mr);
+		/* Skip unwanted items by their header. Not with changes, which may replace an item by one of another type */
+		if (mr->types && mr->item.type != type_submap && !mr->country_id && !mr->m->changes &&
+				!item_type_filter_contains(mr->types, mr->item.type)) {
+			counter_count("binfile_items_skipped", 1);
+			continue;
+		}
+		if (!binfile_item_wanted_at_order(mr))
+			continue;
 		binfile_coord_rewind(mr);
 		binfile_attr_rewind(mr);
 		if ((mr->item.type == type_submap) && (!mr->country_id)) {
@@ -2044,6 +2567,336 @@ binmap_get_estimated_boundaries (struct item *town, GList **boundaries)
 	return 0;
 }
 
+static void
+binfile_nameindex_free(struct map_priv *m)
+{
+	if (m->nameindex) {
+		file_data_free(m->nameindex->t.fi, (unsigned char *)m->nameindex->t.start);
+		g_free(m->nameindex->fuzzy_str);
+		g_free(m->nameindex->fuzzy_keys);
+		g_free(m->nameindex);
+		m->nameindex=NULL;
+	}
+	m->nameindex_checked=0;
+}
+
+/**
+ * @brief Loads the name search index of a map.
+ *
+ * @param m The map
+ * @return The index, or NULL if the map has none (maps built by older maptool versions)
+ */
+static struct binfile_nameindex *
+binfile_nameindex_get(struct map_priv *m)
+{
+	struct binfile_nameindex_header *header;
+	struct binfile_nameindex *ni;
+	struct zip_cd *cd;
+	long long size,needed;
+	int offset;
+
+	if (m->nameindex_checked || !m->eoc)
+		return m->nameindex;
+	m->nameindex_checked=1;
+	offset=binfile_search_cd(m, 0, binfile_nameindex_member, 1, 0);
+	if (offset == -1 || offset % m->cde_size)
+		return NULL;
+	cd=binfile_read_cd(m, offset, -1);
+	if (!cd)
+		return NULL;
+	ni=g_new0(struct binfile_nameindex, 1);
+	ni->t.zipfile_num=offset/m->cde_size;
+	if (!cd->zipcunc || !zipfile_to_tile(m, cd, &ni->t)) {
+		file_data_free(m->fi, (unsigned char *)cd);
+		g_free(ni);
+		return NULL;
+	}
+	file_data_free(m->fi, (unsigned char *)cd);
+	header=(struct binfile_nameindex_header *)ni->t.start;
+	size=(ni->t.end-ni->t.start)*4;
+	if (size < sizeof(*header) || memcmp(header->magic, binfile_nameindex_magic, sizeof(header->magic)) ||
+	    le32_to_cpu(header->version) != binfile_nameindex_version) {
+		dbg(lvl_error,"map file %s: unsupported name index\n", m->filename);
+		file_data_free(ni->t.fi, (unsigned char *)ni->t.start);
+		g_free(ni);
+		return NULL;
+	}
+	ni->key_count=le32_to_cpu(header->keys);
+	ni->trigram_count=le32_to_cpu(header->trigrams);
+	ni->strings_size=le32_to_cpu(header->strings_size);
+	needed=sizeof(*header)+(long long)ni->key_count*sizeof(*ni->keys)+
+		(long long)le32_to_cpu(header->postings)*sizeof(*ni->postings)+
+		(long long)ni->trigram_count*sizeof(*ni->trigrams)+
+		(long long)le32_to_cpu(header->trigram_refs)*sizeof(int)+ni->strings_size;
+	if (needed > size || !ni->strings_size || ((char *)ni->t.start)[needed-1]) {
+		dbg(lvl_error,"map file %s: name index truncated\n", m->filename);
+		file_data_free(ni->t.fi, (unsigned char *)ni->t.start);
+		g_free(ni);
+		return NULL;
+	}
+	ni->keys=(struct binfile_nameindex_key *)(header+1);
+	ni->postings=(struct binfile_nameindex_posting *)(ni->keys+ni->key_count);
+	ni->trigrams=(struct binfile_nameindex_trigram *)(ni->postings+le32_to_cpu(header->postings));
+	ni->trigram_refs=(int *)(ni->trigrams+ni->trigram_count);
+	ni->strings=(char *)(ni->trigram_refs+le32_to_cpu(header->trigram_refs));
+	dbg(lvl_debug,"map file %s: name index with %d keys\n", m->filename, ni->key_count);
+	m->nameindex=ni;
+	return ni;
+}
+
+static char *
+binfile_nameindex_key_name(struct binfile_nameindex *ni, struct binfile_nameindex_key *key)
+{
+	int name=le32_to_cpu(key->name);
+	if (name < 0 || name >= ni->strings_size)
+		return "";
+	return ni->strings+name;
+}
+
+static int
+binfile_nameindex_key_compare(struct binfile_nameindex *ni, struct binfile_nameindex_key *key, int type, int country, char *name)
+{
+	if (le32_to_cpu(key->type) != type)
+		return le32_to_cpu(key->type) < type ? -1:1;
+	if (le32_to_cpu(key->country) != country)
+		return le32_to_cpu(key->country) < country ? -1:1;
+	return strcmp(binfile_nameindex_key_name(ni, key), name);
+}
+
+static void
+binfile_nameindex_add_postings(struct binfile_nameindex *ni, struct binfile_nameindex_key *key, struct coord_rect *r,
+		struct binfile_nameindex_posting **result, int *result_count, int *result_size)
+{
+	int i,first=le32_to_cpu(key->posting),count=le32_to_cpu(key->count);
+
+	for (i = first ; i < first+count ; i++) {
+		struct binfile_nameindex_posting p;
+		p.zipfile=le32_to_cpu(ni->postings[i].zipfile);
+		p.offset=le32_to_cpu(ni->postings[i].offset);
+		p.minx=le32_to_cpu(ni->postings[i].minx);
+		p.miny=le32_to_cpu(ni->postings[i].miny);
+		p.maxx=le32_to_cpu(ni->postings[i].maxx);
+		p.maxy=le32_to_cpu(ni->postings[i].maxy);
+		if (r && (p.maxx < r->lu.x || p.minx > r->rl.x || p.maxy < r->rl.y || p.miny > r->lu.y))
+			continue;
+		if (*result_count == *result_size) {
+			*result_size=*result_size ? *result_size*2 : 16;
+			*result=g_renew(struct binfile_nameindex_posting, *result, *result_size);
+		}
+		(*result)[(*result_count)++]=p;
+	}
+}
+
+/* Number of the first key not sorting before the given one */
+static int
+binfile_nameindex_first_key(struct binfile_nameindex *ni, int type, int country, char *name)
+{
+	int lo=0,hi=ni->key_count;
+	while (lo < hi) {
+		int mid=(lo+hi)/2;
+		if (binfile_nameindex_key_compare(ni, &ni->keys[mid], type, country, name) < 0)
+			lo=mid+1;
+		else
+			hi=mid;
+	}
+	return lo;
+}
+
+static struct binfile_nameindex_trigram *
+binfile_nameindex_trigram(struct binfile_nameindex *ni, char *str)
+{
+	char trigram[4];
+	int lo=0,hi=ni->trigram_count;
+
+	memcpy(trigram, str, 3);
+	trigram[3]='\0';
+	while (lo < hi) {
+		int mid=(lo+hi)/2;
+		int cmp=memcmp(ni->trigrams[mid].trigram, trigram, sizeof(trigram));
+		if (!cmp)
+			return &ni->trigrams[mid];
+		if (cmp < 0)
+			lo=mid+1;
+		else
+			hi=mid;
+	}
+	return NULL;
+}
+
+static int
+binfile_nameindex_posting_compare(const void *a, const void *b)
+{
+	const struct binfile_nameindex_posting *pa=a;
+	const struct binfile_nameindex_posting *pb=b;
+	if (pa->zipfile != pb->zipfile)
+		return pa->zipfile < pb->zipfile ? -1:1;
+	if (pa->offset != pb->offset)
+		return pa->offset < pb->offset ? -1:1;
+	return 0;
+}
+
+/**
+ * @brief Finds the keys approximately matching a search string.
+ *
+ * Approximate matches may differ anywhere, so all names of the type (and country) are
+ * compared with the matcher. Street names are not indexed by town, so the keys are kept
+ * in the index and reused while the streets of the next towns are searched for the same
+ * string. The scan stops after BINFILE_NAMEINDEX_FUZZY_MAX_KEYS keys or
+ * BINFILE_NAMEINDEX_FUZZY_BUDGET ms, returning the matches found so far.
+ *
+ * @param m The map
+ * @param ni The name index of the map
+ * @param type attr_town_name or attr_street_name
+ * @param country Country id for towns
+ * @param str Casefolded search string
+ * @param partial Whether to match names starting with str
+ * @param fuzzy Matcher for str
+ */
+static void
+binfile_nameindex_fuzzy_keys(struct map_priv *m, struct binfile_nameindex *ni, int type, int country, char *str, int partial,
+		struct linguistics_fuzzy *fuzzy)
+{
+	enum linguistics_cmp_mode mode=(partial?linguistics_cmp_partial:0)|(type == attr_street_name?linguistics_cmp_words:0);
+	double deadline=benchmark_time()+BINFILE_NAMEINDEX_FUZZY_BUDGET;
+	int i,first,size=0;
+
+	if (ni->fuzzy_str && ni->fuzzy_type == type && ni->fuzzy_country == country && ni->fuzzy_partial == partial &&
+	    !strcmp(ni->fuzzy_str, str))
+		return;
+	g_free(ni->fuzzy_str);
+	g_free(ni->fuzzy_keys);
+	ni->fuzzy_keys=NULL;
+	ni->fuzzy_key_count=0;
+	ni->fuzzy_type=type;
+	ni->fuzzy_country=country;
+	ni->fuzzy_partial=partial;
+	ni->fuzzy_str=g_strdup(str);
+	first=binfile_nameindex_first_key(ni, type, country, "");
+	for (i = first ; i < ni->key_count ; i++) {
+		struct binfile_nameindex_key *key=&ni->keys[i];
+		if (le32_to_cpu(key->type) != type || le32_to_cpu(key->country) != country)
+			break;
+		if (i-first >= BINFILE_NAMEINDEX_FUZZY_MAX_KEYS ||
+		    (!((i-first) % BINFILE_NAMEINDEX_FUZZY_CHECK) && i > first && benchmark_time() >= deadline)) {
+			dbg(lvl_info,"map file %s: approximate search for '%s' stopped after %d names\n", m->filename, str, i-first);
+			break;
+		}
+		if (linguistics_fuzzy_distance(fuzzy, binfile_nameindex_key_name(ni, key), mode) < 0)
+			continue;
+		if (ni->fuzzy_key_count == size) {
+			size=size ? size*2 : 16;
+			ni->fuzzy_keys=g_renew(int, ni->fuzzy_keys, size);
+		}
+		ni->fuzzy_keys[ni->fuzzy_key_count++]=i;
+	}
+}
+
+/**
+ * @brief Looks up the items matching a search string in the name search index.
+ *
+ * Towns are found by a binary search over the sorted names of their country. Streets
+ * may match at any word of their name, so the candidates are the names containing all
+ * trigrams of the search string, which are then compared with linguistics_compare().
+ * Approximate matches may differ anywhere, see binfile_nameindex_fuzzy_keys(). The result
+ * is sorted by tile so that items of one tile are read in one go.
+ *
+ * @param m The map
+ * @param type attr_town_name or attr_street_name
+ * @param country Country id for towns
+ * @param str Casefolded search string
+ * @param partial Whether to match names starting with str
+ * @param fuzzy If not NULL, matcher for str to find approximate matches
+ * @param r If not NULL, only items whose bounding box overlaps r are returned
+ * @param result Set to the matching items (struct binfile_nameindex_posting), to be g_free()d
+ * @return Number of matching items, -1 if the search has to scan the map
+ */
+static int
+binfile_nameindex_lookup(struct map_priv *m, int type, int country, char *str, int partial, struct linguistics_fuzzy *fuzzy,
+		struct coord_rect *r, struct binfile_nameindex_posting **result)
+{
+	struct binfile_nameindex *ni=binfile_nameindex_get(m);
+	int i,len=strlen(str),count=0,size=0;
+
+	*result=NULL;
+	if (!ni)
+		return -1;
+	if (fuzzy) {
+		binfile_nameindex_fuzzy_keys(m, ni, type, country, str, partial, fuzzy);
+		for (i = 0 ; i < ni->fuzzy_key_count ; i++)
+			binfile_nameindex_add_postings(ni, &ni->keys[ni->fuzzy_keys[i]], r, result, &count, &size);
+	} else if (type == attr_street_name) {
+		struct binfile_nameindex_trigram *t,*shortest=NULL;
+		enum linguistics_cmp_mode mode=linguistics_cmp_words|(partial?linguistics_cmp_partial:0);
+		int *candidates,candidate_count;
+		int j;
+
+		/* Shorter search strings have no trigrams to narrow the candidates down */
+		if (len < 3)
+			return -1;
+		for (i = 0 ; i+3 <= len ; i++) {
+			t=binfile_nameindex_trigram(ni, str+i);
+			if (!t)
+				return 0;
+			if (!shortest || le32_to_cpu(t->count) < le32_to_cpu(shortest->count))
+				shortest=t;
+		}
+		candidate_count=le32_to_cpu(shortest->count);
+		candidates=g_new(int, candidate_count);
+		for (i = 0 ; i < candidate_count ; i++)
+			candidates[i]=le32_to_cpu(ni->trigram_refs[le32_to_cpu(shortest->ref)+i]);
+		/* Both lists are ascending, so intersecting them is a merge */
+		for (i = 0 ; i+3 <= len && candidate_count ; i++) {
+			int *refs,ref_count,k=0,out=0;
+			t=binfile_nameindex_trigram(ni, str+i);
+			if (t == shortest)
+				continue;
+			refs=ni->trigram_refs+le32_to_cpu(t->ref);
+			ref_count=le32_to_cpu(t->count);
+			for (j = 0 ; j < candidate_count && k < ref_count ; ) {
+				int ref=le32_to_cpu(refs[k]);
+				if (candidates[j] < ref)
+					j++;
+				else if (candidates[j] > ref)
+					k++;
+				else {
+					candidates[out++]=candidates[j++];
+					k++;
+				}
+			}
+			candidate_count=out;
+		}
+		for (i = 0 ; i < candidate_count ; i++) {
+			struct binfile_nameindex_key *key;
+			if (candidates[i] < 0 || candidates[i] >= ni->key_count)
+				continue;
+			key=&ni->keys[candidates[i]];
+			if (le32_to_cpu(key->type) == type && !linguistics_compare(binfile_nameindex_key_name(ni, key), str, mode))
+				binfile_nameindex_add_postings(ni, key, r, result, &count, &size);
+		}
+		g_free(candidates);
+	} else {
+		for (i = binfile_nameindex_first_key(ni, type, country, str) ; i < ni->key_count ; i++) {
+			struct binfile_nameindex_key *key=&ni->keys[i];
+			char *name=binfile_nameindex_key_name(ni, key);
+			if (le32_to_cpu(key->type) != type || le32_to_cpu(key->country) != country || strncmp(name, str, len))
+				break;
+			if (partial || !name[len])
+				binfile_nameindex_add_postings(ni, key, r, result, &count, &size);
+		}
+	}
+	if (count > 1) {
+		int out=1;
+		qsort(*result, count, sizeof(**result), binfile_nameindex_posting_compare);
+		for (i = 1 ; i < count ; i++) {
+			if (binfile_nameindex_posting_compare(&(*result)[i], &(*result)[out-1]))
+				(*result)[out++]=(*result)[i];
+		}
+		count=out;
+	}
+	dbg(lvl_debug,"name index: %d items for '%s'\n", count, str);
+	return count;
+}
+
 static struct map_search_priv *
 binmap_search_new(struct map_priv *map, struct item *item, struct attr *search, int partial)
 {
@@ -2052,10 +2905,19 @@ binmap_search_new(struct map_priv *map, struct item *item, struct attr *search,
 	struct item *town;
 	int idx;
 
+	map_binfile_wait(map);
+	msp->postings_count=-1;
 	msp->search = *search;
-	msp->partial = partial;
+	msp->partial = partial & map_search_partial;
 	if(ATTR_IS_STRING(msp->search.type))
 		msp->search.u.str=linguistics_casefold(search->u.str);
+	if (partial & map_search_fuzzy) {
+		if (search->type != attr_town_name && search->type != attr_town_or_district_name && search->type != attr_street_name)
+			goto error;
+		/* Search strings too short for typos have no approximate matches besides the exact ones */
+		if (!(msp->fuzzy=linguistics_fuzzy_new(msp->search.u.str, -1)))
+			goto error;
+	}
 
 	/*
      * NOTE: If you implement search for other attributes than attr_town_name and attr_street_name,
@@ -2066,6 +2928,13 @@ binmap_search_new(struct map_priv *map, struct item *item, struct attr *search,
 			break;
 		case attr_town_name:
 		case attr_town_or_district_name:
+			if ((msp->postings_count=binfile_nameindex_lookup(map, attr_town_name, item->id_lo, msp->search.u.str, msp->partial, msp->fuzzy,
+					NULL, &msp->postings)) >= 0) {
+				msp->mr = map_rect_new_binfile_int(map, NULL);
+				if (!msp->mr)
+					break;
+				return msp;
+			}
 			map_rec = map_rect_new_binfile(map, NULL);
 			if (!map_rec)
 				break;
@@ -2098,6 +2967,11 @@ binmap_search_new(struct map_priv *map, struct item *item, struct attr *search,
 							msp->mr=binmap_search_street_by_estimate(map, town, &c, &msp->ms);
 							msp->mode = 3;
 						}
+						if (msp->mr && (msp->postings_count=binfile_nameindex_lookup(map, attr_street_name, 0, msp->search.u.str, msp->partial,
+								msp->fuzzy, &msp->ms.u.c_rect, &msp->postings)) >= 0) {
+							map_rect_destroy_binfile(msp->mr);
+							msp->mr=map_rect_new_binfile_int(map, &msp->ms);
+						}
 					}
 				}
 				map_rect_destroy_binfile(map_rec);
@@ -2159,6 +3033,10 @@ binmap_search_new(struct map_priv *map, struct item *item, struct attr *search,
 		default:
 			break;
 	}
+error:
+	g_free(msp->postings);
+	if (msp->fuzzy)
+		linguistics_fuzzy_destroy(msp->fuzzy);
 	if(ATTR_IS_STRING(msp->search.type))
 		g_free(msp->search.u.str);
 	g_free(msp);
@@ -2289,6 +3167,46 @@ item_inside_poly_list(struct item *it, GList *l)
 	return 0;
 }
 
+/**
+ * @brief Returns the next item a search has to check.
+ *
+ * Items are taken from the name index results if there are any, otherwise the map rect is scanned.
+ */
+static struct item *
+binmap_search_next_item(struct map_search_priv *map_search)
+{
+	struct map_rect_priv *mr=map_search->mr;
+	struct binfile_nameindex_posting *p;
+	struct tile *t;
+
+	if (map_search->postings_count < 0)
+		return map_rect_get_item_binfile(mr);
+	if (map_search->posting >= map_search->postings_count)
+		return NULL;
+	p=&map_search->postings[map_search->posting++];
+	t=mr->t;
+	/* Postings are sorted by tile, so the current tile can usually be kept */
+	if (!t || t->mode != 1 || t->zipfile_num != p->zipfile)
+		return map_rect_get_item_byid_binfile(mr, p->zipfile, p->offset);
+	t->pos=t->start+p->offset;
+	mr->item.id_hi=p->zipfile;
+	mr->item.id_lo=p->offset;
+	if (mr->m->changes)
+		push_modified_item(mr);
+	setup_pos(mr);
+	binfile_coord_rewind(mr);
+	binfile_attr_rewind(mr);
+	return &mr->item;
+}
+
+static int
+binmap_search_match(struct map_search_priv *map_search, char *str, enum linguistics_cmp_mode mode)
+{
+	if (map_search->fuzzy)
+		return linguistics_fuzzy_distance(map_search->fuzzy, str, mode) >= 0;
+	return !linguistics_compare(str, map_search->search.u.str, mode);
+}
+
 static struct item *
 binmap_search_get_item(struct map_search_priv *map_search)
 {
@@ -2297,21 +3215,23 @@ binmap_search_get_item(struct map_search_priv *map_search)
 	enum linguistics_cmp_mode mode=(map_search->partial?linguistics_cmp_partial:0);
 
 	for (;;) {
-		while ((it  = map_rect_get_item_binfile(map_search->mr))) {
+		while ((it  = binmap_search_next_item(map_search))) {
 			int has_house_number=0;
+			/* Items from the name index are not nested in the country index */
+			int town_level=map_search->postings_count >= 0 || map_search->mr->tile_depth > 1;
 			switch (map_search->search.type) {
 			case attr_town_name:
 			case attr_district_name:
 			case attr_town_or_district_name:
-				if (map_search->mr->tile_depth > 1 && item_is_town(*it) && map_search->search.type != attr_district_name) {
+				if (town_level && item_is_town(*it) && map_search->search.type != attr_district_name) {
 					if (binfile_attr_get(it->priv_data, attr_town_name_match, &at) || binfile_attr_get(it->priv_data, attr_town_name, &at)) {
-						if (!linguistics_compare(at.u.str, map_search->search.u.str, mode) && !duplicate(map_search, it, attr_town_name))
+						if (binmap_search_match(map_search, at.u.str, mode) && !duplicate(map_search, it, attr_town_name))
 							return it;
 					}
 				}
-				if (map_search->mr->tile_depth > 1 && item_is_district(*it) && map_search->search.type != attr_town_name) {
+				if (town_level && item_is_district(*it) && map_search->search.type != attr_town_name) {
 					if (binfile_attr_get(it->priv_data, attr_district_name_match, &at) || binfile_attr_get(it->priv_data, attr_district_name, &at)) {
-						if (!linguistics_compare(at.u.str, map_search->search.u.str, mode) && !duplicate(map_search, it, attr_town_name))
+						if (binmap_search_match(map_search, at.u.str, mode) && !duplicate(map_search, it, attr_town_name))
 							return it;
 					}
 				}
@@ -2319,7 +3239,7 @@ binmap_search_get_item(struct map_search_priv *map_search)
 			case attr_street_name:
 				if (map_search->mode == 1) {
 					if (binfile_attr_get(it->priv_data, attr_street_name_match, &at) || binfile_attr_get(it->priv_data, attr_street_name, &at)) {
-						if (!linguistics_compare(at.u.str, map_search->search.u.str, mode) && !duplicate(map_search, it, attr_street_name)) {
+						if (binmap_search_match(map_search, at.u.str, mode) && !duplicate(map_search, it, attr_street_name)) {
 							return it;
 						}
 					}
@@ -2341,7 +3261,7 @@ binmap_search_get_item(struct map_search_priv *map_search)
 						if(!d)
 							break;
 
-						if(linguistics_compare(at.u.str, map_search->search.u.str, mode|linguistics_cmp_expand|linguistics_cmp_words)) {
+						if(!binmap_search_match(map_search, at.u.str, mode|linguistics_cmp_expand|linguistics_cmp_words)) {
 							/* Remember this non-matching street name in duplicate hash to skip name
 							 * comparison for its following segments */
 							duplicate_insert(map_search, d);
@@ -2450,6 +3370,9 @@ binmap_search_destroy(struct map_search_priv *ms)
 {
 	if (ms->search_results)
 		g_hash_table_destroy(ms->search_results);
+	g_free(ms->postings);
+	if (ms->fuzzy)
+		linguistics_fuzzy_destroy(ms->fuzzy);
 	if(ATTR_IS_STRING(ms->search.type))
 		g_free(ms->search.u.str);
 	if(ms->parent_name)
@@ -2468,6 +3391,7 @@ binmap_search_destroy(struct map_search_priv *ms)
 static int
 binmap_get_attr(struct map_priv *m, enum attr_type type, struct attr *attr)
 {
+	map_binfile_wait(m);
 	attr->type=type;
 	switch (type) {
 	case attr_map_release:
@@ -2514,6 +3438,8 @@ static struct map_methods map_methods_binfile = {
 	NULL,
 	binmap_get_attr,
 	binmap_set_attr,
+	binfile_prefetch,
+	map_search_fuzzy,
 };
 
 static int
@@ -2682,24 +3608,23 @@ map_binfile_download_initial(struct map_priv *m)
 }
 #endif
 
+/**
+ * @brief Checks the format of an opened map file and reads its directory
+ *
+ * This is the expensive part of opening a map. It only uses the map itself and the
+ * file layer, so it may run on a background thread, see map_binfile_open_async().
+ *
+ * @param m The map, with m->fi opened
+ * @return 1 on success, 0 on failure
+ */
 static int
-map_binfile_open(struct map_priv *m)
+map_binfile_setup(struct map_priv *m)
 {
 	int *magic;
 	struct map_rect_priv *mr;
 	struct item *item;
 	struct attr attr;
-	struct attr readwrite={attr_readwrite, {(void *)1}};
-	struct attr *attrs[]={&readwrite, NULL};
 
-	dbg(lvl_debug,"file_create %s\n", m->filename);
-	m->fi=file_create(m->filename, m->url?attrs:NULL);
-	if (! m->fi && m->url)
-		return 0;
-	if (! m->fi) {
-		dbg(lvl_error,"Failed to load '%s'\n", m->filename);
-		return 0;
-	}
 	if (m->check_version)
 		m->version=file_version(m->fi, m->check_version);
 	magic=(int *)file_data_read(m->fi, 0, 4);
@@ -2726,7 +3651,7 @@ map_binfile_open(struct map_priv *m)
 	file_data_free(m->fi, (unsigned char *)magic);
 	m->cachedir=g_strdup("/tmp/navit");
 	m->map_version=0;
-	mr=map_rect_new_binfile(m, NULL);
+	mr=map_rect_new_binfile_nowait(m, NULL);
 	if (mr) {
 		while ((item=map_rect_get_item_binfile(mr)) == &busy_item);
 		if (item && item->type == type_map_information)  {
@@ -2752,10 +3677,32 @@ map_binfile_open(struct map_priv *m)
 	return 1;
 }
 
+static int
+map_binfile_open(struct map_priv *m)
+{
+	struct attr readwrite={attr_readwrite, {(void *)1}};
+	struct attr *attrs[]={&readwrite, NULL};
+
+	dbg(lvl_debug,"file_create %s\n", m->filename);
+	m->fi=file_create(m->filename, m->url?attrs:NULL);
+	if (! m->fi && m->url)
+		return 0;
+	if (! m->fi) {
+		dbg(lvl_error,"Failed to load '%s'\n", m->filename);
+		return 0;
+	}
+	return map_binfile_setup(m);
+}
+
 static void
 map_binfile_close(struct map_priv *m)
 {
 	int i;
+	binfile_nameindex_free(m);
+	g_free(m->prefetch_tiles);
+	m->prefetch_tiles=NULL;
+	m->prefetch_tile_count=0;
+	m->prefetch_checked=0;
 	file_data_free(m->fi, (unsigned char *)m->index_cd);
 	file_data_free(m->fi, (unsigned char *)m->eoc);
 	file_data_free(m->fi, (unsigned char *)m->eoc64);
@@ -2779,6 +3726,89 @@ map_binfile_destroy(struct map_priv *m)
 }
 
 
+#ifdef HAVE_PTHREAD
+static void *
+map_binfile_setup_thread(void *data)
+{
+	struct map_priv *m=data;
+	double start=trace_enabled ? benchmark_time() : 0;
+
+	m->open_result=map_binfile_setup(m);
+	if (m->open_result) {
+		load_changes(m);
+		if (binfile_prefetch_possible(m))
+			binfile_prefetch_index(m);
+	}
+	trace_span("binfile open", m->filename, start);
+	return NULL;
+}
+#endif
+
+/**
+ * @brief Opens a map, reading its directory on a background thread
+ *
+ * Maps are created one after the other while the config is parsed. Reading the
+ * directory and index of each on its own thread lets the maps of a mapset open in
+ * parallel, while the rest of the config is processed. Every map method waits for
+ * the thread with map_binfile_wait() before it uses the map.
+ *
+ * Whether the file exists is still checked here, so a missing map is dropped as
+ * before. A map whose directory turns out to be invalid stays empty instead.
+ *
+ * @param m The map
+ * @return 1 if the file could be opened, 0 otherwise
+ */
+static int
+map_binfile_open_async(struct map_priv *m)
+{
+	dbg(lvl_debug,"file_create %s\n", m->filename);
+	m->fi=file_create(m->filename, NULL);
+	if (! m->fi) {
+		dbg(lvl_error,"Failed to load '%s'\n", m->filename);
+		return 0;
+	}
+#ifdef HAVE_PTHREAD
+	if (!pthread_create(&m->open_thread, NULL, map_binfile_setup_thread, m)) {
+		m->opening=1;
+		return 1;
+	}
+#endif
+	if (!map_binfile_setup(m))
+		return 0;
+	load_changes(m);
+	return 1;
+}
+
+/**
+ * @brief Waits until the directory of a map opened by map_binfile_open_async() has been read
+ *
+ * @param m The map
+ */
+static void
+map_binfile_wait(struct map_priv *m)
+{
+#ifdef HAVE_PTHREAD
+	double start;
+
+	if (!m->opening)
+		return;
+	start=trace_enabled ? benchmark_time() : 0;
+	pthread_join(m->open_thread, NULL);
+	m->opening=0;
+	trace_span("binfile wait", m->filename, start);
+	if (!m->open_result && m->fi) {
+		map_binfile_close(m);
+		m->fi=NULL;
+		m->fis=NULL;
+		m->eoc=NULL;
+		m->eoc64=NULL;
+		m->index_cd=NULL;
+		m->cachedir=NULL;
+		m->map_release=NULL;
+	}
+#endif
+}
+
 static void
 binfile_check_version(struct map_priv *m)
 {
@@ -2832,11 +3862,14 @@ map_new_binfile(struct map_methods *meth, struct attr **attrs, struct callback_l
 	if (download_enabled)
 		m->download_enabled=download_enabled->u.num;
 
-	if (!map_binfile_open(m) && !m->check_version && !m->url) {
+	if (!m->url)
+		binfile_apply_delta(m);
+	if (m->url || m->check_version) {
+		map_binfile_open(m);
+		load_changes(m);
+	} else if (!map_binfile_open_async(m)) {
 		map_binfile_destroy(m);
 		m=NULL;
-	} else {
-		load_changes(m);
 	}
 	return m;
 }
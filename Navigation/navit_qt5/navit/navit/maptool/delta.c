@@ -0,0 +1,233 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tile level map updates.
+ *
+ * A delta describes an updated binfile in terms of the map it replaces:
+ * the complete central directory of the updated map plus the data of all
+ * members (tiles, index and country directory) which differ from the base
+ * map. Members are considered unchanged when name, checksum, sizes and
+ * compression method match. The binfile driver applies a delta found next
+ * to a map (<map>.delta) on startup, see binfile_apply_delta(). It finds
+ * the unchanged members by name, so deltas between consecutive releases can
+ * be applied one after the other to a map which was installed earlier.
+ */
+
+#include "navit_lfs.h"
+#include <stdlib.h>
+#include <string.h>
+#include "maptool.h"
+#include "zipfile.h"
+
+struct delta_map {
+	FILE *f;
+	long long size;
+	long long cd_offset;
+	long long cd_size;
+	int zip64;
+	unsigned char *cd;
+};
+
+static void
+delta_map_close(struct delta_map *map)
+{
+	g_free(map->cd);
+	if (map->f)
+		fclose(map->f);
+}
+
+static int
+delta_map_open(struct delta_map *map, char *filename)
+{
+	struct zip_eoc eoc;
+	struct zip64_eocl eocl;
+	struct zip64_eoc eoc64;
+
+	map->f=fopen(filename,"rb");
+	if (!map->f) {
+		fprintf(stderr,"delta: unable to open %s\n",filename);
+		return 0;
+	}
+	fseeko(map->f, 0, SEEK_END);
+	map->size=ftello(map->f);
+	if (map->size < sizeof(eoc) || fseeko(map->f, map->size-sizeof(eoc), SEEK_SET) ||
+	    fread(&eoc, sizeof(eoc), 1, map->f) != 1 || eoc.zipesig != zip_eoc_sig) {
+		fprintf(stderr,"delta: %s is not a binfile\n",filename);
+		return 0;
+	}
+	map->cd_offset=eoc.zipeofst;
+	map->cd_size=eoc.zipecsz;
+	if (map->size >= sizeof(eoc)+sizeof(eocl) && !fseeko(map->f, map->size-sizeof(eoc)-sizeof(eocl), SEEK_SET) &&
+	    fread(&eocl, sizeof(eocl), 1, map->f) == 1 && eocl.zip64lsig == zip64_eocl_sig) {
+		if (fseeko(map->f, eocl.zip64lofst, SEEK_SET) || fread(&eoc64, sizeof(eoc64), 1, map->f) != 1 ||
+		    eoc64.zip64esig != zip64_eoc_sig) {
+			fprintf(stderr,"delta: %s has a broken zip64 end of central directory\n",filename);
+			return 0;
+		}
+		map->cd_offset=eoc64.zip64eofst;
+		map->cd_size=eoc64.zip64ecsz;
+		map->zip64=1;
+	}
+	map->cd=g_malloc(map->cd_size);
+	if (fseeko(map->f, map->cd_offset, SEEK_SET) || fread(map->cd, map->cd_size, 1, map->f) != 1) {
+		fprintf(stderr,"delta: unable to read central directory of %s\n",filename);
+		return 0;
+	}
+	return 1;
+}
+
+static int
+delta_cd_len(struct zip_cd *cd)
+{
+	return sizeof(*cd)+cd->zipcfnl+cd->zipcxtl+cd->zipccml;
+}
+
+static long long
+delta_cd_offset(struct zip_cd *cd)
+{
+	struct zip_cd_ext *ext=(struct zip_cd_ext *)((unsigned char *)cd+sizeof(*cd)+cd->zipcfnl);
+	if (cd->zipofst == zip_size_64bit_placeholder && cd->zipcxtl >= sizeof(*ext) && ext->tag == zip_extra_header_id_zip64)
+		return ext->zipofst;
+	return cd->zipofst;
+}
+
+static long long
+delta_local_len(struct delta_map *map, struct zip_cd *cd)
+{
+	struct zip_lfh lfh;
+	if (fseeko(map->f, delta_cd_offset(cd), SEEK_SET) || fread(&lfh, sizeof(lfh), 1, map->f) != 1 || lfh.ziplocsig != zip_lfh_sig)
+		return -1;
+	return sizeof(lfh)+lfh.zipfnln+lfh.zipxtraln+(long long)lfh.zipsize;
+}
+
+static int
+delta_member_unchanged(struct zip_cd *old, struct zip_cd *new)
+{
+	return old->zipccrc == new->zipccrc && old->zipcsiz == new->zipcsiz && old->zipcunc == new->zipcunc &&
+		old->zipcmthd == new->zipcmthd;
+}
+
+static int
+delta_copy(FILE *in, long long offset, long long len, FILE *out)
+{
+	char buffer[4096];
+	if (fseeko(in, offset, SEEK_SET))
+		return 0;
+	while (len > 0) {
+		int size=len > sizeof(buffer) ? sizeof(buffer) : len;
+		if (fread(buffer, size, 1, in) != 1 || fwrite(buffer, size, 1, out) != 1)
+			return 0;
+		len-=size;
+	}
+	return 1;
+}
+
+/**
+ * @brief Writes a tile level update from one map to another.
+ *
+ * @param oldmap The map which is installed on the target
+ * @param newmap The freshly built map
+ * @param out Name of the delta file to write
+ * @return 1 on success, 0 on error
+ */
+int
+delta_write(char *oldmap, char *newmap, char *out)
+{
+	struct delta_map old,new;
+	struct binfile_delta_header header;
+	struct binfile_delta_entry entry;
+	GHashTable *old_members=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	FILE *f=NULL;
+	long long pos,payload_size=0,len;
+	int ret=0,members=0,changed=0,pass;
+
+	memset(&old, 0, sizeof(old));
+	memset(&new, 0, sizeof(new));
+	if (!delta_map_open(&old, oldmap) || !delta_map_open(&new, newmap))
+		goto out;
+	for (pos = 0 ; pos < old.cd_size ; pos+=delta_cd_len((struct zip_cd *)(old.cd+pos))) {
+		struct zip_cd *cd=(struct zip_cd *)(old.cd+pos);
+		g_hash_table_insert(old_members, g_strndup(cd->zipcfn, cd->zipcfnl), cd);
+	}
+	f=fopen(out,"wb");
+	if (!f) {
+		fprintf(stderr,"delta: unable to create %s\n",out);
+		goto out;
+	}
+	memset(&header, 0, sizeof(header));
+	fwrite(&header, sizeof(header), 1, f);
+	/* Pass 0 writes the directory, pass 1 appends the data of all changed members */
+	for (pass = 0 ; pass < 2 ; pass++) {
+		for (pos = 0 ; pos < new.cd_size ; pos+=delta_cd_len((struct zip_cd *)(new.cd+pos))) {
+			struct zip_cd *cd=(struct zip_cd *)(new.cd+pos);
+			char *name=g_strndup(cd->zipcfn, cd->zipcfnl);
+			struct zip_cd *old_cd=g_hash_table_lookup(old_members, name);
+			g_free(name);
+			if (old_cd && delta_member_unchanged(old_cd, cd)) {
+				if (pass == 0) {
+					entry.source=binfile_delta_source_base;
+					entry.offset=0;
+					fwrite(&entry, sizeof(entry), 1, f);
+					fwrite(cd, delta_cd_len(cd), 1, f);
+					members++;
+				}
+				continue;
+			}
+			len=delta_local_len(&new, cd);
+			if (len < 0) {
+				fprintf(stderr,"delta: broken local file header in %s\n",newmap);
+				goto out;
+			}
+			if (pass == 0) {
+				entry.source=binfile_delta_source_delta;
+				entry.offset=payload_size;
+				fwrite(&entry, sizeof(entry), 1, f);
+				fwrite(cd, delta_cd_len(cd), 1, f);
+				payload_size+=len;
+				members++;
+				changed++;
+			} else if (!delta_copy(new.f, delta_cd_offset(cd), len, f)) {
+				fprintf(stderr,"delta: unable to copy member data from %s\n",newmap);
+				goto out;
+			}
+		}
+	}
+	memcpy(header.magic, binfile_delta_magic, sizeof(header.magic));
+	header.version=binfile_delta_version;
+	header.flags=new.zip64 ? binfile_delta_flag_zip64 : 0;
+	header.base_size=0;
+	header.members=members;
+	header.cd_size=new.cd_size;
+	header.payload_size=payload_size;
+	fseeko(f, 0, SEEK_SET);
+	if (fwrite(&header, sizeof(header), 1, f) != 1) {
+		fprintf(stderr,"delta: unable to write %s\n",out);
+		goto out;
+	}
+	fprintf(stderr,"delta: %d of %d members changed, "LONGLONG_FMT" of "LONGLONG_FMT" bytes\n",changed,members,payload_size,new.size);
+	ret=1;
+out:
+	if (f && fclose(f))
+		ret=0;
+	g_hash_table_destroy(old_members);
+	delta_map_close(&old);
+	delta_map_close(&new);
+	return ret;
+}
@@ -60,6 +60,8 @@ char ch_suffix[] ="r"; /* Used to make compiler happy due to Bug 35903 in gcc */
 char* experimental_feature_description = "Move coastline data to order 6 tiles. Makes map look more smooth, but may affect drawing/searching performance."; /* add description here */
 /** Indicates if experimental features (if available) were enabled. */
 int experimental;
+/** Number of simplified copies stored for large ways and polygons, see tile_write_item_simplified(). */
+int simplify_levels;
 
 struct buffer node_buffer = {
 	64*1024*1024,
@@ -196,6 +198,7 @@ usage(FILE *f)
 		experimental_feature_description ? experimental_feature_description : "-not available in this version-");
 	fprintf(f,"-i (--input-file) <file>          : specify the input file name (OSM), overrules default stdin\n");
 	fprintf(f,"-k (--keep-tmpfiles)              : do not delete tmp files after processing. useful to reuse them\n");
+	fprintf(f,"-L (--simplify-levels) <levels>   : store up to <levels> copies of large ways and polygons simplified for low orders\n");
 	fprintf(f,"-M (--o5m)                        : input file os o5m\n");
 	fprintf(f,"-N (--nodes-only)                 : process only nodes\n");
 	fprintf(f,"-o (--coverage)                   : map every street to item coverage\n");
@@ -208,6 +211,7 @@ usage(FILE *f)
 	fprintf(f,"-W (--ways-only)                  : process only ways\n");
 	fprintf(f,"-U (--unknown-country)            : add objects with unknown country to index\n");
 	fprintf(f,"-x (--index-size)                 : set maximum country index size in bytes\n");
+	fprintf(f,"-Y (--delta) <oldmap>             : write <map>.delta with the tiles of <map> which differ from <oldmap>, no input is read\n");
 	fprintf(f,"-z (--compression-level) <level>  : set the compression level\n");
 	fprintf(f,"Internal options (undocumented):\n");                                                                      
 	fprintf(f,"-b (--binfile)\n");                                                                                        
@@ -227,6 +231,7 @@ struct maptool_params {
 	int process_relations;
 	char *protobufdb;
 	char *protobufdb_operation;
+	char *delta_base;
 	char *md5file;
 	int start;
 	int end;
@@ -275,6 +280,7 @@ parse_option(struct maptool_params *p, char **argv, int argc, int *option_index)
 		{"experimental", 0, 0, 'E'},
 		{"help", 0, 0, 'h'},
 		{"keep-tmpfiles", 0, 0, 'k'},
+		{"simplify-levels", 1, 0, 'L'},
 		{"nodes-only", 0, 0, 'N'},
 		{"map", 1, 0, 'm'},
 		{"o5m", 0, 0, 'M'},
@@ -290,13 +296,14 @@ parse_option(struct maptool_params *p, char **argv, int argc, int *option_index)
 		{"slice-size", 1, 0, 'S'},
 		{"unknown-country", 0, 0, 'U'},
 		{"index-size", 0, 0, 'x'},
+		{"delta", 1, 0, 'Y'},
 		{0, 0, 0, 0}
 	};
-	c = getopt_long (argc, argv, "5:6B:DEMNO:PS:Wa:bc"
+	c = getopt_long (argc, argv, "5:6B:DEL:MNO:PS:Wa:bc"
 #ifdef HAVE_POSTGRESQL
 				      "d:"
 #endif
-				      "e:hi:knm:p:r:s:t:wu:z:Ux:", long_options, option_index);
+				      "e:hi:knm:p:r:s:t:wu:z:Ux:Y:", long_options, option_index);
 	if (c == -1)
 		return 1;
 	switch (c) {
@@ -315,6 +322,9 @@ parse_option(struct maptool_params *p, char **argv, int argc, int *option_index)
 	case 'E':
 		experimental=1;
 		break;
+	case 'L':
+		simplify_levels=atoi(optarg);
+		break;
 	case 'M':
 		p->o5m=1;
 		break;	
@@ -340,6 +350,9 @@ parse_option(struct maptool_params *p, char **argv, int argc, int *option_index)
 	case 'U':
 		unknown_country=1;
 		break;
+	case 'Y':
+		p->delta_base=optarg;
+		break;
 	case 'a':
 		attr_debug_level=atoi(optarg);
 		break;
@@ -755,9 +768,13 @@ maptool_assemble_map(struct maptool_params *p, char *suffix, char **filenames, c
 	}
 	if (last) {
 		unsigned char md5_data[16];
+		char *nameindex=tempfile_name("","nameindex");
+		int nameindex_size;
 		zipnum=zip_get_zipnum(zip_info);
 		add_aux_tiles("auxtiles.txt", zip_info);
 		write_countrydir(zip_info,p->max_index_size);
+		if ((nameindex_size=nameindex_write(nameindex)))
+			add_aux_tile(zip_info, binfile_nameindex_member, nameindex, nameindex_size);
 		zip_set_zipnum(zip_info, zipnum);
 		write_aux_tiles(zip_info);
 		zip_write_index(zip_info);
@@ -775,7 +792,9 @@ maptool_assemble_map(struct maptool_params *p, char *suffix, char **filenames, c
 			remove_countryfiles();
 			tempfile_unlink("index","");
 			tempfile_unlink("zipdir","");
+			tempfile_unlink("","nameindex");
 		}
+		g_free(nameindex);
 	}
 }
 
@@ -880,6 +899,12 @@ int main(int argc, char **argv)
 		return 0;
 #endif
 	}
+	if (p.delta_base) {
+		char *delta=g_strdup_printf("%s.delta",p.result);
+		int ret=delta_write(p.delta_base, p.result, delta);
+		g_free(delta);
+		return ret ? 0 : 1;
+	}
 	phase=0;
 
 	// input from an OSM file
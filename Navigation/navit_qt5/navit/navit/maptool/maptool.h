@@ -192,6 +192,10 @@ void ch_assemble_map(char *map_suffix, char *suffix, struct zip_info *zip_info);
 
 void process_coastlines(FILE *in, FILE *out);
 
+/* delta.c */
+
+int delta_write(char *oldmap, char *newmap, char *out);
+
 /* itembin.c */
 
 int item_bin_read(struct item_bin *ib, FILE *in);
@@ -248,6 +252,7 @@ extern int bytes_read;
 extern int overlap;
 extern int unknown_country;
 extern int experimental;
+extern int simplify_levels;
 void sig_alrm(int sig);
 void sig_alrm_end(void);
 
@@ -271,6 +276,11 @@ void cat(FILE *in, FILE *out);
 int item_order_by_type(enum item_type type);
 
 
+/* nameindex.c */
+
+void nameindex_add_item(struct item_bin *ib, int country, int zipfile, int offset);
+int nameindex_write(char *filename);
+
 /* osm.c */
 struct maptool_osm {
 	FILE *boundaries;
@@ -390,6 +400,8 @@ int tile_len(char *tile);
 void load_tilesdir(FILE *in);
 void tile_write_item_to_tile(struct tile_info *info, struct item_bin *ib, FILE *reference, char *name);
 void tile_write_item_minmax(struct tile_info *info, struct item_bin *ib, FILE *reference, int min, int max);
+void tile_write_item_simplified(struct tile_info *info, struct item_bin *ib, FILE *reference, int max);
+int item_bin_is_original(struct item_bin *ib);
 int add_aux_tile(struct zip_info *zip_info, char *name, char *filename, int size);
 int write_aux_tiles(struct zip_info *zip_info);
 int create_tile_hash(void);
@@ -244,7 +244,7 @@ phase34_process_file(struct tile_info *info, FILE *in, FILE *reference)
 			if(max>max2)
 				max=max2;
 		}
-		tile_write_item_minmax(info, ib, reference, 0, max);
+		tile_write_item_simplified(info, ib, reference, max);
 	}
 }
 
@@ -0,0 +1,375 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Name search index.
+ *
+ * While the tiles and the country index parts are written, every town and
+ * street name is recorded together with the location of its item. Only the
+ * names are kept in memory, the postings go to a temporary file. At the end
+ * the names are casefolded, expanded (see linguistics_expand_special()) and
+ * written as a sorted key table with postings, plus trigram postings for
+ * matches starting in the middle of a name. The binfile driver uses this
+ * member for town and street search if present.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "maptool.h"
+#include "linguistics.h"
+#include "zipfile.h"
+
+/* Postings placed per pass over the temporary file, bounds the memory of nameindex_write() */
+#define NAMEINDEX_WINDOW (4*1024*1024)
+
+struct nameindex_list {
+	void *data;
+	int count;
+	int size;
+};
+
+struct nameindex_key {
+	int type;
+	int country;
+	char *name;
+	int name_offset;
+	int number;			/* position in nameindex_keys */
+	int count;			/* of postings */
+	int first;			/* number of the first posting in the index */
+	int placed;			/* postings seen in the current pass of nameindex_write() */
+	struct binfile_nameindex_posting last;
+};
+
+/* A posting as recorded in the temporary file, key is the position in nameindex_keys */
+struct nameindex_record {
+	int key;
+	struct binfile_nameindex_posting posting;
+};
+
+static GHashTable *nameindex_hash;
+static struct nameindex_list nameindex_keys;
+static FILE *nameindex_postings;
+
+static void *
+nameindex_list_append(struct nameindex_list *list, int elsize)
+{
+	if (list->count == list->size) {
+		list->size=list->size ? list->size*2 : 4;
+		list->data=g_realloc(list->data, list->size*elsize);
+	}
+	return (char *)list->data+elsize*list->count++;
+}
+
+static void
+nameindex_add(int type, int country, char *name, struct binfile_nameindex_posting *posting)
+{
+	struct nameindex_key *key;
+	struct nameindex_record record;
+	char *hashkey;
+
+	if (!nameindex_hash) {
+		nameindex_hash=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		nameindex_postings=tempfile("postings","nameindex",1);
+		if (!nameindex_postings)
+			fprintf(stderr,"nameindex: unable to create the temporary file of postings\n");
+	}
+	if (!nameindex_postings)
+		return;
+	hashkey=g_strdup_printf("%d:%d:%s", type, country, name);
+	key=g_hash_table_lookup(nameindex_hash, hashkey);
+	if (!key) {
+		key=g_new0(struct nameindex_key, 1);
+		key->type=type;
+		key->country=country;
+		key->name=g_strdup(name);
+		key->number=nameindex_keys.count;
+		*(struct nameindex_key **)nameindex_list_append(&nameindex_keys, sizeof(key))=key;
+		g_hash_table_insert(nameindex_hash, hashkey, key);
+	} else {
+		g_free(hashkey);
+		/* expanded names of one item often fold to the same key */
+		if (key->count && key->last.zipfile == posting->zipfile && key->last.offset == posting->offset)
+			return;
+	}
+	key->last=*posting;
+	key->count++;
+	record.key=key->number;
+	record.posting=*posting;
+	fwrite(&record, sizeof(record), 1, nameindex_postings);
+}
+
+static void
+nameindex_add_name(int type, int country, char *name, struct binfile_nameindex_posting *posting)
+{
+	char *folded=linguistics_casefold(name);
+	int i;
+
+	nameindex_add(type, country, folded, posting);
+	for (i = 1 ; i < 3 ; i++) {
+		char *str=linguistics_expand_special(folded, i);
+		if (str) {
+			if (strcmp(str, folded))
+				nameindex_add(type, country, str, posting);
+			g_free(str);
+		}
+	}
+	g_free(folded);
+}
+
+/**
+ * @brief Records the names of an item for the name search index.
+ *
+ * Towns and districts are recorded under attr_town_name for their country,
+ * as they are written to the country index parts. Streets are recorded under
+ * attr_street_name and country 0, as they are written to the tiles, which do
+ * not belong to a country. Other items are ignored.
+ *
+ * @param ib The item as it is written to the map
+ * @param country Country id of towns, ignored for streets
+ * @param zipfile Number of the zip member the item is written to
+ * @param offset Offset of the item within the member, in 32 bit words
+ */
+void
+nameindex_add_item(struct item_bin *ib, int country, int zipfile, int offset)
+{
+	static const enum attr_type town_attrs[]={attr_town_name_match, attr_town_name, attr_district_name_match, attr_district_name};
+	struct binfile_nameindex_posting posting;
+	struct rect r;
+	char *name;
+	int i;
+
+	if (!item_is_town(*ib) && !item_is_street(*ib))
+		return;
+	if (!ib->clen)
+		return;
+	if (!item_bin_is_original(ib))
+		return;
+	bbox((struct coord *)(ib+1), ib->clen/2, &r);
+	posting.zipfile=zipfile;
+	posting.offset=offset;
+	posting.minx=r.l.x;
+	posting.miny=r.l.y;
+	posting.maxx=r.h.x;
+	posting.maxy=r.h.y;
+	if (item_is_street(*ib)) {
+		if ((name=item_bin_get_attr(ib, attr_label, NULL)))
+			nameindex_add_name(attr_street_name, 0, name, &posting);
+		return;
+	}
+	for (i = 0 ; i < sizeof(town_attrs)/sizeof(town_attrs[0]) ; i++) {
+		if ((name=item_bin_get_attr(ib, town_attrs[i], NULL)))
+			nameindex_add_name(attr_town_name, country, name, &posting);
+	}
+}
+
+static int
+nameindex_key_compare(const void *a, const void *b)
+{
+	const struct nameindex_key *ka=*(struct nameindex_key **)a;
+	const struct nameindex_key *kb=*(struct nameindex_key **)b;
+	if (ka->type != kb->type)
+		return ka->type < kb->type ? -1:1;
+	if (ka->country != kb->country)
+		return ka->country < kb->country ? -1:1;
+	return strcmp(ka->name, kb->name);
+}
+
+static int
+nameindex_trigram_compare(const void *a, const void *b)
+{
+	return memcmp(*(char **)a, *(char **)b, 4);
+}
+
+static void
+nameindex_free_list(gpointer data)
+{
+	struct nameindex_list *list=data;
+	g_free(list->data);
+	g_free(list);
+}
+
+static void
+nameindex_free(void)
+{
+	struct nameindex_key **keys=nameindex_keys.data;
+	int i;
+
+	for (i = 0 ; i < nameindex_keys.count ; i++) {
+		g_free(keys[i]->name);
+		g_free(keys[i]);
+	}
+	g_free(nameindex_keys.data);
+	memset(&nameindex_keys, 0, sizeof(nameindex_keys));
+	if (nameindex_hash) {
+		g_hash_table_destroy(nameindex_hash);
+		nameindex_hash=NULL;
+	}
+	if (nameindex_postings) {
+		fclose(nameindex_postings);
+		nameindex_postings=NULL;
+		tempfile_unlink("postings","nameindex");
+	}
+}
+
+/**
+ * @brief Writes the name search index collected with nameindex_add_item().
+ *
+ * @param filename File to write the index to
+ * @return Size of the written index, 0 if there are no names or on error
+ */
+int
+nameindex_write(char *filename)
+{
+	struct binfile_nameindex_header header;
+	struct nameindex_key **keys,**numbered=nameindex_keys.data;
+	struct nameindex_record record;
+	struct binfile_nameindex_posting *window;
+	char **trigrams;
+	GHashTable *strings,*trigram_hash;
+	GHashTableIter iter;
+	gpointer value;
+	FILE *f;
+	int i,j,key_count=nameindex_keys.count,trigram_count,pool_size=0,posting=0,ref=0,size=0,start;
+
+	if (!key_count) {
+		nameindex_free();
+		return 0;
+	}
+	keys=g_new(struct nameindex_key *, key_count);
+	memcpy(keys, numbered, key_count*sizeof(*keys));
+	qsort(keys, key_count, sizeof(*keys), nameindex_key_compare);
+
+	/* Names occurring in several keys (e.g. towns of the same name in different countries) are stored once */
+	strings=g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0 ; i < key_count ; i++) {
+		if (g_hash_table_lookup_extended(strings, keys[i]->name, NULL, &value)) {
+			keys[i]->name_offset=GPOINTER_TO_INT(value);
+		} else {
+			keys[i]->name_offset=pool_size;
+			g_hash_table_insert(strings, keys[i]->name, GINT_TO_POINTER(pool_size));
+			pool_size+=strlen(keys[i]->name)+1;
+		}
+	}
+	g_hash_table_destroy(strings);
+
+	/* Trigram postings refer to key numbers, which are ascending because keys are visited in order */
+	trigram_hash=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, nameindex_free_list);
+	for (i = 0 ; i < key_count ; i++) {
+		int len=strlen(keys[i]->name);
+		for (j = 0 ; j+3 <= len ; j++) {
+			char trigram[4];
+			struct nameindex_list *list;
+			memcpy(trigram, keys[i]->name+j, 3);
+			trigram[3]='\0';
+			list=g_hash_table_lookup(trigram_hash, trigram);
+			if (!list) {
+				list=g_new0(struct nameindex_list, 1);
+				g_hash_table_insert(trigram_hash, g_strdup(trigram), list);
+			}
+			if (!list->count || ((int *)list->data)[list->count-1] != i)
+				*(int *)nameindex_list_append(list, sizeof(int))=i;
+		}
+	}
+	trigram_count=g_hash_table_size(trigram_hash);
+	trigrams=g_new(char *, trigram_count);
+	i=0;
+	g_hash_table_iter_init(&iter, trigram_hash);
+	while (g_hash_table_iter_next(&iter, &value, NULL))
+		trigrams[i++]=value;
+	qsort(trigrams, trigram_count, sizeof(*trigrams), nameindex_trigram_compare);
+
+	f=fopen(filename, "wb");
+	if (!f) {
+		fprintf(stderr,"nameindex: unable to create %s\n",filename);
+		goto out;
+	}
+	memset(&header, 0, sizeof(header));
+	fwrite(&header, sizeof(header), 1, f);
+	for (i = 0 ; i < key_count ; i++) {
+		struct binfile_nameindex_key k;
+		k.type=keys[i]->type;
+		k.country=keys[i]->country;
+		k.name=keys[i]->name_offset;
+		k.posting=keys[i]->first=posting;
+		k.count=keys[i]->count;
+		fwrite(&k, sizeof(k), 1, f);
+		posting+=k.count;
+	}
+	/* The postings are grouped by key window by window, reading the temporary file once per window */
+	window=g_new(struct binfile_nameindex_posting, MIN(posting, NAMEINDEX_WINDOW));
+	for (start = 0 ; start < posting ; start+=NAMEINDEX_WINDOW) {
+		int count=MIN(posting-start, NAMEINDEX_WINDOW);
+		for (i = 0 ; i < key_count ; i++)
+			keys[i]->placed=0;
+		rewind(nameindex_postings);
+		while (fread(&record, sizeof(record), 1, nameindex_postings) == 1) {
+			struct nameindex_key *key=numbered[record.key];
+			int pos=key->first+key->placed++-start;
+			if (pos >= 0 && pos < count)
+				window[pos]=record.posting;
+		}
+		fwrite(window, sizeof(*window), count, f);
+	}
+	g_free(window);
+	for (i = 0 ; i < trigram_count ; i++) {
+		struct nameindex_list *list=g_hash_table_lookup(trigram_hash, trigrams[i]);
+		struct binfile_nameindex_trigram t;
+		memcpy(t.trigram, trigrams[i], sizeof(t.trigram));
+		t.ref=ref;
+		t.count=list->count;
+		fwrite(&t, sizeof(t), 1, f);
+		ref+=t.count;
+	}
+	for (i = 0 ; i < trigram_count ; i++) {
+		struct nameindex_list *list=g_hash_table_lookup(trigram_hash, trigrams[i]);
+		fwrite(list->data, sizeof(int), list->count, f);
+	}
+	/* The pool is written in the order the offsets were assigned */
+	j=0;
+	for (i = 0 ; i < key_count ; i++) {
+		if (keys[i]->name_offset == j) {
+			fwrite(keys[i]->name, strlen(keys[i]->name)+1, 1, f);
+			j+=strlen(keys[i]->name)+1;
+		}
+	}
+	while (ftell(f) % 4)
+		fputc(0, f);
+	memcpy(header.magic, binfile_nameindex_magic, sizeof(header.magic));
+	header.version=binfile_nameindex_version;
+	header.keys=key_count;
+	header.postings=posting;
+	header.trigrams=trigram_count;
+	header.trigram_refs=ref;
+	header.strings_size=pool_size;
+	fseek(f, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, f);
+	fseek(f, 0, SEEK_END);
+	size=ftell(f);
+	if (fclose(f)) {
+		fprintf(stderr,"nameindex: unable to write %s\n",filename);
+		size=0;
+	}
+	fprintf(stderr,"nameindex: %d names, %d references, %d trigrams, %d bytes\n", key_count, posting, trigram_count, size);
+out:
+	g_free(trigrams);
+	g_hash_table_destroy(trigram_hash);
+	g_free(keys);
+	nameindex_free();
+	return size;
+}
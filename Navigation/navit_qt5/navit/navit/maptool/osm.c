@@ -3244,6 +3244,8 @@ write_countrydir(struct zip_info *zip_info, int max_index_size)
 					partsize=0;
 				}
 
+				/* The part becomes the next zip member once it is complete */
+				nameindex_add_item(ib,co->countryid,zip_get_zipnum(zip_info),partsize/4);
 				item_bin_write(ib,out);
 				partsize+=ibsize;
 				g_strlcpy(last_key,key,sizeof(last_key));
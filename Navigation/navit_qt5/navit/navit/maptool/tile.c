@@ -38,6 +38,7 @@
 #include "file.h"
 #include "item.h"
 #include "map.h"
+#include "transform.h"
 #include "zipfile.h"
 #include "main.h"
 #include "config.h"
@@ -339,8 +340,12 @@ write_item(char *tile, struct item_bin *ib, FILE *reference)
 			fwrite(&th->zipnum, sizeof(th->zipnum), 1, reference);
 			fwrite(&offset, sizeof(th->total_size_used), 1, reference);
 		}
-		if (th->zip_data)
+		if (th->zip_data) {
 			memcpy(th->zip_data+th->total_size_used, ib, size);
+			/* towns are recorded from the country index parts, under their country */
+			if (th->name[0] && item_is_street(*ib))
+				nameindex_add_item(ib, 0, th->zipnum, th->total_size_used/4);
+		}
 		th->total_size_used+=size;
 	} else {
 		fprintf(stderr,"no tile hash found for %s\n", tile);
@@ -368,6 +373,102 @@ tile_write_item_minmax(struct tile_info *info, struct item_bin *ib, FILE *refere
 	tile_write_item_to_tile(info, ib, reference, buffer);
 }
 
+/* Ways and polygons with fewer coordinates are not worth simplifying */
+#define SIMPLIFY_MIN_COORDS 32
+
+static struct item_bin *
+item_bin_new_simplified(struct item_bin *ib, struct coord *c, int count, int min_order, int max_order)
+{
+	int *attrs=(int *)(ib+1)+ib->clen;
+	int attrs_len=ib->len-2-ib->clen;
+	/* Room for the header and the up to 8 bytes of the added int attribute */
+	struct item_bin *ret=g_malloc((ib->len+1)*4+sizeof(struct attr_bin)+8);
+
+	item_bin_init(ret, ib->type);
+	item_bin_add_coord(ret, c, count);
+	item_bin_add_attr_int(ret, attr_simplified_orders, min_order | (max_order << 16));
+	memcpy((int *)ret+ret->len+1, attrs, attrs_len*4);
+	ret->len+=attrs_len;
+	return ret;
+}
+
+/**
+ * @brief Checks whether an item is a simplified copy written by tile_write_item_simplified()
+ *
+ * @param ib The item
+ * @return 0 for a simplified copy, 1 for the original item
+ */
+int
+item_bin_is_original(struct item_bin *ib)
+{
+	int *orders=item_bin_get_attr(ib, attr_simplified_orders, NULL);
+	return !orders || (*orders >> 16) == 255;
+}
+
+/**
+ * @brief Writes an item to its tile, together with copies simplified for low orders
+ *
+ * With -L, ways and polygons with many coordinates are stored up to simplify_levels
+ * more times in their tile, simplified with Douglas-Peucker. Starting at the lowest
+ * order the tile is meant for, each copy covers two orders and may be off by a pixel at
+ * the higher one. The original is used at the orders above the last copy. Copies only
+ * follow while they save at least a quarter of the coordinates.
+ *
+ * All versions carry the orders they are meant for in attr_simplified_orders as their
+ * first attribute, from which binfile picks the one to draw without decoding the others.
+ * Only the original is written to the reference file and to the name index.
+ *
+ * @param info Tile info
+ * @param ib The item
+ * @param reference Reference file or NULL
+ * @param max Maximum tile depth of the item
+ */
+void
+tile_write_item_simplified(struct tile_info *info, struct item_bin *ib, FILE *reference, int max)
+{
+	struct coord *c=(struct coord *)(ib+1),*sc;
+	int count=ib->clen/2,min_count=ib->type >= type_area ? 4:2;
+	int depth,level,order,scount,min_order=0;
+	struct item_bin *out;
+	struct rect r;
+	char buffer[1024];
+
+	if (!simplify_levels || ib->type < type_line || count < SIMPLIFY_MIN_COORDS ||
+			item_bin_get_attr_bin(ib, attr_order, NULL)) {
+		tile_write_item_minmax(info, ib, reference, 0, max);
+		return;
+	}
+	bbox(c, count, &r);
+	buffer[0]='\0';
+	depth=tile(&r, info->suffix, buffer, max, overlap, NULL);
+	sc=g_new(struct coord, count);
+	for (level = 0 ; level < simplify_levels ; level++) {
+		double pixel;
+		order=(depth > 4 ? depth-4 : 0)+level*2+1;
+		/* At order 14 a pixel is one unit */
+		if (order >= 14)
+			break;
+		pixel=1 << (14-order);
+		scount=transform_douglas_peucker_float(c, count, pixel*pixel, sc);
+		if (scount < min_count)
+			continue;
+		if (scount*4 > count*3)
+			break;
+		out=item_bin_new_simplified(ib, sc, scount, min_order, order);
+		tile_write_item_to_tile(info, out, NULL, buffer);
+		g_free(out);
+		min_order=order+1;
+	}
+	g_free(sc);
+	if (!min_order) {
+		tile_write_item_to_tile(info, ib, reference, buffer);
+		return;
+	}
+	out=item_bin_new_simplified(ib, c, count, min_order, 255);
+	tile_write_item_to_tile(info, out, reference, buffer);
+	g_free(out);
+}
+
 int
 add_aux_tile(struct zip_info *zip_info, char *name, char *filename, int size)
 {
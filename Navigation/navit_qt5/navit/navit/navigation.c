@@ -17,6 +17,7 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,11 +42,16 @@
 #include "plugin.h"
 #include "navit_nls.h"
 #include "util.h"
+#include "benchmark.h"
 
 /* #define DEBUG */
 
 static int roundabout_extra_length=50;
 
+/* Maneuvers look back this far (see junction_limit in maneuver_required2()), so
+ * they have to be recalculated this far behind a change of the route */
+#define NAVIGATION_MANEUVER_LOOKBACK 100
+
 
 struct suffix {
 	char *fullname;
@@ -61,6 +67,18 @@ struct suffix {
 	{"strasse",NULL,2},
 };
 
+/**
+ * @brief What the last navigation_state signal told
+ */
+struct navigation_state {
+	int active;			/**< Whether there was a destination */
+	int destination_length;		/**< Distance to the destination in meters */
+	int destination_time;		/**< Time to the destination in 1/10 s */
+	enum item_type maneuver;	/**< Type of the next maneuver, one of the type_nav_* types */
+	int maneuver_length;		/**< Rounded distance to the next maneuver in meters */
+	char *street_name;		/**< Current street, NULL if it has no name */
+};
+
 struct navigation {
 	NAVIT_OBJECT
 	struct route *route;
@@ -87,8 +105,18 @@ struct navigation {
 	int curr_delay;
 	int turn_around_count;
 	int flags;
+	struct navigation_state state;
+	double state_time;
 };
 
+/*
+ * Distance and time to the destination change with every position, so the
+ * navigation_state signal only reports them every NAVIGATION_STATE_INTERVAL ms.
+ * A new maneuver or street, the start and the end of a navigation are sent
+ * right away.
+ */
+#define NAVIGATION_STATE_INTERVAL 1000
+
 int distances[]={1,2,3,4,5,10,25,50,75,100,150,200,250,300,400,500,750,-1};
 
 
@@ -656,6 +684,8 @@ navigation_itm_ways_update(struct navigation_itm *itm, struct map *graph_map)
 	coord_sel.next = NULL;
 	coord_sel.u.c_rect.lu = itm->start;
 	coord_sel.u.c_rect.rl = itm->start;
+	coord_sel.types = NULL;
+	coord_sel.simplified = 0;
 	// the selection's order is ignored
 	
 	g_rect = map_rect_new(graph_map, &coord_sel);
@@ -709,6 +739,23 @@ navigation_itm_ways_update(struct navigation_itm *itm, struct map *graph_map)
 	itm->way.next = w;
 }
 
+/**
+ * @brief Frees a navigation item which is not part of the list any more
+ *
+ * @param this_ The navigation object
+ * @param itm The item to free
+ */
+static void
+navigation_itm_destroy(struct navigation *this_, struct navigation_itm *itm)
+{
+	if (item_hash_lookup(this_->hash, &itm->way.item) == itm)
+		item_hash_remove(this_->hash, &itm->way.item);
+	map_convert_free(itm->way.name1);
+	map_convert_free(itm->way.name2);
+	navigation_itm_ways_clear(itm);
+	g_free(itm);
+}
+
 static void
 navigation_destroy_itms_cmds(struct navigation *this_, struct navigation_itm *end)
 {
@@ -720,7 +767,6 @@ navigation_destroy_itms_cmds(struct navigation *this_, struct navigation_itm *en
 	while (this_->first && this_->first != end) {
 		itm=this_->first;
 		dbg(lvl_debug,"destroying %p\n", itm);
-		item_hash_remove(this_->hash, &itm->way.item);
 		this_->first=itm->next;
 		if (this_->first)
 			this_->first->prev=NULL;
@@ -732,10 +778,7 @@ navigation_destroy_itms_cmds(struct navigation *this_, struct navigation_itm *en
 			}
 			g_free(cmd);
 		}
-		map_convert_free(itm->way.name1);
-		map_convert_free(itm->way.name2);
-		navigation_itm_ways_clear(itm);
-		g_free(itm);
+		navigation_itm_destroy(this_, itm);
 	}
 	if (! this_->first)
 		this_->last=NULL;
@@ -786,6 +829,8 @@ check_roundabout(struct navigation_itm *itm, struct map *graph_map)
 	coord_sel.next = NULL;
 	coord_sel.u.c_rect.lu = itm->start;
 	coord_sel.u.c_rect.rl = itm->start;
+	coord_sel.types = NULL;
+	coord_sel.simplified = 0;
 	// the selection's order is ignored
 	
 	g_rect = map_rect_new(graph_map, &coord_sel);
@@ -1003,6 +1048,27 @@ calculate_dest_distance(struct navigation *this_, int incr)
     dbg(lvl_error,"len %d time %d\n", len, time);
 }
 
+/**
+ * @brief Calculates distance and time to the destination for the items in front of an unchanged part of the route
+ *
+ * @param this_ The navigation whose destination / time should be calculated
+ * @param suffix The first item of the unchanged part, its values have to be valid
+ */
+static void
+calculate_dest_distance_before(struct navigation *this_, struct navigation_itm *suffix)
+{
+	int len=suffix->dest_length, time=suffix->dest_time, count=suffix->dest_count+1;
+	struct navigation_itm *itm=suffix->prev;
+	while (itm) {
+		len+=itm->length;
+		time+=itm->time;
+		itm->dest_length=len;
+		itm->dest_time=time;
+		itm->dest_count=count++;
+		itm=itm->prev;
+	}
+}
+
 /**
  * @brief Checks if two navigation items are on the same street
  *
@@ -1553,14 +1619,19 @@ command_new(struct navigation *this_, struct navigation_itm *itm, int delta)
 	return ret;
 }
 
+/**
+ * @brief Appends the commands for the items from the first one up to end
+ *
+ * @param this_ The navigation object
+ * @param end The last item to create commands for, NULL for all. If this is the last item,
+ *        the final command is created as well.
+ */
 static void
-make_maneuvers(struct navigation *this_, struct route *route)
+make_maneuvers_until(struct navigation *this_, struct navigation_itm *end)
 {
 	struct navigation_itm *itm, *last=NULL, *last_itm=NULL;
 	int delta;
 	itm=this_->first;
-	this_->cmd_last=NULL;
-	this_->cmd_first=NULL;
 	while (itm) {
 		if (last) {
 			if (maneuver_required2(this_, last_itm, itm,&delta,NULL)) {
@@ -1569,9 +1640,20 @@ make_maneuvers(struct navigation *this_, struct route *route)
 		} else
 			last=itm;
 		last_itm=itm;
+		if (itm == end)
+			break;
 		itm=itm->next;
 	}
-	command_new(this_, last_itm, 0);
+	if (last_itm == this_->last)
+		command_new(this_, last_itm, 0);
+}
+
+static void
+make_maneuvers(struct navigation *this_, struct route *route)
+{
+	this_->cmd_last=NULL;
+	this_->cmd_first=NULL;
+	make_maneuvers_until(this_, NULL);
 }
 
 static int
@@ -2009,11 +2091,163 @@ show_next_maneuvers(struct navigation *nav, struct navigation_itm *itm, struct n
 	return ret;
 }
 
+/**
+ * @brief Returns the item type the navigation map uses for a maneuver
+ *
+ * @param cmd The maneuver
+ * @return type_nav_destination, one of the type_nav_roundabout_* types for leaving a roundabout,
+ * one of type_nav_left_* and type_nav_right_* for turns, type_none if the turn is too sharp
+ */
+static enum item_type
+navigation_command_type(struct navigation_command *cmd)
+{
+	struct navigation_itm *itm=cmd->itm;
+	int delta=cmd->delta;
+
+	if (!itm->next)
+		return type_nav_destination;
+	if (itm->prev && !(itm->way.flags & AF_ROUNDABOUT) && (itm->prev->way.flags & AF_ROUNDABOUT)) {
+		enum item_type r=type_none,l=type_none;
+		switch (((180+22)-cmd->roundabout_delta)/45) {
+		case 0:
+		case 1:
+			r=type_nav_roundabout_r1;
+			l=type_nav_roundabout_l7;
+			break;
+		case 2:
+			r=type_nav_roundabout_r2;
+			l=type_nav_roundabout_l6;
+			break;
+		case 3:
+			r=type_nav_roundabout_r3;
+			l=type_nav_roundabout_l5;
+			break;
+		case 4:
+			r=type_nav_roundabout_r4;
+			l=type_nav_roundabout_l4;
+			break;
+		case 5:
+			r=type_nav_roundabout_r5;
+			l=type_nav_roundabout_l3;
+			break;
+		case 6:
+			r=type_nav_roundabout_r6;
+			l=type_nav_roundabout_l2;
+			break;
+		case 7:
+			r=type_nav_roundabout_r7;
+			l=type_nav_roundabout_l1;
+			break;
+		case 8:
+			r=type_nav_roundabout_r8;
+			l=type_nav_roundabout_l8;
+			break;
+		}
+		dbg(lvl_debug,"delta %d\n",delta);
+		return delta < 0 ? l : r;
+	}
+	if (delta < 0) {
+		delta=-delta;
+		if (delta < 45)
+			return type_nav_left_1;
+		if (delta < 105)
+			return type_nav_left_2;
+		if (delta < 165)
+			return type_nav_left_3;
+		return type_none;
+	}
+	if (delta < 45)
+		return type_nav_right_1;
+	if (delta < 105)
+		return type_nav_right_2;
+	if (delta < 165)
+		return type_nav_right_3;
+	return type_none;
+}
+
+static void
+navigation_state_send(struct navigation *this_)
+{
+	struct attr type,destination_length,destination_time,maneuver,length,street_name,cb,*attr_list[7];
+	int valid=0,count=0;
+
+	type.type=attr_type;
+	type.u.str="navigation_state";
+	attr_list[count++]=&type;
+	if (this_->state.active) {
+		destination_length.type=attr_destination_length;
+		destination_length.u.num=this_->state.destination_length;
+		attr_list[count++]=&destination_length;
+		destination_time.type=attr_destination_time;
+		destination_time.u.num=this_->state.destination_time;
+		attr_list[count++]=&destination_time;
+		maneuver.type=attr_item_type;
+		maneuver.u.item_type=this_->state.maneuver;
+		attr_list[count++]=&maneuver;
+		length.type=attr_length;
+		length.u.num=this_->state.maneuver_length;
+		attr_list[count++]=&length;
+		if (this_->state.street_name) {
+			street_name.type=attr_street_name;
+			street_name.u.str=this_->state.street_name;
+			attr_list[count++]=&street_name;
+		}
+	}
+	attr_list[count]=NULL;
+	if (navit_get_attr(this_->navit, attr_callback_list, &cb, NULL))
+		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
+}
+
+/**
+ * @brief Sends a navigation_state signal if the state changed
+ *
+ * The signal carries the distance and time to the destination, the type of the
+ * next maneuver with its distance and the current street, or only its type
+ * when navigation ended. See NAVIGATION_STATE_INTERVAL for rate limiting.
+ *
+ * @param this_ The navigation
+ */
+static void
+navigation_state_update(struct navigation *this_)
+{
+	struct navigation_state state;
+	char *street_name=NULL;
+	double now;
+
+	memset(&state, 0, sizeof(state));
+	if (this_->first && this_->cmd_first) {
+		state.active=1;
+		state.destination_length=this_->first->dest_length;
+		state.destination_time=this_->first->dest_time;
+		state.maneuver=navigation_command_type(this_->cmd_first);
+		state.maneuver_length=round_distance(this_->first->dest_length-this_->cmd_first->itm->dest_length);
+		street_name=this_->first->way.name1 ? this_->first->way.name1 : this_->first->way.name2;
+	}
+	if (!state.active && !this_->state.active)
+		return;
+	now=benchmark_time();
+	if (state.active == this_->state.active && state.maneuver == this_->state.maneuver &&
+	    !street_name == !this_->state.street_name && (!street_name || !strcmp(street_name, this_->state.street_name))) {
+		if (state.destination_length == this_->state.destination_length &&
+		    state.destination_time == this_->state.destination_time &&
+		    state.maneuver_length == this_->state.maneuver_length)
+			return;
+		if (now-this_->state_time < NAVIGATION_STATE_INTERVAL)
+			return;
+	}
+	g_free(this_->state.street_name);
+	state.street_name=g_strdup(street_name);
+	this_->state=state;
+	this_->state_time=now;
+	navigation_state_send(this_);
+}
+
 static void
 navigation_call_callbacks(struct navigation *this_, int force_speech)
 {
 	int distance, level = 0;
 	void *p=this_;
+	navigation_state_update(this_);
 	if (!this_->cmd_first)
 		return;
 	callback_list_call(this_->callback, 1, &p);
@@ -2066,6 +2300,207 @@ navigation_call_callbacks(struct navigation *this_, int force_speech)
 	}
 }
 
+static void
+navigation_update_turn_around(struct navigation *this_, struct item *ritem)
+{
+	if (ritem->type == type_route_start && this_->turn_around > -this_->turn_around_limit+1)
+		this_->turn_around--;
+	if (ritem->type == type_route_start_reverse && this_->turn_around < this_->turn_around_limit)
+		this_->turn_around++;
+}
+
+/**
+ * @brief Finds an item of the previous route which can be reused for a route item
+ *
+ * An item can be reused if it is on the same street in the same direction and covers the same part of it.
+ *
+ * @param this_ The navigation object
+ * @param old The items of the previous route which have not been reused yet
+ * @param ritem The item of the route map
+ * @return The item to reuse, or NULL
+ */
+static struct navigation_itm *
+navigation_itm_find_reusable(struct navigation *this_, GHashTable *old, struct item *ritem)
+{
+	struct navigation_itm *itm;
+	struct attr street_item,direction;
+	struct coord c,start,end;
+	int count=0;
+
+	if (!item_attr_get(ritem, attr_street_item, &street_item))
+		return NULL;
+	itm=item_hash_lookup(this_->hash, street_item.u.item);
+	if (!itm || !g_hash_table_lookup(old, itm))
+		return NULL;
+	if (!item_attr_get(ritem, attr_direction, &direction))
+		direction.u.num=0;
+	if (itm->way.dir != direction.u.num)
+		return NULL;
+	while (item_coord_get(ritem, &c, 1)) {
+		if (!count++)
+			start=c;
+		end=c;
+	}
+	item_coord_rewind(ritem);
+	if (count < 2 || !coord_equal(&itm->start, &start) || !coord_equal(&itm->end, &end))
+		return NULL;
+	return itm;
+}
+
+/**
+ * @brief Appends an item of the previous route to the list
+ *
+ * Length and time are taken from the route item. The ways at the start of the item
+ * only have to be queried again if the item before it has changed.
+ */
+static void
+navigation_itm_reuse(struct navigation *this_, struct navigation_itm *itm, struct item *ritem, struct map *graph_map)
+{
+	struct navigation_itm *old_prev=itm->prev;
+
+	if (ritem)
+		navigation_itm_update(itm, ritem);
+	itm->told=0;
+	itm->streetname_told=0;
+	itm->next=NULL;
+	itm->prev=this_->last;
+	if (this_->last)
+		this_->last->next=itm;
+	else
+		this_->first=itm;
+	this_->last=itm;
+	if (!itm->prev)
+		navigation_itm_ways_clear(itm);
+	else if (ritem && graph_map && (!old_prev || !item_is_equal(old_prev->way.item, itm->prev->way.item)))
+		navigation_itm_ways_update(itm, graph_map);
+}
+
+/**
+ * @brief Builds the items and commands for a new route, reusing what is unchanged
+ *
+ * Items of the previous route on the same street parts are reused, which saves
+ * looking up their names and the ways at their start. If the end of the route is
+ * unchanged (e.g. after leaving the route), the commands and distances of that part
+ * are kept, except for the first ones which look back into the changed part.
+ *
+ * @param this_ The navigation object
+ * @param mr Map rect of the route map
+ * @return True if there is a route
+ */
+static int
+navigation_rebuild(struct navigation *this_, struct map_rect *mr)
+{
+	GHashTable *old=g_hash_table_new(g_direct_hash, g_direct_equal);
+	GHashTable *tail;
+	GHashTableIter iter;
+	struct navigation_itm *itm,*suffix=NULL,*end,**old_itms;
+	struct navigation_itm *old_last=this_->last;
+	struct navigation_command *cmd,*next,*kept=NULL,*kept_last=NULL;
+	struct map *graph_map=route_get_graph_map(this_->route);
+	struct item *ritem;
+	int old_count=0,i,dist,reused=0;
+
+	for (itm = this_->first ; itm ; itm=itm->next)
+		old_count++;
+	old_itms=g_new(struct navigation_itm *, old_count ? old_count : 1);
+	for (i = 0, itm = this_->first ; itm ; itm=itm->next) {
+		old_itms[i++]=itm;
+		g_hash_table_insert(old, itm, itm);
+	}
+	cmd=this_->cmd_first;
+	this_->first=this_->last=NULL;
+	this_->cmd_first=this_->cmd_last=NULL;
+
+	while ((ritem=map_rect_get_item(mr))) {
+		navigation_update_turn_around(this_, ritem);
+		if (ritem->type != type_street_route)
+			continue;
+		itm=navigation_itm_find_reusable(this_, old, ritem);
+		if (itm) {
+			g_hash_table_remove(old, itm);
+			navigation_itm_reuse(this_, itm, ritem, graph_map);
+			reused++;
+		} else
+			navigation_itm_new(this_, ritem);
+	}
+	if (this_->first) {
+		if (old_last && !old_last->way.item.map && old_last->prev && old_last->prev == this_->last &&
+		    g_hash_table_lookup(old, old_last)) {
+			g_hash_table_remove(old, old_last);
+			navigation_itm_reuse(this_, old_last, NULL, graph_map);
+		} else
+			navigation_itm_new(this_, NULL);
+	}
+
+	/* The unchanged end of the route, the same items in the same order */
+	for (i = old_count-1, itm = this_->last ; i >= 0 && itm && old_itms[i] == itm ; i--, itm=itm->prev)
+		suffix=itm;
+	g_free(old_itms);
+	dbg(lvl_debug,"reused %d items, unchanged end starts at %p\n", reused, suffix);
+
+	/* Commands of the unchanged end are kept behind the part the maneuvers look back into */
+	end=NULL;
+	tail=g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (suffix) {
+		end=suffix->prev ? suffix : NULL;
+		dist=0;
+		while (end && end->next) {
+			dist+=end->length;
+			if (dist > NAVIGATION_MANEUVER_LOOKBACK && !(end->way.flags & AF_ROUNDABOUT))
+				break;
+			end=end->next;
+		}
+		for (itm = end ? end->next : suffix ; itm ; itm=itm->next)
+			g_hash_table_insert(tail, itm, itm);
+	}
+	while (cmd) {
+		next=cmd->next;
+		if (g_hash_table_lookup(tail, cmd->itm)) {
+			cmd->prev=kept_last;
+			cmd->next=NULL;
+			if (kept_last)
+				kept_last->next=cmd;
+			else
+				kept=cmd;
+			kept_last=cmd;
+		} else
+			g_free(cmd);
+		cmd=next;
+	}
+	g_hash_table_destroy(tail);
+
+	g_hash_table_iter_init(&iter, old);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&itm, NULL))
+		navigation_itm_destroy(this_, itm);
+	g_hash_table_destroy(old);
+
+	if (!this_->first) {
+		while (kept) {
+			next=kept->next;
+			g_free(kept);
+			kept=next;
+		}
+		return 0;
+	}
+	if (!kept)
+		make_maneuvers_until(this_, NULL);
+	else {
+		if (end)
+			make_maneuvers_until(this_, end);
+		if (this_->cmd_last) {
+			this_->cmd_last->next=kept;
+			kept->prev=this_->cmd_last;
+		} else
+			this_->cmd_first=kept;
+		this_->cmd_last=kept_last;
+	}
+	if (suffix)
+		calculate_dest_distance_before(this_, suffix);
+	else
+		calculate_dest_distance(this_, 0);
+	return 1;
+}
+
 static void
 navigation_update(struct navigation *this_, struct route *route, struct attr *attr)
 {
@@ -2081,29 +2516,38 @@ navigation_update(struct navigation *this_, struct route *route, struct attr *at
 		return;
 
 	dbg(lvl_debug,"enter %d\n", mode);
-	if (attr->u.num == route_status_no_destination || attr->u.num == route_status_not_found || attr->u.num == route_status_path_done_new) 
+	if (attr->u.num == route_status_no_destination || attr->u.num == route_status_not_found) {
 		navigation_flush(this_);
+		navigation_state_update(this_);
+	}
 	if (attr->u.num != route_status_path_done_new && attr->u.num != route_status_path_done_incremental)
 		return;
 		
-	if (! this_->route)
-		return;
-	map=route_get_map(this_->route);
-	if (! map)
-		return;
-	mr=map_rect_new(map, NULL);
-	if (! mr)
+	map=this_->route ? route_get_map(this_->route) : NULL;
+	mr=map ? map_rect_new(map, NULL) : NULL;
+	if (! mr) {
+		if (attr->u.num == route_status_path_done_new) {
+			navigation_flush(this_);
+			navigation_state_update(this_);
+		}
 		return;
+	}
 	if (route_get_attr(route, attr_vehicleprofile, &vehicleprofile, NULL))
 		this_->vehicleprofile=vehicleprofile.u.vehicleprofile;
 	else
 		this_->vehicleprofile=NULL;
 	dbg(lvl_debug,"enter\n");
+	if (attr->u.num == route_status_path_done_new) {
+		if (navigation_rebuild(this_, mr)) {
+			profile(0,"end");
+			navigation_call_callbacks(this_, FALSE);
+		} else
+			navigation_state_update(this_);
+		map_rect_destroy(mr);
+		return;
+	}
 	while ((ritem=map_rect_get_item(mr))) {
-		if (ritem->type == type_route_start && this_->turn_around > -this_->turn_around_limit+1)
-			this_->turn_around--;
-		if (ritem->type == type_route_start_reverse && this_->turn_around < this_->turn_around_limit)
-			this_->turn_around++;
+		navigation_update_turn_around(this_, ritem);
 		if (ritem->type != type_street_route)
 			continue;
 		if (first && item_attr_get(ritem, attr_street_item, &street_item)) {
@@ -2156,6 +2600,7 @@ navigation_destroy(struct navigation *this_)
 	item_hash_destroy(this_->hash);
 	callback_list_destroy(this_->callback);
 	callback_list_destroy(this_->callback_speech);
+	g_free(this_->state.street_name);
 	g_free(this_);
 }
 
@@ -2459,7 +2904,6 @@ static struct item *
 navigation_map_get_item(struct map_rect_priv *priv)
 {
 	struct item *ret=&priv->item;
-	int delta;
 	if (!priv->itm_next)
 		return NULL;
 	priv->itm=priv->itm_next;
@@ -2477,75 +2921,7 @@ navigation_map_get_item(struct map_rect_priv *priv)
 	if (priv->cmd->itm == priv->itm) {
 		priv->cmd_itm_next=priv->cmd->itm;
 		priv->cmd_next=priv->cmd->next;
-		if (priv->cmd_itm_next && !priv->cmd_itm_next->next)
-			ret->type=type_nav_destination;
-		else {
-			if (priv->itm && priv->itm->prev && !(priv->itm->way.flags & AF_ROUNDABOUT) && (priv->itm->prev->way.flags & AF_ROUNDABOUT)) {
-				enum item_type r=type_none,l=type_none;
-				switch (((180+22)-priv->cmd->roundabout_delta)/45) {
-				case 0:
-				case 1:
-					r=type_nav_roundabout_r1;
-					l=type_nav_roundabout_l7;
-					break;
-				case 2:
-					r=type_nav_roundabout_r2;
-					l=type_nav_roundabout_l6;
-					break;
-				case 3:
-					r=type_nav_roundabout_r3;
-					l=type_nav_roundabout_l5;
-					break;
-				case 4:
-					r=type_nav_roundabout_r4;
-					l=type_nav_roundabout_l4;
-					break;
-				case 5:
-					r=type_nav_roundabout_r5;
-					l=type_nav_roundabout_l3;
-					break;
-				case 6:
-					r=type_nav_roundabout_r6;
-					l=type_nav_roundabout_l2;
-					break;
-				case 7:
-					r=type_nav_roundabout_r7;
-					l=type_nav_roundabout_l1;
-					break;
-				case 8:
-					r=type_nav_roundabout_r8;
-					l=type_nav_roundabout_l8;
-					break;
-				}
-				dbg(lvl_debug,"delta %d\n",priv->cmd->delta);
-				if (priv->cmd->delta < 0)
-					ret->type=l;
-				else
-					ret->type=r;
-			} else {
-				delta=priv->cmd->delta;	
-				if (delta < 0) {
-					delta=-delta;
-					if (delta < 45)
-						ret->type=type_nav_left_1;
-					else if (delta < 105)
-						ret->type=type_nav_left_2;
-					else if (delta < 165) 
-						ret->type=type_nav_left_3;
-					else
-						ret->type=type_none;
-				} else {
-					if (delta < 45)
-						ret->type=type_nav_right_1;
-					else if (delta < 105)
-						ret->type=type_nav_right_2;
-					else if (delta < 165) 
-						ret->type=type_nav_right_3;
-					else
-						ret->type=type_none;
-				}
-			}
-		}
+		ret->type=navigation_command_type(priv->cmd);
 	}
 	navigation_map_item_coord_rewind(priv);
 	navigation_map_item_attr_rewind(priv);
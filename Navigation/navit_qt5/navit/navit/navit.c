@@ -68,6 +68,11 @@
 #include "vehicleprofile.h"
 #include "sunriset.h"
 #include "bookmarks.h"
+#include "geocode.h"
+#include "poisearch.h"
+#include "benchmark.h"
+#include "counter.h"
+#include "trace.h"
 #ifdef HAVE_API_WIN32_BASE
 #include <windows.h>
 #include "util.h"
@@ -78,6 +83,10 @@
 
 /* define string for bookmark handling */
 #define TEXTFILE_COMMENT_NAVI_STOPPED "# navigation stopped\n"
+/* Predicted movement stops when no fix arrives for this long (ms) */
+#define NAVIT_PREDICTION_TIMEOUT 3000
+/* Higher prediction_rate values are lowered to this many frames per second */
+#define NAVIT_PREDICTION_RATE_MAX 50
 
 /**
  * @defgroup navit The navit core instance
@@ -173,6 +182,13 @@ struct navit {
 	int imperial;
 	int waypoints_flag;
 	struct coord_geo center;
+	struct geocode *geocode;
+	int prediction_rate;		/**< Frames per second the vehicle is moved at between fixes, 0 to disable, at most NAVIT_PREDICTION_RATE_MAX */
+	struct callback *prediction_cb;
+	struct event_timeout *prediction_timeout;
+	double prediction_fix_time;	/**< Time of the last fix in milliseconds */
+	int prediction_follow;		/**< The map is moved with the predicted position */
+	int prediction_dragged;		/**< The map has been moved with graphics_draw_drag() since the last redraw */
 };
 
 struct gui *main_loop_gui;
@@ -187,6 +203,7 @@ struct attr_iter {
 
 static void navit_vehicle_update_position(struct navit *this_, struct navit_vehicle *nv);
 static void navit_vehicle_draw(struct navit *this_, struct navit_vehicle *nv, struct point *pnt);
+static void navit_prediction_stop(struct navit *this_);
 static int navit_add_vehicle(struct navit *this_, struct vehicle *v);
 static int navit_set_attr_do(struct navit *this_, struct attr *attr, int init);
 static int navit_get_cursor_pnt(struct navit *this_, struct point *p, int keep_orientation, int *dir);
@@ -202,31 +219,40 @@ struct navit *global_navit;
 
 
 
+static void
+navit_append_item_address_attr(char **parts, int *count, struct item *item, enum attr_type type)
+{
+	struct attr attr;
+	if (item_attr_get(item, type, &attr))
+		parts[(*count)++]=g_strdup(map_convert_string_tmp(item->map,attr.u.str));
+}
+
 char *
 navit_compose_item_address_string(struct item *item, int prependPostal)
 {
-	char *s=g_strdup("");
-	struct attr attr;
-	if(prependPostal && item_attr_get(item, attr_postal, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_house_number, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_street_name, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_street_name_systematic, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_district_name, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_town_name, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_county_name, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-	if(item_attr_get(item, attr_country_name, &attr))
-		s=g_strjoin(" ",s,map_convert_string_tmp(item->map,attr.u.str),NULL);
-
-	if(item_attr_get(item, attr_address, &attr))
-		s=g_strjoin(" ",s,"|",map_convert_string_tmp(item->map,attr.u.str),NULL);
-	return s;
+	char *parts[12],*ret;
+	int count=0;
+
+	/* The empty first part gives the leading blank of the former format */
+	parts[count++]=g_strdup("");
+	if(prependPostal)
+		navit_append_item_address_attr(parts, &count, item, attr_postal);
+	navit_append_item_address_attr(parts, &count, item, attr_house_number);
+	navit_append_item_address_attr(parts, &count, item, attr_street_name);
+	navit_append_item_address_attr(parts, &count, item, attr_street_name_systematic);
+	navit_append_item_address_attr(parts, &count, item, attr_district_name);
+	navit_append_item_address_attr(parts, &count, item, attr_town_name);
+	navit_append_item_address_attr(parts, &count, item, attr_county_name);
+	navit_append_item_address_attr(parts, &count, item, attr_country_name);
+	parts[count++]=g_strdup("|");
+	navit_append_item_address_attr(parts, &count, item, attr_address);
+	if (!strcmp(parts[count-1], "|"))
+		g_free(parts[--count]);
+	parts[count]=NULL;
+	ret=g_strjoinv(" ", parts);
+	while (count)
+		g_free(parts[--count]);
+	return ret;
 }
 
 int navit_create_curr_position_distance_attr(struct pcoord *c, struct attr *attr)
@@ -270,10 +296,9 @@ int navit_create_curr_position_distance_attr(struct pcoord *c, struct attr *attr
 	return ret;
 }
 
-struct attr** navit_add_item_distance_from_curr_pos(struct navit *this_, struct item *item, struct attr **attr_list)
+static int
+navit_item_distance_from_curr_pos(struct navit *this_, struct item *item, struct attr *attr)
 {
-	struct attr attr;
-
 	struct transformation *trans;
     struct coord c;
     struct coord curr_coord;
@@ -287,13 +312,23 @@ struct attr** navit_add_item_distance_from_curr_pos(struct navit *this_, struct
     	   item_coord_get_pro(item, &c, 1, transform_get_projection(trans))) {
 
     	   transform_from_geo(transform_get_projection(trans),pos_attr.u.coord_geo, &curr_coord);
-    	   attr.type = attr_curr_position_distance;
+    	   attr->type = attr_curr_position_distance;
 
-    	   attr.u.num = transform_distance(transform_get_projection(trans), &curr_coord, &c);
-    	   attr_list=attr_generic_add_attr(attr_list, &attr);
+    	   attr->u.num = transform_distance(transform_get_projection(trans), &curr_coord, &c);
+    	   return 1;
     	}
   	}
 
+    return 0;
+}
+
+struct attr** navit_add_item_distance_from_curr_pos(struct navit *this_, struct item *item, struct attr **attr_list)
+{
+	struct attr attr;
+
+	if (navit_item_distance_from_curr_pos(this_, item, &attr))
+		attr_list=attr_generic_add_attr(attr_list, &attr);
+
     return attr_list;
 }
 
@@ -307,25 +342,32 @@ struct attr** navit_add_item_address(struct navit *this_, struct item *item, str
     	attr.type = attr_address;
     	attr.u.str = address;
     	attr_list=attr_generic_add_attr(attr_list, &attr);
+    	g_free(address);
     }
 
     return attr_list;
 }
 
 
-struct attr** navit_get_point_attr_list(struct navit *this_, struct point *p)
+/**
+ * @brief Collects the attributes of the items displayed around a point
+ *
+ * @param this_ The navit instance
+ * @param p The point in screen coordinates
+ * @param store Receives the geo coordinates of the point, followed by item_type, label,
+ * curr_position_distance (if the vehicle position is known) and address of each item
+ */
+static void
+navit_get_point_attr_store(struct navit *this_, struct point *p, struct attr_store *store)
 {
 	struct displaylist_handle *dlh;
 	struct displaylist *display;
 	struct displayitem *di;
-	struct attr **attr_list=NULL;
 	struct attr attr;
 	struct coord_geo g;
 
 	struct transformation *trans;
     struct coord c;
-    struct coord curr_coord;
-    char *address;
 
     // transform pixel coordinates to geo coordinates
     trans=navit_get_trans(this_);
@@ -338,39 +380,58 @@ struct attr** navit_get_point_attr_list(struct navit *this_, struct point *p)
     attr.type=attr_click_coord_geo;
 
     // add clicked point geo coordinates to atrributes list:
-    attr_list=attr_generic_add_attr(attr_list, &attr);
+    attr_store_add(store, &attr);
 
 	display=navit_get_displaylist(this_);
 	dlh=graphics_displaylist_open(display);
 	while ((di=graphics_displaylist_next(dlh))) {
 		struct item *item=graphics_displayitem_get_item(di);
-		long int idist = 0;
 		//if (item_is_point(*item) && graphics_displayitem_get_displayed(di) &&
 		if (graphics_displayitem_get_displayed(di) &&
 			graphics_displayitem_within_dist(display, di, p, this_->radius)) {
 			struct map_rect *mr=map_rect_new(item->map, NULL);
 			struct item *itemo=map_rect_get_item_byid(mr, item->id_hi, item->id_lo);
 			if (itemo) {
+				char *address;
+
 				attr.type = attr_item_type;
 				attr.u.item_type = item->type;
-				attr_list=attr_generic_add_attr(attr_list, &attr);
+				attr_store_add(store, &attr);
 
 				if (!item_attr_get(itemo, attr_label, &attr)) {
 					attr.type = attr_label;
 					attr.u.str = "";
 				}
 
-				attr_list=attr_generic_add_attr(attr_list, &attr);
+				attr_store_add(store, &attr);
 
 				// item distance from current position
-				attr_list=navit_add_item_distance_from_curr_pos(this_,itemo,attr_list);
+				if (navit_item_distance_from_curr_pos(this_, itemo, &attr))
+					attr_store_add(store, &attr);
 				// item address
-				attr_list=navit_add_item_address(this_,itemo,attr_list);
+				if ((address=navit_compose_item_address_string(itemo,0))) {
+					attr.type = attr_address;
+					attr.u.str = address;
+					attr_store_add(store, &attr);
+					g_free(address);
+				}
 			}
 			map_rect_destroy(mr);
 		}
 	}
 	graphics_displaylist_close(dlh);
+}
+
+
+struct attr** navit_get_point_attr_list(struct navit *this_, struct point *p)
+{
+	struct attr_store store;
+	struct attr **attr_list;
+
+	attr_store_init(&store, 0);
+	navit_get_point_attr_store(this_, p, &store);
+	attr_list=attr_list_dup(attr_store_get_list(&store));
+	attr_store_clear(&store);
 
 	return attr_list;
 }
@@ -412,15 +473,16 @@ static
 void navit_dbus_send_point_info(void* data, struct point *p)
 {
 	struct navit *this=data;
-	struct attr cb, **attr_list=NULL;
+	struct attr cb;
+	struct attr_store store;
 	int valid=0;
 
-	attr_list = navit_get_point_attr_list(this,p);
-
-	if (attr_list && navit_get_attr(this, attr_callback_list, &cb, NULL))
-		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
-
-	attr_list_free(attr_list);
+	if (!navit_get_attr(this, attr_callback_list, &cb, NULL))
+		return;
+	attr_store_init(&store, 0);
+	navit_get_point_attr_store(this, p, &store);
+	callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_store_get_list(&store), NULL, &valid);
+	attr_store_clear(&store);
 }
 
 
@@ -448,26 +510,55 @@ void navit_dbus_send_point_info(void* data, struct point *p)
 void navit_dbus_send_dest_time_length(void* data, struct pcoord *start, struct pcoord *end)
 {
 	struct navit *this=data;
-	struct attr cb, length, time, **attr_list=NULL;
+	struct attr cb, length, time;
+	struct attr_store store;
 	int valid=0;
 
 	if (navit_get_dest_length_time(this, start, end, &length, &time)) {
 
-		attr_list=attr_generic_add_attr(attr_list, &length);
-		attr_list=attr_generic_add_attr(attr_list, &time);
+		attr_store_init(&store, 1);
+		attr_store_add(&store, &length);
+		attr_store_add(&store, &time);
 
-		if (attr_list && navit_get_attr(this, attr_callback_list, &cb, NULL))
-			callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
+		if (navit_get_attr(this, attr_callback_list, &cb, NULL))
+			callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_store_get_list(&store), NULL, &valid);
 
-		attr_list_free(attr_list);
+		attr_store_clear(&store);
 	}
 }
 
+/**
+ * @brief Finds the address at a coordinate
+ *
+ * The reverse geocoder of the first mapset is created on first use and keeps
+ * the index of the most recently queried areas until the maps change, see
+ * geocode_reverse().
+ *
+ * @param this_ The navit instance
+ * @param pc The coordinate
+ * @param result Receives the address, valid until the next call
+ * @returns 1 if a street or town was found, otherwise 0
+ */
+int
+navit_reverse_geocode(struct navit *this_, struct pcoord *pc, struct geocode_result *result)
+{
+	struct mapset *ms=navit_get_mapset(this_);
+
+	if (!ms)
+		return 0;
+	if (!this_->geocode)
+		this_->geocode=geocode_new(ms);
+	else
+		geocode_set_mapset(this_->geocode, ms);
+	return geocode_reverse(this_->geocode, pc, result);
+}
+
 static
 void navit_dbus_send_tap_point_info(void* data, struct point *p)
 {
 	struct navit *this=data;
-	struct attr attr, cb, **attr_list=NULL;
+	struct attr attr, cb;
+	struct attr_store store;
 	int valid=0;
 	struct transformation *trans;
 	struct coord c;
@@ -484,12 +575,58 @@ void navit_dbus_send_tap_point_info(void* data, struct point *p)
     attr.type=attr_tap_coord_geo;
 
 	    // add clicked point geo coordinates to atrributes list:
-    attr_list=attr_generic_add_attr(attr_list, &attr);
+	attr_store_init(&store, 1);
+    attr_store_add(&store, &attr);
 
-	if (attr_list && navit_get_attr(this, attr_callback_list, &cb, NULL))
-		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
+	if (navit_get_attr(this, attr_callback_list, &cb, NULL))
+		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_store_get_list(&store), NULL, &valid);
 
-	attr_list_free(attr_list);
+	attr_store_clear(&store);
+}
+
+#define NAVIT_POIS_PER_SIGNAL 50
+
+/**
+ * @brief Collects the attributes of POIs as sent by navit_dbus_send_selected_pois()
+ *
+ * Each POI is described by item_type, position_coord_geo, static_distance, label,
+ * curr_position_distance (if the vehicle position is known) and address.
+ *
+ * @param results POIs as returned by poi_search_get_results()
+ * @param count Number of POIs
+ * @param store Receives the attributes
+ */
+static void
+navit_poi_results_attr_store(struct poi_search_result *results, int count, struct attr_store *store)
+{
+	struct attr attr;
+	struct coord_geo g;
+	struct pcoord pc;
+	int i;
+
+	for (i = 0 ; i < count ; i++) {
+		attr.type=attr_item_type;
+		attr.u.item_type=results[i].type;
+		attr_store_add(store, &attr);
+		transform_to_geo(projection_mg, &results[i].c, &g);
+		attr.type=attr_position_coord_geo;
+		attr.u.coord_geo=&g;
+		attr_store_add(store, &attr);
+		attr.type=attr_static_distance;
+		attr.u.num=results[i].distance;
+		attr_store_add(store, &attr);
+		attr.type=attr_label;
+		attr.u.str=results[i].label;
+		attr_store_add(store, &attr);
+		pc.pro=projection_mg;
+		pc.x=results[i].c.x;
+		pc.y=results[i].c.y;
+		if (navit_create_curr_position_distance_attr(&pc, &attr))
+			attr_store_add(store, &attr);
+		attr.type=attr_address;
+		attr.u.str=results[i].address;
+		attr_store_add(store, &attr);
+	}
 }
 
 /**
@@ -497,104 +634,56 @@ void navit_dbus_send_tap_point_info(void* data, struct point *p)
  *
  * @param cn center point
  * @param dist distance from center point in meters
- * @return Pointer to the updated attribute list
+ * @return Pointer to the updated attribute list, NULL if there are no pois
  */
 struct attr** navit_get_selected_pois(struct navit *this_, struct pcoord cn, int dist)
 {
+	struct poi_search *ps;
+	struct poi_search_result *results;
+	struct attr_store store;
 	struct attr **attr_list=NULL;
-	struct attr attr;
-	struct item* item;
-	struct mapset_handle *h;
-	struct map_selection *sel,*selm;
-	struct map_rect *mr;
-	struct map *m;
-	int idist;
-	struct coord center;
-	struct coord_geo g;
-	struct transformation *trans;
-
-    sel=map_selection_rect_new(&cn,dist*transform_scale(abs(cn.y)+dist*1.5),18);
-
-	center.x=cn.x;
-	center.y=cn.y;
-	h=mapset_open(navit_get_mapset(this_));
-
-	while ((m=mapset_next(h, 1))) {
-		selm=map_selection_dup_pro(sel, cn.pro, map_projection(m));
-	    mr=map_rect_new(m, selm);
-
-	    if (mr) {
-	    	while ((item=map_rect_get_item(mr))) {
-	    		struct coord c;
-	            if (item_coord_get_pro(item, &c, 1, cn.pro) &&
-	            	coord_rect_contains(&sel->u.c_rect, &c) &&
-	                (idist=transform_distance(cn.pro, &center, &c)) < dist &&
-	                item->type<type_line) {
-
-	        	    // item type
-	                attr.type = attr_item_type;
-	                attr.u.item_type = item->type;
-	                attr_list=attr_generic_add_attr(attr_list, &attr);
-
-	                // transform  to geo coordinates
-	                trans=navit_get_trans(this_);
-                	transform_to_geo(transform_get_projection(trans), &c, &g);
-
-                	// poi position
-                	attr.u.coord_geo=&g;
-                	attr.type=attr_position_coord_geo;
-
-                    attr_list=attr_generic_add_attr(attr_list, &attr);
-
-                    // poi distance from center point in meters
-                    attr.u.num = idist;
-                    attr.type=attr_static_distance;
-
-                    attr_list=attr_generic_add_attr(attr_list, &attr);
-
-                    // poi label
-                    if (!item_attr_get(item, attr_label, &attr)) {
-                    	attr.type = attr_label;
-                    	attr.u.str = "";
-                    }
-
-                    attr_list=attr_generic_add_attr(attr_list, &attr);
-
-                    // item distance from current position
-    				attr_list=navit_add_item_distance_from_curr_pos(this_,item,attr_list);
-    				// item address
-    				attr_list=navit_add_item_address(this_,item,attr_list);
-	            }
-	    	}
-	    }
+	int count;
 
-	    map_selection_destroy(selm);
+	ps=poi_search_new(navit_get_mapset(this_), &cn, dist, NULL, 0);
+	poi_search_read_all(ps);
+	if ((count=poi_search_get_results(ps, G_MAXINT, &results))) {
+		attr_store_init(&store, 0);
+		navit_poi_results_attr_store(results, count, &store);
+		attr_list=attr_list_dup(attr_store_get_list(&store));
+		attr_store_clear(&store);
 	}
-
-	map_selection_destroy(sel);
-	mapset_close(h);
-
+	poi_search_destroy(ps);
 	return attr_list;
 }
 
 /**
  * @brief This function sends over dbus atribute list with pois found around given center point
  *
+ * The pois are sent nearest first, NAVIT_POIS_PER_SIGNAL per signal.
+ *
  * @param center center point
  * @param dist distance from center point in meters
  */
 void navit_dbus_send_selected_pois(void* data, struct pcoord *pc, int distance)
 {
 	struct navit *this=data;
-	struct attr cb, **attr_list=NULL;
-	int valid=0;
+	struct attr cb;
+	struct attr_store store;
+	struct poi_search *ps;
+	struct poi_search_result *results;
+	int count,valid=0;
 
-	attr_list = navit_get_selected_pois(this, *pc, distance);
-
-	if (attr_list && navit_get_attr(this, attr_callback_list, &cb, NULL))
-		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
-
-	attr_list_free(attr_list);
+	if (!navit_get_attr(this, attr_callback_list, &cb, NULL))
+		return;
+	attr_store_init(&store, 0);
+	ps=poi_search_new(navit_get_mapset(this), pc, distance, NULL, 0);
+	poi_search_read_all(ps);
+	while ((count=poi_search_get_results(ps, NAVIT_POIS_PER_SIGNAL, &results))) {
+		navit_poi_results_attr_store(results, count, &store);
+		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_store_get_list(&store), NULL, &valid);
+		attr_store_clear(&store);
+	}
+	poi_search_destroy(ps);
 }
 
 void
@@ -1325,6 +1414,8 @@ navit_cmd_map_add_curr_pos(struct navit *this, char *function, struct attr **in,
 		sel.order=18;
 		sel.range.min=type_none;
 		sel.range.max=type_tec_common;
+		sel.types=NULL;
+		sel.simplified=0;
 		sel.u.c_rect.lu.x=curr_coord.x-selection_range;
 		sel.u.c_rect.lu.y=curr_coord.y+selection_range;
 		sel.u.c_rect.rl.x=curr_coord.x+selection_range;
@@ -1761,6 +1852,27 @@ navit_cmd_spawn(struct navit *this, char *function, struct attr **in, struct att
 	}
 }
 
+/**
+ * Matches a recorded NMEA or GPX track to the streets of the map, see tracking_match_log()
+ *
+ * @param navit The navit instance
+ * @param function unused (needed to match command function signiture)
+ * @param in input attributes in[0] is the track file, in[1] the file to write the result to
+ * @param out output attribute, the number of matched fixes or -1 on error
+ * @param valid unused
+ * @returns nothing
+ */
+static void
+navit_cmd_tracking_match_log(struct navit *this, char *function, struct attr **in, struct attr ***out, int *valid)
+{
+	struct attr ret;
+	ret.type=attr_type_int_begin;
+	ret.u.num=-1;
+	if (this->tracking && in && in[0] && ATTR_IS_STRING(in[0]->type) && in[0]->u.str &&
+	    in[1] && ATTR_IS_STRING(in[1]->type) && in[1]->u.str)
+		ret.u.num=tracking_match_log(this->tracking, in[0]->u.str, in[1]->u.str);
+	*out=attr_generic_add_attr(*out, &ret);
+}
 
 static struct command_table commands[] = {
 	{"zoom_in",command_cast(navit_cmd_zoom_in)},
@@ -1787,6 +1899,7 @@ static struct command_table commands[] = {
 	{"map_item_set_attr",command_cast(navit_cmd_map_item_set_attr)},
 	{"set_attr_var",command_cast(navit_cmd_set_attr_var)},
 	{"get_attr_var",command_cast(navit_cmd_get_attr_var)},
+	{"tracking_match_log",command_cast(navit_cmd_tracking_match_log)},
 };
 	
 void 
@@ -2330,7 +2443,7 @@ navit_speak(struct navit *this_)
 	if (mr) {
 		while ((item=map_rect_get_item(mr)) && (item->type == type_nav_position || item->type == type_nav_none));
 		if (item && item_attr_get(item, attr_navigation_speech, &attr)) {
-			speech_say(this_->speech, attr.u.str);
+			speech_say_priority(this_->speech, attr.u.str, speech_priority_maneuver);
 			navit_add_message(this_, attr.u.str);
 			navit_textfile_debug_log(this_, "type=announcement label=\"%s\"", attr.u.str);
 		}
@@ -2451,8 +2564,8 @@ navit_window_roadbook_new(struct navit *this_)
 	navit_window_roadbook_update(this_);
 }
 
-void
-navit_init(struct navit *this_)
+static void
+navit_init_do(struct navit *this_)
 {
 	struct mapset *ms;
 	struct map *map;
@@ -2590,6 +2703,14 @@ navit_init(struct navit *this_)
 #endif
 }
 
+void
+navit_init(struct navit *this_)
+{
+	double start=trace_enabled ? benchmark_time() : 0;
+	navit_init_do(this_);
+	trace_span("navit_init", NULL, start);
+}
+
 void
 navit_zoom_to_rect(struct navit *this_, struct coord_rect *r)
 {
@@ -3050,6 +3171,11 @@ navit_set_attr_do(struct navit *this_, struct attr *attr, int init)
 		attr_updated=(this_->follow_cursor != !!attr->u.num);
 		this_->follow_cursor=!!attr->u.num;
 		break;
+	case attr_prediction_rate:
+		attr_updated=(this_->prediction_rate != MIN(attr->u.num, NAVIT_PREDICTION_RATE_MAX));
+		this_->prediction_rate=MIN(attr->u.num, NAVIT_PREDICTION_RATE_MAX);
+		navit_prediction_stop(this_);
+		break;
 	case attr_imperial:
 		attr_updated=(this_->imperial != attr->u.num);
 		this_->imperial=attr->u.num;
@@ -3272,6 +3398,9 @@ navit_get_attr(struct navit *this_, enum attr_type type, struct attr *attr, stru
 	case attr_follow_cursor:
 		attr->u.num=this_->follow_cursor;
 		break;
+	case attr_prediction_rate:
+		attr->u.num=this_->prediction_rate;
+		break;
 	case attr_waypoints_flag:
 		attr->u.num=this_->waypoints_flag;
 		break;
@@ -3451,6 +3580,77 @@ navit_vehicle_draw(struct navit *this_, struct navit_vehicle *nv, struct point *
 	vehicle_draw(nv->vehicle, this_->gra, &cursor_pnt, nv->dir-transform_get_yaw(this_->trans_cursor), nv->speed);
 }
 
+static void
+navit_prediction_stop(struct navit *this_)
+{
+	if (this_->prediction_timeout) {
+		event_remove_timeout(this_->prediction_timeout);
+		this_->prediction_timeout=NULL;
+	}
+}
+
+/**
+ * @brief Moves the cursor of the active vehicle to its predicted position
+ *
+ * This is called prediction_rate times per second between two fixes. Only the cursor
+ * is redrawn. If the map follows the vehicle, the map image of the last redraw is moved
+ * with graphics_draw_drag() instead of being redrawn, until the next fix triggers a
+ * proper redraw. Route, navigation and tracking are only updated by real fixes.
+ *
+ * @param this_ The navit object
+ */
+static void
+navit_prediction_frame(struct navit *this_)
+{
+	struct navit_vehicle *nv=this_->vehicle;
+	enum projection pro=transform_get_projection(this_->trans_cursor);
+	double elapsed=benchmark_time()-this_->prediction_fix_time;
+	struct point pnt,fix_pnt;
+	struct coord c;
+	int dir;
+
+	if (!nv || !this_->tracking || !this_->tracking_flag || this_->ready != 3 || this_->blocked || this_->button_pressed
+	    || elapsed > NAVIT_PREDICTION_TIMEOUT) {
+		navit_prediction_stop(this_);
+		return;
+	}
+	if (!tracking_predict(this_->tracking, elapsed, &c, &dir))
+		return;
+	transform(this_->trans_cursor, pro, &c, &pnt, 1, 0, 0, NULL);
+	if (this_->prediction_follow) {
+		struct point offset;
+		transform(this_->trans_cursor, pro, &nv->coord, &fix_pnt, 1, 0, 0, NULL);
+		offset.x=fix_pnt.x-pnt.x;
+		offset.y=fix_pnt.y-pnt.y;
+		if (graphics_draw_drag(this_->gra, &offset)) {
+			this_->prediction_dragged=1;
+			pnt=fix_pnt;
+		}
+	}
+	vehicle_draw(nv->vehicle, this_->gra, &pnt, dir-transform_get_yaw(this_->trans_cursor), nv->speed);
+}
+
+/**
+ * @brief Prepares the predicted movement after a fix of the active vehicle
+ *
+ * @param this_ The navit object
+ * @param follow Whether the map has been centered on the fix
+ */
+static void
+navit_prediction_fix(struct navit *this_, int follow)
+{
+	this_->prediction_fix_time=benchmark_time();
+	this_->prediction_follow=follow;
+	if (this_->prediction_rate <= 0 || !this_->tracking || !this_->tracking_flag) {
+		navit_prediction_stop(this_);
+		return;
+	}
+	if (!this_->prediction_cb)
+		this_->prediction_cb=callback_new_1(callback_cast(navit_prediction_frame), this_);
+	if (!this_->prediction_timeout)
+		this_->prediction_timeout=event_add_timeout(1000/this_->prediction_rate, 1, this_->prediction_cb);
+}
+
 /**
  * @brief Called when the position of a vehicle changes.
  *
@@ -3492,7 +3692,9 @@ navit_vehicle_update_position(struct navit *this_, struct navit_vehicle *nv) {
 	if (this_->vehicle == nv && this_->tracking_flag)
 		tracking=this_->tracking;
 	if (tracking) {
+		double start=benchmark_enabled || counter_enabled ? benchmark_time() : 0;
 		tracking_update(tracking, nv->vehicle, this_->vehicleprofile, pro);
+		benchmark_add(benchmark_tracking, start);
 		attr_object=tracking;
 		get_attr=(int (*)(void *, enum attr_type, struct attr *, struct attr_iter *))tracking_get_attr;
 	} else {
@@ -3532,12 +3734,17 @@ navit_vehicle_update_position(struct navit *this_, struct navit_vehicle *nv) {
 		if (this_->gui && nv->speed > 2)
 			navit_disable_suspend();
 
+		if (this_->prediction_dragged) {
+			graphics_draw_drag(this_->gra, NULL);
+			this_->prediction_dragged=0;
+		}
 		transform(this_->trans_cursor, pro, &nv->coord, &cursor_pnt, 1, 0, 0, NULL);
 		if (this_->button_pressed != 1 && this_->follow_cursor && nv->follow_curr <= nv->follow && 
 			(nv->follow_curr == 1 || !transform_within_border(this_->trans_cursor, &cursor_pnt, this_->border)))
 			navit_set_center_cursor_draw(this_);
 		else
 			navit_vehicle_draw(this_, nv, pnt);
+		navit_prediction_fix(this_, this_->follow_cursor && nv->follow == 1);
 
 		if (nv->follow_curr > 1)
 			nv->follow_curr--;
@@ -3945,6 +4152,8 @@ navit_destroy(struct navit *this_)
 	callback_destroy(this_->popup_callback);
 	callback_destroy(this_->motion_timeout_callback);
 	callback_destroy(this_->progress_cb);
+	navit_prediction_stop(this_);
+	callback_destroy(this_->prediction_cb);
 
 	if(this_->gra) {
 	  graphics_remove_callback(this_->gra, this_->resize_callback);
@@ -3963,6 +4172,9 @@ navit_destroy(struct navit *this_)
 
         map_destroy(this_->former_destination);
 
+	if (this_->geocode)
+		geocode_destroy(this_->geocode);
+
         graphics_displaylist_destroy(this_->displaylist);
 
 	graphics_free(this_->gra);
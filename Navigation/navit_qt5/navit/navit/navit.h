@@ -37,6 +37,7 @@ struct attr_iter;
 struct callback;
 struct coord_rect;
 struct displaylist;
+struct geocode_result;
 struct graphics;
 struct gui;
 struct mapset;
@@ -127,6 +128,7 @@ void navit_command_add_table(struct navit*this_, struct command_table *commands,
 struct navit * navit_ref(struct navit *this_);
 void navit_unref(struct navit *this_);
 void navit_set_visitbefore(struct navit *nav, struct pcoord *pc,int visitbefore);
+char *navit_compose_item_address_string(struct item *item, int prependPostal);
 struct attr** navit_get_point_attr_list(struct navit *this_, struct point *p);
 struct attr** navit_get_selected_pois(struct navit *this_, struct pcoord cn, int distance);
 void navit_dbus_send_selected_pois(void* data, struct pcoord *pc, int distance);
@@ -136,6 +138,7 @@ int navit_create_curr_position_distance_attr(struct pcoord *c, struct attr *attr
 void navit_show_selection_point_pcoord(void* data, struct pcoord *p, int enable);
 int navit_get_dest_length_time(struct navit *this_, struct pcoord *pos, struct pcoord *c, struct attr* length, struct attr* time);
 void navit_dbus_send_dest_time_length(void* data, struct pcoord *start, struct pcoord *end);
+int navit_reverse_geocode(struct navit *this_, struct pcoord *pc, struct geocode_result *result);
 /* end of prototypes */
 #ifdef __cplusplus
 }
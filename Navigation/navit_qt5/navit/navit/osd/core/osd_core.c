@@ -2059,6 +2059,8 @@ osd_speed_cam_draw(struct osd_priv_common *opc, struct navit *navit, struct vehi
   sel.order=18;
   sel.range.min=type_tec_common;
   sel.range.max=type_tec_common;
+  sel.types=NULL;
+  sel.simplified=0;
   sel.u.c_rect.lu.x=curr_coord.x-dst;
   sel.u.c_rect.lu.y=curr_coord.y+dst;
   sel.u.c_rect.rl.x=curr_coord.x+dst;
@@ -37,6 +37,8 @@
 #include "plugin.h"
 #include "item.h"
 #include "debug.h"
+#include "benchmark.h"
+#include "trace.h"
 
 #ifdef USE_PLUGINS
 #ifndef HAVE_GMODULE
@@ -340,17 +342,21 @@ plugins_init(struct plugins *pls)
 #ifdef USE_PLUGINS
 	struct plugin *pl;
 	GList *l;
+	double start;
 
 	l=pls->list;
 	if (l){
 		while (l) {
 			pl=l->data;
 			if (! plugin_get_ondemand(pl)) {
+				start=trace_enabled ? benchmark_time() : 0;
 				if (plugin_get_active(pl))
 					if (!plugin_load(pl))
 						plugin_set_active(pl, 0);
-				if (plugin_get_active(pl))
+				if (plugin_get_active(pl)) {
 					plugin_call_init(pl);
+					trace_span("plugin", pl->name, start);
+				}
 			}
 			l=g_list_next(l);
 		}
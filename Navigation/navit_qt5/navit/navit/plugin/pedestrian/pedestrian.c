@@ -352,6 +352,8 @@ map_route_occluded_get_buildings(struct mapset *mapset, struct coord_rect *r)
 	sel.order=18;
 	sel.range.min=type_poly_building;
 	sel.range.max=type_poly_building;
+	sel.types=NULL;
+	sel.simplified=0;
 
 	map_route_occluded_buildings_free();
 	while ((map = mapset_next(msh, 1))) {
@@ -0,0 +1,376 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * POI search around a point.
+ *
+ * The area is read in rings: the first one reaches POI_SEARCH_FIRST_RADIUS
+ * meters from the center, each following one twice as far, up to the
+ * requested distance. For a ring only the frame between the bounding
+ * rectangle of the ring and the rectangle read before is selected, with a
+ * small overlap against rounding, so the area is read about once. Items in
+ * the corners of the frame which are beyond the ring are kept for the
+ * following rings. Results are handed out nearest first from the current
+ * ring, so the outer rings are only read if more results are asked for.
+ * When all results are wanted, the whole area is read in a single ring.
+ * Labels and addresses are looked up for the handed out results only.
+ */
+
+#include <stdlib.h>
+#include <glib.h>
+#include "debug.h"
+#include "item.h"
+#include "coord.h"
+#include "projection.h"
+#include "transform.h"
+#include "map.h"
+#include "mapset.h"
+#include "navit.h"
+#include "poisearch.h"
+
+#define POI_SEARCH_FIRST_RADIUS 250
+/* The frames overlap by this many units, as maps in other projections round the selection */
+#define POI_SEARCH_MARGIN 16
+
+struct poi_search_candidate {
+	struct map *map;
+	int id_hi,id_lo;
+	enum item_type type;
+	struct coord c;
+	int distance;
+};
+
+struct poi_search {
+	struct mapset *ms;
+	struct coord center;		/* projection_mg */
+	int dist;
+	enum item_type *types;		/* sorted, NULL for all POIs */
+	int type_count;
+	int all;			/* all results will be read, see poi_search_read_all() */
+	int radius;			/* outer radius of the ring read last, 0 before the first one */
+	int half;			/* half the size of the rectangle read so far, 0 before the first ring */
+	struct poi_search_candidate *candidates;	/* of the ring read last, nearest first */
+	int candidate_count,candidate_size,candidate_pos;
+	struct poi_search_candidate *pending;	/* read already, but beyond the ring read last */
+	int pending_count,pending_size;
+	struct poi_search_result *results;	/* of the last poi_search_get_results() */
+	int result_count,result_size;
+};
+
+static int
+poi_search_type_compare(const void *a, const void *b)
+{
+	enum item_type ta=*(const enum item_type *)a;
+	enum item_type tb=*(const enum item_type *)b;
+	return ta < tb ? -1 : ta > tb;
+}
+
+static int
+poi_search_candidate_compare(const void *a, const void *b)
+{
+	const struct poi_search_candidate *ca=a;
+	const struct poi_search_candidate *cb=b;
+	if (ca->distance != cb->distance)
+		return ca->distance < cb->distance ? -1:1;
+	if (ca->type != cb->type)
+		return ca->type < cb->type ? -1:1;
+	if (ca->id_hi != cb->id_hi)
+		return ca->id_hi < cb->id_hi ? -1:1;
+	return ca->id_lo < cb->id_lo ? -1 : ca->id_lo > cb->id_lo;
+}
+
+/**
+ * @brief Creates a POI search
+ *
+ * @param ms The mapset to search
+ * @param center Center of the search
+ * @param dist Maximum distance from the center in meters
+ * @param types Item types to search for, NULL for all point items
+ * @param type_count Number of entries of types
+ * @return The new search
+ */
+struct poi_search *
+poi_search_new(struct mapset *ms, struct pcoord *center, int dist, enum item_type *types, int type_count)
+{
+	struct poi_search *this_=g_new0(struct poi_search, 1);
+	struct coord c;
+
+	this_->ms=ms;
+	c.x=center->x;
+	c.y=center->y;
+	transform_from_to(&c, center->pro, &this_->center, projection_mg);
+	this_->dist=dist;
+	if (types && type_count) {
+		this_->types=g_memdup(types, type_count*sizeof(*types));
+		this_->type_count=type_count;
+		qsort(this_->types, type_count, sizeof(*types), poi_search_type_compare);
+	}
+	return this_;
+}
+
+static int
+poi_search_type_matches(struct poi_search *this_, enum item_type type)
+{
+	if (!this_->types)
+		return type < type_line;
+	return bsearch(&type, this_->types, this_->type_count, sizeof(type), poi_search_type_compare) != NULL;
+}
+
+/**
+ * @brief Tells a POI search that all of its results will be read
+ *
+ * The whole area is then read at once instead of ring by ring.
+ *
+ * @param this_ The search
+ */
+void
+poi_search_read_all(struct poi_search *this_)
+{
+	this_->all=1;
+}
+
+static struct poi_search_candidate *
+poi_search_add(struct poi_search_candidate **list, int *count, int *size)
+{
+	if (*count == *size) {
+		*size=*size ? *size*2 : 64;
+		*list=g_renew(struct poi_search_candidate, *list, *size);
+	}
+	return &(*list)[(*count)++];
+}
+
+static int
+poi_search_in_rect(struct coord *center, int half, struct coord *c)
+{
+	return abs(c->x-center->x) <= half && abs(c->y-center->y) <= half;
+}
+
+/* Selects the rectangle of half size outer around center without the one of half size inner */
+static struct map_selection *
+poi_search_frame(struct coord *center, int inner, int outer)
+{
+	struct map_selection *ret=NULL,*sel;
+	int i;
+
+	for (i = 0 ; i < (inner ? 4 : 1) ; i++) {
+		sel=g_new0(struct map_selection, 1);
+		sel->order=18;
+		sel->range=item_range_all;
+		switch (i) {
+		case 0:
+			sel->u.c_rect.lu.x=center->x-outer;
+			sel->u.c_rect.lu.y=center->y+outer;
+			sel->u.c_rect.rl.x=center->x+outer;
+			sel->u.c_rect.rl.y=inner ? center->y+inner+1 : center->y-outer;
+			break;
+		case 1:
+			sel->u.c_rect.lu.x=center->x-outer;
+			sel->u.c_rect.lu.y=center->y-inner-1;
+			sel->u.c_rect.rl.x=center->x+outer;
+			sel->u.c_rect.rl.y=center->y-outer;
+			break;
+		case 2:
+			sel->u.c_rect.lu.x=center->x-outer;
+			sel->u.c_rect.lu.y=center->y+inner;
+			sel->u.c_rect.rl.x=center->x-inner-1;
+			sel->u.c_rect.rl.y=center->y-inner;
+			break;
+		case 3:
+			sel->u.c_rect.lu.x=center->x+inner+1;
+			sel->u.c_rect.lu.y=center->y+inner;
+			sel->u.c_rect.rl.x=center->x+outer;
+			sel->u.c_rect.rl.y=center->y-inner;
+			break;
+		}
+		sel->next=ret;
+		ret=sel;
+	}
+	return ret;
+}
+
+static void
+poi_search_read_ring(struct poi_search *this_, int outer)
+{
+	struct map_selection *sel,*selm;
+	struct mapset_handle *h;
+	struct map_rect *mr;
+	struct map *m;
+	struct item *item;
+	int half=outer*transform_scale(abs(this_->center.y)+outer*1.5);
+	int i,pending=0;
+
+	this_->candidate_count=0;
+	this_->candidate_pos=0;
+	for (i = 0 ; i < this_->pending_count ; i++) {
+		if (this_->pending[i].distance < outer)
+			*poi_search_add(&this_->candidates, &this_->candidate_count, &this_->candidate_size)=this_->pending[i];
+		else
+			this_->pending[pending++]=this_->pending[i];
+	}
+	this_->pending_count=pending;
+	sel=poi_search_frame(&this_->center, this_->half ? this_->half-POI_SEARCH_MARGIN : 0, half+POI_SEARCH_MARGIN);
+	h=mapset_open(this_->ms);
+	while (h && (m=mapset_next(h, 1))) {
+		selm=map_selection_dup_pro(sel, projection_mg, map_projection(m));
+		mr=map_rect_new(m, selm);
+		if (mr) {
+			while ((item=map_rect_get_item(mr))) {
+				struct poi_search_candidate *candidate;
+				struct coord c;
+				int d;
+				if (!poi_search_type_matches(this_, item->type))
+					continue;
+				if (!item_coord_get_pro(item, &c, 1, projection_mg))
+					continue;
+				/* Maps return more than selected, the items of the rectangle read before were seen already */
+				if (!poi_search_in_rect(&this_->center, half, &c) || (this_->half && poi_search_in_rect(&this_->center, this_->half, &c)))
+					continue;
+				d=transform_distance(projection_mg, &this_->center, &c);
+				if (d >= this_->dist)
+					continue;
+				if (d < outer)
+					candidate=poi_search_add(&this_->candidates, &this_->candidate_count, &this_->candidate_size);
+				else
+					candidate=poi_search_add(&this_->pending, &this_->pending_count, &this_->pending_size);
+				candidate->map=m;
+				candidate->id_hi=item->id_hi;
+				candidate->id_lo=item->id_lo;
+				candidate->type=item->type;
+				candidate->c=c;
+				candidate->distance=d;
+			}
+			map_rect_destroy(mr);
+		}
+		map_selection_destroy(selm);
+	}
+	if (h)
+		mapset_close(h);
+	map_selection_destroy(sel);
+	this_->half=half;
+	if (this_->candidate_count)
+		qsort(this_->candidates, this_->candidate_count, sizeof(*this_->candidates), poi_search_candidate_compare);
+	dbg(lvl_debug,"ring up to %d: %d candidates, %d for later rings\n", outer, this_->candidate_count, this_->pending_count);
+}
+
+static struct poi_search_candidate *
+poi_search_next(struct poi_search *this_)
+{
+	while (this_->candidate_pos == this_->candidate_count) {
+		int inner=this_->radius;
+		if (inner >= this_->dist)
+			return NULL;
+		this_->radius=inner ? inner*2 : POI_SEARCH_FIRST_RADIUS;
+		if (this_->all || this_->radius > this_->dist)
+			this_->radius=this_->dist;
+		poi_search_read_ring(this_, this_->radius);
+	}
+	return &this_->candidates[this_->candidate_pos++];
+}
+
+static void
+poi_search_free_results(struct poi_search *this_)
+{
+	int i;
+	for (i = 0 ; i < this_->result_count ; i++) {
+		g_free(this_->results[i].label);
+		g_free(this_->results[i].address);
+	}
+	this_->result_count=0;
+}
+
+/**
+ * @brief Returns the next results of a POI search, nearest first
+ *
+ * @param this_ The search
+ * @param count Maximum number of results to return
+ * @param results Set to the results, valid until the next call
+ * @return Number of results, 0 if all were returned
+ */
+int
+poi_search_get_results(struct poi_search *this_, int count, struct poi_search_result **results)
+{
+	struct poi_search_candidate *candidate;
+	struct map *mr_map=NULL;
+	struct map_rect *mr=NULL;
+
+	poi_search_free_results(this_);
+	while (this_->result_count < count && (candidate=poi_search_next(this_))) {
+		struct poi_search_result *result;
+		struct item *item;
+		struct attr attr;
+
+		if (this_->result_count == this_->result_size) {
+			this_->result_size=this_->result_size ? this_->result_size*2 : 16;
+			this_->results=g_renew(struct poi_search_result, this_->results, this_->result_size);
+		}
+		result=&this_->results[this_->result_count++];
+		result->type=candidate->type;
+		result->c=candidate->c;
+		result->distance=candidate->distance;
+		result->label=NULL;
+		result->address=NULL;
+		if (candidate->map != mr_map) {
+			if (mr)
+				map_rect_destroy(mr);
+			mr_map=candidate->map;
+			mr=map_rect_new(mr_map, NULL);
+		}
+		item=mr ? map_rect_get_item_byid(mr, candidate->id_hi, candidate->id_lo) : NULL;
+		if (item) {
+			if (item_attr_get(item, attr_label, &attr))
+				result->label=g_strdup(map_convert_string_tmp(item->map, attr.u.str));
+			result->address=navit_compose_item_address_string(item, 0);
+		}
+		if (!result->label)
+			result->label=g_strdup("");
+		if (!result->address)
+			result->address=g_strdup("");
+	}
+	if (mr)
+		map_rect_destroy(mr);
+	*results=this_->results;
+	return this_->result_count;
+}
+
+/**
+ * @brief Skips results of a POI search, e.g. to start at a later page
+ *
+ * @param this_ The search
+ * @param count Number of results to skip
+ * @return Number of skipped results, less than count if there are no more
+ */
+int
+poi_search_skip(struct poi_search *this_, int count)
+{
+	int skipped=0;
+	while (skipped < count && poi_search_next(this_))
+		skipped++;
+	return skipped;
+}
+
+void
+poi_search_destroy(struct poi_search *this_)
+{
+	poi_search_free_results(this_);
+	g_free(this_->results);
+	g_free(this_->candidates);
+	g_free(this_->pending);
+	g_free(this_->types);
+	g_free(this_);
+}
@@ -0,0 +1,55 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_POISEARCH_H
+#define NAVIT_POISEARCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A POI found by a POI search
+ *
+ * The strings are owned by the search and stay valid until the next call of
+ * poi_search_get_results().
+ */
+struct poi_search_result {
+	enum item_type type;
+	struct coord c;		/**< Position of the POI (projection_mg) */
+	int distance;		/**< Distance from the center of the search in meters */
+	char *label;		/**< Label of the POI, "" if it has none */
+	char *address;		/**< Address of the POI, see navit_compose_item_address_string() */
+};
+
+/* prototypes */
+struct mapset;
+struct pcoord;
+struct poi_search;
+struct poi_search *poi_search_new(struct mapset *ms, struct pcoord *center, int dist, enum item_type *types, int type_count);
+void poi_search_read_all(struct poi_search *this_);
+int poi_search_get_results(struct poi_search *this_, int count, struct poi_search_result **results);
+int poi_search_skip(struct poi_search *this_, int count);
+void poi_search_destroy(struct poi_search *this_);
+/* end of prototypes */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -71,6 +71,8 @@
 #include "vehicleprofile.h"
 #include "roadprofile.h"
 #include "debug.h"
+#include "benchmark.h"
+#include "counter.h"
 
 struct map_priv {
 	struct route *route;
@@ -259,6 +261,7 @@ struct route {
 	struct pcoord pc;
 	struct vehicle *v;
 	struct sel_point selp;
+	double reroute_start;		/**< Time the graph update started, while benchmarking */
 };
 
 /**
@@ -278,12 +281,17 @@ struct route_graph {
 	struct event_idle *idle_ev;			/**< The pointer to the idle event */
    	struct route_graph_segment *route_segments; /**< Pointer to the first route_graph_segment in the linked list of all segments */
 	struct route_graph_segment *avoid_seg;
+	double build_start;				/**< Time building the graph started, while collecting counters */
 #define HASH_SIZE 8192
 	struct route_graph_point *hash[HASH_SIZE];	/**< A hashtable containing all route_graph_points in this graph */
 };
 
 #define HASHCOORD(c) ((((c)->x +(c)->y) * 2654435761UL) & (HASH_SIZE-1))
 
+#define ROUTE_PREFETCH_LENGTH 20000	/**< Length of the route ahead whose map data is prefetched, in meters */
+#define ROUTE_PREFETCH_RECT 2000	/**< Maximum width and height of one prefetched rectangle */
+#define ROUTE_PREFETCH_MARGIN 500	/**< Margin around the route within the prefetched rectangles */
+
 /**
  * @brief Iterator to iterate through all route graph segments in a route graph point
  *
@@ -762,6 +770,59 @@ route_previous_destination(struct route *this)
 	return l->data;
 }
 
+/**
+ * @brief Prefetches the map data along the first part of a new route
+ *
+ * The route is covered by small rectangles, so that the detailed tiles which
+ * will be drawn and searched for the position while driving along it are
+ * read in the background.
+ *
+ * @param this The route
+ */
+static void
+route_path_prefetch(struct route *this)
+{
+	struct route_path_segment *seg;
+	struct map_selection *sel=NULL,*s=NULL;
+	struct mapset_handle *h;
+	struct map *m;
+	int i,len=0;
+
+	for (seg = this->path2->path ; seg && len < ROUTE_PREFETCH_LENGTH ; seg = seg->next) {
+		for (i = 0 ; i < seg->ncoords ; i++) {
+			struct coord *c=&seg->c[i];
+			if (s && (MAX(s->u.c_rect.rl.x, c->x)-MIN(s->u.c_rect.lu.x, c->x) <= ROUTE_PREFETCH_RECT) &&
+			    (MAX(s->u.c_rect.lu.y, c->y)-MIN(s->u.c_rect.rl.y, c->y) <= ROUTE_PREFETCH_RECT)) {
+				coord_rect_extend(&s->u.c_rect, c);
+				continue;
+			}
+			s=g_new0(struct map_selection, 1);
+			s->u.c_rect.lu=*c;
+			s->u.c_rect.rl=*c;
+			s->order=18;
+			s->range=item_range_all;
+			s->next=sel;
+			sel=s;
+		}
+		len+=seg->data->len;
+	}
+	for (s = sel ; s ; s = s->next) {
+		s->u.c_rect.lu.x-=ROUTE_PREFETCH_MARGIN;
+		s->u.c_rect.lu.y+=ROUTE_PREFETCH_MARGIN;
+		s->u.c_rect.rl.x+=ROUTE_PREFETCH_MARGIN;
+		s->u.c_rect.rl.y-=ROUTE_PREFETCH_MARGIN;
+	}
+	if (!sel)
+		return;
+	h=mapset_open(this->ms);
+	while ((m=mapset_next(h, 1))) {
+		if (map_projection(m) == projection_mg)
+			map_prefetch(m, sel);
+	}
+	mapset_close(h);
+	map_selection_destroy(sel);
+}
+
 static void
 route_path_update_done(struct route *this, int new_graph)
 {
@@ -813,11 +874,17 @@ route_path_update_done(struct route *this, int new_graph)
 		}
 		if (!new_graph && this->path2->updated)
 			route_status.u.num=route_status_path_done_incremental;
-		else
+		else {
 			route_status.u.num=route_status_path_done_new;
+			route_path_prefetch(this);
+		}
 	} else 
 		route_status.u.num=route_status_not_found;
 	this->link_path=0;
+	if (this->reroute_start) {
+		benchmark_add(benchmark_reroute, this->reroute_start);
+		this->reroute_start=0;
+	}
 	route_set_attr(this, &route_status);
 }
 
@@ -992,7 +1059,7 @@ struct map_selection *
 route_rect(int order, struct coord *c1, struct coord *c2, int rel, int abs)
 {
 	int dx,dy,sx=1,sy=1,d,m;
-	struct map_selection *sel=g_new(struct map_selection, 1);
+	struct map_selection *sel=g_new0(struct map_selection, 1);
 	if (!sel) {
 		printf("%s:Out of memory\n", __FUNCTION__);
 		return sel;
@@ -2348,6 +2415,7 @@ route_graph_flood(struct route_graph *this, struct route_info *dst, struct vehic
 	struct route_graph_segment *s=NULL;
 	int min,new,val;
 	struct fibheap *heap; /* This heap will hold all points with "temporarily" calculated costs */
+	double start=counter_enabled ? benchmark_time() : 0;
 
 	heap = fh_makekeyheap();   
 
@@ -2445,6 +2513,8 @@ route_graph_flood(struct route_graph *this, struct route_info *dst, struct vehic
 		}
 	}
 	fh_deleteheap(heap);
+	if (start)
+		counter_latency("route_flood", start);
 	callback_call_0(cb);
 	dbg(lvl_debug,"return\n");
 }
@@ -2841,6 +2911,8 @@ route_graph_build_done(struct route_graph *rg, int cancel)
 	rg->sel=NULL;
 	if (! cancel) {
 		route_graph_process_restrictions(rg);
+		if (rg->build_start)
+			counter_latency("route_build", rg->build_start);
 		callback_call_0(rg->done_cb);
 	}
 	rg->busy=0;
@@ -2895,6 +2967,8 @@ route_graph_build(struct mapset *ms, struct coord *c, int count, struct callback
 
 	dbg(lvl_debug,"enter\n");
 
+	if (counter_enabled)
+		ret->build_start=benchmark_time();
 	ret->sel=route_calc_selection(c, count, profile);
 	ret->h=mapset_open(ms);
 	ret->done_cb=done_cb;
@@ -2933,6 +3007,8 @@ route_graph_update(struct route *this, struct callback *cb, int async)
 	GList *tmp;
 
 	route_status.type=attr_route_status;
+	if (benchmark_enabled || counter_enabled)
+		this->reroute_start=benchmark_time();
 	route_graph_destroy(this->graph);
 	this->graph=NULL;
 	callback_destroy(this->route_graph_done_cb);
@@ -260,6 +260,8 @@ routech_find_nearest(struct mapset *ms, struct coord *c, struct item_id *id, str
 	sel.order=18;
 	sel.range.min=type_ch_node;
 	sel.range.max=type_ch_node;
+	sel.types=NULL;
+	sel.simplified=0;
 	sel.u.c_rect.lu.x=c->x-dst;
 	sel.u.c_rect.lu.y=c->y+dst;
 	sel.u.c_rect.rl.x=c->x+dst;
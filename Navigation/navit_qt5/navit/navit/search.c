@@ -40,12 +40,14 @@
 #include "android.h"
 #endif
 #include "layout.h"
+#include "benchmark.h"
 
 static struct search_list_result *search_list_result_dup(struct search_list_result *slr);
 static void search_list_country_destroy(struct search_list_country *this_);
 static void search_list_town_destroy(struct search_list_town *this_);
 static void search_list_street_destroy(struct search_list_street *this_);
 static void search_list_house_number_destroy(struct search_list_house_number *this_);
+static void search_list_result_destroy(int level, void *p);
 
 struct search_list_level {
 	struct mapset *ms;
@@ -56,6 +58,10 @@ struct search_list_level {
 	struct mapset_search *search;
 	GHashTable *hash;
 	GList *list,*curr,*last;
+	int complete;	/**< list holds all results of the last search at this level */
+	int refined;	/**< list was filtered from the previous results instead of searching the maps */
+	GList *refined_curr;
+	int fuzzy;	/**< list holds approximate matches, see search_list_fuzzy() */
 };
 
 struct search_list {
@@ -70,8 +76,12 @@ struct search_list {
 	struct house_number_interpolation inter;
 	int use_address_results;
 	GList *address_results,*address_results_pos;
+	double search_start;
 };
 
+/* Time in ms after the start of a search after which no more approximate matches are searched for */
+#define SEARCH_FUZZY_BUDGET 300
+
 static guint
 search_item_hash_hash(gconstpointer key)
 {
@@ -336,6 +346,86 @@ search_address_results_free(struct search_list *this_)
 	this_->address_results=this_->address_results_pos=NULL;
 }
 
+/**
+ * @brief Match a name of a result like the map search matched it.
+ *
+ * Mirrors binmap_search_get_item(): a name the map prepared for matching is compared as a plain
+ * prefix, the displayed name is also matched at word boundaries and with special characters expanded.
+ *
+ * @param slc result to match
+ * @param match_type attribute of slc holding the name prepared for matching, if the map gives one
+ * @param name displayed name
+ * @param str casefolded search string
+ * @return 1 if the name matches str
+ */
+static int
+search_list_name_match(struct search_list_common *slc, enum attr_type match_type, char *name, char *str)
+{
+	struct attr *match=attr_search(slc->attrs, NULL, match_type);
+	if (match)
+		return !linguistics_compare(match->u.str, str, linguistics_cmp_partial);
+	return name && !linguistics_compare(name, str, linguistics_cmp_partial|linguistics_cmp_expand|linguistics_cmp_words);
+}
+
+static int
+search_list_refined_match(int level, struct search_list_common *slc, char *str)
+{
+	if (level == 1)
+		return search_list_name_match(slc, attr_town_name_match, slc->town_name, str) ||
+			search_list_name_match(slc, attr_district_name_match, slc->district_name, str);
+	return search_list_name_match(slc, attr_street_name_match, ((struct search_list_street *)slc)->name, str);
+}
+
+/**
+ * @brief Try to answer a search by filtering the results of the previous one.
+ *
+ * While a name is typed, each search usually extends the previous search string. If the previous
+ * partial search of the same type on this level ran to completion, every new match is already in
+ * its result list, so the list is filtered instead of searching the maps again.
+ *
+ * @param this_ search_list representing the search
+ * @param level search list level of search_attr
+ * @param search_attr attribute to search for
+ * @param partial do partial search?
+ * @return 1 if the results of the level have been refined, 0 if a new search is required
+ */
+static int
+search_list_refine(struct search_list *this_, int level, struct attr *search_attr, int partial)
+{
+	struct search_list_level *le=&this_->levels[level];
+	char *prev,*str;
+	GList *curr,*next;
+	int ret=0;
+
+	/* Towns and streets are matched by name only, other levels depend on more than that */
+	if ((level != 1 && level != 2) || !le->complete || le->fuzzy || !partial || !le->partial || !le->attr ||
+	    le->attr->type != search_attr->type)
+		return 0;
+	prev=linguistics_casefold(le->attr->u.str);
+	str=linguistics_casefold(search_attr->u.str);
+	if (!strncmp(str, prev, strlen(prev))) {
+		curr=le->list;
+		while (curr) {
+			next=g_list_next(curr);
+			if (!search_list_refined_match(level, curr->data, str)) {
+				search_list_result_destroy(level, curr->data);
+				le->list=g_list_delete_link(le->list, curr);
+			}
+			curr=next;
+		}
+		attr_free(le->attr);
+		le->attr=attr_dup(search_attr);
+		le->curr=NULL;
+		le->last=NULL;
+		le->refined=1;
+		le->refined_curr=le->list;
+		ret=1;
+	}
+	g_free(prev);
+	g_free(str);
+	return ret;
+}
+
 /**
  * @brief Start a search.
  *
@@ -358,10 +448,17 @@ search_list_search(struct search_list *this_, struct attr *search_attr, int part
 	this_->use_address_results=0;
 	level=search_list_level(search_attr->type);
 	this_->item=NULL;
+	this_->search_start=benchmark_time();
 	house_number_interpolation_clear_all(&this_->inter);
 	if (level != -1) {
+		int i;
 		this_->result.id=0;
 		this_->level=level;
+		/* Results of the levels below depend on the results of this one */
+		for (i = level+1 ; i < sizeof(this_->levels)/sizeof(this_->levels[0]) ; i++)
+			this_->levels[i].complete=0;
+		if (search_list_refine(this_, level, search_attr, partial))
+			return;
 		le=&this_->levels[level];
 		search_list_search_free(this_, level);
 		le->attr=attr_dup(search_attr);
@@ -371,8 +468,11 @@ search_list_search(struct search_list *this_, struct attr *search_attr, int part
 			le->curr=le->list;
 		}
 	} else if (search_attr->type == attr_postal) {
+		int i;
 		g_free(this_->postal);
 		this_->postal=g_strdup(search_attr->u.str);
+		for (i = 0 ; i < sizeof(this_->levels)/sizeof(this_->levels[0]) ; i++)
+			this_->levels[i].complete=0;
 	}
 }
 
@@ -392,6 +492,8 @@ search_list_select(struct search_list *this_, enum attr_type attr_type, int id,
 	curr=le->list;
 	if (mode > 0 || !id)
 		le->selected=mode;
+	for (num = level+1 ; num < sizeof(this_->levels)/sizeof(this_->levels[0]) ; num++)
+		this_->levels[num].complete=0;
 	//dbg(lvl_debug,"enter level=%d %d %d %p\n", level, id, mode, curr);
 	num = 0;
 	while (curr) {
@@ -414,27 +516,29 @@ search_list_select(struct search_list *this_, enum attr_type attr_type, int id,
 static void
 search_list_common_addattr(struct attr* attr,struct search_list_common *common)
 {
+	/* The names live in the data blocks of the store, so they stay valid when the store grows */
+	char *str=attr_store_add(&common->attr_store,attr)->u.str;
 
-	common->attrs=attr_generic_prepend_attr(common->attrs,attr);
+	common->attrs=attr_store_get_list(&common->attr_store);
 	switch(attr->type) {
 		case attr_town_name:
-			common->town_name=common->attrs[0]->u.str;
+			common->town_name=str;
 			break;
 		case attr_county_name:
-			common->county_name=common->attrs[0]->u.str;
+			common->county_name=str;
 			break;
 		case attr_district_name:
-			common->district_name=common->attrs[0]->u.str;
+			common->district_name=str;
 			break;
 		case attr_postal:
-			common->postal=common->attrs[0]->u.str;
+			common->postal=str;
 			break;
 		case attr_town_postal:
 			if(!common->postal)
-				common->postal=common->attrs[0]->u.str;
+				common->postal=str;
 			break;
 		case attr_postal_mask:
-			common->postal_mask=common->attrs[0]->u.str;
+			common->postal_mask=str;
 			break;
 		default:
 			break;
@@ -455,6 +559,9 @@ search_list_common_new(struct item *item, struct search_list_common *common)
 		attr_postal,
 		attr_town_postal,
 		attr_postal_mask,
+		attr_town_name_match,
+		attr_district_name_match,
+		attr_street_name_match,
 		attr_none
 	};
 
@@ -463,7 +570,8 @@ search_list_common_new(struct item *item, struct search_list_common *common)
 	common->county_name=NULL;
 	common->postal=NULL;
 	common->postal_mask=NULL;
-	common->attrs=NULL;
+	attr_store_init(&common->attr_store, 0);
+	common->attrs=attr_store_get_list(&common->attr_store);
 
 	for(i=0;common_attrs[i];i++) {
 		if (item_attr_get(item, common_attrs[i], &attr)) {
@@ -481,10 +589,10 @@ search_list_common_dup(struct search_list_common *src, struct search_list_common
 {
 	int i;
 
-	if(dst->attrs) {
-		for(i=0;dst->attrs[i];i++)
-			search_list_common_addattr(src->attrs[i],dst);
-	}
+	attr_store_init(&dst->attr_store, 0);
+	dst->attrs=attr_store_get_list(&dst->attr_store);
+	for(i=0;src->attrs && src->attrs[i];i++)
+		search_list_common_addattr(src->attrs[i],dst);
 
 	if (src->c) {
 		dst->c=g_new(struct pcoord, 1);
@@ -497,7 +605,7 @@ static void
 search_list_common_destroy(struct search_list_common *common)
 {
 	g_free(common->c);
-	attr_list_free(common->attrs);
+	attr_store_clear(&common->attr_store);
 
 	common->town_name=NULL;
 	common->district_name=NULL;
@@ -753,6 +861,10 @@ search_list_search_free(struct search_list *sl, int level)
 	le->list=NULL;
 	le->curr=NULL;
 	le->last=NULL;
+	le->complete=0;
+	le->refined=0;
+	le->refined_curr=NULL;
+	le->fuzzy=0;
 }
 
 char *
@@ -838,6 +950,133 @@ search_add_result(struct search_list_level *le, struct search_list_common *slc)
 	return 0;
 }
 
+static int
+search_list_item_postal_match(struct search_list *this_, struct item *item)
+{
+	struct attr postal;
+	if (!this_->postal)
+		return 1;
+	if (item_attr_get(item, attr_postal_mask, &postal))
+		return postal_match(this_->postal, postal.u.str);
+	if (item_attr_get(item, attr_postal, &postal))
+		return !strcmp(this_->postal, postal.u.str);
+	return 1;
+}
+
+static int
+search_list_fuzzy_distance(int level, struct linguistics_fuzzy *fuzzy, struct search_list_common *slc, int partial)
+{
+	enum linguistics_cmp_mode mode=linguistics_cmp_expand|linguistics_cmp_words|(partial?linguistics_cmp_partial:0);
+	char *name=level == 1 ? slc->town_name : ((struct search_list_street *)slc)->name;
+	int distance,ret=-1;
+
+	if (name)
+		ret=linguistics_fuzzy_distance(fuzzy, name, mode);
+	if (level == 1 && slc->district_name && (distance=linguistics_fuzzy_distance(fuzzy, slc->district_name, mode)) >= 0 &&
+	    (ret < 0 || distance < ret))
+		ret=distance;
+	return ret;
+}
+
+static gint
+search_list_distance_compare(gconstpointer a, gconstpointer b)
+{
+	return ((const struct search_list_common *)a)->distance-((const struct search_list_common *)b)->distance;
+}
+
+/**
+ * @brief Search the maps for approximate matches.
+ *
+ * Called when a town or street search found nothing, e.g. because of a typo. The maps are
+ * searched again with map_search_fuzzy, and the matches are ranked by edit distance and
+ * then returned like refined results. Once SEARCH_FUZZY_BUDGET ms have passed since the
+ * search was started, no more parents are searched, so slow devices return fewer matches
+ * instead of blocking.
+ *
+ * @param this_ search_list representing the search
+ * @param level search list level to search
+ * @return 1 if the level holds approximate matches now, 0 if the search string is not suitable
+ */
+static int
+search_list_fuzzy(struct search_list *this_, int level)
+{
+	struct search_list_level *le=&this_->levels[level],*leu;
+	struct linguistics_fuzzy *fuzzy;
+	GList *curr;
+	double deadline;
+	int timeout=0;
+	char *str;
+
+	if ((level != 1 && level != 2) || le->fuzzy || le->list || !le->attr)
+		return 0;
+	str=linguistics_casefold(le->attr->u.str);
+	fuzzy=linguistics_fuzzy_new(str, -1);
+	g_free(str);
+	if (!fuzzy)
+		return 0;
+	le->fuzzy=1;
+	deadline=(this_->search_start ? this_->search_start : benchmark_time())+SEARCH_FUZZY_BUDGET;
+	leu=&this_->levels[level-1];
+	le->hash=g_hash_table_new(search_item_hash_hash, search_item_hash_equal);
+	for (curr=leu->list ; curr && !timeout ; curr=g_list_next(curr)) {
+		struct search_list_common *parent=curr->data;
+		struct mapset_search *search;
+		struct item *item;
+
+		if (parent->selected != leu->selected)
+			continue;
+		search=mapset_search_new(this_->ms, &parent->item, le->attr, (le->partial?map_search_partial:0)|map_search_fuzzy);
+		while (!timeout && (item=mapset_search_get_item(search))) {
+			struct search_list_common *slc;
+			timeout=benchmark_time() >= deadline;
+			if (!search_list_item_postal_match(this_, item))
+				continue;
+			if (level == 1)
+				slc=(struct search_list_common *)search_list_town_new(item);
+			else
+				slc=(struct search_list_common *)search_list_street_new(item);
+			slc->parent=parent;
+			/* Map plugins without approximate search return partial matches instead */
+			slc->distance=search_list_fuzzy_distance(level, fuzzy, slc, le->partial);
+			if (slc->distance < 0 || !search_add_result(le, slc))
+				search_list_result_destroy(level, slc);
+		}
+		mapset_search_destroy(search);
+	}
+	g_hash_table_destroy(le->hash);
+	le->hash=NULL;
+	linguistics_fuzzy_destroy(fuzzy);
+	if (timeout)
+		dbg(lvl_info,"approximate search for '%s' stopped after %d ms\n", le->attr->u.str, SEARCH_FUZZY_BUDGET);
+	le->list=g_list_sort(le->list, search_list_distance_compare);
+	le->refined=1;
+	le->refined_curr=le->list;
+	return 1;
+}
+
+static int
+search_list_has_parent(struct search_list_level *leu)
+{
+	GList *curr;
+	for (curr=leu->curr ; curr ; curr=g_list_next(curr)) {
+		struct search_list_common *slc=curr->data;
+		if (!slc || slc->selected == leu->selected)
+			return 1;
+	}
+	return 0;
+}
+
+static void
+search_list_finished(struct search_list *this_, struct search_list_level *le)
+{
+	if (this_->search_start) {
+		dbg(lvl_debug,"search for '%s' %s: %d results in %lld ms\n", le->attr ? le->attr->u.str : "",
+			le->fuzzy ? "searched approximate matches" : (le->refined ? "refined previous results" : "searched maps"),
+			this_->result.id, (long long)(benchmark_time()-this_->search_start));
+		this_->search_start=0;
+	}
+}
+
 /**
  * @brief Get (next) result from a search.
  *
@@ -864,6 +1103,30 @@ search_list_get_result(struct search_list *this_)
 	//dbg(lvl_debug,"enter\n");
 	le=&this_->levels[level];
 	//dbg(lvl_debug,"le=%p\n", le);
+	if (le->refined) {
+		struct search_list_common *slc;
+		/* Refining a search without results cannot find anything either */
+		if (!le->refined_curr && !this_->result.id)
+			search_list_fuzzy(this_, level);
+		if (!le->refined_curr) {
+			search_list_finished(this_, le);
+			return NULL;
+		}
+		slc=le->refined_curr->data;
+		le->refined_curr=g_list_next(le->refined_curr);
+		this_->result.house_number=NULL;
+		if (level == 1) {
+			this_->result.town=(struct search_list_town *)slc;
+			this_->result.street=NULL;
+		} else {
+			this_->result.street=(struct search_list_street *)slc;
+			this_->result.town=slc->parent;
+		}
+		this_->result.country=this_->result.town->common.parent;
+		this_->result.c=slc->c;
+		this_->result.id++;
+		return &this_->result;
+	}
 	for (;;)
 	{
 		//dbg(lvl_debug,"le->search=%p\n", le->search);
@@ -883,6 +1146,10 @@ search_list_get_result(struct search_list *this_)
 					struct search_list_common *slc;
 					if (! leu->curr)
 					{
+						if (!this_->result.id && search_list_fuzzy(this_, level))
+							return search_list_get_result(this_);
+						le->complete=1;
+						search_list_finished(this_, le);
 						return NULL;
 					}
 					le->parent=leu->curr->data;
@@ -1030,8 +1297,13 @@ search_list_get_result(struct search_list *this_)
 			mapset_search_destroy(le->search);
 			le->search=NULL;
 			g_hash_table_destroy(le->hash);
-			if (! level)
+			/* All results are in the list once the search of the last parent is exhausted */
+			if (!level || !search_list_has_parent(&this_->levels[level-1]))
+				le->complete=1;
+			if (! level) {
+				search_list_finished(this_, le);
 				break;
+			}
 		}
 	}
 	return NULL;
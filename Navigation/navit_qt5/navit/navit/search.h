@@ -33,7 +33,9 @@ struct search_list_common {
 	char *postal;
 	char *postal_mask;
 	char *county_name;
-	struct attr **attrs;
+	struct attr **attrs;		/**< Attributes of attr_store */
+	struct attr_store attr_store;
+	int distance;	/**< Edit distance of approximate matches, 0 for exact matches */
 };
 
 struct search_list_country {
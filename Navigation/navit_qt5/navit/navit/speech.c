@@ -24,11 +24,27 @@
 #include "speech.h"
 #include "plugin.h"
 #include "xmlconfig.h"
+#include "callback.h"
+#include "event.h"
+#include "benchmark.h"
+#include "counter.h"
+
+/* How often a busy plugin is asked whether it is done, in ms */
+#define SPEECH_POLL_INTERVAL 100
+
+struct speech_utterance {
+	char *text;
+	enum speech_priority priority;
+	double queued;			/**< Time the announcement was queued, while benchmarking */
+};
 
 struct speech {
 	NAVIT_OBJECT;
 	struct speech_priv *priv;
 	struct speech_methods meth;
+	GList *queue;			/**< Announcements not handed to the plugin yet, highest priority first */
+	struct callback *poll_cb;
+	struct event_timeout *poll;
 };
 
 
@@ -64,19 +80,120 @@ speech_new(struct attr *parent, struct attr **attrs)
 	return this_;
 }
 
+static void
+speech_utterance_destroy(struct speech_utterance *utterance)
+{
+	g_free(utterance->text);
+	g_free(utterance);
+}
+
 void
 speech_destroy(struct speech *this_)
 {
+	if (this_->poll)
+		event_remove_timeout(this_->poll);
+	callback_destroy(this_->poll_cb);
+	g_list_foreach(this_->queue, (GFunc)speech_utterance_destroy, NULL);
+	g_list_free(this_->queue);
 	if (this_->priv)
 		this_->meth.destroy(this_->priv);
 	navit_object_destroy((struct navit_object *)this_);
 }
 
+static int
+speech_busy(struct speech *this_)
+{
+	return this_->meth.busy && this_->meth.busy(this_->priv);
+}
+
+static int
+speech_say_plugin(struct speech *this_, const char *text, enum speech_priority priority)
+{
+	dbg(lvl_debug, "this_=%p text='%s' priority %d\n", this_, text, priority);
+	if (this_->meth.say_priority)
+		return this_->meth.say_priority(this_->priv, text, priority);
+	return this_->meth.say(this_->priv, text);
+}
+
+/* Hands the first queued announcement to the plugin once it is done with the last one */
+static void
+speech_poll(struct speech *this_)
+{
+	struct speech_utterance *utterance;
+
+	if (this_->queue && speech_busy(this_))
+		return;
+	if (this_->queue) {
+		utterance=this_->queue->data;
+		this_->queue=g_list_delete_link(this_->queue, this_->queue);
+		if (utterance->queued)
+			benchmark_add(benchmark_speech, utterance->queued);
+		speech_say_plugin(this_, utterance->text, utterance->priority);
+		speech_utterance_destroy(utterance);
+	}
+	if (!this_->queue) {
+		event_remove_timeout(this_->poll);
+		this_->poll=NULL;
+	}
+}
+
+/**
+ * @brief Says an announcement, or queues it while the plugin is busy
+ *
+ * Plugins which can tell when they are still speaking the last text implement busy(),
+ * everything else is handed to the plugin at once. Calling a busy plugin would block
+ * the caller, e.g. the navigation update, until the plugin is done, so announcements
+ * wait in a queue ordered by priority instead. An announcement of a text which is
+ * already waiting is dropped, and a maneuver drops the maneuvers still waiting as
+ * they are stale.
+ *
+ * @param this_ The speech object
+ * @param text The text to say
+ * @param priority Priority of the announcement
+ * @return The result of the plugin if it was called right away, 0 if the announcement was queued
+ */
+int
+speech_say_priority(struct speech *this_, const char *text, enum speech_priority priority)
+{
+	struct speech_utterance *utterance;
+	GList *l,*next;
+
+	if (!this_->queue && !speech_busy(this_))
+		return speech_say_plugin(this_, text, priority);
+	for (l = this_->queue ; l ; l = next) {
+		next=g_list_next(l);
+		utterance=l->data;
+		if (!strcmp(utterance->text, text)) {
+			if (utterance->priority >= priority)
+				return 0;
+		} else if (priority != speech_priority_maneuver || utterance->priority != speech_priority_maneuver)
+			continue;
+		dbg(lvl_debug, "dropping '%s'\n", utterance->text);
+		speech_utterance_destroy(utterance);
+		this_->queue=g_list_delete_link(this_->queue, l);
+	}
+	utterance=g_new0(struct speech_utterance, 1);
+	utterance->text=g_strdup(text);
+	utterance->priority=priority;
+	if (benchmark_enabled || counter_enabled)
+		utterance->queued=benchmark_time();
+	for (l = this_->queue ; l ; l = g_list_next(l)) {
+		if (((struct speech_utterance *)l->data)->priority < priority)
+			break;
+	}
+	this_->queue=g_list_insert_before(this_->queue, l, utterance);
+	if (!this_->poll) {
+		if (!this_->poll_cb)
+			this_->poll_cb=callback_new_1(callback_cast(speech_poll), this_);
+		this_->poll=event_add_timeout(SPEECH_POLL_INTERVAL, 1, this_->poll_cb);
+	}
+	return 0;
+}
+
 int
 speech_say(struct speech *this_, const char *text)
 {
-	dbg(lvl_debug, "this_=%p text='%s' calling %p\n", this_, text, this_->meth.say);
-	return (this_->meth.say)(this_->priv, text);
+	return speech_say_priority(this_, text, speech_priority_info);
 }
 
 struct attr active=ATTR_INT(active, 1);
@@ -23,14 +23,30 @@
 struct speech_priv;
 struct attr_iter;
 
+/**
+ * @brief Priority of an announcement
+ *
+ * Announcements queued while the plugin is busy are spoken in order of priority, a newer
+ * maneuver replaces a maneuver that has not been spoken yet.
+ */
+enum speech_priority {
+	speech_priority_info,		/**< Messages, route status and other information */
+	speech_priority_maneuver,	/**< Navigation announcements */
+};
+
 struct speech_methods {
 	void (*destroy)(struct speech_priv *this_);
 	int (*say)(struct speech_priv *this_, const char *text);
+	/** Optional, used instead of say for plugins which can prioritize themselves */
+	int (*say_priority)(struct speech_priv *this_, const char *text, enum speech_priority priority);
+	/** Optional, returns whether the last text is still being spoken, announcements are queued meanwhile */
+	int (*busy)(struct speech_priv *this_);
 };
 
 /* prototypes */
 struct speech * speech_new(struct attr *parent, struct attr **attrs);
 int speech_say(struct speech *this_, const char *text);
+int speech_say_priority(struct speech *this_, const char *text, enum speech_priority priority);
 int speech_sayf(struct speech *this_, const char *format, ...);
 void speech_destroy(struct speech *this_);
 int speech_get_attr(struct speech *this_, enum attr_type type, struct attr *attr, struct attr_iter *iter);
@@ -198,6 +198,12 @@ speechd_say(struct speech_priv *this, const char *text)
 	return 0;
 }
 
+/* The text is still spoken while the last spawned process runs */
+static int
+speechd_busy(struct speech_priv *this)
+{
+	return this->spi && spawn_process_check_status(this->spi, 0) == -1;
+}
 
 static void 
 speechd_destroy(struct speech_priv *this) {
@@ -217,6 +223,8 @@ speechd_destroy(struct speech_priv *this) {
 static struct speech_methods speechd_meth = {
 	speechd_destroy,
 	speechd_say,
+	NULL,
+	speechd_busy,
 };
 
 static struct speech_priv *
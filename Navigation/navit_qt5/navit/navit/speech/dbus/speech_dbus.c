@@ -32,22 +32,31 @@ struct speech_priv {
 };
 
 static int 
-speech_dbus_say(struct speech_priv *this, const char *text)
+speech_dbus_say_priority(struct speech_priv *this, const char *text, enum speech_priority priority)
 {
-	struct attr attr1,attr2,cb,*attr_list[3];
+	struct attr attr1,attr2,attr3,cb,*attr_list[4];
 	int valid=0;
 	attr1.type=attr_type;
 	attr1.u.str="speech";
 	attr2.type=attr_data;
 	attr2.u.str=(char *)text;
+	attr3.type=attr_priority;
+	attr3.u.num=priority;
 	attr_list[0]=&attr1;
 	attr_list[1]=&attr2;
-	attr_list[2]=NULL;
+	attr_list[2]=&attr3;
+	attr_list[3]=NULL;
 	if (navit_get_attr(this->nav, attr_callback_list, &cb, NULL))
 		callback_list_call_attr_4(cb.u.callback_list, attr_command, "dbus_send_signal", attr_list, NULL, &valid);
 	return 0;
 }
 
+static int 
+speech_dbus_say(struct speech_priv *this, const char *text)
+{
+	return speech_dbus_say_priority(this, text, speech_priority_info);
+}
+
 static void 
 speech_dbus_destroy(struct speech_priv *this) {
 	g_free(this);
@@ -56,6 +65,7 @@ speech_dbus_destroy(struct speech_priv *this) {
 static struct speech_methods speech_dbus_meth = {
 	speech_dbus_destroy,
 	speech_dbus_say,
+	speech_dbus_say_priority,
 };
 
 static struct speech_priv *
@@ -46,6 +46,9 @@
 #include "atom.h"
 #include "command.h"
 #include "geom.h"
+#include "benchmark.h"
+#include "trace.h"
+#include "counter.h"
 #ifdef HAVE_API_WIN32_CE
 #include <windows.h>
 #include <winbase.h>
@@ -60,10 +63,14 @@ print_usage(void)
 {
 	printf("%s",_("navit usage:\n"
 	"navit [options] [configfile]\n"
+	"\t-b <file>: write timings of tracking, rerouting, redraws and speech to <file> at exit (- for stdout).\n"
 	"\t-c <file>: use <file> as config file, instead of using the default file.\n"
+	"\t-C <file>: cache the parsed config file in <file> and load it from there while the config files are unchanged.\n"
 	"\t-d <n>: set the global debug output level to <n> (0=error, 1=warning, 2=info, 3=debug).\n"
 	"\tSettings from config file will still take effect where they set a higher level.\n"
 	"\t-h: print this usage info and exit.\n"
+	"\t-p <n>: collect performance counters and log them every <n> seconds (0: only collect them, to be read over D-Bus).\n"
+	"\t-t <file>: write a trace of the startup phases to <file> (- for stdout), for chrome://tracing.\n"
 	"\t-v: print the version and exit.\n"));
 }
 
@@ -76,9 +83,11 @@ int main_real(int argc, char * const* argv)
 {
 	xmlerror *error = NULL;
 	char *config_file = NULL, *command=NULL, *startup_file=NULL;
-	int opt;
+	int opt,result;
 	char *cp;
 	struct attr navit, conf;
+	double start;
+	int counter_interval=-1;
 
 	GList *list = NULL, *li;
 	main_argc=argc;
@@ -122,7 +131,7 @@ int main_real(int argc, char * const* argv)
 		argc=1;
 	if (argc > 1) {
 		/* Don't forget to update the manpage if you modify theses options */
-		while((opt = getopt(argc, argv, ":hvc:d:e:s:")) != -1) {
+		while((opt = getopt(argc, argv, ":hvb:c:C:d:e:p:s:t:")) != -1) {
 			switch(opt) {
 			case 'h':
 				print_usage();
@@ -132,19 +141,31 @@ int main_real(int argc, char * const* argv)
 				printf("%s %s\n", "navit", version);
 				exit(0);
 				break;
+			case 'b':
+				benchmark_init(optarg);
+				break;
 			case 'c':
 				printf("config file n is set to `%s'\n", optarg);
 	            config_file = optarg;
 				break;
+			case 'C':
+				config_set_cache(optarg);
+				break;
 			case 'd':
 				debug_set_global_level(atoi(optarg), 1);
 				break;
 			case 'e':
 				command=optarg;
 				break;
+			case 'p':
+				counter_interval=atoi(optarg);
+				break;
 			case 's':
 				startup_file=optarg;
 				break;
+			case 't':
+				trace_init(optarg);
+				break;
 #ifdef HAVE_GETOPT_H
 			case ':':
 				fprintf(stderr, "navit: Error - Option `%c' needs a value\n", optopt);
@@ -193,7 +214,10 @@ int main_real(int argc, char * const* argv)
 	}
 
 	dbg(lvl_debug,"Loading %s\n",config_file);
-	if (!config_load(config_file, &error)) {
+	start=trace_enabled ? benchmark_time() : 0;
+	result=config_load(config_file, &error);
+	trace_span("config", config_file, start);
+	if (!result) {
 		dbg(lvl_error, _("Error parsing config file '%s': %s\n"), config_file, error ? error->message : "");
 	} else {
 		dbg(lvl_info, _("Using config file '%s'\n"), config_file);
@@ -231,6 +255,9 @@ int main_real(int argc, char * const* argv)
 	if (command) {
 		command_evaluate(&conf, command);
 	}
+	/* Logging needs the event system, which is only available now */
+	if (counter_interval >= 0)
+		counter_init(counter_interval);
 	event_main_loop_run();
 
 	/* TODO: Android actually has no event loop, so we can't free all allocated resources here. Have to find better place to
@@ -0,0 +1,148 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of struct attr_store. The allocation counts are those navit -b
+ * reports in its "attr" line.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "config.h"
+#include "item.h"
+#include "coord.h"
+#include "attr.h"
+#include "benchmark.h"
+#include "navit_test.h"
+
+#define ATTR_TEST_ROUNDS 20
+
+static void
+attr_test_make(int i, char *buffer, struct coord_geo *g, struct attr *label, struct attr *position, struct attr *distance)
+{
+	sprintf(buffer, "name%d", i%3);
+	label->type=attr_label;
+	label->u.str=buffer;
+	g->lat=i;
+	g->lng=i*2;
+	position->type=attr_position_coord_geo;
+	position->u.coord_geo=g;
+	distance->type=attr_static_distance;
+	distance->u.num=i;
+}
+
+/* Content is copied, the strings stay valid while the store grows */
+static void
+attr_test_store_copy(void)
+{
+	struct attr_store store;
+	struct attr label,position,distance,**list;
+	struct coord_geo g;
+	char buffer[32],*first;
+	int i;
+
+	attr_store_init(&store, 0);
+	for (i = 0 ; i < ATTR_TEST_ROUNDS ; i++) {
+		attr_test_make(i, buffer, &g, &label, &position, &distance);
+		first=attr_store_add(&store, &label)->u.str;
+		attr_store_add(&store, &position);
+		attr_store_add(&store, &distance);
+		test_assert(first != buffer);
+	}
+	strcpy(buffer, "changed");
+	g.lat=-1;
+	list=attr_store_get_list(&store);
+	for (i = 0 ; i < ATTR_TEST_ROUNDS ; i++) {
+		char expected[32];
+		sprintf(expected, "name%d", i%3);
+		test_assert(list[i*3]->type == attr_label && !strcmp(list[i*3]->u.str, expected));
+		test_assert(list[i*3+1]->u.coord_geo->lat == i && list[i*3+1]->u.coord_geo->lng == i*2);
+		test_assert(list[i*3+2]->u.num == i);
+	}
+	test_assert(list[ATTR_TEST_ROUNDS*3] == NULL);
+	attr_store_clear(&store);
+	test_assert(attr_store_get_list(&store)[0] == NULL);
+}
+
+/* A borrowing store references the content as it is */
+static void
+attr_test_store_borrow(void)
+{
+	struct attr_store store;
+	struct attr label;
+	char buffer[]="borrowed";
+
+	attr_store_init(&store, 1);
+	label.type=attr_label;
+	label.u.str=buffer;
+	test_assert(attr_store_add(&store, &label)->u.str == buffer);
+	attr_store_clear(&store);
+}
+
+/* 60 attributes need 10 allocations in a store, but 160 with attr_generic_add_attr() */
+static void
+attr_test_allocations(void)
+{
+	struct attr_store store;
+	struct attr label,position,distance,**list=NULL;
+	struct attr_stats before,after;
+	struct coord_geo g;
+	char buffer[32];
+	int i,store_allocs,list_allocs;
+
+	benchmark_enabled=1;
+	attr_get_stats(&before);
+	attr_store_init(&store, 0);
+	for (i = 0 ; i < ATTR_TEST_ROUNDS ; i++) {
+		attr_test_make(i, buffer, &g, &label, &position, &distance);
+		attr_store_add(&store, &label);
+		attr_store_add(&store, &position);
+		attr_store_add(&store, &distance);
+	}
+	attr_store_clear(&store);
+	attr_get_stats(&after);
+	store_allocs=after.allocs-before.allocs;
+	test_assert(after.strings-before.strings == ATTR_TEST_ROUNDS);
+
+	before=after;
+	for (i = 0 ; i < ATTR_TEST_ROUNDS ; i++) {
+		attr_test_make(i, buffer, &g, &label, &position, &distance);
+		list=attr_generic_add_attr(list, &label);
+		list=attr_generic_add_attr(list, &position);
+		list=attr_generic_add_attr(list, &distance);
+	}
+	attr_list_free(list);
+	attr_get_stats(&after);
+	list_allocs=after.allocs-before.allocs;
+	benchmark_enabled=0;
+
+	printf("%d attributes: %d allocations in a store, %d with attr_generic_add_attr()\n", ATTR_TEST_ROUNDS*3, store_allocs, list_allocs);
+	test_assert(store_allocs <= 10);
+	test_assert(list_allocs >= 160);
+}
+
+int
+main(int argc, char **argv)
+{
+	test_init(argv[0]);
+	attr_test_store_copy();
+	attr_test_store_borrow();
+	attr_test_allocations();
+	return 0;
+}
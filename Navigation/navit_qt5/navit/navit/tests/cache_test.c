@@ -0,0 +1,193 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of struct cache, with ids shaped like those of the file cache.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "cache.h"
+#include "navit_test.h"
+
+#define CACHE_TEST_DATA 200
+#define CACHE_TEST_BUDGET (64*1024)
+#define CACHE_TEST_THREADS 4
+
+struct cache_test_id {
+	int key,a,b,c,d;
+};
+
+/* Fills in the data before cache_insert(), as other threads may look it up right after */
+static void
+cache_test_put(struct cache *cache, int key)
+{
+	struct cache_test_id id={key,1,2,3,4};
+	int *data=cache_entry_new(cache, &id, CACHE_TEST_DATA);
+	data[0]=key;
+	cache_insert(cache, data);
+	cache_entry_destroy(cache, data);
+}
+
+/* Returns whether key is cached, checking that the data belongs to it */
+static int
+cache_test_get(struct cache *cache, int key)
+{
+	struct cache_test_id id={key,1,2,3,4};
+	int *data=cache_lookup(cache, &id);
+	if (!data)
+		return 0;
+	test_assert(data[0] == key);
+	cache_entry_destroy(cache, data);
+	return 1;
+}
+
+/* The budget is split between the shards, and inserted data is found again */
+static void
+cache_test_basic(int shards)
+{
+	struct cache *cache=cache_new(sizeof(struct cache_test_id), CACHE_TEST_BUDGET, shards);
+	struct cache_test_id id={1,1,2,3,4};
+	struct cache_stats stats;
+	int i;
+
+	cache_stats(cache, &stats);
+	test_assert(stats.shards == shards);
+	test_assert(stats.budget == CACHE_TEST_BUDGET);
+	for (i = 0 ; i < 16 ; i++)
+		cache_test_put(cache, i);
+	for (i = 0 ; i < 16 ; i++)
+		test_assert(cache_test_get(cache, i));
+	test_assert(!cache_test_get(cache, 16));
+	cache_flush(cache, &id);
+	test_assert(!cache_test_get(cache, 1));
+	cache_stats(cache, &stats);
+	test_assert(stats.hits == 16 && stats.misses == 16);
+}
+
+/* However many shards, the cached data stays within the budget */
+static void
+cache_test_budget(int shards)
+{
+	struct cache *cache=cache_new(sizeof(struct cache_test_id), CACHE_TEST_BUDGET, shards);
+	struct cache_stats stats;
+	int i;
+
+	for (i = 0 ; i < 10000 ; i++) {
+		cache_test_put(cache, i);
+		if (i % 3 == 0)
+			cache_test_get(cache, i/2);
+	}
+	cache_stats(cache, &stats);
+	test_assert(stats.t1+stats.t2 <= stats.budget+shards*(CACHE_TEST_DATA+64));
+	test_assert(stats.t1+stats.t2 >= stats.budget/2);
+}
+
+/* Data used twice survives a scan of data used once, unlike in a plain LRU cache */
+static void
+cache_test_scan(int shards)
+{
+	struct cache *cache=cache_new(sizeof(struct cache_test_id), CACHE_TEST_BUDGET, shards);
+	int i,hot=CACHE_TEST_BUDGET/(CACHE_TEST_DATA+64)/4;
+
+	for (i = 0 ; i < hot ; i++) {
+		cache_test_put(cache, i);
+		test_assert(cache_test_get(cache, i));
+	}
+	for (i = 0 ; i < 5000 ; i++)
+		cache_test_put(cache, 1000000+i);
+	for (i = 0 ; i < hot ; i++)
+		test_assert(cache_test_get(cache, i));
+	test_assert(!cache_test_get(cache, 1000000));
+}
+
+/* Data in use is neither evicted nor freed */
+static void
+cache_test_in_use(void)
+{
+	struct cache *cache=cache_new(sizeof(struct cache_test_id), CACHE_TEST_BUDGET, 1);
+	struct cache_test_id id={-1,1,2,3,4};
+	int *data=cache_insert_new(cache, &id, CACHE_TEST_DATA);
+	int i;
+
+	data[0]=-1;
+	for (i = 0 ; i < 5000 ; i++)
+		cache_test_put(cache, i);
+	test_assert(data[0] == -1);
+	test_assert(cache_test_get(cache, -1));
+	cache_entry_destroy(cache, data);
+}
+
+#ifdef HAVE_PTHREAD
+static struct cache *cache_test_shared;
+
+static void *
+cache_test_thread(void *arg)
+{
+	int i,base=*(int *)arg*100;
+	for (i = 0 ; i < 20000 ; i++) {
+		int key=base+i%300;
+		if (!cache_test_get(cache_test_shared, key))
+			cache_test_put(cache_test_shared, key);
+	}
+	return NULL;
+}
+
+/* Threads sharing a cache, partly with the same ids, always get their own data */
+static void
+cache_test_threads(void)
+{
+	pthread_t threads[CACHE_TEST_THREADS];
+	int numbers[CACHE_TEST_THREADS];
+	struct cache_stats stats;
+	int i;
+
+	cache_test_shared=cache_new(sizeof(struct cache_test_id), CACHE_TEST_BUDGET, CACHE_TEST_THREADS);
+	for (i = 0 ; i < CACHE_TEST_THREADS ; i++) {
+		numbers[i]=i;
+		test_assert(!pthread_create(&threads[i], NULL, cache_test_thread, &numbers[i]));
+	}
+	for (i = 0 ; i < CACHE_TEST_THREADS ; i++)
+		pthread_join(threads[i], NULL);
+	cache_stats(cache_test_shared, &stats);
+	test_assert(stats.hits+stats.misses == CACHE_TEST_THREADS*20000);
+	test_assert(stats.t1+stats.t2 <= stats.budget+CACHE_TEST_THREADS*(CACHE_TEST_DATA+64));
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	test_init(argv[0]);
+	cache_test_basic(1);
+	cache_test_basic(4);
+	cache_test_budget(1);
+	cache_test_budget(4);
+	cache_test_scan(1);
+	cache_test_scan(4);
+	cache_test_in_use();
+#ifdef HAVE_PTHREAD
+	cache_test_threads();
+#endif
+	return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of the reverse geocoder on test maps of a few streets and town labels.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include "coord.h"
+#include "geocode.h"
+#include "navit_test.h"
+
+#define GEOCODE_TEST_X 1300000
+#define GEOCODE_TEST_Y 6200000
+
+/* Main knows its town, Side does not, so the town label next to it is used */
+static struct test_map_item geocode_test_base_items[]={
+	{type_street_2_city,"Main","Streetown","12345",{{GEOCODE_TEST_X,GEOCODE_TEST_Y},{GEOCODE_TEST_X+2000,GEOCODE_TEST_Y}}},
+	{type_street_2_city,"Side",NULL,NULL,{{GEOCODE_TEST_X,GEOCODE_TEST_Y+400},{GEOCODE_TEST_X+2000,GEOCODE_TEST_Y+400}}},
+	{type_town_label_1e5,"Labeltown",NULL,"54321",{{GEOCODE_TEST_X+500,GEOCODE_TEST_Y+300}}},
+	{type_none},
+};
+
+/* A map added later, with a street closer to the points queried next to Main */
+static struct test_map_item geocode_test_added_items[]={
+	{type_street_2_city,"New",NULL,NULL,{{GEOCODE_TEST_X,GEOCODE_TEST_Y+15},{GEOCODE_TEST_X+2000,GEOCODE_TEST_Y+15}}},
+	{type_none},
+};
+
+static struct test_map geocode_test_base={geocode_test_base_items};
+static struct test_map geocode_test_added={geocode_test_added_items};
+
+static int
+geocode_test_query(struct geocode *geocode, int dx, int dy, struct geocode_result *result)
+{
+	struct pcoord pc={projection_mg,GEOCODE_TEST_X+dx,GEOCODE_TEST_Y+dy};
+	return geocode_reverse(geocode, &pc, result);
+}
+
+/* The town the map gives for a street is used before the nearest town label */
+static void
+geocode_test_town(struct geocode *geocode)
+{
+	struct geocode_result result;
+
+	test_assert(geocode_test_query(geocode, 500, 20, &result));
+	test_assert(!strcmp(result.street_name, "Main"));
+	test_assert(result.distance > 0 && result.distance <= 20);
+	test_assert(!strcmp(result.town_name, "Streetown"));
+	test_assert(!strcmp(result.postal, "12345"));
+	test_assert(geocode_test_query(geocode, 500, 380, &result));
+	test_assert(!strcmp(result.street_name, "Side"));
+	test_assert(!strcmp(result.town_name, "Labeltown"));
+	test_assert(!strcmp(result.postal, "54321"));
+}
+
+/* Maps added to the mapset or switched off are seen by the next query */
+static void
+geocode_test_maps_changed(struct geocode *geocode, struct mapset *ms)
+{
+	struct geocode_result result;
+	struct attr active={attr_active};
+	struct map *added;
+
+	added=test_map_add(ms, &geocode_test_added);
+	test_assert(geocode_test_query(geocode, 500, 20, &result));
+	test_assert(!strcmp(result.street_name, "New"));
+	active.u.num=0;
+	map_set_attr(added, &active);
+	test_assert(geocode_test_query(geocode, 500, 20, &result));
+	test_assert(!strcmp(result.street_name, "Main"));
+}
+
+int
+main(int argc, char **argv)
+{
+	struct mapset *ms;
+	struct geocode *geocode;
+
+	test_init(argv[0]);
+	ms=mapset_new(NULL, NULL);
+	test_map_add(ms, &geocode_test_base);
+	geocode=geocode_new(ms);
+	geocode_test_town(geocode);
+	geocode_test_maps_changed(geocode, ms);
+	geocode_destroy(geocode);
+	return 0;
+}
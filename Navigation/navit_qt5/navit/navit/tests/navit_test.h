@@ -0,0 +1,265 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_TEST_H
+#define NAVIT_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include "atom.h"
+#include "debug.h"
+#include "event_glib.h"
+#include "item.h"
+#include "coord.h"
+#include "attr.h"
+#include "projection.h"
+#include "map.h"
+#include "maptype.h"
+#include "mapset.h"
+
+/**
+ * @brief Fails the test program if a condition does not hold
+ */
+#define test_assert(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr,"%s:%d: assertion '%s' failed\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} \
+} while (0)
+
+#ifndef HAVE_GLIB
+void _g_slice_thread_init_nomessage(void);
+#endif
+
+/**
+ * @brief Initializes what the code under test expects, as main_real() does
+ *
+ * @param name Name of the test program
+ */
+static inline void
+test_init(char *name)
+{
+#ifdef HAVE_GLIB
+	event_glib_init();
+#else
+	/* Plain malloc lets tools like valgrind check the allocations of the code under test */
+	g_slice_set_config(G_SLICE_CONFIG_ALWAYS_MALLOC, TRUE);
+	_g_slice_thread_init_nomessage();
+#endif
+	atom_init();
+	debug_init(name);
+}
+
+/**
+ * @brief An item of a test_map
+ */
+struct test_map_item {
+	enum item_type type;		/**< type_none ends the table */
+	char *name;			/**< Label, and street name of lines */
+	char *town_name;		/**< Town of a line, NULL if the map does not tell */
+	char *postal;			/**< Postal code, NULL if unknown */
+	struct coord c[2];		/**< Position of a point, ends of a line */
+};
+
+/**
+ * @brief A map serving a table of items, in projection_mg
+ */
+struct test_map {
+	struct test_map_item *items;	/**< Items, up to one of type_none */
+	int select;			/**< Only return the items within the selection of the map rect */
+	int returned;			/**< Number of items returned so far */
+};
+
+/* As declared by plugin.h, which can not be included twice */
+void plugin_register_map_type(const char *name, struct map_priv *(*new_)(struct map_methods *meth, struct attr **attrs, struct callback_list *cbl));
+
+struct map_priv {
+	struct test_map *map;
+};
+
+struct map_rect_priv {
+	struct test_map *map;
+	struct map_selection *sel;
+	int pos,coord;
+	struct item item;
+	struct item_methods meth;
+};
+
+static inline int
+test_map_coord_count(struct map_rect_priv *mr)
+{
+	return item_is_point(mr->item) ? 1 : 2;
+}
+
+static inline void
+test_map_coord_rewind(void *priv_data)
+{
+	((struct map_rect_priv *)priv_data)->coord=0;
+}
+
+static inline int
+test_map_coord_get(void *priv_data, struct coord *c, int count)
+{
+	struct map_rect_priv *mr=priv_data;
+	int ret=0;
+	while (ret < count && mr->coord < test_map_coord_count(mr))
+		c[ret++]=mr->map->items[mr->pos].c[mr->coord++];
+	return ret;
+}
+
+static inline void
+test_map_attr_rewind(void *priv_data)
+{
+}
+
+static inline int
+test_map_attr_get(void *priv_data, enum attr_type attr_type, struct attr *attr)
+{
+	struct map_rect_priv *mr=priv_data;
+	struct test_map_item *item=&mr->map->items[mr->pos];
+	attr->type=attr_type;
+	switch (attr_type) {
+	case attr_label:
+		attr->u.str=item->name;
+		break;
+	case attr_street_name:
+		attr->u.str=item_is_point(mr->item) ? NULL : item->name;
+		break;
+	case attr_town_name:
+		attr->u.str=item_is_town(mr->item) ? item->name : item->town_name;
+		break;
+	case attr_postal:
+		attr->u.str=item->postal;
+		break;
+	default:
+		return 0;
+	}
+	return attr->u.str != NULL;
+}
+
+static inline struct map_rect_priv *
+test_map_rect_new(struct map_priv *priv, struct map_selection *sel)
+{
+	struct map_rect_priv *mr=g_new0(struct map_rect_priv, 1);
+	mr->map=priv->map;
+	mr->sel=sel;
+	mr->pos=-1;
+	mr->meth.item_coord_rewind=test_map_coord_rewind;
+	mr->meth.item_coord_get=test_map_coord_get;
+	mr->meth.item_attr_rewind=test_map_attr_rewind;
+	mr->meth.item_attr_get=test_map_attr_get;
+	mr->item.meth=&mr->meth;
+	mr->item.priv_data=mr;
+	return mr;
+}
+
+static inline void
+test_map_rect_destroy(struct map_rect_priv *mr)
+{
+	g_free(mr);
+}
+
+static inline struct item *
+test_map_item_at(struct map_rect_priv *mr, int pos)
+{
+	mr->pos=pos;
+	mr->coord=0;
+	mr->item.type=mr->map->items[pos].type;
+	mr->item.id_hi=0;
+	mr->item.id_lo=pos+1;
+	return &mr->item;
+}
+
+static inline struct item *
+test_map_get_item(struct map_rect_priv *mr)
+{
+	struct test_map_item *item;
+	while ((item=&mr->map->items[mr->pos+1])->type != type_none) {
+		test_map_item_at(mr, mr->pos+1);
+		if (!mr->map->select || (item_is_point(mr->item) ? map_selection_contains_point(mr->sel, item->c) :
+		    map_selection_contains_polyline(mr->sel, item->c, 2))) {
+			mr->map->returned++;
+			return &mr->item;
+		}
+	}
+	return NULL;
+}
+
+static inline struct item *
+test_map_get_item_byid(struct map_rect_priv *mr, int id_hi, int id_lo)
+{
+	int count=0;
+	while (mr->map->items[count].type != type_none)
+		count++;
+	if (id_hi || id_lo < 1 || id_lo > count)
+		return NULL;
+	return test_map_item_at(mr, id_lo-1);
+}
+
+static inline void
+test_map_destroy(struct map_priv *priv)
+{
+	g_free(priv);
+}
+
+static inline struct map_priv *
+test_map_new(struct map_methods *meth, struct attr **attrs, struct callback_list *cbl)
+{
+	struct attr *data=attr_search(attrs, NULL, attr_data);
+	struct map_priv *ret=g_new0(struct map_priv, 1);
+	struct test_map *map;
+
+	/* The data attribute holds the address of the struct test_map */
+	test_assert(data != NULL && sscanf(data->u.str, "%p", (void **)&map) == 1);
+	ret->map=map;
+	meth->pro=projection_mg;
+	meth->charset="utf-8";
+	meth->map_destroy=test_map_destroy;
+	meth->map_rect_new=test_map_rect_new;
+	meth->map_rect_destroy=test_map_rect_destroy;
+	meth->map_rect_get_item=test_map_get_item;
+	meth->map_rect_get_item_byid=test_map_get_item_byid;
+	return ret;
+}
+
+/**
+ * @brief Adds a map serving the items of a test_map to a mapset
+ *
+ * @param ms The mapset
+ * @param map Items of the map, which have to outlive it
+ * @return The new map
+ */
+static inline struct map *
+test_map_add(struct mapset *ms, struct test_map *map)
+{
+	char data[32];
+	struct attr type={attr_type,{"test_map"}},data_attr={attr_data,{data}},*attrs[]={&type,&data_attr,NULL};
+	struct attr attr;
+
+	plugin_register_map_type("test_map", test_map_new);
+	g_snprintf(data, sizeof(data), "%p", map);
+	attr.type=attr_map;
+	attr.u.map=map_new(NULL, attrs);
+	test_assert(attr.u.map != NULL);
+	mapset_add_attr(ms, &attr);
+	return attr.u.map;
+}
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of the POI search on a test map of a grid of POIs, which counts the
+ * items it returns.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include "item.h"
+#include "coord.h"
+#include "transform.h"
+#include "poisearch.h"
+#include "navit_test.h"
+
+#define POI_TEST_X 10000
+#define POI_TEST_STEP 100
+#define POI_TEST_SIZE 61		/* POIs per side of the grid, centered at POI_TEST_X,0 */
+#define POI_TEST_DIST 2000
+
+static struct test_map poi_test_map={NULL,1};
+
+static void
+poi_test_position(int pos, struct coord *c)
+{
+	c->x=POI_TEST_X+(pos%POI_TEST_SIZE-POI_TEST_SIZE/2)*POI_TEST_STEP;
+	c->y=(pos/POI_TEST_SIZE-POI_TEST_SIZE/2)*POI_TEST_STEP;
+}
+
+static struct mapset *
+poi_test_mapset(void)
+{
+	struct mapset *ms=mapset_new(NULL, NULL);
+	int pos;
+
+	poi_test_map.items=g_new0(struct test_map_item, POI_TEST_SIZE*POI_TEST_SIZE+1);
+	for (pos = 0 ; pos < POI_TEST_SIZE*POI_TEST_SIZE ; pos++) {
+		poi_test_map.items[pos].type=type_poi_fuel;
+		poi_test_position(pos, &poi_test_map.items[pos].c[0]);
+	}
+	poi_test_map.items[pos].type=type_none;
+	test_map_add(ms, &poi_test_map);
+	return ms;
+}
+
+/* Number of POIs within POI_TEST_DIST, and the number within the rectangle selected for it */
+static void
+poi_test_expected(int *count, int *in_rect)
+{
+	struct coord center={POI_TEST_X,0},c;
+	int half=POI_TEST_DIST*transform_scale(POI_TEST_DIST*1.5);
+	int pos;
+
+	*count=*in_rect=0;
+	for (pos = 0 ; pos < POI_TEST_SIZE*POI_TEST_SIZE ; pos++) {
+		poi_test_position(pos, &c);
+		if (transform_distance(projection_mg, &center, &c) < POI_TEST_DIST)
+			(*count)++;
+		if (abs(c.x-center.x) <= half && abs(c.y-center.y) <= half)
+			(*in_rect)++;
+	}
+}
+
+/* Reads all results in pages of page, checking they come nearest first and once each */
+static int
+poi_test_search(struct mapset *ms, int page, int all)
+{
+	struct pcoord center={projection_mg,POI_TEST_X,0};
+	struct poi_search *ps=poi_search_new(ms, &center, POI_TEST_DIST, NULL, 0);
+	struct poi_search_result *results;
+	char *seen=g_new0(char, POI_TEST_SIZE*POI_TEST_SIZE);
+	int count,i,total=0,last=0;
+
+	if (all)
+		poi_search_read_all(ps);
+	while ((count=poi_search_get_results(ps, page, &results))) {
+		for (i = 0 ; i < count ; i++) {
+			int pos=(results[i].c.y/POI_TEST_STEP+POI_TEST_SIZE/2)*POI_TEST_SIZE+(results[i].c.x-POI_TEST_X)/POI_TEST_STEP+POI_TEST_SIZE/2;
+			test_assert(results[i].distance >= last);
+			test_assert(results[i].distance < POI_TEST_DIST);
+			test_assert(!seen[pos]);
+			seen[pos]=1;
+			last=results[i].distance;
+		}
+		total+=count;
+	}
+	poi_search_destroy(ps);
+	g_free(seen);
+	return total;
+}
+
+/* Rings only read the frame around the area read before, overlapping it by a margin */
+static void
+poi_test_rings(struct mapset *ms)
+{
+	int count,in_rect;
+
+	poi_test_expected(&count, &in_rect);
+	poi_test_map.returned=0;
+	test_assert(poi_test_search(ms, 7, 0) == count);
+	test_assert(poi_test_map.returned >= in_rect && poi_test_map.returned < in_rect+in_rect/10);
+	poi_test_map.returned=0;
+	test_assert(poi_test_search(ms, G_MAXINT, 1) == count);
+	test_assert(poi_test_map.returned >= in_rect && poi_test_map.returned < in_rect+in_rect/10);
+}
+
+/* Items a map returns beyond the selection are not handed out twice */
+static void
+poi_test_unselected_items(struct mapset *ms)
+{
+	int count,in_rect;
+
+	poi_test_expected(&count, &in_rect);
+	poi_test_map.select=0;
+	test_assert(poi_test_search(ms, 7, 0) == count);
+	test_assert(poi_test_search(ms, 1000, 0) == count);
+	poi_test_map.select=1;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct mapset *ms;
+
+	test_init(argv[0]);
+	ms=poi_test_mapset();
+	poi_test_rings(ms);
+	poi_test_unselected_items(ms);
+	return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of the speech queue. The speech plugin and the event system of the
+ * test let it decide when the plugin is busy and when the queue is polled.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include "item.h"
+#include "attr.h"
+#include "callback.h"
+#include "event.h"
+#include "plugin.h"
+#include "speech.h"
+#include "navit_test.h"
+
+struct speech_priv {
+	int busy;
+	char spoken[256];
+};
+
+static struct callback *speech_test_poll;
+
+static struct event_timeout *
+speech_test_add_timeout(int timeout, int multi, struct callback *cb)
+{
+	test_assert(!speech_test_poll && multi);
+	speech_test_poll=cb;
+	return (struct event_timeout *)cb;
+}
+
+static void
+speech_test_remove_timeout(struct event_timeout *ev)
+{
+	test_assert(ev == (struct event_timeout *)speech_test_poll);
+	speech_test_poll=NULL;
+}
+
+struct event_priv {
+	int data;
+};
+
+static struct event_priv *
+speech_test_event_new(struct event_methods *meth)
+{
+	memset(meth, 0, sizeof(*meth));
+	meth->add_timeout=speech_test_add_timeout;
+	meth->remove_timeout=speech_test_remove_timeout;
+	return (struct event_priv *)speech_test_event_new;
+}
+
+static int
+speech_test_say(struct speech_priv *this, const char *text)
+{
+	if (this->spoken[0])
+		strcat(this->spoken, ",");
+	strcat(this->spoken, text);
+	this->busy=1;
+	return strlen(text);
+}
+
+static int
+speech_test_busy(struct speech_priv *this)
+{
+	return this->busy;
+}
+
+static void
+speech_test_destroy(struct speech_priv *this)
+{
+}
+
+static struct speech_priv speech_test_priv;
+
+static struct speech_methods speech_test_meth = {
+	speech_test_destroy,
+	speech_test_say,
+	NULL,
+	speech_test_busy,
+};
+
+static struct speech_priv *
+speech_test_new(struct speech_methods *meth, struct attr **attrs, struct attr *parent)
+{
+	*meth=speech_test_meth;
+	return &speech_test_priv;
+}
+
+/* Lets the plugin finish the text it is speaking and polls the queue */
+static void
+speech_test_done(void)
+{
+	speech_test_priv.busy=0;
+	test_assert(speech_test_poll != NULL);
+	callback_call_0(speech_test_poll);
+}
+
+/* An idle plugin is called right away and its result is returned */
+static void
+speech_test_direct(struct speech *speech)
+{
+	test_assert(speech_say(speech, "hello") == 5);
+	test_assert(!strcmp(speech_test_priv.spoken, "hello"));
+	test_assert(speech_test_poll == NULL);
+	speech_test_priv.busy=0;
+	speech_test_priv.spoken[0]='\0';
+}
+
+/* While the plugin is busy, a repeated text is merged and a newer maneuver drops the waiting one */
+static void
+speech_test_queue(struct speech *speech)
+{
+	test_assert(speech_say(speech, "busy") == 4);
+	test_assert(speech_say(speech, "info") == 0);
+	test_assert(speech_say_priority(speech, "turn left", speech_priority_maneuver) == 0);
+	test_assert(speech_say(speech, "info") == 0);
+	test_assert(speech_say_priority(speech, "turn right", speech_priority_maneuver) == 0);
+	/* still busy, nothing is handed to the plugin */
+	callback_call_0(speech_test_poll);
+	test_assert(!strcmp(speech_test_priv.spoken, "busy"));
+	speech_test_done();
+	test_assert(!strcmp(speech_test_priv.spoken, "busy,turn right"));
+	speech_test_done();
+	test_assert(!strcmp(speech_test_priv.spoken, "busy,turn right,info"));
+	/* the queue is empty, polling stops */
+	test_assert(speech_test_poll == NULL);
+	speech_test_priv.busy=0;
+	speech_test_priv.spoken[0]='\0';
+}
+
+/* A waiting text said again with a higher priority moves ahead */
+static void
+speech_test_priority(struct speech *speech)
+{
+	speech_say(speech, "busy");
+	speech_say(speech, "first");
+	speech_say(speech, "second");
+	speech_say_priority(speech, "second", speech_priority_maneuver);
+	speech_test_done();
+	speech_test_done();
+	test_assert(!strcmp(speech_test_priv.spoken, "busy,second,first"));
+	test_assert(speech_test_poll == NULL);
+	speech_test_priv.busy=0;
+	speech_test_priv.spoken[0]='\0';
+}
+
+int
+main(int argc, char **argv)
+{
+	struct attr type={attr_type,{"speech_test"}},*attrs[]={&type,NULL};
+	struct speech *speech;
+
+	test_init(argv[0]);
+	plugin_register_event_type("speech_test", speech_test_event_new);
+	test_assert(event_request_system("speech_test", "speech_test"));
+	plugin_register_speech_type("speech_test", speech_test_new);
+	speech=speech_new(NULL, attrs);
+	test_assert(speech != NULL);
+	speech_test_direct(speech);
+	speech_test_queue(speech);
+	speech_test_priority(speech);
+	speech_destroy(speech);
+	return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of tracking_match_log() on a test map of two parallel, unconnected streets.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include "transform.h"
+#include "track.h"
+#include "navit_test.h"
+
+#define TRACK_TEST_X 1300000
+#define TRACK_TEST_Y 6200000
+#define TRACK_TEST_FIXES 30
+#define TRACK_TEST_NOISY 15		/* fix closer to Side than to Main */
+
+static struct test_map_item track_test_items[]={
+	{type_street_2_city,"Main",NULL,NULL,{{TRACK_TEST_X,TRACK_TEST_Y},{TRACK_TEST_X+2000,TRACK_TEST_Y}}},
+	{type_street_2_city,"Side",NULL,NULL,{{TRACK_TEST_X,TRACK_TEST_Y+60},{TRACK_TEST_X+2000,TRACK_TEST_Y+60}}},
+	{type_none},
+};
+
+static struct test_map track_test_map={track_test_items};
+
+static struct tracking *
+track_test_tracking(void)
+{
+	struct mapset *ms=mapset_new(NULL, NULL);
+	struct tracking *tr=tracking_new(NULL, NULL);
+
+	test_map_add(ms, &track_test_map);
+	tracking_set_mapset(tr, ms);
+	return tr;
+}
+
+/* Fixes driving along Main, 5 units off, one of them 20 units from Side */
+static void
+track_test_write_gpx(const char *name)
+{
+	FILE *f=fopen(name, "w");
+	int i;
+
+	test_assert(f != NULL);
+	fprintf(f,"<gpx><trk><trkseg>\n");
+	for (i = 0 ; i < TRACK_TEST_FIXES ; i++) {
+		struct coord c;
+		struct coord_geo g;
+		c.x=TRACK_TEST_X+100+i*50;
+		c.y=TRACK_TEST_Y+(i == TRACK_TEST_NOISY ? 40 : 5);
+		transform_to_geo(projection_mg, &c, &g);
+		fprintf(f,"<trkpt lat=\"%.7f\" lon=\"%.7f\"></trkpt>\n", g.lat, g.lng);
+	}
+	fprintf(f,"</trkseg></trk></gpx>\n");
+	fclose(f);
+}
+
+/* A single noisy fix does not switch to an unconnected street, and the live tracking is left alone */
+static void
+track_test_match_log(struct tracking *tr)
+{
+	struct attr street_count;
+	char line[256];
+	FILE *f;
+	int count=0;
+
+	track_test_write_gpx("track_test.gpx");
+	test_assert(tracking_match_log(tr, "track_test.gpx", "track_test.out") == TRACK_TEST_FIXES);
+	f=fopen("track_test.out", "r");
+	test_assert(f != NULL);
+	while (fgets(line, sizeof(line), f)) {
+		test_assert(strstr(line, " Main\n") != NULL);
+		count++;
+	}
+	fclose(f);
+	test_assert(count == TRACK_TEST_FIXES);
+	test_assert(tracking_get_attr(tr, attr_street_count, &street_count, NULL));
+	test_assert(street_count.u.num == 0);
+	remove("track_test.gpx");
+	remove("track_test.out");
+}
+
+/* A log without fixes is an error */
+static void
+track_test_match_empty(struct tracking *tr)
+{
+	FILE *f=fopen("track_test.gpx", "w");
+	test_assert(f != NULL);
+	fprintf(f,"<gpx></gpx>\n");
+	fclose(f);
+	test_assert(tracking_match_log(tr, "track_test.gpx", "track_test.out") == -1);
+	remove("track_test.gpx");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct tracking *tr;
+
+	test_init(argv[0]);
+	tr=track_test_tracking();
+	track_test_match_log(tr);
+	track_test_match_empty(tr);
+	tracking_destroy(tr);
+	return 0;
+}
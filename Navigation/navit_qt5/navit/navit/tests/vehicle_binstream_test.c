@@ -0,0 +1,124 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Tests of the record decoder of the binstream vehicle. The plugin is built into
+ * the test, so that its records can be applied without a socket.
+ */
+
+#include "config.h"
+#include "vehicle/binstream/vehicle_binstream.c"
+#include "navit_test.h"
+
+static int
+binstream_test_key(struct vehicle_priv *priv, unsigned short seq, int lat, int lng)
+{
+	union vehicle_binstream_record record;
+
+	memset(&record, 0, sizeof(record));
+	record.key.type=VEHICLE_BINSTREAM_KEY;
+	record.key.seq=seq;
+	record.key.lat=lat;
+	record.key.lng=lng;
+	record.key.speed=1000;
+	record.key.direction=VEHICLE_BINSTREAM_UNKNOWN;
+	record.key.time=1000000;
+	return vehicle_binstream_record(priv, &record, sizeof(record.key));
+}
+
+static int
+binstream_test_delta(struct vehicle_priv *priv, unsigned short seq, short lat, short lng)
+{
+	union vehicle_binstream_record record;
+
+	memset(&record, 0, sizeof(record));
+	record.delta.type=VEHICLE_BINSTREAM_DELTA;
+	record.delta.seq=seq;
+	record.delta.lat=lat;
+	record.delta.lng=lng;
+	record.delta.time=100;
+	record.delta.speed=VEHICLE_BINSTREAM_UNKNOWN;
+	record.delta.direction=9000;
+	return vehicle_binstream_record(priv, &record, sizeof(record.delta));
+}
+
+/* Deltas are added to the key record before them */
+static void
+binstream_test_deltas(void)
+{
+	struct vehicle_priv priv;
+
+	memset(&priv, 0, sizeof(priv));
+	test_assert(!binstream_test_delta(&priv, 1, 10, 10));
+	test_assert(binstream_test_key(&priv, 2, 481392000, 115659000));
+	test_assert(priv.speed == 36);
+	test_assert(binstream_test_delta(&priv, 3, 10, -20));
+	test_assert(binstream_test_delta(&priv, 4, 10, -20));
+	test_assert(priv.lat == 481392020 && priv.lng == 115658960);
+	test_assert(priv.time == 1000200);
+	test_assert(priv.speed == 36 && priv.direction == 90);
+	test_assert(priv.lost == 0);
+}
+
+/* After a gap deltas are ignored until the next key record */
+static void
+binstream_test_gap(void)
+{
+	struct vehicle_priv priv;
+
+	memset(&priv, 0, sizeof(priv));
+	test_assert(binstream_test_key(&priv, 65534, 481392000, 115659000));
+	test_assert(binstream_test_delta(&priv, 65535, 10, 10));
+	test_assert(!binstream_test_delta(&priv, 2, 10, 10));
+	test_assert(priv.lost == 2);
+	test_assert(!binstream_test_delta(&priv, 3, 10, 10));
+	test_assert(priv.lat == 481392010 && priv.lng == 115659010);
+	test_assert(binstream_test_key(&priv, 4, 481393000, 115660000));
+	test_assert(binstream_test_delta(&priv, 5, 10, 10));
+	test_assert(priv.lat == 481393010 && priv.lng == 115660010);
+	test_assert(priv.lost == 2);
+}
+
+/* Repeated and older key records are applied but not counted as lost, short records are ignored */
+static void
+binstream_test_lost(void)
+{
+	struct vehicle_priv priv;
+	union vehicle_binstream_record record;
+
+	memset(&priv, 0, sizeof(priv));
+	test_assert(binstream_test_key(&priv, 10, 481392000, 115659000));
+	test_assert(binstream_test_key(&priv, 10, 481392000, 115659000));
+	test_assert(binstream_test_key(&priv, 8, 481392000, 115659000));
+	test_assert(priv.lost == 0);
+	test_assert(binstream_test_key(&priv, 12, 481392000, 115659000));
+	test_assert(priv.lost == 3);
+	record.type=VEHICLE_BINSTREAM_KEY;
+	test_assert(!vehicle_binstream_record(&priv, &record, 1));
+}
+
+int
+main(int argc, char **argv)
+{
+	test_init(argv[0]);
+	binstream_test_deltas();
+	binstream_test_gap();
+	binstream_test_lost();
+	return 0;
+}
@@ -0,0 +1,223 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Startup trace.
+ *
+ * Once enabled with trace_init() (navit -t), the phases of the startup
+ * (config parsing, plugin loading, opening of maps, navit_init, the first
+ * displaylist and the first frame) are recorded as spans. When the first
+ * frame is drawn, or at exit if that never happens, they are written in the
+ * JSON format of the Chrome trace viewer (chrome://tracing, Perfetto), with
+ * one track per thread, so maps opened in the background show up in parallel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "debug.h"
+#include "benchmark.h"
+#include "trace.h"
+
+struct trace_span {
+	char *name;
+	char *detail;
+	double start;
+	double duration;
+	int thread;
+};
+
+int trace_enabled;
+static char *trace_filename;
+static double trace_origin;
+static struct trace_span *trace_spans;
+static int trace_span_count, trace_span_size;
+
+#ifdef HAVE_PTHREAD
+#define TRACE_THREADS_MAX 32
+static pthread_mutex_t trace_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_t trace_threads[TRACE_THREADS_MAX];
+static int trace_thread_count;
+
+/* Small ids for the viewer, the main thread calls trace_init() and gets 1 */
+static int
+trace_thread(void)
+{
+	pthread_t self=pthread_self();
+	int i;
+
+	for (i = 0 ; i < trace_thread_count ; i++) {
+		if (pthread_equal(trace_threads[i], self))
+			return i+1;
+	}
+	if (trace_thread_count == TRACE_THREADS_MAX)
+		return TRACE_THREADS_MAX+1;
+	trace_threads[trace_thread_count++]=self;
+	return trace_thread_count;
+}
+#else
+#define trace_thread() 1
+#endif
+
+static void
+trace_atexit(void)
+{
+	trace_finish();
+}
+
+/**
+ * @brief Enables the startup trace
+ *
+ * Times in the trace are relative to this call.
+ *
+ * @param filename File the trace is written to, "-" for stdout
+ */
+void
+trace_init(const char *filename)
+{
+	if (!trace_filename)
+		atexit(trace_atexit);
+	g_free(trace_filename);
+	trace_filename=g_strdup(filename);
+	trace_origin=benchmark_time();
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&trace_lock);
+	trace_thread();
+	pthread_mutex_unlock(&trace_lock);
+#endif
+	trace_enabled=1;
+}
+
+/**
+ * @brief Records a phase of the startup that ends now
+ *
+ * May be called from any thread.
+ *
+ * @param name Name of the phase
+ * @param detail Additional information shown with the span, e.g. a file name, or NULL
+ * @param start Time the phase started, as returned by benchmark_time()
+ */
+void
+trace_span(const char *name, const char *detail, double start)
+{
+	struct trace_span *span;
+	double now;
+
+	if (!trace_enabled)
+		return;
+	now=benchmark_time();
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&trace_lock);
+	/* trace_finish() may have run in between */
+	if (!trace_enabled) {
+		pthread_mutex_unlock(&trace_lock);
+		return;
+	}
+#endif
+	if (trace_span_count == trace_span_size) {
+		trace_span_size=trace_span_size ? trace_span_size*2 : 64;
+		trace_spans=g_renew(struct trace_span, trace_spans, trace_span_size);
+	}
+	span=&trace_spans[trace_span_count++];
+	span->name=g_strdup(name);
+	span->detail=g_strdup(detail);
+	span->start=start-trace_origin;
+	span->duration=now-start;
+	span->thread=trace_thread();
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&trace_lock);
+#endif
+}
+
+static void
+trace_write_string(FILE *f, const char *str)
+{
+	fputc('"', f);
+	while (*str) {
+		if (*str == '"' || *str == '\\')
+			fprintf(f, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(f, "\\u%04x", *str);
+		else
+			fputc(*str, f);
+		str++;
+	}
+	fputc('"', f);
+}
+
+/**
+ * @brief Writes the recorded spans and stops tracing
+ *
+ * Called once the first frame is drawn. Spans recorded afterwards are dropped.
+ */
+void
+trace_finish(void)
+{
+	FILE *f;
+	int i;
+
+	if (!trace_enabled)
+		return;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&trace_lock);
+#endif
+	trace_enabled=0;
+	if (!strcmp(trace_filename, "-"))
+		f=stdout;
+	else
+		f=fopen(trace_filename, "w");
+	if (f) {
+		fprintf(f, "{\"traceEvents\":[\n");
+		for (i = 0 ; i < trace_span_count ; i++) {
+			struct trace_span *span=&trace_spans[i];
+			fprintf(f, "{\"name\":");
+			trace_write_string(f, span->name);
+			fprintf(f, ",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%.0f,\"dur\":%.0f,\"pid\":1,\"tid\":%d",
+				span->start*1000, span->duration*1000, span->thread);
+			if (span->detail) {
+				fprintf(f, ",\"args\":{\"detail\":");
+				trace_write_string(f, span->detail);
+				fprintf(f, "}");
+			}
+			fprintf(f, "}%s\n", i < trace_span_count-1 ? ",":"");
+		}
+		fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+		if (f == stdout)
+			fflush(f);
+		else
+			fclose(f);
+	} else {
+		dbg(lvl_error,"unable to write startup trace to %s\n", trace_filename);
+	}
+	for (i = 0 ; i < trace_span_count ; i++) {
+		g_free(trace_spans[i].name);
+		g_free(trace_spans[i].detail);
+	}
+	g_free(trace_spans);
+	trace_spans=NULL;
+	trace_span_count=trace_span_size=0;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&trace_lock);
+#endif
+}
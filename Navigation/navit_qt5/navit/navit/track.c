@@ -18,6 +18,8 @@
  */
 
 #include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -42,13 +44,94 @@
 
 struct object_func tracking_func;
 
+/*
+ * Streets for map matching are read from the mapset in square blocks and kept
+ * until they are the least recently used ones. Each block puts its street
+ * segments into a grid of cells, so a position only has to be compared with
+ * the segments of the cells around it, nearest cells first.
+ */
+#define TRACKING_BLOCK_SHIFT 12		/* blocks of 4096 units */
+#define TRACKING_CELL_SHIFT 8		/* cells of 256 units */
+#define TRACKING_CELLS (1 << (TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT))
+#define TRACKING_MAX_BLOCKS 16
+#define TRACKING_QUERY_DIST 1000	/* streets further away are not considered */
+#define TRACKING_POOL_SIZE 32768
+
 struct tracking_line
 {
 	struct street_data *street;
-	struct tracking_line *next;
+	struct tracking_line *next;	/* next line of the block */
+	struct tracking_line *link;	/* next line of tracking->lines */
 	int angle[0];
 };
 
+/**
+ * @brief Memory the lines and streets of a block are allocated from
+ *
+ * All chunks of a block are freed together when the block is dropped.
+ */
+struct tracking_pool {
+	struct tracking_pool *next;
+	int size,used;
+	char data[0];
+};
+
+struct tracking_segment {
+	struct tracking_line *line;
+	int offset;
+};
+
+/*
+ * Optional hidden Markov model map matching. For each fix the best few
+ * streets nearby are kept as candidates, scored by how well they fit the
+ * fix (emission) and by how plausible it is to get there from each candidate
+ * of the previous fix (transition). The path through the candidates with the
+ * best score wins, so a single noisy fix does not switch to an unconnected
+ * street.
+ */
+#define TRACKING_HMM_CANDIDATES 8
+#define TRACKING_HMM_DIST 200		/* streets further away are no candidates */
+#define TRACKING_HMM_SIGMA2 800.0	/* scale of the emission, in squared units */
+#define TRACKING_HMM_BETA 50.0		/* scale of the transition, in units */
+#define TRACKING_HMM_JUMP 500		/* detour assumed between unconnected streets */
+
+struct tracking_candidate {
+	struct item item;		/* only map and ids stay valid after the fix */
+	struct coord lpnt;		/* point on the street closest to the fix */
+	struct coord start,end;		/* first and last point of the street */
+	int offset;			/* segment of the street */
+	int value;			/* tracking_value() of the segment */
+	double emission;		/* log probability of the fix if it was on this street */
+	double score;			/* log probability of the best path ending here */
+	int prev;			/* candidate of the previous fix on that path, -1 if none */
+	struct tracking_line *line;	/* only valid during the fix */
+};
+
+struct tracking_column {
+	int count;
+	double fix_dist;		/* distance to the previous fix */
+	struct tracking_candidate candidates[TRACKING_HMM_CANDIDATES];
+};
+
+/**
+ * @brief Candidates of the last fixes
+ *
+ * The columns form a ring of size entries, count of them are used, the oldest one at first.
+ */
+struct tracking_hmm {
+	int size,count,first;
+	struct tracking_column *columns;
+};
+
+struct tracking_block {
+	struct coord key;		/* block number in x and y */
+	unsigned int used;
+	struct tracking_pool *pool;
+	struct tracking_line *lines;
+	struct tracking_segment *segments;	/* segments sorted by cell */
+	int cell_start[TRACKING_CELLS*TRACKING_CELLS+1];
+};
+
 
 /**
  * @brief Conatins a list of previous speeds
@@ -90,7 +173,8 @@ struct tracking {
 	struct map *map;
 	struct vehicle *vehicle;
 	struct vehicleprofile *vehicleprofile;
-	struct coord last_updated;
+	GHashTable *blocks;
+	unsigned int updates;
 	struct tracking_line *lines;
 	struct tracking_line *curr_line;
 	int pos;
@@ -117,6 +201,9 @@ struct tracking {
 	int overspeed_pref;
 	int overspeed_percent_pref;
 	int tunnel_extrapolation;
+	int map_matching_window;
+	struct tracking_hmm *hmm;
+	struct coord last_hmm;
 };
 
 
@@ -380,7 +467,7 @@ tracking_get_attr(struct tracking *_this, enum attr_type type, struct attr *attr
 		tl=_this->lines;
 		while (tl) {
 			attr->u.num++;
-			tl=tl->next;
+			tl=tl->link;
 		}
 		return 1;
 	default:
@@ -457,66 +544,243 @@ street_data_within_selection(struct street_data *sd, struct map_selection *sel)
 }
 
 
+static void *
+tracking_pool_alloc(struct tracking_pool **pool, int size)
+{
+	struct tracking_pool *curr=*pool;
+	void *ret;
+
+	size=(size+7) & ~7;
+	if (!curr || curr->used+size > curr->size) {
+		int chunk=size > TRACKING_POOL_SIZE ? size : TRACKING_POOL_SIZE;
+		curr=g_malloc(sizeof(*curr)+chunk);
+		curr->next=*pool;
+		curr->size=chunk;
+		curr->used=0;
+		*pool=curr;
+	}
+	ret=curr->data+curr->used;
+	curr->used+=size;
+	return ret;
+}
+
 static void
-tracking_doupdate_lines(struct tracking *tr, struct coord *pc, enum projection pro)
+tracking_block_destroy(struct tracking_block *block)
 {
-	int max_dist=1000;
-	struct map_selection *sel;
+	struct tracking_pool *pool=block->pool,*next;
+	while (pool) {
+		next=pool->next;
+		g_free(pool);
+		pool=next;
+	}
+	g_free(block->segments);
+	g_free(block);
+}
+
+/* Copies the street into the pool of the block and prepends it to the lines of the block */
+static struct tracking_line *
+tracking_block_add_street(struct tracking_block *block, struct street_data *street)
+{
+	int line_size=sizeof(struct tracking_line)+(street->count-1)*sizeof(int);
+	int street_size=sizeof(struct street_data)+street->count*sizeof(struct coord);
+	struct tracking_line *tl=tracking_pool_alloc(&block->pool, ((line_size+7) & ~7)+street_size);
+
+	tl->street=(struct street_data *)((char *)tl+((line_size+7) & ~7));
+	memcpy(tl->street, street, street_size);
+	tracking_get_angles(tl);
+	tl->next=block->lines;
+	block->lines=tl;
+	return tl;
+}
+
+struct tracking_block_entry {
+	int cell;
+	struct tracking_segment segment;
+};
+
+/* Sorts the segments of the lines of a block into its cells */
+static void
+tracking_block_index(struct tracking_block *block)
+{
+	struct tracking_block_entry *entries=NULL;
+	struct tracking_line *tl;
+	int count=0,size=0,i,x,y;
+	int x0=block->key.x << TRACKING_BLOCK_SHIFT, y0=block->key.y << TRACKING_BLOCK_SHIFT;
+
+	for (tl = block->lines ; tl ; tl=tl->next) {
+		struct street_data *sd=tl->street;
+		for (i = 0 ; i < sd->count-1 ; i++) {
+			int lx=coord_floor_shift(MIN(sd->c[i].x, sd->c[i+1].x)-x0, TRACKING_CELL_SHIFT);
+			int hx=coord_floor_shift(MAX(sd->c[i].x, sd->c[i+1].x)-x0, TRACKING_CELL_SHIFT);
+			int ly=coord_floor_shift(MIN(sd->c[i].y, sd->c[i+1].y)-y0, TRACKING_CELL_SHIFT);
+			int hy=coord_floor_shift(MAX(sd->c[i].y, sd->c[i+1].y)-y0, TRACKING_CELL_SHIFT);
+			if (hx < 0 || hy < 0 || lx >= TRACKING_CELLS || ly >= TRACKING_CELLS)
+				continue;
+			for (y = MAX(ly,0) ; y <= MIN(hy,TRACKING_CELLS-1) ; y++) {
+				for (x = MAX(lx,0) ; x <= MIN(hx,TRACKING_CELLS-1) ; x++) {
+					if (count == size) {
+						size=size ? size*2 : 256;
+						entries=g_renew(struct tracking_block_entry, entries, size);
+					}
+					entries[count].cell=y*TRACKING_CELLS+x;
+					entries[count].segment.line=tl;
+					entries[count].segment.offset=i;
+					count++;
+				}
+			}
+		}
+	}
+	memset(block->cell_start, 0, sizeof(block->cell_start));
+	for (i = 0 ; i < count ; i++)
+		block->cell_start[entries[i].cell+1]++;
+	for (i = 0 ; i < TRACKING_CELLS*TRACKING_CELLS ; i++)
+		block->cell_start[i+1]+=block->cell_start[i];
+	block->segments=g_new(struct tracking_segment, count ? count : 1);
+	for (i = 0 ; i < count ; i++) {
+		int pos=block->cell_start[entries[i].cell]++;
+		block->segments[pos]=entries[i].segment;
+	}
+	/* cell_start now holds the end of each cell, shift it back */
+	for (i = TRACKING_CELLS*TRACKING_CELLS ; i > 0 ; i--)
+		block->cell_start[i]=block->cell_start[i-1];
+	block->cell_start[0]=0;
+	g_free(entries);
+}
+
+static struct tracking_block *
+tracking_block_read(struct tracking *tr, struct coord *key, enum projection pro)
+{
+	struct tracking_block *block=g_new0(struct tracking_block, 1);
+	struct map_selection sel;
 	struct mapset_handle *h;
 	struct map *m;
 	struct map_rect *mr;
 	struct item *item;
 	struct street_data *street;
-	struct tracking_line *tl;
 	struct coord_geo g;
-	struct coord cc;
+	int i;
 
-	dbg(lvl_debug,"enter\n");
+	dbg(lvl_debug,"enter block %d,%d\n", key->x, key->y);
+	block->key=*key;
 	h=mapset_open(tr->ms);
 	while ((m=mapset_next(h,2))) {
-		cc.x = pc->x;
-		cc.y = pc->y;
+		memset(&sel, 0, sizeof(sel));
+		sel.order=18;
+		sel.range.min=route_item_first;
+		sel.range.max=route_item_last;
+		sel.u.c_rect.lu.x=key->x << TRACKING_BLOCK_SHIFT;
+		sel.u.c_rect.lu.y=((key->y+1) << TRACKING_BLOCK_SHIFT)-1;
+		sel.u.c_rect.rl.x=((key->x+1) << TRACKING_BLOCK_SHIFT)-1;
+		sel.u.c_rect.rl.y=key->y << TRACKING_BLOCK_SHIFT;
 		if (map_projection(m) != pro) {
-			transform_to_geo(pro, &cc, &g);
-			transform_from_geo(map_projection(m), &g, &cc);
+			for (i = 0 ; i < 2 ; i++) {
+				struct coord *c=i ? &sel.u.c_rect.rl : &sel.u.c_rect.lu;
+				transform_to_geo(pro, c, &g);
+				transform_from_geo(map_projection(m), &g, c);
+			}
 		}
-		sel = route_rect(18, &cc, &cc, 0, max_dist);
-		mr=map_rect_new(m, sel);
+		mr=map_rect_new(m, &sel);
 		if (!mr)
 			continue;
 		while ((item=map_rect_get_item(mr))) {
 			if (item_get_default_flags(item->type)) {
 				street=street_get_data(item);
-				if (street_data_within_selection(street, sel)) {
-					tl=g_malloc(sizeof(struct tracking_line)+(street->count-1)*sizeof(int));
-					tl->street=street;
-					tracking_get_angles(tl);
-					tl->next=tr->lines;
-					tr->lines=tl;
-				} else
-					street_data_free(street);
+				if (street->count > 1 && street_data_within_selection(street, &sel))
+					tracking_block_add_street(block, street);
+				street_data_free(street);
 			}
 		}
-		map_selection_destroy(sel);
 		map_rect_destroy(mr);
 	}
 	mapset_close(h);
-	dbg(lvl_debug, "exit\n");
+	tracking_block_index(block);
+	dbg(lvl_debug,"exit block %d,%d with %d segments\n", key->x, key->y, block->cell_start[TRACKING_CELLS*TRACKING_CELLS]);
+	return block;
 }
 
+/*
+ * Chains the lines of all blocks, for the tracking map. A street crossing block
+ * boundaries has a copy in each of these blocks, only the first one is chained.
+ */
+static void
+tracking_link_lines(struct tracking *tr)
+{
+	GHashTableIter iter;
+	struct tracking_block *block;
+	struct tracking_line *tl,**last=&tr->lines;
+	struct item_hash *seen=item_hash_new();
+
+	g_hash_table_iter_init(&iter, tr->blocks);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&block)) {
+		for (tl = block->lines ; tl ; tl=tl->next) {
+			if (item_hash_lookup(seen, &tl->street->item))
+				continue;
+			item_hash_insert(seen, &tl->street->item, tl);
+			*last=tl;
+			last=&tl->link;
+		}
+	}
+	*last=NULL;
+	item_hash_destroy(seen);
+}
+
+/**
+ * @brief Makes sure the blocks around a position are loaded
+ *
+ * Blocks that are not needed are dropped, least recently used first,
+ * if there are more than TRACKING_MAX_BLOCKS.
+ */
+static void
+tracking_doupdate_lines(struct tracking *tr, struct coord *pc, enum projection pro)
+{
+	struct tracking_block *block;
+	struct coord key;
+	int lx,ly,hx,hy,changed=0;
+
+	if (!tr->blocks)
+		tr->blocks=g_hash_table_new_full(coord_hash, coord_equal, NULL, (GDestroyNotify)tracking_block_destroy);
+	tr->updates++;
+	lx=coord_floor_shift(pc->x-TRACKING_QUERY_DIST, TRACKING_BLOCK_SHIFT);
+	hx=coord_floor_shift(pc->x+TRACKING_QUERY_DIST, TRACKING_BLOCK_SHIFT);
+	ly=coord_floor_shift(pc->y-TRACKING_QUERY_DIST, TRACKING_BLOCK_SHIFT);
+	hy=coord_floor_shift(pc->y+TRACKING_QUERY_DIST, TRACKING_BLOCK_SHIFT);
+	for (key.y = ly ; key.y <= hy ; key.y++) {
+		for (key.x = lx ; key.x <= hx ; key.x++) {
+			block=g_hash_table_lookup(tr->blocks, &key);
+			if (!block) {
+				block=tracking_block_read(tr, &key, pro);
+				g_hash_table_insert(tr->blocks, &block->key, block);
+				changed=1;
+			}
+			block->used=tr->updates;
+		}
+	}
+	while (g_hash_table_size(tr->blocks) > TRACKING_MAX_BLOCKS) {
+		GHashTableIter iter;
+		struct tracking_block *oldest=NULL;
+		g_hash_table_iter_init(&iter, tr->blocks);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&block))
+			if (!oldest || tr->updates-block->used > tr->updates-oldest->used)
+				oldest=block;
+		g_hash_table_remove(tr->blocks, &oldest->key);
+		tr->curr_line=NULL;
+		changed=1;
+	}
+	if (changed)
+		tracking_link_lines(tr);
+}
 
 void
 tracking_flush(struct tracking *tr)
 {
-	struct tracking_line *tl=tr->lines,*next;
 	dbg(lvl_debug,"enter(tr=%p)\n", tr);
 
-	while (tl) {
-		next=tl->next;
-		street_data_free(tl->street);
-		g_free(tl);
-		tl=next;
+	if (tr->blocks) {
+		g_hash_table_destroy(tr->blocks);
+		tr->blocks=NULL;
 	}
+	if (tr->hmm)
+		tr->hmm->count=0;
 	tr->lines=NULL;
 	tr->curr_line = NULL;
 }
@@ -628,7 +892,7 @@ tracking_value(struct tracking *tr, struct tracking_line *t, int offset, struct
 		return value;
 	if ((flags & 16) && tr->route_pref)
 		value += tracking_is_on_route(tr, tr->rt, &sd->item);
-	if ((flags & 32) && tr->overspeed_percent_pref && tr->overspeed_pref ) {
+	if ((flags & 32) && tr->overspeed_percent_pref && tr->overspeed_pref && tr->vehicleprofile) {
 		struct roadprofile *roadprofile=g_hash_table_lookup(tr->vehicleprofile->roadprofile_hash, (void *)t->street->item.type);
 		if (roadprofile && tr->speed > roadprofile->speed * tr->overspeed_percent_pref/ 100)
 			value += tr->overspeed_pref;
@@ -638,14 +902,276 @@ tracking_value(struct tracking *tr, struct tracking_line *t, int offset, struct
 	return value;
 }
 
+/**
+ * @brief Finds the best matching street segment for the current position
+ *
+ * The cells around the position are visited ring by ring. Since the value of a segment
+ * is at least its squared distance, the search stops as soon as the next ring is too far
+ * away to contain a better segment.
+ *
+ * @param tr The tracking object
+ * @param min_out Receives the value of the best segment, INT_MAX/2 if there is none
+ * @param lpnt_out Receives the point on the best segment closest to the position
+ * @param offset_out Receives the number of the best segment within its line
+ * @return The line containing the best segment, NULL if there is none
+ */
+static struct tracking_line *
+tracking_find_best(struct tracking *tr, int *min_out, struct coord *lpnt_out, int *offset_out)
+{
+	struct tracking_line *best=NULL;
+	struct tracking_block *block=NULL;
+	struct coord key,lpnt;
+	int cx=coord_floor_shift(tr->curr_in.x, TRACKING_CELL_SHIFT);
+	int cy=coord_floor_shift(tr->curr_in.y, TRACKING_CELL_SHIFT);
+	int rings=(TRACKING_QUERY_DIST >> TRACKING_CELL_SHIFT)+1;
+	int min=INT_MAX/2,r,x,y,i,value;
+
+	for (r = 0 ; r <= rings ; r++) {
+		if (r > 1) {
+			long long d=(long long)(r-1) << TRACKING_CELL_SHIFT;
+			if (d*d >= min)
+				break;
+		}
+		for (y = cy-r ; y <= cy+r ; y++) {
+			for (x = cx-r ; x <= cx+r ; x++) {
+				int cell;
+				if (x != cx-r && x != cx+r && y != cy-r && y != cy+r)
+					continue;
+				key.x=coord_floor_shift(x, TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT);
+				key.y=coord_floor_shift(y, TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT);
+				if (!block || block->key.x != key.x || block->key.y != key.y)
+					block=g_hash_table_lookup(tr->blocks, &key);
+				if (!block)
+					continue;
+				cell=(y-(key.y << (TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT)))*TRACKING_CELLS+
+				     (x-(key.x << (TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT)));
+				for (i = block->cell_start[cell] ; i < block->cell_start[cell+1] ; i++) {
+					struct tracking_segment *seg=&block->segments[i];
+					value=tracking_value(tr,seg->line,seg->offset,&lpnt,min,-1);
+					if (value < min) {
+						min=value;
+						best=seg->line;
+						*offset_out=seg->offset;
+						*lpnt_out=lpnt;
+					}
+				}
+			}
+		}
+	}
+	*min_out=min;
+	return best;
+}
+
+static struct tracking_hmm *
+tracking_hmm_new(int size)
+{
+	struct tracking_hmm *hmm=g_new0(struct tracking_hmm, 1);
+	hmm->size=size;
+	hmm->columns=g_new0(struct tracking_column, size);
+	return hmm;
+}
+
+static void
+tracking_hmm_destroy(struct tracking_hmm *hmm)
+{
+	if (!hmm)
+		return;
+	g_free(hmm->columns);
+	g_free(hmm);
+}
+
+static struct tracking_column *
+tracking_hmm_column(struct tracking_hmm *hmm, int idx)
+{
+	return &hmm->columns[(hmm->first+idx)%hmm->size];
+}
+
+static int
+tracking_hmm_best(struct tracking_column *col)
+{
+	int i,ret=-1;
+	for (i = 0 ; i < col->count ; i++)
+		if (ret == -1 || col->candidates[i].score > col->candidates[ret].score)
+			ret=i;
+	return ret;
+}
+
+static void
+tracking_hmm_add_candidate(struct tracking_column *col, struct tracking_line *line, int offset, struct coord *lpnt, int value)
+{
+	struct street_data *sd=line->street;
+	struct tracking_candidate *cand;
+	int i;
+
+	for (i = 0 ; i < col->count ; i++) {
+		if (item_is_equal(col->candidates[i].item, sd->item)) {
+			if (col->candidates[i].value <= value)
+				return;
+			memmove(&col->candidates[i], &col->candidates[i+1], (col->count-i-1)*sizeof(*cand));
+			col->count--;
+			break;
+		}
+	}
+	for (i = col->count ; i > 0 && col->candidates[i-1].value > value ; i--);
+	if (i >= TRACKING_HMM_CANDIDATES)
+		return;
+	if (col->count == TRACKING_HMM_CANDIDATES)
+		col->count--;
+	memmove(&col->candidates[i+1], &col->candidates[i], (col->count-i)*sizeof(*cand));
+	col->count++;
+	cand=&col->candidates[i];
+	cand->item=sd->item;
+	cand->lpnt=*lpnt;
+	cand->start=sd->c[0];
+	cand->end=sd->c[sd->count-1];
+	cand->offset=offset;
+	cand->value=value;
+	cand->line=line;
+}
+
+/* Collects the best segment of each street near tr->curr_in, ignoring the connected and no-stop terms the transitions take care of */
+static void
+tracking_hmm_find_candidates(struct tracking *tr, struct tracking_column *col)
+{
+	struct tracking_block *block;
+	struct coord key,lpnt;
+	int lx=coord_floor_shift(tr->curr_in.x-TRACKING_HMM_DIST, TRACKING_CELL_SHIFT);
+	int hx=coord_floor_shift(tr->curr_in.x+TRACKING_HMM_DIST, TRACKING_CELL_SHIFT);
+	int ly=coord_floor_shift(tr->curr_in.y-TRACKING_HMM_DIST, TRACKING_CELL_SHIFT);
+	int hy=coord_floor_shift(tr->curr_in.y+TRACKING_HMM_DIST, TRACKING_CELL_SHIFT);
+	int x,y,i,value;
+
+	col->count=0;
+	for (y = ly ; y <= hy ; y++) {
+		for (x = lx ; x <= hx ; x++) {
+			int cell;
+			key.x=coord_floor_shift(x, TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT);
+			key.y=coord_floor_shift(y, TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT);
+			block=g_hash_table_lookup(tr->blocks, &key);
+			if (!block)
+				continue;
+			cell=(y-(key.y << (TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT)))*TRACKING_CELLS+
+			     (x-(key.x << (TRACKING_BLOCK_SHIFT-TRACKING_CELL_SHIFT)));
+			for (i = block->cell_start[cell] ; i < block->cell_start[cell+1] ; i++) {
+				struct tracking_segment *seg=&block->segments[i];
+				if (tracking_value(tr, seg->line, seg->offset, &lpnt, INT_MAX/2, 1) > TRACKING_HMM_DIST*TRACKING_HMM_DIST)
+					continue;
+				value=tracking_value(tr, seg->line, seg->offset, &lpnt, INT_MAX/2, 1|2|16|32|64);
+				tracking_hmm_add_candidate(col, seg->line, seg->offset, &lpnt, value);
+			}
+		}
+	}
+}
+
+static double
+tracking_hmm_dist(struct coord *c1, struct coord *c2)
+{
+	return sqrt(transform_distance_sq_float(c1, c2));
+}
+
+/*
+ * Log probability of moving from one candidate to the next. The distance along
+ * the streets is approximated by the way through a common end point, it should
+ * be close to the distance between the fixes.
+ */
+static double
+tracking_hmm_transition(struct tracking_candidate *from, struct tracking_candidate *to, double fix_dist)
+{
+	struct coord *node=NULL;
+	double dist;
+
+	if (item_is_equal(from->item, to->item))
+		dist=tracking_hmm_dist(&from->lpnt, &to->lpnt);
+	else {
+		if (coord_equal(&from->start, &to->start) || coord_equal(&from->start, &to->end))
+			node=&from->start;
+		else if (coord_equal(&from->end, &to->start) || coord_equal(&from->end, &to->end))
+			node=&from->end;
+		if (node)
+			dist=tracking_hmm_dist(&from->lpnt, node)+tracking_hmm_dist(node, &to->lpnt);
+		else
+			dist=tracking_hmm_dist(&from->lpnt, &to->lpnt)+TRACKING_HMM_JUMP;
+	}
+	return -fabs(dist-fix_dist)/TRACKING_HMM_BETA;
+}
+
+/**
+ * @brief Adds the candidates of the fix at tr->curr_in to the lattice
+ *
+ * The oldest column is dropped if the lattice is full. The scores are set by
+ * tracking_hmm_viterbi().
+ *
+ * @param tr The tracking object, the streets around the fix have to be loaded
+ * @param hmm The lattice
+ * @param prev_pos Position of the previous fix
+ * @return The column of the fix
+ */
+static struct tracking_column *
+tracking_hmm_add(struct tracking *tr, struct tracking_hmm *hmm, struct coord *prev_pos)
+{
+	struct tracking_column *col;
+	int i;
+
+	if (hmm->count == hmm->size) {
+		hmm->first=(hmm->first+1)%hmm->size;
+		hmm->count--;
+	}
+	col=tracking_hmm_column(hmm, hmm->count++);
+	col->fix_dist=tracking_hmm_dist(prev_pos, &tr->curr_in);
+	tracking_hmm_find_candidates(tr, col);
+	for (i = 0 ; i < col->count ; i++)
+		col->candidates[i].emission=-col->candidates[i].value/(2*TRACKING_HMM_SIGMA2);
+	return col;
+}
+
+/* Scores the candidates of a column from those of the column before, the first column only by the emission */
+static void
+tracking_hmm_viterbi(struct tracking_hmm *hmm, int idx)
+{
+	struct tracking_column *prev=idx ? tracking_hmm_column(hmm, idx-1) : NULL;
+	struct tracking_column *col=tracking_hmm_column(hmm, idx);
+	double max=0;
+	int i,j;
+
+	for (i = 0 ; i < col->count ; i++) {
+		struct tracking_candidate *cand=&col->candidates[i];
+		cand->prev=-1;
+		cand->score=cand->emission;
+		for (j = 0 ; prev && j < prev->count ; j++) {
+			double score=prev->candidates[j].score+tracking_hmm_transition(&prev->candidates[j], cand, col->fix_dist)+cand->emission;
+			if (cand->prev == -1 || score > cand->score) {
+				cand->score=score;
+				cand->prev=j;
+			}
+		}
+		if (i == 0 || cand->score > max)
+			max=cand->score;
+	}
+	/* keep the scores small, only their differences matter */
+	for (i = 0 ; i < col->count ; i++)
+		col->candidates[i].score-=max;
+}
+
+/*
+ * Decodes the fixes in the lattice from the oldest one, so the match of the
+ * newest fix depends on the last hmm->size fixes only.
+ */
+static struct tracking_column *
+tracking_hmm_decode(struct tracking_hmm *hmm)
+{
+	int i;
+	for (i = 0 ; i < hmm->count ; i++)
+		tracking_hmm_viterbi(hmm, i);
+	return tracking_hmm_column(hmm, hmm->count-1);
+}
+
 
 void
 tracking_update(struct tracking *tr, struct vehicle *v, struct vehicleprofile *vehicleprofile, enum projection pro)
 {
 	struct tracking_line *t;
-	int i,value,min,time;
-	struct coord lpnt;
-	struct coord cin;
+	int i,min,time;
+	struct coord lpnt={0,0};
 	struct attr valid,speed_attr,direction_attr,coord_geo,lag,time_attr,static_speed,static_distance;
 	double speed, direction;
 	if (v)
@@ -726,6 +1252,8 @@ tracking_update(struct tracking *tr, struct vehicle *v, struct vehicleprofile *v
 		dbg(lvl_debug,"new 0x%x,0x%x\n",tr->curr_in.x, tr->curr_in.y);
 	}
 	tr->time=time;
+	if (tr->pro != pro)
+		tracking_flush(tr);
 	tr->pro=pro;
 #if 0
 
@@ -737,50 +1265,45 @@ tracking_update(struct tracking *tr, struct vehicle *v, struct vehicleprofile *v
 	tr->last_out=tr->curr_out;
 	tr->last[0]=tr->curr[0];
 	tr->last[1]=tr->curr[1];
-	if (!tr->lines || transform_distance(pro, &tr->last_updated, &tr->curr_in) > 500) {
-		dbg(lvl_debug, "update\n");
-		tracking_flush(tr);
-		tracking_doupdate_lines(tr, &tr->curr_in, pro);
-		tr->last_updated=tr->curr_in;
-		dbg(lvl_debug,"update end\n");
-	}
-	
+	tracking_doupdate_lines(tr, &tr->curr_in, pro);
+
 	tr->street_direction=0;
-	t=tr->lines;
 	tr->curr_line=NULL;
-	min=INT_MAX/2;
-	while (t) {
-		struct street_data *sd=t->street;
-		for (i = 0; i < sd->count-1 ; i++) {
-			value=tracking_value(tr,t,i,&lpnt,min,-1);
-			if (value < min) {
-				struct coord lpnt_tmp;
-				int angle_delta=tracking_angle_abs_diff(tr->curr_angle, t->angle[i], 360);
-				tr->curr_line=t;
-				tr->pos=i;
-				tr->curr[0]=sd->c[i];
-				tr->curr[1]=sd->c[i+1];
-				tr->direction_matched=t->angle[i];
-				dbg(lvl_debug,"lpnt.x=0x%x,lpnt.y=0x%x pos=%d %d+%d+%d+%d=%d\n", lpnt.x, lpnt.y, i, 
-					transform_distance_line_sq(&sd->c[i], &sd->c[i+1], &cin, &lpnt_tmp),
-					tracking_angle_delta(tr, tr->curr_angle, t->angle[i], 0)*tr->angle_pref,
-					tracking_is_connected(tr, tr->last, &sd->c[i]) ? tr->connected_pref : 0,
-					lpnt.x == tr->last_out.x && lpnt.y == tr->last_out.y ? tr->nostop_pref : 0,
-					value
-				);
-				tr->curr_out.x=lpnt.x;
-				tr->curr_out.y=lpnt.y;
-				tr->coord_geo_valid=0;
-				if (angle_delta < 70)
-					tr->street_direction=1;
-				else if (angle_delta > 110)
-					tr->street_direction=-1;
-				else
-					tr->street_direction=0;
-				min=value;
-			}
+	t=NULL;
+	if (tr->hmm) {
+		struct tracking_column *col;
+		int best;
+		tracking_hmm_add(tr, tr->hmm, &tr->last_hmm);
+		col=tracking_hmm_decode(tr->hmm);
+		best=tracking_hmm_best(col);
+		tr->last_hmm=tr->curr_in;
+		if (best != -1) {
+			t=col->candidates[best].line;
+			i=col->candidates[best].offset;
+			lpnt=col->candidates[best].lpnt;
+			min=col->candidates[best].value;
 		}
-		t=t->next;
+	}
+	if (!t)
+		t=tracking_find_best(tr, &min, &lpnt, &i);
+	if (t) {
+		struct street_data *sd=t->street;
+		int angle_delta=tracking_angle_abs_diff(tr->curr_angle, t->angle[i], 360);
+		tr->curr_line=t;
+		tr->pos=i;
+		tr->curr[0]=sd->c[i];
+		tr->curr[1]=sd->c[i+1];
+		tr->direction_matched=t->angle[i];
+		dbg(lvl_debug,"lpnt.x=0x%x,lpnt.y=0x%x pos=%d value=%d\n", lpnt.x, lpnt.y, i, min);
+		tr->curr_out.x=lpnt.x;
+		tr->curr_out.y=lpnt.y;
+		tr->coord_geo_valid=0;
+		if (angle_delta < 70)
+			tr->street_direction=1;
+		else if (angle_delta > 110)
+			tr->street_direction=-1;
+		else
+			tr->street_direction=0;
 	}
 	dbg(lvl_debug,"tr->curr_line=%p min=%d\n", tr->curr_line, min);
 	if (!tr->curr_line || min > tr->offroad_limit_pref) {
@@ -798,6 +1321,249 @@ tracking_update(struct tracking *tr, struct vehicle *v, struct vehicleprofile *v
 	callback_list_call_attr_0(tr->callback_list, attr_position_coord_geo);
 }
 
+/**
+ * @brief Predicts the position of the vehicle some time after the last fix
+ *
+ * The matched position is moved on with the last speed. On a street it follows the
+ * street's polyline in the direction of travel and stops at the end of the street,
+ * off the streets it follows the last direction. This is cheap enough to be called
+ * for every frame between two fixes.
+ *
+ * @param tr The tracking object
+ * @param ms Time since the last fix in milliseconds
+ * @param c Returns the predicted position
+ * @param dir Returns the predicted direction in degrees
+ * @return True if a prediction is available, false if the vehicle is not moving
+ */
+int
+tracking_predict(struct tracking *tr, int ms, struct coord *c, int *dir)
+{
+	struct street_data *sd;
+	double dist,len;
+	int i,next;
+
+	if (tr->valid != attr_position_valid_valid || tr->speed <= 0)
+		return 0;
+	dist=tr->speed*ms/3600.0;
+	*c=tr->curr_out;
+	if (!tr->curr_line || !tr->street_direction) {
+		*dir=tr->direction;
+		transform_project(tr->pro, &tr->curr_out, dist, *dir, c);
+		return 1;
+	}
+	sd=tr->curr_line->street;
+	i=tr->pos;
+	for (;;) {
+		if (tr->street_direction > 0) {
+			next=i+1;
+			*dir=tr->curr_line->angle[i];
+		} else {
+			next=i;
+			*dir=(tr->curr_line->angle[i]+180)%360;
+		}
+		len=transform_distance(tr->pro, c, &sd->c[next]);
+		if (dist <= len) {
+			if (len > 0) {
+				c->x+=(sd->c[next].x-c->x)*dist/len;
+				c->y+=(sd->c[next].y-c->y)*dist/len;
+			}
+			return 1;
+		}
+		dist-=len;
+		*c=sd->c[next];
+		i+=tr->street_direction;
+		if (i < 0 || i+1 >= sd->count)
+			return 1;
+	}
+}
+
+struct tracking_log_fix {
+	struct coord c;
+	double direction;	/* degrees, -1 if unknown */
+	double speed;		/* km/h */
+};
+
+static double
+tracking_nmea_degrees(char *value, char *hemisphere)
+{
+	double v=g_ascii_strtod(value, NULL);
+	double deg=floor(v/100);
+	deg+=(v-deg*100)/60;
+	if (hemisphere[0] == 'S' || hemisphere[0] == 'W')
+		deg=-deg;
+	return deg;
+}
+
+/* Parses a RMC sentence of a NMEA log or a trkpt element of a GPX file */
+static int
+tracking_log_parse_line(char *line, struct coord_geo *g, double *direction, double *speed)
+{
+	char *lat,*lon;
+
+	if (line[0] == '$' && strlen(line) > 6 && !strncmp(line+3, "RMC,", 4)) {
+		char **fields=g_strsplit(line, ",", 0);
+		int ret=0;
+		if (g_strv_length(fields) >= 9 && fields[2][0] == 'A' && fields[3][0] && fields[5][0]) {
+			g->lat=tracking_nmea_degrees(fields[3], fields[4]);
+			g->lng=tracking_nmea_degrees(fields[5], fields[6]);
+			*speed=fields[7][0] ? g_ascii_strtod(fields[7], NULL)*1.852 : 0;
+			*direction=fields[8][0] ? g_ascii_strtod(fields[8], NULL) : -1;
+			ret=1;
+		}
+		g_strfreev(fields);
+		return ret;
+	}
+	if ((line=strstr(line, "<trkpt")) && (lat=strstr(line, "lat=\"")) && (lon=strstr(line, "lon=\""))) {
+		g->lat=g_ascii_strtod(lat+5, NULL);
+		g->lng=g_ascii_strtod(lon+5, NULL);
+		*direction=-1;
+		*speed=0;
+		return 1;
+	}
+	return 0;
+}
+
+static struct tracking_log_fix *
+tracking_log_read(const char *filename, enum projection pro, int *count)
+{
+	struct tracking_log_fix *fixes=NULL;
+	struct coord_geo g;
+	char line[4096];
+	int size=0;
+	FILE *f=fopen(filename, "r");
+
+	*count=0;
+	if (!f) {
+		dbg(lvl_error,"unable to open %s\n", filename);
+		return NULL;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		struct tracking_log_fix *fix;
+		if (*count == size) {
+			size=size ? size*2 : 256;
+			fixes=g_renew(struct tracking_log_fix, fixes, size);
+		}
+		fix=&fixes[*count];
+		if (!tracking_log_parse_line(line, &g, &fix->direction, &fix->speed))
+			continue;
+		transform_from_geo(pro, &g, &fix->c);
+		if (fix->direction < 0 && *count)
+			fix->direction=transform_get_angle_delta(&fixes[*count-1].c, &fix->c, 0);
+		(*count)++;
+	}
+	fclose(f);
+	return fixes;
+}
+
+static char *
+tracking_item_label(struct item *item)
+{
+	struct map_rect *mr;
+	struct item *it;
+	struct attr attr;
+	char *ret=NULL;
+
+	if (!item->map || !(mr=map_rect_new(item->map, NULL)))
+		return NULL;
+	it=map_rect_get_item_byid(mr, item->id_hi, item->id_lo);
+	if (it && (item_attr_get(it, attr_street_name, &attr) || item_attr_get(it, attr_label, &attr)))
+		ret=map_convert_string(item->map, attr.u.str);
+	map_rect_destroy(mr);
+	return ret;
+}
+
+/**
+ * @brief Matches a recorded track to the streets of the mapset
+ *
+ * Unlike the matching during navigation, the whole track is known, so the best path
+ * through the candidates of all fixes is chosen. The output file gets one line per fix
+ * with the longitude and latitude of the matched position and the street name, or the
+ * position of the fix and "-" if there is no street nearby. This allows to compare
+ * the matching of a track before and after changes.
+ *
+ * @param tr The tracking object, its mapset and preferences are used. The matching runs
+ *           on a private copy, so the tracking during navigation is not disturbed.
+ * @param in NMEA (RMC sentences) or GPX file
+ * @param out File to write the result to
+ * @return The number of matched fixes, -1 on error
+ */
+int
+tracking_match_log(struct tracking *tr, const char *in, const char *out)
+{
+	enum projection pro=tr->pro ? tr->pro : projection_mg;
+	struct tracking_log_fix *fixes;
+	struct tracking_hmm *hmm;
+	struct tracking match;
+	int count,i,state,matched=0;
+	int *path;
+	FILE *f;
+
+	if (!tr->ms)
+		return -1;
+	fixes=tracking_log_read(in, pro, &count);
+	if (!count) {
+		g_free(fixes);
+		return -1;
+	}
+	f=fopen(out, "w");
+	if (!f) {
+		dbg(lvl_error,"unable to create %s\n", out);
+		g_free(fixes);
+		return -1;
+	}
+	/* The route of the navigation has nothing to do with the track */
+	memset(&match, 0, sizeof(match));
+	match.ms=tr->ms;
+	match.vehicleprofile=tr->vehicleprofile;
+	match.pro=pro;
+	match.angle_pref=tr->angle_pref;
+	match.connected_pref=tr->connected_pref;
+	match.nostop_pref=tr->nostop_pref;
+	match.offroad_limit_pref=tr->offroad_limit_pref;
+	match.overspeed_pref=tr->overspeed_pref;
+	match.overspeed_percent_pref=tr->overspeed_percent_pref;
+	hmm=tracking_hmm_new(count);
+	for (i = 0 ; i < count ; i++) {
+		match.curr_in=fixes[i].c;
+		match.curr_angle=fixes[i].direction < 0 ? 0 : fixes[i].direction;
+		match.speed=fixes[i].speed;
+		tracking_doupdate_lines(&match, &match.curr_in, pro);
+		tracking_hmm_add(&match, hmm, i ? &fixes[i-1].c : &fixes[i].c);
+		tracking_hmm_viterbi(hmm, i);
+	}
+
+	/* Follow the best path backwards, starting over after fixes without candidates */
+	path=g_new(int, count);
+	state=tracking_hmm_best(tracking_hmm_column(hmm, count-1));
+	for (i = count-1 ; i >= 0 ; i--) {
+		path[i]=state;
+		if (state != -1)
+			state=tracking_hmm_column(hmm, i)->candidates[state].prev;
+		if (state == -1 && i > 0)
+			state=tracking_hmm_best(tracking_hmm_column(hmm, i-1));
+	}
+	for (i = 0 ; i < count ; i++) {
+		struct coord_geo g;
+		char *label=NULL;
+		if (path[i] != -1) {
+			struct tracking_candidate *cand=&tracking_hmm_column(hmm, i)->candidates[path[i]];
+			transform_to_geo(pro, &cand->lpnt, &g);
+			label=tracking_item_label(&cand->item);
+			matched++;
+		} else
+			transform_to_geo(pro, &fixes[i].c, &g);
+		fprintf(f,"%.6f %.6f %s\n", g.lng, g.lat, label ? label : "-");
+		g_free(label);
+	}
+	fclose(f);
+	dbg(lvl_debug,"matched %d of %d fixes\n", matched, count);
+	g_free(path);
+	tracking_hmm_destroy(hmm);
+	tracking_flush(&match);
+	g_free(fixes);
+	return matched;
+}
+
 static int
 tracking_set_attr_do(struct tracking *tr, struct attr *attr, int initial)
 {
@@ -826,6 +1592,11 @@ tracking_set_attr_do(struct tracking *tr, struct attr *attr, int initial)
 	case attr_tunnel_extrapolation:
 		tr->tunnel_extrapolation=attr->u.num;
 		return 1;
+	case attr_map_matching_window:
+		tr->map_matching_window=attr->u.num;
+		tracking_hmm_destroy(tr->hmm);
+		tr->hmm=tr->map_matching_window > 0 ? tracking_hmm_new(tr->map_matching_window) : NULL;
+		return 1;
 	default:
 		return 0;
 	}
@@ -909,6 +1680,8 @@ tracking_new(struct attr *parent, struct attr **attrs)
 void
 tracking_set_mapset(struct tracking *this, struct mapset *ms)
 {
+	if (this->ms != ms)
+		tracking_flush(this);
 	this->ms=ms;
 }
 
@@ -924,6 +1697,7 @@ tracking_destroy(struct tracking *tr)
 	if (tr->attr) 
 		attr_free(tr->attr);
 	tracking_flush(tr);
+	tracking_hmm_destroy(tr->hmm);
 	callback_list_destroy(tr->callback_list);
 	g_free(tr);
 }
@@ -1137,7 +1911,7 @@ tracking_map_get_item(struct map_rect_priv *priv)
 		return NULL;
 	if (! priv->curr || priv->coord + 2 >= priv->curr->street->count) {
 		priv->curr=priv->next;
-		priv->next=priv->curr->next;
+		priv->next=priv->curr->link;
 		priv->coord=0;
 		priv->item.id_lo=0;
 		priv->item.id_hi++;
@@ -1264,7 +1264,7 @@ transform_douglas_peucker(struct coord *in, int count, int dist_sq, struct coord
 {
 	int ret=0;
 	int i,d,dmax=0, idx=0;
-	for (i = 1; i < count-2 ; i++) {
+	for (i = 1; i < count-1 ; i++) {
 		d=transform_distance_line_sq(&in[0], &in[count-1], &in[i], NULL);
 		if (d > dmax) {
 			idx=i;
@@ -1272,7 +1272,7 @@ transform_douglas_peucker(struct coord *in, int count, int dist_sq, struct coord
 		}
 	}
 	if (dmax > dist_sq) {
-		ret=transform_douglas_peucker(in, idx, dist_sq, out)-1;
+		ret=transform_douglas_peucker(in, idx+1, dist_sq, out)-1;
 		ret+=transform_douglas_peucker(in+idx, count-idx, dist_sq, out+ret);
 	} else {
 		if (count > 0)
@@ -1289,7 +1289,7 @@ transform_douglas_peucker_float(struct coord *in, int count, navit_float dist_sq
 	int ret=0;
 	int i,idx=0;
 	navit_float d,dmax=0;
-	for (i = 1; i < count-2 ; i++) {
+	for (i = 1; i < count-1 ; i++) {
 		d=transform_distance_line_sq_float(&in[0], &in[count-1], &in[i], NULL);
 		if (d > dmax) {
 			idx=i;
@@ -1297,7 +1297,7 @@ transform_douglas_peucker_float(struct coord *in, int count, navit_float dist_sq
 		}
 	}
 	if (dmax > dist_sq) {
-		ret=transform_douglas_peucker_float(in, idx, dist_sq, out)-1;
+		ret=transform_douglas_peucker_float(in, idx+1, dist_sq, out)-1;
 		ret+=transform_douglas_peucker_float(in+idx, count-idx, dist_sq, out+ret);
 	} else {
 		if (count > 0)
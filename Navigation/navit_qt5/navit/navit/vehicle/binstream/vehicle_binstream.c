@@ -0,0 +1,295 @@
+/** @file vehicle_binstream.c
+ * @brief Reads a binary position stream from a local datagram socket
+ *
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ * The vehicle binds a unix datagram socket to the path given in the source, e.g.
+ * source="binstream:/run/navit/position", and applies the records described in
+ * vehicle_binstream.h. All records waiting in the socket are decoded at once and only
+ * the newest position is reported. The socket queue is bounded by the kernel, so a
+ * sender has to keep or drop positions while navit is busy.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "debug.h"
+#include "callback.h"
+#include "plugin.h"
+#include "coord.h"
+#include "item.h"
+#include "vehicle.h"
+#include "event.h"
+#include "vehicle_binstream.h"
+
+struct vehicle_priv {
+	char *source;
+	char *path;
+	int fd;
+	struct callback_list *cbl;
+	struct callback *cb;
+	struct event_watch *watch;
+	struct coord_geo geo;
+	double speed;
+	double direction;
+	int lat,lng;
+	long long time;
+	unsigned short seq;
+	int have_key;
+	int fix_type;
+	int records;
+	int lost;
+	char fixiso8601[128];
+	struct attr **attrs;
+};
+
+static void
+vehicle_binstream_close(struct vehicle_priv *priv)
+{
+	if (priv->watch)
+		event_remove_watch(priv->watch);
+	priv->watch=NULL;
+	if (priv->fd >= 0) {
+		close(priv->fd);
+		unlink(priv->path);
+	}
+	priv->fd=-1;
+}
+
+static void
+vehicle_binstream_destroy(struct vehicle_priv *priv)
+{
+	vehicle_binstream_close(priv);
+	dbg(lvl_debug,"%d records, %d lost\n", priv->records, priv->lost);
+	if (priv->cb)
+		callback_destroy(priv->cb);
+	g_free(priv->source);
+	g_free(priv);
+}
+
+static void
+vehicle_binstream_set_common(struct vehicle_priv *priv, unsigned short speed, unsigned short direction)
+{
+	if (speed != VEHICLE_BINSTREAM_UNKNOWN)
+		priv->speed=speed*0.036;
+	if (direction != VEHICLE_BINSTREAM_UNKNOWN)
+		priv->direction=direction/100.0;
+}
+
+/* A datagram, received in place so that the records are aligned */
+union vehicle_binstream_record {
+	unsigned char type;
+	struct vehicle_binstream_key key;
+	struct vehicle_binstream_delta delta;
+	unsigned char buffer[64];
+};
+
+/* Counts the records missing before seq, but not repeated or older ones */
+static void
+vehicle_binstream_count_lost(struct vehicle_priv *priv, unsigned short seq)
+{
+	unsigned short gap=seq-priv->seq-1;
+	if (gap < 0x8000)
+		priv->lost+=gap;
+}
+
+/**
+ * @brief Applies one record
+ *
+ * @param priv The vehicle
+ * @param record The record
+ * @param len Length of the datagram
+ * @return 1 if the position changed, 0 if the record was ignored
+ */
+static int
+vehicle_binstream_record(struct vehicle_priv *priv, union vehicle_binstream_record *record, int len)
+{
+	if (len == sizeof(struct vehicle_binstream_key) && record->type == VEHICLE_BINSTREAM_KEY) {
+		struct vehicle_binstream_key *key=&record->key;
+		if (priv->have_key)
+			vehicle_binstream_count_lost(priv, key->seq);
+		priv->lat=key->lat;
+		priv->lng=key->lng;
+		priv->time=key->time;
+		priv->seq=key->seq;
+		priv->have_key=1;
+		vehicle_binstream_set_common(priv, key->speed, key->direction);
+		return 1;
+	}
+	if (len == sizeof(struct vehicle_binstream_delta) && record->type == VEHICLE_BINSTREAM_DELTA) {
+		struct vehicle_binstream_delta *delta=&record->delta;
+		if (!priv->have_key || delta->seq != (unsigned short)(priv->seq+1)) {
+			if (priv->have_key)
+				vehicle_binstream_count_lost(priv, delta->seq);
+			priv->have_key=0;
+			return 0;
+		}
+		priv->lat+=delta->lat;
+		priv->lng+=delta->lng;
+		priv->time+=delta->time;
+		priv->seq=delta->seq;
+		vehicle_binstream_set_common(priv, delta->speed, delta->direction);
+		return 1;
+	}
+	dbg(lvl_warning,"invalid record of %d bytes\n", len);
+	return 0;
+}
+
+static void
+vehicle_binstream_io(struct vehicle_priv *priv)
+{
+	union vehicle_binstream_record record;
+	int len,changed=0;
+
+	while ((len=recv(priv->fd, &record, sizeof(record), MSG_DONTWAIT)) > 0) {
+		priv->records++;
+		changed|=vehicle_binstream_record(priv, &record, len);
+	}
+	if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		dbg(lvl_error,"recv from %s failed: %s\n", priv->path, strerror(errno));
+	if (!changed)
+		return;
+	priv->geo.lat=priv->lat/1e7;
+	priv->geo.lng=priv->lng/1e7;
+	priv->fix_type=1;
+	callback_list_call_attr_0(priv->cbl, attr_position_coord_geo);
+}
+
+static int
+vehicle_binstream_open(struct vehicle_priv *priv)
+{
+	struct sockaddr_un addr;
+
+	if (strlen(priv->path) >= sizeof(addr.sun_path)) {
+		dbg(lvl_error,"socket path %s is too long\n", priv->path);
+		return 0;
+	}
+	priv->fd=socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (priv->fd < 0) {
+		dbg(lvl_error,"unable to create socket: %s\n", strerror(errno));
+		return 0;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path, priv->path);
+	unlink(priv->path);
+	if (bind(priv->fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		dbg(lvl_error,"unable to bind to %s: %s\n", priv->path, strerror(errno));
+		close(priv->fd);
+		priv->fd=-1;
+		return 0;
+	}
+	priv->cb=callback_new_1(callback_cast(vehicle_binstream_io), priv);
+	priv->watch=event_add_watch(priv->fd, event_watch_cond_read, priv->cb);
+	return 1;
+}
+
+static int
+vehicle_binstream_position_attr_get(struct vehicle_priv *priv,
+			       enum attr_type type, struct attr *attr)
+{
+	struct attr *active=NULL;
+	switch (type) {
+	case attr_position_fix_type:
+		attr->u.num = priv->fix_type;
+		break;
+	case attr_position_speed:
+		attr->u.numd = &priv->speed;
+		break;
+	case attr_position_direction:
+		attr->u.numd = &priv->direction;
+		break;
+	case attr_position_coord_geo:
+		attr->u.coord_geo = &priv->geo;
+		if (!priv->fix_type)
+			return 0;
+		break;
+	case attr_position_time_iso8601:
+		{
+		struct tm tm;
+		time_t fix_time=priv->time/1000;
+		if (!priv->time)
+			return 0;
+		if (gmtime_r(&fix_time, &tm)) {
+			strftime(priv->fixiso8601, sizeof(priv->fixiso8601),
+				"%Y-%m-%dT%TZ", &tm);
+			attr->u.str=priv->fixiso8601;
+		} else
+			return 0;
+		}
+		break;
+	case attr_active:
+		active = attr_search(priv->attrs,NULL,attr_active);
+		if (active != NULL) {
+			attr->u.num=active->u.num;
+			return 1;
+		} else
+			return 0;
+	default:
+		return 0;
+	}
+	attr->type = type;
+	return 1;
+}
+
+static struct vehicle_methods vehicle_binstream_methods = {
+	vehicle_binstream_destroy,
+	vehicle_binstream_position_attr_get,
+};
+
+static struct vehicle_priv *
+vehicle_binstream_new(struct vehicle_methods *meth,
+		struct callback_list *cbl,
+		struct attr **attrs)
+{
+	struct vehicle_priv *ret;
+	struct attr *source;
+
+	dbg(lvl_debug, "enter\n");
+	source = attr_search(attrs, NULL, attr_source);
+	if (!source || strncmp(source->u.str, "binstream:", 10) || !source->u.str[10]) {
+		dbg(lvl_error,"source must be binstream:<path>\n");
+		return NULL;
+	}
+	ret = g_new0(struct vehicle_priv, 1);
+	ret->source = g_strdup(source->u.str);
+	ret->path = ret->source+10;
+	ret->fd = -1;
+	ret->cbl = cbl;
+	ret->attrs = attrs;
+	if (!vehicle_binstream_open(ret)) {
+		vehicle_binstream_destroy(ret);
+		return NULL;
+	}
+	*meth = vehicle_binstream_methods;
+	dbg(lvl_debug, "listening on %s\n", ret->path);
+	return ret;
+}
+
+void
+plugin_init(void)
+{
+	dbg(lvl_debug, "enter\n");
+	plugin_register_vehicle_type("binstream", vehicle_binstream_new);
+}
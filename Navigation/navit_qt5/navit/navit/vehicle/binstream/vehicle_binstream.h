@@ -0,0 +1,64 @@
+/**
+ * Navit, a modular navigation system.
+ * Copyright (C) 2005-2015 Navit Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NAVIT_VEHICLE_BINSTREAM_H
+#define NAVIT_VEHICLE_BINSTREAM_H
+
+/*
+ * Records of the position stream read by vehicle_binstream.
+ *
+ * Every datagram carries one record. A key record has the absolute position, a delta
+ * record the difference to the record before it. A sender starts with a key record,
+ * sends one at least every VEHICLE_BINSTREAM_KEY_INTERVAL records and whenever a difference
+ * does not fit or a record was not sent. The receiver ignores delta records whose
+ * sequence number does not follow the previous record until the next key record.
+ * Sender and receiver run on the same machine, so everything is in host byte order.
+ */
+
+#define VEHICLE_BINSTREAM_KEY 1
+#define VEHICLE_BINSTREAM_DELTA 2
+
+#define VEHICLE_BINSTREAM_KEY_INTERVAL 10
+
+/* Value of speed and direction if they are not known */
+#define VEHICLE_BINSTREAM_UNKNOWN 0xffff
+
+struct vehicle_binstream_key {
+	unsigned char type;		/**< VEHICLE_BINSTREAM_KEY */
+	unsigned char reserved;
+	unsigned short seq;		/**< Increased by one for every record */
+	int lat;			/**< Latitude in 1e-7 degrees */
+	int lng;			/**< Longitude in 1e-7 degrees */
+	unsigned short speed;		/**< Speed in cm/s */
+	unsigned short direction;	/**< Direction in 1/100 degrees, clockwise from north */
+	long long time;			/**< Time of the fix in ms since the epoch */
+};
+
+struct vehicle_binstream_delta {
+	unsigned char type;		/**< VEHICLE_BINSTREAM_DELTA */
+	unsigned char reserved;
+	unsigned short seq;
+	short lat;			/**< Difference to the previous latitude in 1e-7 degrees */
+	short lng;			/**< Difference to the previous longitude in 1e-7 degrees */
+	unsigned short time;		/**< Time since the previous record in ms */
+	unsigned short speed;
+	unsigned short direction;
+};
+
+#endif
@@ -105,6 +105,8 @@ struct vehicle_priv {
 	int sats_visible;
 	int sats_signal;
 	int time;
+	int time_warp;
+	double last_fixtime;
 	int on_eof;
 #ifdef _WIN32
 	int no_data_count;
@@ -356,6 +358,40 @@ vehicle_file_close(struct vehicle_priv *priv)
     }
 }
 
+/**
+ * @brief Computes the delay before the next fix of a replayed file is read
+ *
+ * Without a time warp every fix is delayed by the configured time. With a time warp
+ * the delay is the difference between the UTC times of this and the previous fix,
+ * divided by the warp factor, so a recorded trip is replayed at a fixed multiple of
+ * its original pace. Fixes without a usable time fall back to time / time_warp.
+ *
+ * @param priv The vehicle
+ * @return The delay in milliseconds
+ */
+static int
+vehicle_file_replay_delay(struct vehicle_priv *priv)
+{
+	double fixtime,delta;
+	int hours,minutes;
+
+	if (priv->time_warp <= 0)
+		return priv->time;
+	delta=-1;
+	if (sscanf(priv->fixtime, "%2d%2d", &hours, &minutes) == 2 && strlen(priv->fixtime) >= 6) {
+		fixtime=hours*3600+minutes*60+g_ascii_strtod(priv->fixtime+4, NULL);
+		if (priv->last_fixtime >= 0) {
+			delta=fixtime-priv->last_fixtime;
+			if (delta < -43200)
+				delta+=86400;
+		}
+		priv->last_fixtime=fixtime;
+	}
+	if (delta < 0)
+		return priv->time/priv->time_warp;
+	return delta*1000/priv->time_warp;
+}
+
 //***************************************************************************
 /** @fn static int vehicle_file_enable_watch_timer(struct vehicle_priv *priv)
 *****************************************************************************
@@ -496,7 +532,7 @@ vehicle_file_parse(struct vehicle_priv *priv, char *buffer)
 		if (priv->file_type == file_type_file) {
 			if (priv->watch) {
 				vehicle_file_disable_watch(priv);
-				event_add_timeout(priv->time, 0, priv->cbt);
+				event_add_timeout(vehicle_file_replay_delay(priv), 0, priv->cbt);
 			}
 		}
 	}
@@ -946,6 +982,7 @@ vehicle_file_new_file(struct vehicle_methods
 	struct vehicle_priv *ret;
 	struct attr *source;
 	struct attr *time;
+	struct attr *time_warp;
 	struct attr *on_eof;
 	struct attr *baudrate;
 	struct attr *checksum_ignore;
@@ -971,6 +1008,10 @@ vehicle_file_new_file(struct vehicle_methods
 	time = attr_search(attrs, NULL, attr_time);
 	if (time)
 		ret->time=time->u.num;
+	ret->last_fixtime=-1;
+	time_warp = attr_search(attrs, NULL, attr_time_warp);
+	if (time_warp)
+		ret->time_warp=time_warp->u.num;
 	baudrate = attr_search(attrs, NULL, attr_baudrate);
 	if (baudrate) {
 		switch (baudrate->u.num) {
@@ -51,12 +51,16 @@
 #include "vehicleprofile.h"
 #include "callback.h"
 #include "config_.h"
+#include "configcache.h"
 
 #if (defined __MINGW32__) || (defined _MSC_VER)
 /* This only works if a is a string constant, i.e. "name" */
 #define unsetenv(a) putenv(a "=")
 #endif
 
+/** Maximum nesting of documents through xi:include, including the config file itself */
+#define XML_DOCUMENT_MAX_LEVEL 17
+
 struct xistate {
 	struct xistate *parent;
 	struct xistate *child;
@@ -89,6 +93,11 @@ struct xmlstate {
 };
 
 
+/** Config file being recorded into the cache, if any */
+static struct config_cache *config_cache_recording;
+/** Name of the config cache, set with config_set_cache() */
+static char *config_cache_filename;
+
 struct attr_fixme {
 	char *element;
 	char **attr_fixme;
@@ -718,7 +727,7 @@ xinclude(xml_context *context, const gchar **attribute_names, const gchar **attr
 	const char *href=NULL;
 	char **we_files;
 
-	if (doc_old->level >= 16) {
+	if (doc_old->level >= XML_DOCUMENT_MAX_LEVEL-1) {
 		g_set_error(error,G_MARKUP_ERROR,G_MARKUP_ERROR_INVALID_CONTENT, "xi:include recursion too deep");
 		return;
 	}
@@ -765,6 +774,11 @@ xinclude(xml_context *context, const gchar **attribute_names, const gchar **attr
 		we_files=file_wordexp_get_array(we);
 		count=file_wordexp_get_count(we);
 		dbg(lvl_debug,"%d results\n", count);
+		if (config_cache_recording) {
+			config_cache_add_wordexp(config_cache_recording, href, we_files, count);
+			if (!file_exists(we_files[0]))
+				config_cache_add_file(config_cache_recording, we_files[0]);
+		}
 		if (file_exists(we_files[0])) {
 			for (i = 0 ; i < count ; i++) {
 				dbg(lvl_debug,"result[%d]='%s'\n", i, we_files[i]);
@@ -956,6 +970,8 @@ xi_start_element(xml_context *context,
 			xinclude(context, xistate->attribute_names, xistate->attribute_values, doc, error);
 			return;
 		}
+		if (config_cache_recording)
+			config_cache_add_start(config_cache_recording, element_name, xistate->attribute_names, xistate->attribute_values);
 		start_element(context, element_name, xistate->attribute_names, xistate->attribute_values, doc->user_data, error);
 		doc->active++;
 	}
@@ -989,6 +1005,8 @@ xi_end_element (xml_context *context,
 		if(!g_ascii_strcasecmp("xi:include", element_name)) {
 			return;
 		}
+		if (config_cache_recording)
+			config_cache_add_end(config_cache_recording, element_name);
 		end_element(context, element_name, doc->user_data, error);
 		doc->active--;
 	}
@@ -1002,6 +1020,25 @@ xi_end_element (xml_context *context,
 	g_free(xistate);
 }
 
+/* Adds character data to the current element */
+/* text is not nul-terminated */
+static void
+text_element(const gchar *text, gsize text_len, struct xmlstate **state)
+{
+	struct xmlstate *curr;
+	struct attr attr;
+	char *text_dup = malloc(text_len+1);
+
+	curr=*state;
+	strncpy(text_dup, text, text_len);
+	text_dup[text_len]='\0';
+	attr.type=attr_xml_text;
+	attr.u.str=text_dup;
+	if (curr->object_func && curr->object_func->add_attr && curr->element_attr.u.data)
+		curr->object_func->add_attr(curr->element_attr.u.data, &attr);
+	free(text_dup);
+}
+
 /* Called for character data */
 /* text is not nul-terminated */
 static void
@@ -1016,19 +1053,9 @@ xi_text (xml_context *context,
 	if (doc->active) {
 		for (i = 0 ; i < text_len ; i++) {
 			if (!isspace(text[i])) {
-				struct xmldocument *doc=user_data;
-				struct xmlstate *curr, **state = doc->user_data;
-				struct attr attr;
-				char *text_dup = malloc(text_len+1);
-
-				curr=*state;
-				strncpy(text_dup, text, text_len);
-				text_dup[text_len]='\0';
-				attr.type=attr_xml_text;
-				attr.u.str=text_dup;
-				if (curr->object_func && curr->object_func->add_attr && curr->element_attr.u.data)
-					curr->object_func->add_attr(curr->element_attr.u.data, &attr);
-				free(text_dup);
+				if (config_cache_recording)
+					config_cache_add_text(config_cache_recording, text, text_len);
+				text_element(text, text_len, doc->user_data);
 				return;
 			}
 		}
@@ -1088,6 +1115,46 @@ xml_parse_text(const char *document, void *data,
 }
 
 
+/* XMLDIR and XMLFILE of the including document, restored once an included one is done */
+struct xmlenv {
+	char *xmldir;
+	char *xmlfile;
+};
+
+static void
+xmlenv_enter(struct xmlenv *env, const char *href)
+{
+	char *xmldir,*sep;
+
+	env->xmldir=g_strdup(getenv("XMLDIR"));
+	env->xmlfile=g_strdup(getenv("XMLFILE"));
+	xmldir=g_strdup(href);
+	if ((sep=strrchr(xmldir,'/')))
+		*sep='\0';
+	else {
+		g_free(xmldir);
+		xmldir=g_strdup(".");
+	}
+	setenv("XMLDIR",xmldir,1);
+	setenv("XMLFILE",href,1);
+	g_free(xmldir);
+}
+
+static void
+xmlenv_leave(struct xmlenv *env)
+{
+	if (env->xmldir)
+		setenv("XMLDIR",env->xmldir,1);
+	else
+		unsetenv("XMLDIR");
+	if (env->xmlfile)
+		setenv("XMLFILE",env->xmlfile,1);
+	else
+		unsetenv("XMLFILE");
+	g_free(env->xmldir);
+	g_free(env->xmlfile);
+}
+
 #if !USE_EZXML
 
 static const GMarkupParser parser = {
@@ -1113,7 +1180,7 @@ parse_file(struct xmldocument *document, xmlerror **error)
 	gsize len;
 	gint line, chr;
 	gboolean result;
-	char *xmldir,*newxmldir,*xmlfile,*newxmlfile,*sep;
+	struct xmlenv env;
 
 	dbg(lvl_debug,"enter filename='%s'\n", document->href);
 #if GLIB_MAJOR_VERSION == 2 && GLIB_MINOR_VERSION < 12
@@ -1125,18 +1192,11 @@ parse_file(struct xmldocument *document, xmlerror **error)
 		g_markup_parse_context_free (context);
 		return FALSE;
 	}
-	xmldir=getenv("XMLDIR");
-	xmlfile=getenv("XMLFILE");
-	newxmlfile=g_strdup(document->href);
-	newxmldir=g_strdup(document->href);
-	if ((sep=strrchr(newxmldir,'/'))) 
-		*sep='\0';
-	else {
-		g_free(newxmldir);
-		newxmldir=g_strdup(".");
+	if (config_cache_recording) {
+		config_cache_add_file(config_cache_recording, document->href);
+		config_cache_add_document(config_cache_recording, document->href);
 	}
-	setenv("XMLDIR",newxmldir,1);
-	setenv("XMLFILE",newxmlfile,1);
+	xmlenv_enter(&env, document->href);
 	document->active=document->xpointer ? 0:1;
 	document->first=NULL;
 	document->last=NULL;
@@ -1149,16 +1209,9 @@ parse_file(struct xmldocument *document, xmlerror **error)
 	}
 	g_markup_parse_context_free (context);
 	g_free (contents);
-	if (xmldir)
-		setenv("XMLDIR",xmldir,1);	
-	else
-		unsetenv("XMLDIR");
-	if (xmlfile)
-		setenv("XMLFILE",xmlfile,1);
-	else
-		unsetenv("XMLFILE");
-	g_free(newxmldir);
-	g_free(newxmlfile);
+	xmlenv_leave(&env);
+	if (config_cache_recording)
+		config_cache_add_document_end(config_cache_recording);
 	dbg(lvl_debug,"return %d\n", result);
 
 	return result;
@@ -1187,6 +1240,8 @@ parse_file(struct xmldocument *document, xmlerror **error)
 	f=fopen(document->href,"rb");
 	if (!f)
 		return FALSE;
+	if (config_cache_recording)
+		config_cache_add_file(config_cache_recording, document->href);
 	root = ezxml_parse_fp(f);
 	fclose(f);
 	if (!root)
@@ -1201,6 +1256,71 @@ parse_file(struct xmldocument *document, xmlerror **error)
 }
 #endif
 
+/**
+ * * Rebuild the configuration from the events of a config cache
+ * *
+ * * @param cc the opened cache
+ * * @param state ptr to the current xmlstate
+ * * @param error ptr to error details, if any
+ * * @returns boolean TRUE or FALSE (if error detected)
+ * */
+
+static gboolean
+config_load_cache(struct config_cache *cc, struct xmlstate **state, xmlerror **error)
+{
+	struct config_cache_event event;
+	struct xmlenv env[XML_DOCUMENT_MAX_LEVEL];
+	int level=0;
+	gboolean result=TRUE;
+
+	while (result && config_cache_next(cc, &event)) {
+		switch (event.type) {
+		case config_cache_event_document:
+			if (level >= XML_DOCUMENT_MAX_LEVEL) {
+				g_set_error(error,G_MARKUP_ERROR,G_MARKUP_ERROR_INVALID_CONTENT, "xi:include recursion too deep");
+				result=FALSE;
+				break;
+			}
+			xmlenv_enter(&env[level++], event.name);
+			break;
+		case config_cache_event_document_end:
+			if (level > 0)
+				xmlenv_leave(&env[--level]);
+			break;
+		case config_cache_event_start:
+			start_element(NULL, event.name, event.attribute_names, event.attribute_values, state, error);
+			break;
+		case config_cache_event_end:
+			end_element(NULL, event.name, state, error);
+			break;
+		case config_cache_event_text:
+			text_element(event.text, event.text_len, state);
+			break;
+		default:
+			break;
+		}
+		if (error && *error)
+			result=FALSE;
+	}
+	while (level > 0)
+		xmlenv_leave(&env[--level]);
+	return result;
+}
+
+/**
+ * * Set the file used to cache the parsed config file
+ * *
+ * * @param filename FQFN of the cache, NULL to disable the cache
+ * * @returns nothing
+ * */
+
+void
+config_set_cache(const char *filename)
+{
+	g_free(config_cache_filename);
+	config_cache_filename=g_strdup(filename);
+}
+
 /**
  * * Load and parse the master config file
  * *
@@ -1213,6 +1333,7 @@ gboolean config_load(const char *filename, xmlerror **error)
 {
 	struct xmldocument document;
 	struct xmlstate *curr=NULL;
+	struct config_cache *cc=NULL;
 	gboolean result;
 
 	attr_create_hash();
@@ -1223,11 +1344,28 @@ gboolean config_load(const char *filename, xmlerror **error)
 	memset(&document, 0, sizeof(document));
 	document.href=filename;
 	document.user_data=&curr;
-	result=parse_file(&document, error);
+	if (config_cache_filename)
+		cc=config_cache_open(config_cache_filename, filename);
+	if (cc) {
+		dbg(lvl_info,"using config cache '%s'\n", config_cache_filename);
+		result=config_load_cache(cc, &curr, error);
+	} else {
+		if (config_cache_filename)
+			config_cache_recording=config_cache_new(filename);
+		result=parse_file(&document, error);
+	}
 	if (result && curr) {
 		g_set_error(error,G_MARKUP_ERROR,G_MARKUP_ERROR_PARSE, "element '%s' not closed", curr->element);
 		result=FALSE;
 	}
+	if (config_cache_recording) {
+		if (result)
+			config_cache_write(config_cache_recording, config_cache_filename);
+		config_cache_destroy(config_cache_recording);
+		config_cache_recording=NULL;
+	}
+	if (cc)
+		config_cache_destroy(cc);
 	attr_destroy_hash();
 	item_destroy_hash();
 	dbg(lvl_debug,"return %d\n", result);
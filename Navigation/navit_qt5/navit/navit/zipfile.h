@@ -167,6 +167,81 @@ struct zip64_eocl {
 	int zip74lnum;
 } ATTRIBUTE_PACKED;
 
+#define binfile_delta_magic "NAVDELTA"
+#define binfile_delta_version 2
+#define binfile_delta_flag_zip64 1
+
+//! Header of a tile level map update as written by "maptool --delta".
+
+//! The header is followed by one struct binfile_delta_entry (plus the
+//! central directory record it describes) for every member of the
+//! updated map and finally by the local file records of all members
+//! which are not already present in the base map. Members taken from the
+//! base map are looked up by name, so a delta applies to any map holding
+//! the same members, no matter where they are stored.
+struct binfile_delta_header {
+	char magic[8];           //!< binfile_delta_magic
+	int version;             //!< binfile_delta_version
+	int flags;               //!< binfile_delta_flag_* values
+	long long base_size;     //!< 0, set by navit to the size of the installed map when it starts applying the delta
+	int members;             //!< number of members of the updated map
+	long long cd_size;       //!< size of the central directory of the updated map
+	long long payload_size;  //!< size of the member data following the directory
+} ATTRIBUTE_PACKED;
+
+#define binfile_delta_source_base 0
+#define binfile_delta_source_delta 1
+
+//! Location of one member of the updated map, followed by its central directory record.
+struct binfile_delta_entry {
+	int source;              //!< binfile_delta_source_base or binfile_delta_source_delta
+	long long offset;        //!< offset of the local file header within the delta payload, 0 for members of the base map
+} ATTRIBUTE_PACKED;
+
+#define binfile_nameindex_member "nameindex"
+#define binfile_nameindex_magic "NAVNAMES"
+#define binfile_nameindex_version 1
+
+//! Header of the name search index member written by maptool.
+
+//! The header is followed by the arrays it describes, in this order:
+//! keys (sorted by type, country and name), postings (grouped by key, in
+//! the order the items were written), trigrams (sorted bytewise), trigram
+//! references (key numbers, ascending per trigram) and the string pool
+//! holding the casefolded names.
+struct binfile_nameindex_header {
+	char magic[8];           //!< binfile_nameindex_magic
+	int version;             //!< binfile_nameindex_version
+	int keys;                //!< number of struct binfile_nameindex_key
+	int postings;            //!< number of struct binfile_nameindex_posting
+	int trigrams;            //!< number of struct binfile_nameindex_trigram
+	int trigram_refs;        //!< number of key numbers referenced by trigrams
+	int strings_size;        //!< size of the string pool
+} ATTRIBUTE_PACKED;
+
+//! One casefolded name and the items carrying it.
+struct binfile_nameindex_key {
+	int type;                //!< attr_town_name or attr_street_name
+	int country;             //!< country id for towns, 0 for streets
+	int name;                //!< offset of the name within the string pool
+	int posting;             //!< number of the first posting
+	int count;               //!< number of postings
+} ATTRIBUTE_PACKED;
+
+//! Reference to an item within a tile, plus its bounding box.
+struct binfile_nameindex_posting {
+	int zipfile;             //!< zip member the item is stored in
+	int offset;              //!< offset of the item within the member, in 32 bit words
+	int minx,miny,maxx,maxy; //!< bounding box of the item
+} ATTRIBUTE_PACKED;
+
+//! List of keys whose name contains a three byte sequence.
+struct binfile_nameindex_trigram {
+	char trigram[4];         //!< the bytes, padded with 0
+	int ref;                 //!< number of the first trigram reference
+	int count;               //!< number of trigram references
+} ATTRIBUTE_PACKED;
+
 struct zip_alignment_check {
 	int x[sizeof(struct zip_cd) == 46 ? 1:-1];
 };